@@ -18,6 +18,7 @@
 #include <atheme/authcookie.h>
 #include <atheme/base64.h>
 #include <atheme/bcrypt.h>
+#include <atheme/bitmap.h>
 #include <atheme/botserv.h>
 #include <atheme/channels.h>
 #include <atheme/commandhelp.h>
@@ -43,6 +44,7 @@
 #include <atheme/i18n.h>
 #include <atheme/inline.h>
 #include <atheme/instpaths.h>
+#include <atheme/latency.h>
 #include <atheme/linker.h>
 #include <atheme/match.h>
 #include <atheme/memory.h>
@@ -53,13 +55,15 @@
 #include <atheme/pmodule.h>
 #include <atheme/privs.h>
 #include <atheme/random.h>
+#include <atheme/replyq.h>
 #include <atheme/sasl.h>
 #include <atheme/scrypt.h>
 #include <atheme/serno.h>
 #include <atheme/servers.h>
 #include <atheme/services.h>
 #include <atheme/servtree.h>
-#include <atheme/sharedheap.h>
+#include <atheme/slab.h>
+#include <atheme/stall.h>
 #include <atheme/sourceinfo.h>
 #include <atheme/stdheaders.h>
 #include <atheme/string.h>
@@ -67,6 +71,7 @@
 #include <atheme/table.h>
 #include <atheme/taint.h>
 #include <atheme/template.h>
+#include <atheme/timerwheel.h>
 #include <atheme/tools.h>
 #include <atheme/uid.h>
 #include <atheme/uplink.h>
@@ -16,9 +16,10 @@
 #include <atheme/stdheaders.h>
 #include <atheme/structures.h>
 
-/* kline list struct */
+/* kline list struct; the strings are stored right after it */
 struct kline
 {
+	mowgli_node_t   node;           // in klnlist
 	char *          user;
 	char *          host;
 	char *          reason;
@@ -27,11 +28,24 @@ struct kline
 	long            duration;
 	time_t          settime;
 	time_t          expires;
+	mowgli_node_t   pending_node;   // in the klines kline_add_bulk() has yet to send
+	bool            pending;
 };
 
-/* xline list struct */
+/* kline_add_bulk() input */
+struct kline_bulk_entry
+{
+	const char *    user;
+	const char *    host;
+	const char *    reason;
+	const char *    setby;
+	long            duration;
+};
+
+/* xline list struct; the strings are stored right after it */
 struct xline
 {
+	mowgli_node_t   node;           // in xlnlist
 	char *          realname;
 	char *          reason;
 	char *          setby;
@@ -41,9 +55,10 @@ struct xline
 	time_t          expires;
 };
 
-/* qline list struct */
+/* qline list struct; the strings are stored right after it */
 struct qline
 {
+	mowgli_node_t   node;           // in qlnlist
 	char *          mask;
 	char *          reason;
 	char *          setby;
@@ -63,6 +78,13 @@ struct svsignore
 	char *                  reason;
 };
 
+/* position of a record in one of the expiry queues (see expire_check()) */
+struct expiry_entry
+{
+	time_t  due;    // next time the record has to be looked at
+	size_t  pos;    // 1-based heap index, 0 if not queued
+};
+
 /* services accounts */
 struct myuser
 {
@@ -74,7 +96,7 @@ struct myuser
 	time_t                  registered;
 	time_t                  lastlogin;
 	struct soper *          soper;
-	unsigned int            flags;
+	unsigned int            flags;                  // change with myuser_set_flags()
 	mowgli_list_t           memos;                  // store memos
 	unsigned int            memoct_new;
 	unsigned int            memo_ratelimit_num;     // memos sent recently
@@ -84,6 +106,10 @@ struct myuser
 	mowgli_list_t           nicks;                  // registered nicks, must include mu->name if nonempty
 	struct language *       language;
 	mowgli_list_t           cert_fingerprints;
+	struct expiry_entry     expiry;
+	mowgli_node_t           email_node;             // for the email_canonical reverse index
+	mowgli_list_t           vhosts;                 // our entries in the vhost reverse index
+	uint32_t                flagslot;               // position in the flag indexes
 };
 
 /* Keep this synchronized with mu_flags in libathemecore/flags.c */
@@ -120,6 +146,7 @@ struct mynick
 	time_t                  registered;
 	time_t                  lastseen;
 	mowgli_node_t           node;   // for struct myuser -> nicks
+	struct expiry_entry     expiry;
 };
 
 /* record about a name that used to exist */
@@ -148,7 +175,9 @@ struct mychan
 	unsigned int            mlock_off;
 	unsigned int            mlock_limit;
 	char *                  mlock_key;
-	unsigned int            flags;
+	unsigned int            flags;                  // change with mychan_set_flags()
+	struct expiry_entry     expiry;
+	uint32_t                flagslot;               // position in the flag indexes
 };
 
 /* Keep this synchronized with mc_flags in libathemecore/flags.c */
@@ -175,6 +204,9 @@ struct mychan
 
 #define MC_VERBOSE_MASK (MC_VERBOSE | MC_VERBOSE_OPS)
 
+/* Temporary state changes too often to be worth indexing */
+#define MC_INDEXED_MASK (~(MC_INHABIT | MC_MLOCK_CHECK | MC_FORCEVERBOSE | MC_RECREATED))
+
 /* struct for channel access list */
 struct chanacs
 {
@@ -309,6 +341,7 @@ enum db_save_strategy
 };
 
 extern void (*db_save)(void *arg, enum db_save_strategy strategy);
+extern struct latency_histogram db_save_latency; // filled in by the backend, however it writes
 extern void (*db_load)(const char *arg);
 
 /* function.c */
@@ -320,6 +353,7 @@ extern mowgli_list_t klnlist;
 struct kline *kline_add_with_id(const char *user, const char *host, const char *reason, long duration, const char *setby, unsigned long id);
 struct kline *kline_add(const char *user, const char *host, const char *reason, long duration, const char *setby);
 struct kline *kline_add_user(struct user *user, const char *reason, long duration, const char *setby);
+size_t kline_add_bulk(const struct kline_bulk_entry *entries, size_t count);
 void kline_delete(struct kline *k);
 struct kline *kline_find(const char *user, const char *host);
 struct kline *kline_find_num(unsigned long number);
@@ -360,6 +394,12 @@ void myuser_delete(struct myuser *mu);
 void myuser_rename(struct myuser *mu, const char *name);
 void myuser_set_email(struct myuser *mu, const char *newemail);
 struct myuser *myuser_find_ext(const char *name);
+const mowgli_list_t *myuser_find_by_email(const char *email);
+const mowgli_list_t *myuser_find_by_email_canonical(stringref email_canonical);
+const mowgli_list_t *myuser_find_by_vhost(const char *vhost);
+void myuser_set_flags(struct myuser *mu, unsigned int flags);
+unsigned int myuser_count_with_flags(unsigned int flagset);
+void myuser_foreach_with_flags(unsigned int flagset, int (*cb)(struct myuser *mu, void *privdata), void *privdata);
 void myuser_notice(const char *from, struct myuser *target, const char *fmt, ...) ATHEME_FATTR_PRINTF(3, 4);
 
 bool myuser_access_verify(struct user *u, struct myuser *mu);
@@ -380,6 +420,9 @@ struct mycertfp *mycertfp_find(const char *certfp);
 
 struct mychan *mychan_add(char *name);
 //inline struct mychan *mychan_find(const char *name);
+void mychan_set_flags(struct mychan *mc, unsigned int flags);
+unsigned int mychan_count_with_flags(unsigned int flagset);
+void mychan_foreach_with_flags(unsigned int flagset, int (*cb)(struct mychan *mc, void *privdata), void *privdata);
 bool mychan_isused(struct mychan *mc);
 unsigned int mychan_num_founders(struct mychan *mc);
 const char *mychan_founder_names(struct mychan *mc);
@@ -0,0 +1,58 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Compressed bitmaps of small integers.
+ */
+
+#ifndef ATHEME_INC_BITMAP_H
+#define ATHEME_INC_BITMAP_H 1
+
+#include <atheme/stdheaders.h>
+
+/* Values are split into a 16-bit container key and a 16-bit low part.
+ * A container holds its low parts as a sorted array while it is sparse
+ * and switches to a plain 65536-bit bitmap once that is smaller, so a
+ * bitmap costs about two bytes per member at worst and sets can be
+ * counted and intersected a container at a time.
+ */
+struct bitmap_container
+{
+	uint16_t                key;
+	unsigned int            card;
+	unsigned int            cap;            // of array
+	uint16_t *              array;          // sorted, NULL once words is used
+	uint64_t *              words;
+};
+
+struct bitmap
+{
+	struct bitmap_container *containers;
+	size_t                  count;
+	size_t                  size;
+	size_t                  card;
+};
+
+struct bitmap_iteration_state
+{
+	size_t                  container;
+	unsigned int            pos;
+};
+
+bool bitmap_add(struct bitmap *bm, uint32_t value);
+bool bitmap_remove(struct bitmap *bm, uint32_t value);
+bool bitmap_contains(const struct bitmap *bm, uint32_t value);
+void bitmap_clear(struct bitmap *bm);
+size_t bitmap_and_count(const struct bitmap *a, const struct bitmap *b);
+void bitmap_iteration_start(struct bitmap_iteration_state *state);
+bool bitmap_iteration_next(const struct bitmap *bm, struct bitmap_iteration_state *state, uint32_t *value);
+
+static inline size_t
+bitmap_count(const struct bitmap *const bm)
+{
+	return bm->card;
+}
+
+#endif /* !ATHEME_INC_BITMAP_H */
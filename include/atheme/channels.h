@@ -30,9 +30,11 @@ struct channel
 	char *          topic_setter;
 	time_t          topicts;
 	mowgli_list_t   members;
+	mowgli_list_t   svcmembers;     // members that are internal clients
 	mowgli_list_t   bans;
 	unsigned int    flags;
 	struct mychan * mychan;
+	mowgli_node_t   sweepnode;      // for deferred destruction of empty channels
 };
 
 /* struct for channel memberships */
@@ -43,6 +45,7 @@ struct chanuser
 	unsigned int    modes;
 	mowgli_node_t   unode;
 	mowgli_node_t   cnode;
+	mowgli_node_t   snode;          // for struct channel -> svcmembers
 };
 
 struct chanban
@@ -67,6 +70,7 @@ struct chanban
 
 /* for struct channel -> flags */
 #define CHAN_LOG        0x00000001U /* logs sent to here */
+#define CHAN_SWEEP      0x00000002U /* emptied while channel_sweep_begin() was in effect */
 
 /* for struct chanuser -> modes */
 #define CSTATUS_OP      0x00000001U
@@ -126,10 +130,13 @@ void init_channels(void);
 
 struct channel *channel_add(const char *name, time_t ts, struct server *creator);
 void channel_delete(struct channel *c);
+void channel_sweep_begin(void);
+void channel_sweep_end(void);
 //inline struct channel *channel_find(const char *name);
 
 struct chanuser *chanuser_add(struct channel *chan, const char *user);
 void chanuser_delete(struct channel *chan, struct user *user);
+void chanuser_delete_member(struct chanuser *cu);
 struct chanuser *chanuser_find(struct channel *chan, struct user *user);
 
 struct chanban *chanban_add(struct channel *chan, const char *mask, int type);
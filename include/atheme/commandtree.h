@@ -25,6 +25,7 @@ struct command
 		const char *    path;
 		void          (*func)(struct sourceinfo *, const char *subcmd);
 	}                       help;
+	struct latency_stat *   latency;
 };
 
 /* commandtree.c */
@@ -32,6 +33,9 @@ void command_add(struct command *, mowgli_patricia_t *);
 void command_delete(struct command *, mowgli_patricia_t *);
 void command_delete_trie_cb(const char *, void *, void *);
 struct command *command_find(mowgli_patricia_t *, const char *);
+struct command_dispatch *command_dispatch_create(mowgli_patricia_t *commandtree, mowgli_patricia_t *aliases);
+void command_dispatch_destroy(struct command_dispatch *dispatch);
+struct command *command_dispatch_find(const struct command_dispatch *dispatch, const char *name);
 void command_exec(struct service *, struct sourceinfo *, struct command *, int, char **);
 void command_exec_split(struct service *, struct sourceinfo *, const char *, char *, mowgli_patricia_t *);
 void subcommand_dispatch_simple(struct service *, struct sourceinfo *, int, char **, mowgli_patricia_t *, const char *);
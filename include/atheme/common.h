@@ -52,5 +52,7 @@ void strshare_init(void);
 stringref strshare_get(const char *str);
 stringref strshare_ref(stringref str);
 void strshare_unref(stringref str);
+bool strshare_is_shared(stringref str);
+size_t strshare_share_bytes(stringref str);
 
 #endif /* !ATHEME_INC_COMMON_H */
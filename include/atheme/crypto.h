@@ -37,4 +37,8 @@ const struct crypt_impl *crypt_verify_password(const char *password, const char
 
 const char *crypt_password(const char *password);
 
+// How long crypt_verify_password() and crypt_password() take
+extern struct latency_histogram crypt_verify_latency;
+extern struct latency_histogram crypt_latency;
+
 #endif /* !ATHEME_INC_CRYPTO_H */
@@ -18,6 +18,7 @@ void sendq_add_eof(struct connection *cptr);
 void sendq_flush(struct connection *cptr);
 bool sendq_nonempty(struct connection *cptr);
 void sendq_set_limit(struct connection *cptr, size_t len);
+size_t sendq_length(struct connection *cptr);
 
 int recvq_length(struct connection *cptr);
 void recvq_put(struct connection *cptr);
@@ -89,6 +89,9 @@ struct ConfOption
 	unsigned int    default_clone_warn;     // default clone warn
 	bool            clone_increase;         // If the clone limit will increase based on # of identified clones
 	unsigned int    uplink_sendq_limit;
+	unsigned int    reply_rate;             // command reply lines per second, 0 for no limit
+	unsigned int    reply_queue_max;        // command reply lines that may wait per user, 0 for no limit
+	unsigned int    stall_threshold;        // milliseconds an iteration of the main loop may take, 0 to not check
 	char *          language;               // default language
 	mowgli_list_t   exempts;                // List of masks never to automatically kline
 	bool            allow_taint;            // allow tainted operation
@@ -128,6 +131,7 @@ struct cnt
 	unsigned int    operclass;
 	unsigned int    myuser_access;
 	unsigned int    myuser_name;
+	uint64_t        lines_in;       // lines received from the uplink
 };
 
 extern struct cnt cnt;
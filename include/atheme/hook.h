@@ -166,6 +166,13 @@ struct hook_server_delete
 	/* space for reason etc here */
 };
 
+struct hook_server_split
+{
+	struct server *         s;
+	struct user * const *   users;          // every user behind s, each marked UF_SPLIT
+	size_t                  count;
+};
+
 struct hook_user_change_password_check
 {
 	struct sourceinfo * si;
@@ -17,6 +17,7 @@ struct path_handler
 {
 	const char *    path;
 	void          (*handler)(struct connection *, void *);
+	bool            get;            // also handles GET requests, with a NULL request body
 };
 
 struct httpddata
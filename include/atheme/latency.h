@@ -0,0 +1,78 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Latency histograms for hook handlers and commands.
+ */
+
+#ifndef ATHEME_INC_LATENCY_H
+#define ATHEME_INC_LATENCY_H 1
+
+#include <atheme/stdheaders.h>
+#include <atheme/structures.h>
+
+/* Each histogram counts durations in nanoseconds into buckets that are
+ * linear within each power of two, with 8 buckets per power of two, so
+ * that any value is known to within 12.5%. Durations of 2^36 ns (about 69
+ * seconds) or more all go in the last bucket.
+ */
+#define LATENCY_SUB_BITS        3U
+#define LATENCY_SUB_BUCKETS     (1U << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS        36U
+#define LATENCY_BUCKETS         ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1U) * LATENCY_SUB_BUCKETS)
+
+enum latency_kind
+{
+	LATENCY_HOOK            = 0,    // one handler of a hook
+	LATENCY_PCOMMAND        = 1,    // a protocol command from the uplink
+	LATENCY_COMMAND         = 2,    // a command of a service
+};
+
+struct latency_histogram
+{
+	uint64_t                count;
+	uint64_t                total;
+	uint64_t                max;
+	uint32_t                buckets[LATENCY_BUCKETS];
+};
+
+/* A stat is created the first time something is timed while timing is
+ * enabled, and lives until shutdown, so that the numbers for a module
+ * survive it being reloaded. Callers keep a pointer to it with whatever is
+ * being timed so that it only has to be looked up once.
+ */
+struct latency_stat
+{
+	char *                          name;
+	enum latency_kind               kind;
+	struct latency_histogram        hist;
+};
+
+typedef void (*latency_foreach_fn)(const struct latency_stat *stat, void *priv);
+
+extern bool latency_enabled;
+
+struct latency_stat *latency_stat_get(enum latency_kind kind, const char *name);
+void latency_record(struct latency_stat *stat, uint64_t nsec);
+void latency_histogram_record(struct latency_histogram *hist, uint64_t nsec);
+uint64_t latency_bucket_limit(unsigned int bucket);
+void latency_reset(void);
+void latency_foreach(latency_foreach_fn fn, void *priv);
+size_t latency_top(const enum latency_kind *kind, const struct latency_stat **stats, size_t max);
+uint64_t latency_percentile(const struct latency_histogram *hist, unsigned int permille);
+const char *latency_kind_name(enum latency_kind kind);
+bool latency_kind_parse(const char *name, enum latency_kind *kind);
+
+static inline uint64_t
+latency_clock(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t) ts.tv_sec * UINT64_C(1000000000)) + (uint64_t) ts.tv_nsec;
+}
+
+#endif /* !ATHEME_INC_LATENCY_H */
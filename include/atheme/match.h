@@ -78,6 +78,7 @@ void strcasecanon(char *);
 void noopcanon(char *);
 
 int match(const char *, const char *);
+bool match_is_literal(const char *);
 char *collapse(char *);
 
 /* regex_create() flags */
@@ -54,6 +54,13 @@ void *smalloc(size_t len)
     ATHEME_FATTR_OWNERSHIP_RETURNS(malloc)
     ATHEME_FATTR_DIAGNOSE_IF(!len, "calling smalloc() with !len", "error");
 
+void *smemalign(size_t alignment, size_t len)
+    ATHEME_FATTR_ALLOC_SIZE(2)
+    ATHEME_FATTR_MALLOC
+    ATHEME_FATTR_RETURNS_NONNULL
+    ATHEME_FATTR_OWNERSHIP_RETURNS(malloc)
+    ATHEME_FATTR_DIAGNOSE_IF(!len, "calling smemalign() with !len", "error");
+
 void *srealloc(void *ptr, size_t len)
     ATHEME_FATTR_ALLOC_SIZE(2)
     ATHEME_FATTR_WUR
@@ -74,6 +74,7 @@ void *module_locate_symbol(const char *modname, const char *sym);
 void module_unload(struct module *m, enum module_unload_intent intent);
 struct module *module_find(const char *name);
 struct module *module_find_published(const char *name);
+struct module *module_current(void);
 bool module_request(const char *name);
 
 // Located in libathemecore/module.c
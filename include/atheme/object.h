@@ -17,15 +17,43 @@ struct metadata
 {
 	stringref       name;
 	char *          value;
+	unsigned int    key;            // interned ID of name
+	bool            shared;         // value is a strshare reference
+};
+
+/* An object's metadata is a small vector of entries sorted by interned
+ * key ID, which becomes an open-addressed hash table once it holds more
+ * than a handful of keys. Neither may be modified while iterating.
+ */
+struct metadata_table;
+
+struct metadata_iteration_state
+{
+	const char *    last;           // name of the entry returned last
+};
+
+struct metadata_stats
+{
+	size_t          tables;         // objects that have any metadata
+	size_t          table_bytes;
+	size_t          entries;
+	size_t          entry_bytes;
+	size_t          keys;           // distinct interned keys
+	size_t          key_bytes;
+	size_t          private_values; // values with their own copy
+	size_t          private_value_bytes;
+	size_t          shared_values;  // values that are strshare references
 };
 
 typedef void (*atheme_object_destructor_fn)(void *);
+typedef void (*atheme_object_metadata_fn)(void *, const struct metadata *, bool added);
 
 struct atheme_object
 {
 	int                             refcount;
 	atheme_object_destructor_fn     destructor;
-	mowgli_patricia_t *             metadata;
+	atheme_object_metadata_fn       metadata_changed;       // told about entries added and removed
+	struct metadata_table *         metadata;
 	mowgli_patricia_t *             privatedata;
 #ifdef OBJECT_DEBUG
 	mowgli_node_t                   dnode;
@@ -44,6 +72,13 @@ struct metadata *metadata_add(void *target, const char *name, const char *value)
 void metadata_delete(void *target, const char *name);
 struct metadata *metadata_find(void *target, const char *name);
 void metadata_delete_all(void *target);
+unsigned int metadata_count(void *target);
+void metadata_iteration_start(void *target, struct metadata_iteration_state *state);
+struct metadata *metadata_iteration_next(void *target, struct metadata_iteration_state *state);
+void metadata_get_stats(struct metadata_stats *stats);
+
+#define METADATA_FOREACH(md, state, target) \
+	for (metadata_iteration_start((target), (state)); ((md) = metadata_iteration_next((target), (state))) != NULL; )
 
 void *privatedata_get(void *target, const char *key);
 void privatedata_set(void *target, const char *key, void *data);
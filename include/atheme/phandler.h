@@ -137,6 +137,12 @@ extern void (*notice_channel_sts)(struct user *from, struct channel *target, con
  * source may or may not be on channel
  * generic_wallchops() sends an individual notice to each channel operator */
 extern void (*wallchops)(struct user *source, struct channel *target, const char *message);
+/* send the same notice to several users
+ * from can be a client on the services server or the services server
+ * itself (NULL)
+ * generic_notice_users_sts() sends one notice_user_sts() per target;
+ * ircds that take comma-separated targets can use notice_users_multi_sts() */
+extern void (*notice_users_sts)(struct user *from, struct user **targets, size_t count, const char *text);
 /* send a numeric from must currently be me.me */
 extern void (*numeric_sts)(struct server *from, int numeric, struct user *target, const char *fmt, ...) ATHEME_FATTR_PRINTF(4, 5);
 /* kill a user
@@ -274,6 +280,8 @@ void generic_notice_user_sts(struct user *from, struct user *target, const char
 void generic_notice_global_sts(struct user *from, const char *mask, const char *text);
 void generic_notice_channel_sts(struct user *from, struct channel *target, const char *text);
 void generic_wallchops(struct user *source, struct channel *target, const char *message);
+void generic_notice_users_sts(struct user *from, struct user **targets, size_t count, const char *text);
+void notice_users_multi_sts(const char *source, struct user **targets, size_t count, const char *text, size_t maxtargets);
 void generic_numeric_sts(struct server *from, int numeric, struct user *target, const char *fmt, ...) ATHEME_FATTR_PRINTF(4, 5);
 void generic_kill_id_sts(struct user *killer, const char *id, const char *reason);
 void generic_part_sts(struct channel *c, struct user *u);
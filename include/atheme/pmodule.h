@@ -20,6 +20,7 @@ struct proto_cmd
 	void  (*handler)(struct sourceinfo *si, int parc, char *parv[]);
 	int     minparc;
 	int     sourcetype;
+	struct latency_stat *latency;
 };
 
 /* values for sourcetype */
@@ -30,7 +31,7 @@ struct proto_cmd
 #define MAXPARC		35 /* max # params to protocol command */
 
 /* pmodule.c */
-extern mowgli_heap_t *pcommand_heap;
+extern struct slab_type *pcommand_heap;
 extern mowgli_heap_t *messagetree_heap;
 extern mowgli_patricia_t *pcommands;
 
@@ -40,6 +41,7 @@ void pcommand_add(const char *token,
 	int minparc, int sourcetype);
 void pcommand_delete(const char *token);
 struct proto_cmd *pcommand_find(const char *token);
+void pcommand_exec(struct proto_cmd *pcmd, struct sourceinfo *si, int parc, char *parv[]);
 
 /* ptasks.c */
 const char *get_build_date(void);
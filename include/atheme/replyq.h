@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Fair queueing of command replies.
+ */
+
+#ifndef ATHEME_INC_REPLYQ_H
+#define ATHEME_INC_REPLYQ_H 1
+
+#include <atheme/stdheaders.h>
+#include <atheme/structures.h>
+
+/* Command replies go out at most general::reply_rate lines per second.
+ * Replies over that budget wait in a queue per recipient, and the queues
+ * are drained a line at a time in turn, so one long LIST does not hold up
+ * everybody else's replies. Protocol traffic (SASL, kills, forced nick
+ * changes, modes) never waits here, and replies are held back entirely
+ * while the uplink sendq is more than half full to leave room for it.
+ *
+ * notice() also queues behind a user's waiting replies, so that the
+ * notices a command sends with them stay in order. Lines sent straight
+ * through msg() or the protocol module are not queued and can overtake
+ * waiting replies.
+ */
+struct replyq_stats
+{
+	unsigned int    queues;         // recipients with replies waiting
+	size_t          lines;          // replies waiting in all queues
+	size_t          max_depth;      // longest queue right now
+	size_t          peak_depth;     // longest queue since startup
+	uint64_t        sent_direct;    // replies sent without waiting
+	uint64_t        sent_queued;    // replies sent from a queue
+	uint64_t        dropped;        // replies to users who left first, or over general::reply_queue_max
+};
+
+void replyq_send(struct service *svs, struct user *u, const char *line, bool privmsg);
+bool replyq_send_if_waiting(const char *from, struct user *u, const char *line, bool privmsg);
+void replyq_user_delete(struct user *u);
+void replyq_service_delete(struct service *svs);
+void replyq_get_stats(struct replyq_stats *stats);
+
+#endif /* !ATHEME_INC_REPLYQ_H */
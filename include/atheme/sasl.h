@@ -33,7 +33,6 @@
 
 // Flags for sasl_session->flags
 #define ASASL_SFLAG_NONE                0x00000000U // Nothing special
-#define ASASL_SFLAG_MARKED_FOR_DELETION 0x00000001U // See sasl_delete_stale() in modules/saslserv/main.c
 #define ASASL_SFLAG_CLIENT_SECURE       0x00000002U // The client is connected to the network securely
 
 // Flags for sasl_input_buf->flags
@@ -47,7 +46,9 @@
 
 struct sasl_session
 {
-	mowgli_node_t                   node;                   // Node for entry into the active sessions list
+	mowgli_node_t                   node;                   // Node for entry into a timeout wheel slot
+	mowgli_node_t                   servnode;               // Node for entry into the server's session list
+	unsigned int                    wheelslot;              // Timeout wheel slot the session is in
 	const struct sasl_mechanism *   mechptr;                // Mechanism they're using
 	struct server *                 server;                 // Server they're on
 	struct sourceinfo *             si;                     // The source info for logcommand(), bad_password(), and login hooks
@@ -130,6 +131,7 @@ struct sasl_core_functions
 	sasl_authxid_can_login_fn   authcid_can_login;
 	sasl_authxid_can_login_fn   authzid_can_login;
 	void                      (*recalc_mechlist)(const struct sasl_session *, const struct myuser *, const char **);
+	size_t                    (*session_count)(void);
 };
 
 #endif /* !ATHEME_INC_SASL_H */
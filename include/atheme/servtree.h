@@ -30,6 +30,7 @@ struct service
 	mowgli_patricia_t *     commands;
 	mowgli_patricia_t *     aliases;
 	mowgli_patricia_t *     access;
+	struct command_dispatch *dispatch;      // built from commands and aliases on demand
 	bool                    chanmsg;
 	mowgli_list_t           conf_table;
 	bool                    botonly;
@@ -57,6 +58,7 @@ struct service *service_find_nick(const char *nick);
 char *service_name(char *name) ATHEME_FATTR_MALLOC;
 void service_set_chanmsg(struct service *, bool);
 const char *service_resolve_alias(struct service *sptr, const char *context, const char *cmd);
+struct command *service_find_command(struct service *sptr, const char *cmd);
 const char *service_set_access(struct service *sptr, const char *cmd, const char *access);
 
 void service_bind_command(struct service *, struct command *);
@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Size-class slab allocator.
+ */
+
+#ifndef ATHEME_INC_SLAB_H
+#define ATHEME_INC_SLAB_H 1
+
+#include <atheme/attributes.h>
+#include <atheme/stdheaders.h>
+#include <atheme/structures.h>
+
+/* Objects are allocated by type. A type only names what is being
+ * allocated so that its memory use can be counted; the memory itself
+ * comes from a size class shared by every type of a similar size.
+ * Types created with a size of 0 hold objects or strings of any length.
+ */
+struct slab_type_stats
+{
+	const char *            name;
+	size_t                  size;           // object size, 0 if variable
+	size_t                  class_size;     // 0 when allocated with smalloc()
+	size_t                  live;
+	size_t                  peak;
+	size_t                  bytes;
+	size_t                  peak_bytes;
+	uint64_t                allocs;
+};
+
+struct slab_stats
+{
+	size_t                  arenas;
+	size_t                  slabs;
+	size_t                  spare_slabs;
+	size_t                  reserved_bytes;
+	size_t                  used_bytes;
+	size_t                  large_bytes;
+};
+
+typedef void (*slab_type_stats_fn)(const struct slab_type_stats *stats, void *priv);
+
+struct slab_type *slab_type_create(const char *name, size_t size);
+void *slab_alloc(struct slab_type *type) ATHEME_FATTR_MALLOC;
+void slab_free(struct slab_type *type, void *ptr);
+void *slab_alloc_bytes(struct slab_type *type, size_t len) ATHEME_FATTR_MALLOC;
+void slab_free_bytes(struct slab_type *type, void *ptr, size_t len);
+char *slab_strdup(struct slab_type *type, const char *str) ATHEME_FATTR_MALLOC;
+void slab_strfree(struct slab_type *type, char *str);
+void slab_get_stats(struct slab_stats *stats);
+void slab_foreach_type(slab_type_stats_fn fn, void *priv);
+
+#endif /* !ATHEME_INC_SLAB_H */
@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Event loop stall detection.
+ */
+
+#ifndef ATHEME_INC_STALL_H
+#define ATHEME_INC_STALL_H 1
+
+#include <atheme/stdheaders.h>
+#include <atheme/structures.h>
+
+#define STALL_CONTEXT_MAX       8U
+#define STALL_CONTEXT_NAMELEN   48U
+#define STALL_FRAMES_MAX        32U
+#define STALL_RECORDS_MAX       16U
+
+/* What the main thread is doing. The names are copied in rather than
+ * pointed to, because whatever they belong to (a module, a service) can go
+ * away while it is still on the stack.
+ */
+struct stall_context
+{
+	const char *                    kind;   // "hook", "pcommand", "command" or "timer"
+	char                            name[STALL_CONTEXT_NAMELEN];
+	char                            detail[STALL_CONTEXT_NAMELEN];
+};
+
+struct stall_record
+{
+	time_t                          when;   // when the main loop got going again
+	uint64_t                        nsec;   // how long the iteration of the main loop took
+	unsigned int                    depth;  // entries of context, innermost last
+	struct stall_context            context[STALL_CONTEXT_MAX];
+	unsigned int                    frames; // entries of symbols
+	char **                         symbols;
+};
+
+extern unsigned int stall_count;
+
+void stall_context_push(const char *kind, const char *name, const char *detail);
+void stall_context_pop(void);
+unsigned int stall_loop_tick(void);
+void stall_loop_stop(void);
+bool stall_watchdog_running(void);
+const struct stall_record *stall_record_get(unsigned int num);
+const char *stall_record_describe(const struct stall_record *rec, char *buf, size_t len);
+void stall_clear(void);
+
+#endif /* !ATHEME_INC_STALL_H */
@@ -28,6 +28,9 @@ struct chanban;
 struct channel;
 struct chanuser;
 
+// Defined in libathemecore/commandtree.c
+struct command_dispatch;
+
 // Defined in atheme/connection.h
 struct connection;
 
@@ -66,6 +69,10 @@ struct hook;
 // Defined in atheme/httpd.h
 struct path_handler;
 
+// Defined in atheme/latency.h
+struct latency_histogram;
+struct latency_stat;
+
 // Defined in atheme/match.h
 struct atheme_regex;
 
@@ -110,13 +117,17 @@ struct nicksvs;
 // Defined in atheme/servtree.h
 struct service;
 
-// Defined in atheme/sharedheap.h
-struct sharedheap;
+// Defined in libathemecore/slab.c
+struct slab_type;
 
 // Defined in atheme/sourceinfo.h
 struct sourceinfo;
 struct sourceinfo_vtable;
 
+// Defined in atheme/stall.h
+struct stall_context;
+struct stall_record;
+
 // Defined in atheme/table.h
 struct atheme_table;
 struct atheme_table_cell;
@@ -128,6 +139,10 @@ struct taint_reason;
 // Defined in atheme/template.h
 struct default_template;
 
+// Defined in atheme/timerwheel.h
+struct timerwheel_entry;
+struct timerwheel_handle;
+
 // Defined in atheme/tools.h
 struct email_canonicalizer_item;
 struct logfile;
@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Hierarchical timing wheel for per-entity timeouts.
+ */
+
+#ifndef ATHEME_INC_TIMERWHEEL_H
+#define ATHEME_INC_TIMERWHEEL_H 1
+
+#include <atheme/stdheaders.h>
+#include <atheme/structures.h>
+
+/* A module creates one handle for each kind of timeout it keeps, and
+ * embeds a struct timerwheel_entry in each object that can time out.
+ * Scheduling and cancelling an entry take constant time; the wheel has a
+ * resolution of one second.
+ *
+ * When an entry expires, it is no longer pending when the handle's
+ * callback is called, so the callback may free the object or schedule the
+ * entry again.
+ */
+typedef void (*timerwheel_fn)(struct timerwheel_entry *entry);
+
+struct timerwheel_entry
+{
+	mowgli_node_t                   node;   // for the wheel slot
+	mowgli_node_t                   hnode;  // for struct timerwheel_handle -> entries
+	mowgli_list_t *                 slot;   // NULL when not pending
+	struct timerwheel_handle *      handle;
+	time_t                          expires;
+};
+
+struct timerwheel_handle
+{
+	char *                          name;
+	timerwheel_fn                   expire;
+	mowgli_list_t                   entries;
+};
+
+struct timerwheel_handle *timerwheel_handle_create(const char *name, timerwheel_fn expire);
+void timerwheel_handle_destroy(struct timerwheel_handle *handle, timerwheel_fn cancelled);
+void timerwheel_schedule(struct timerwheel_handle *handle, struct timerwheel_entry *entry, time_t expires);
+void timerwheel_cancel(struct timerwheel_entry *entry);
+
+static inline bool
+timerwheel_pending(const struct timerwheel_entry *const entry)
+{
+	return entry->slot != NULL;
+}
+
+#endif /* !ATHEME_INC_TIMERWHEEL_H */
@@ -38,6 +38,7 @@ void init_uplinks(void);
 struct uplink *uplink_add(const char *name, const char *host, const char *send_password, const char *receive_password, const char *vhost, unsigned int port);
 void uplink_delete(struct uplink *u);
 struct uplink *uplink_find(const char *name);
+bool uplink_sendq_busy(void);
 void uplink_connect(void);
 
 /* packet.c */
@@ -57,6 +57,7 @@ struct user
 #define UF_CUSTOM2     0x00040000U
 #define UF_CUSTOM3     0x00080000U
 #define UF_CUSTOM4     0x00100000U
+#define UF_SPLIT       0x00200000U /* user is being removed by a netsplit */
 
 #define CLIENT_NAME(user)	((user)->uid != NULL ? (user)->uid : (user)->nick)
 
@@ -21,13 +21,372 @@ mowgli_patricia_t *oldnameslist;
 mowgli_patricia_t *mclist;
 
 static mowgli_patricia_t *certfplist;
+static mowgli_patricia_t *emaillist;    // canonical email -> mowgli_list_t of struct myuser
+static mowgli_patricia_t *vhostlist;    // assigned vhost -> mowgli_list_t of struct myuser
+
+static struct slab_type *myuser_heap;
+static struct slab_type *mynick_heap;
+static struct slab_type *mycertfp_heap;
+static struct slab_type *myuser_name_heap;
+static struct slab_type *mychan_heap;
+static struct slab_type *chanacs_heap;
+
+/* Expiry queues: binary min-heaps of records ordered by the next time
+ * expire_check() has to look at them. lastlogin, lastseen and used only
+ * ever move forward, so code updating them does not need to touch the
+ * queues; a record that turns out not to be due yet is simply put back
+ * at its new projected expiry time.
+ */
+struct expiry_queue
+{
+	struct expiry_entry **  heap;
+	size_t                  count;
+	size_t                  size;
+};
+
+#define EXPIRY_CONTAINER(e, type)       ((type *) (void *) ((char *) (e) - offsetof(type, expiry)))
+
+/* how long to wait before looking at a record again if it was due but was
+ * kept (held, logged in, vetoed by a hook, ...); matches the expire_check()
+ * timer interval
+ */
+#define EXPIRY_RECHECK                  SECONDS_PER_HOUR
+
+/* keep last used time of channels in use accurate to within a day */
+#define MYCHAN_USED_REFRESH             (SECONDS_PER_DAY - SECONDS_PER_HOUR - SECONDS_PER_MINUTE)
+
+static struct expiry_queue myuser_expiryq;
+static struct expiry_queue mynick_expiryq;
+static struct expiry_queue mychan_expiryq;
+
+/* Flag indexes: every account and channel gets a small integer slot
+ * (reused after deletion, so slots stay dense), and each flag bit has a
+ * compressed bitmap of the slots of the records that have it set. The
+ * flags must only be changed with myuser_set_flags() and
+ * mychan_set_flags() so that the bitmaps stay accurate.
+ */
+struct flag_index
+{
+	void **                 objects;        // by slot, NULL if free
+	unsigned int *          flags;          // by slot, copy of the record's flags
+	uint32_t                size;
+	uint32_t                used;           // slots ever handed out
+	uint32_t *              freeslots;
+	uint32_t                nfree;
+	uint32_t                freesize;
+	unsigned int            mask;           // bits that are indexed
+	struct bitmap           bits[32];
+};
+
+static struct flag_index myuser_flagindex = { .mask = ~0U };
+static struct flag_index mychan_flagindex = { .mask = MC_INDEXED_MASK };
+
+static void myuser_metadata_changed(void *target, const struct metadata *md, bool added);
+
+static inline void
+expiry_place(struct expiry_queue *const q, struct expiry_entry *const e, const size_t i)
+{
+	q->heap[i] = e;
+	e->pos = i + 1;
+}
+
+static void
+expiry_sift_up(struct expiry_queue *const q, size_t i)
+{
+	struct expiry_entry *const e = q->heap[i];
+
+	while (i > 0)
+	{
+		const size_t parent = (i - 1) / 2;
+
+		if (q->heap[parent]->due <= e->due)
+			break;
+
+		expiry_place(q, q->heap[parent], i);
+		i = parent;
+	}
+
+	expiry_place(q, e, i);
+}
+
+static void
+expiry_sift_down(struct expiry_queue *const q, size_t i)
+{
+	struct expiry_entry *const e = q->heap[i];
+
+	for (;;)
+	{
+		size_t child = (2 * i) + 1;
+
+		if (child >= q->count)
+			break;
+
+		if (child + 1 < q->count && q->heap[child + 1]->due < q->heap[child]->due)
+			child++;
+
+		if (e->due <= q->heap[child]->due)
+			break;
+
+		expiry_place(q, q->heap[child], i);
+		i = child;
+	}
+
+	expiry_place(q, e, i);
+}
+
+static void
+expiry_append(struct expiry_queue *const q, struct expiry_entry *const e, const time_t due)
+{
+	if (q->count == q->size)
+	{
+		q->size = q->size ? (q->size * 2) : 1024;
+		q->heap = sreallocarray(q->heap, q->size, sizeof *q->heap);
+	}
+
+	e->due = due;
+	expiry_place(q, e, q->count++);
+}
+
+/* (re)schedules a record; O(log n) */
+static void
+expiry_schedule(struct expiry_queue *const q, struct expiry_entry *const e, const time_t due)
+{
+	if (! e->pos)
+	{
+		expiry_append(q, e, due);
+		expiry_sift_up(q, e->pos - 1);
+		return;
+	}
+
+	const time_t olddue = e->due;
+
+	e->due = due;
+
+	if (due < olddue)
+		expiry_sift_up(q, e->pos - 1);
+	else if (due > olddue)
+		expiry_sift_down(q, e->pos - 1);
+}
+
+/* removes a record from its queue (if it is queued at all); O(log n) */
+static void
+expiry_unschedule(struct expiry_queue *const q, struct expiry_entry *const e)
+{
+	if (! e->pos)
+		return;
+
+	const size_t i = e->pos - 1;
+	struct expiry_entry *const last = q->heap[--q->count];
+
+	e->pos = 0;
+
+	if (last == e)
+		return;
+
+	expiry_place(q, last, i);
+	expiry_sift_down(q, i);
+	expiry_sift_up(q, last->pos - 1);
+}
+
+/* returns the earliest record in the queue if it is due, NULL otherwise */
+static struct expiry_entry *
+expiry_next_due(const struct expiry_queue *const q)
+{
+	if (! q->count || q->heap[0]->due > CURRTIME)
+		return NULL;
+
+	return q->heap[0];
+}
+
+/* throws away the heap order; the queue is refilled with expiry_append()
+ * and then restored with expiry_heapify()
+ */
+static void
+expiry_clear(struct expiry_queue *const q)
+{
+	for (size_t i = 0; i < q->count; i++)
+		q->heap[i]->pos = 0;
+
+	q->count = 0;
+}
+
+static void
+expiry_heapify(struct expiry_queue *const q)
+{
+	for (size_t i = q->count / 2; i > 0; i--)
+		expiry_sift_down(q, i - 1);
+}
+
+static void
+flag_index_update(struct flag_index *const fi, const uint32_t slot, const unsigned int flags)
+{
+	const unsigned int changed = (fi->flags[slot] ^ flags) & fi->mask;
+
+	fi->flags[slot] = flags;
+
+	if (!changed)
+		return;
+
+	for (unsigned int bit = 0; bit < 32U; bit++)
+	{
+		if (! (changed & (1U << bit)))
+			continue;
+
+		if (flags & (1U << bit))
+			(void) bitmap_add(&fi->bits[bit], slot);
+		else
+			(void) bitmap_remove(&fi->bits[bit], slot);
+	}
+}
+
+static uint32_t
+flag_index_attach(struct flag_index *const fi, void *const obj, const unsigned int flags)
+{
+	uint32_t slot;
+
+	if (fi->nfree)
+		slot = fi->freeslots[--fi->nfree];
+	else
+	{
+		if (fi->used == fi->size)
+		{
+			fi->size = fi->size ? (fi->size * 2U) : 1024U;
+			fi->objects = sreallocarray(fi->objects, fi->size, sizeof *fi->objects);
+			fi->flags = sreallocarray(fi->flags, fi->size, sizeof *fi->flags);
+		}
+
+		slot = fi->used++;
+	}
+
+	fi->objects[slot] = obj;
+	fi->flags[slot] = 0;
+	flag_index_update(fi, slot, flags);
+
+	return slot;
+}
+
+static void
+flag_index_detach(struct flag_index *const fi, const uint32_t slot)
+{
+	flag_index_update(fi, slot, 0);
+	fi->objects[slot] = NULL;
+
+	if (fi->nfree == fi->freesize)
+	{
+		fi->freesize = fi->freesize ? (fi->freesize * 2U) : 64U;
+		fi->freeslots = sreallocarray(fi->freeslots, fi->freesize, sizeof *fi->freeslots);
+	}
+
+	fi->freeslots[fi->nfree++] = slot;
+}
+
+// the smallest bitmap among the indexed bits of flagset, or NULL if none are indexed
+static const struct bitmap *
+flag_index_smallest(const struct flag_index *const fi, const unsigned int flagset)
+{
+	const struct bitmap *best = NULL;
+
+	for (unsigned int bit = 0; bit < 32U; bit++)
+	{
+		if (! (flagset & fi->mask & (1U << bit)))
+			continue;
+
+		if (best == NULL || bitmap_count(&fi->bits[bit]) < bitmap_count(best))
+			best = &fi->bits[bit];
+	}
+
+	return best;
+}
+
+struct flag_index_iteration
+{
+	const struct bitmap *           bm;     // NULL to look at every slot
+	struct bitmap_iteration_state   state;
+	uint32_t                        slot;
+	unsigned int                    flagset;
+};
+
+static void
+flag_index_start(const struct flag_index *const fi, const unsigned int flagset, struct flag_index_iteration *const it)
+{
+	it->bm = flag_index_smallest(fi, flagset);
+	it->slot = 0;
+	it->flagset = flagset;
+
+	bitmap_iteration_start(&it->state);
+}
+
+/* Returns the next record that has all of the flags of the iteration, or
+ * NULL at the end. The indexed flags must not change during the iteration.
+ */
+static void *
+flag_index_next(const struct flag_index *const fi, struct flag_index_iteration *const it)
+{
+	uint32_t slot;
+
+	if (it->bm != NULL)
+	{
+		while (bitmap_iteration_next(it->bm, &it->state, &slot))
+			if ((fi->flags[slot] & it->flagset) == it->flagset)
+				return fi->objects[slot];
+
+		return NULL;
+	}
+
+	// nothing in flagset is indexed (or it is empty); look at every record
+	while (it->slot < fi->used)
+	{
+		slot = it->slot++;
+
+		if (fi->objects[slot] != NULL && (fi->flags[slot] & it->flagset) == it->flagset)
+			return fi->objects[slot];
+	}
+
+	return NULL;
+}
+
+static unsigned int
+flag_index_count_slow(const struct flag_index *const fi, const unsigned int flagset)
+{
+	struct flag_index_iteration it;
+	unsigned int count = 0;
+
+	flag_index_start(fi, flagset, &it);
+
+	while (flag_index_next(fi, &it) != NULL)
+		count++;
+
+	return count;
+}
+
+static unsigned int
+flag_index_count(const struct flag_index *const fi, const unsigned int flagset)
+{
+	unsigned int first = 32U, second = 32U;
 
-static mowgli_heap_t *myuser_heap;   /* HEAP_USER */
-static mowgli_heap_t *mynick_heap;   /* HEAP_USER */
-static mowgli_heap_t *mycertfp_heap; /* HEAP_USER */
-static mowgli_heap_t *myuser_name_heap;	/* HEAP_USER / 2 */
-static mowgli_heap_t *mychan_heap;	/* HEAP_CHANNEL */
-static mowgli_heap_t *chanacs_heap;	/* HEAP_CHANACS */
+	if (flagset & ~fi->mask)
+		return flag_index_count_slow(fi, flagset);
+
+	for (unsigned int bit = 0; bit < 32U; bit++)
+	{
+		if (! (flagset & (1U << bit)))
+			continue;
+
+		if (first == 32U)
+			first = bit;
+		else if (second == 32U)
+			second = bit;
+		else
+			return flag_index_count_slow(fi, flagset);
+	}
+
+	if (first == 32U)
+		return fi->used - fi->nfree;
+	if (second == 32U)
+		return (unsigned int) bitmap_count(&fi->bits[first]);
+
+	return (unsigned int) bitmap_and_count(&fi->bits[first], &fi->bits[second]);
+}
 
 /*
  * init_accounts()
@@ -46,12 +405,12 @@ static mowgli_heap_t *chanacs_heap;	/* HEAP_CHANACS */
 void
 init_accounts(void)
 {
-	myuser_heap = sharedheap_get(sizeof(struct myuser));
-	mynick_heap = sharedheap_get(sizeof(struct myuser));
-	myuser_name_heap = sharedheap_get(sizeof(struct myuser_name));
-	mychan_heap = sharedheap_get(sizeof(struct mychan));
-	chanacs_heap = sharedheap_get(sizeof(struct chanacs));
-	mycertfp_heap = sharedheap_get(sizeof(struct mycertfp));
+	myuser_heap = slab_type_create("myuser", sizeof(struct myuser));
+	mynick_heap = slab_type_create("mynick", sizeof(struct mynick));
+	myuser_name_heap = slab_type_create("myuser_name", sizeof(struct myuser_name));
+	mychan_heap = slab_type_create("mychan", sizeof(struct mychan));
+	chanacs_heap = slab_type_create("chanacs", sizeof(struct chanacs));
+	mycertfp_heap = slab_type_create("mycertfp", sizeof(struct mycertfp));
 
 	if (myuser_heap == NULL || mynick_heap == NULL || mychan_heap == NULL
 			|| chanacs_heap == NULL || mycertfp_heap == NULL)
@@ -64,6 +423,8 @@ init_accounts(void)
 	oldnameslist = mowgli_patricia_create(irccasecanon);
 	mclist = mowgli_patricia_create(irccasecanon);
 	certfplist = mowgli_patricia_create(strcasecanon);
+	emaillist = mowgli_patricia_create(noopcanon);
+	vhostlist = mowgli_patricia_create(irccasecanon);
 }
 
 /*
@@ -114,13 +475,15 @@ myuser_add_id(const char *id, const char *name, const char *pass, const char *em
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "myuser_add(): %s -> %s", name, email);
 
-	mu = mowgli_heap_alloc(myuser_heap);
+	mu = slab_alloc(myuser_heap);
 	atheme_object_init(atheme_object(mu), name, (atheme_object_destructor_fn) myuser_delete);
+	atheme_object(mu)->metadata_changed = &myuser_metadata_changed;
 
 	entity(mu)->type = ENT_USER;
 	entity(mu)->name = strshare_get(name);
 	mu->email = strshare_get(email);
 	mu->email_canonical = canonicalize_email(email);
+	myuser_email_index_add(mu);
 	if (id)
 	{
 		if (myentity_find_uid(id) == NULL)
@@ -138,6 +501,7 @@ myuser_add_id(const char *id, const char *name, const char *pass, const char *em
 		mu->flags &= ~MU_ENFORCE;
 		metadata_add(mu, "private:doenforce", "1");
 	}
+	mu->flagslot = flag_index_attach(&myuser_flagindex, mu, mu->flags);
 	mu->language = NULL; /* default */
 
 	/* If it's already crypted, don't touch the password. Otherwise,
@@ -162,6 +526,11 @@ myuser_add_id(const char *id, const char *name, const char *pass, const char *em
 
 	myuser_name_restore(entity(mu)->name, mu);
 
+	/* the caller (or the database backend) may still fill in lastlogin
+	 * and flags, so look at it again on the next expire_check() run
+	 */
+	expiry_schedule(&myuser_expiryq, &mu->expiry, CURRTIME);
+
 	cnt.myuser++;
 
 	return mu;
@@ -312,14 +681,18 @@ myuser_delete(struct myuser *mu)
 	if (nicks[0] != '\0')
 		slog(LG_REGISTER, "DELETE: \2%s\2 from \2%s\2", nicks, entity(mu)->name);
 
+	expiry_unschedule(&myuser_expiryq, &mu->expiry);
+	flag_index_detach(&myuser_flagindex, mu->flagslot);
+
 	/* entity(mu)->name is the index for this dtree */
 	myentity_del(entity(mu));
 
+	myuser_email_index_delete(mu);
 	strshare_unref(mu->email);
 	strshare_unref(mu->email_canonical);
 	strshare_unref(entity(mu)->name);
 
-	mowgli_heap_free(myuser_heap, mu);
+	slab_free(myuser_heap, mu);
 
 	cnt.myuser--;
 }
@@ -380,37 +753,329 @@ myuser_rename(struct myuser *mu, const char *name)
 		}
 	}
 
-	data.mu = mu;
-	data.oldname = nb;
-	hook_call_user_rename(&data);
+	/* the nick matching the account name is never expired on its own;
+	 * have all of them looked at again now that it may have changed
+	 */
+	MOWGLI_ITER_FOREACH(n, mu->nicks.head)
+	{
+		struct mynick *const mn = n->data;
+
+		expiry_schedule(&mynick_expiryq, &mn->expiry, CURRTIME);
+	}
+
+	data.mu = mu;
+	data.oldname = nb;
+	hook_call_user_rename(&data);
+}
+
+/*
+ * myuser_set_email(struct myuser *mu, const char *name)
+ *
+ * Changes the email address of an account.
+ *
+ * Inputs:
+ *      - account to change
+ *      - new email address; this must be valid
+ *
+ * Outputs:
+ *      - nothing
+ *
+ * Side Effects:
+ *      - email address is changed
+ */
+void
+myuser_set_email(struct myuser *mu, const char *newemail)
+{
+	return_if_fail(mu != NULL);
+	return_if_fail(newemail != NULL);
+
+	myuser_email_index_delete(mu);
+	strshare_unref(mu->email);
+	strshare_unref(mu->email_canonical);
+
+	mu->email = strshare_get(newemail);
+	mu->email_canonical = canonicalize_email(newemail);
+	myuser_email_index_add(mu);
+}
+
+/*
+ * myuser_email_index_add(struct myuser *mu)
+ * myuser_email_index_delete(struct myuser *mu)
+ *
+ * Maintain the reverse index of canonical email addresses. Whoever
+ * changes mu->email_canonical must take the account out of the index
+ * before and put it back in afterwards.
+ */
+void
+myuser_email_index_add(struct myuser *mu)
+{
+	mowgli_list_t *l;
+
+	return_if_fail(mu != NULL);
+
+	if (mu->email_canonical == NULL)
+		return;
+
+	if ((l = mowgli_patricia_retrieve(emaillist, mu->email_canonical)) == NULL)
+	{
+		l = mowgli_list_create();
+		mowgli_patricia_add(emaillist, mu->email_canonical, l);
+	}
+
+	mowgli_node_add(mu, &mu->email_node, l);
+}
+
+void
+myuser_email_index_delete(struct myuser *mu)
+{
+	mowgli_list_t *l;
+
+	return_if_fail(mu != NULL);
+
+	if (mu->email_canonical == NULL)
+		return;
+
+	if ((l = mowgli_patricia_retrieve(emaillist, mu->email_canonical)) == NULL)
+		return;
+
+	mowgli_node_delete(&mu->email_node, l);
+
+	if (! MOWGLI_LIST_LENGTH(l))
+	{
+		(void) mowgli_patricia_delete(emaillist, mu->email_canonical);
+		mowgli_list_free(l);
+	}
+}
+
+/*
+ * myuser_find_by_email(const char *email)
+ * myuser_find_by_email_canonical(stringref email_canonical)
+ *
+ * Finds the accounts registered to an email address, comparing the
+ * canonical forms of the addresses (see canonicalize_email()).
+ *
+ * Inputs:
+ *      - an email address (no wildcards), or its canonical form
+ *
+ * Outputs:
+ *      - a list of struct myuser, or NULL if there are none
+ *
+ * Side Effects:
+ *      - none
+ */
+const mowgli_list_t *
+myuser_find_by_email(const char *email)
+{
+	const mowgli_list_t *l;
+	stringref email_canonical;
+
+	return_val_if_fail(email != NULL, NULL);
+
+	email_canonical = canonicalize_email(email);
+	l = myuser_find_by_email_canonical(email_canonical);
+	strshare_unref(email_canonical);
+
+	return l;
+}
+
+const mowgli_list_t *
+myuser_find_by_email_canonical(stringref email_canonical)
+{
+	return_val_if_fail(email_canonical != NULL, NULL);
+
+	return mowgli_patricia_retrieve(emaillist, email_canonical);
+}
+
+/* One entry of an account in the vhost reverse index. The account keeps
+ * its entries on mu->vhosts, tagged with the metadata key they are for,
+ * so removing one never has to search the list of a shared vhost.
+ */
+struct myuser_vhost_entry
+{
+	mowgli_node_t   node;           // in the vhostlist list, data is the account
+	mowgli_node_t   owner_node;     // in mu->vhosts
+	mowgli_list_t * list;
+	unsigned int    key;            // interned ID of the metadata key
+};
+
+/*
+ * myuser_vhost_index_add(struct myuser *mu, const struct metadata *md)
+ * myuser_vhost_index_delete(struct myuser *mu, const struct metadata *md)
+ *
+ * Maintain the reverse index of assigned vhosts. An account appears
+ * once for every private:usercloak or private:usercloak:<nick> key
+ * holding the vhost.
+ */
+static void
+myuser_vhost_index_add(struct myuser *mu, const struct metadata *md)
+{
+	struct myuser_vhost_entry *ve;
+	mowgli_list_t *l;
+
+	if ((l = mowgli_patricia_retrieve(vhostlist, md->value)) == NULL)
+	{
+		l = mowgli_list_create();
+		mowgli_patricia_add(vhostlist, md->value, l);
+	}
+
+	ve = smalloc(sizeof *ve);
+	ve->list = l;
+	ve->key = md->key;
+
+	mowgli_node_add(mu, &ve->node, l);
+	mowgli_node_add(ve, &ve->owner_node, &mu->vhosts);
+}
+
+static void
+myuser_vhost_index_delete(struct myuser *mu, const struct metadata *md)
+{
+	struct myuser_vhost_entry *ve = NULL;
+	mowgli_node_t *n;
+
+	// only as long as the number of vhost keys this account has
+	MOWGLI_ITER_FOREACH(n, mu->vhosts.head)
+	{
+		if (((struct myuser_vhost_entry *) n->data)->key == md->key)
+		{
+			ve = n->data;
+			break;
+		}
+	}
+
+	if (ve == NULL)
+		return;
+
+	mowgli_node_delete(&ve->owner_node, &mu->vhosts);
+	mowgli_node_delete(&ve->node, ve->list);
+
+	if (! MOWGLI_LIST_LENGTH(ve->list))
+	{
+		(void) mowgli_patricia_delete(vhostlist, md->value);
+		mowgli_list_free(ve->list);
+	}
+
+	sfree(ve);
+}
+
+/* Metadata hook of every account, see atheme_object_init() */
+static void
+myuser_metadata_changed(void *target, const struct metadata *md, bool added)
+{
+	static const char prefix[] = "private:usercloak";
+
+	if (strncasecmp(md->name, prefix, sizeof prefix - 1) != 0)
+		return;
+
+	if (md->name[sizeof prefix - 1] != '\0' && md->name[sizeof prefix - 1] != ':')
+		return;
+
+	if (added)
+		myuser_vhost_index_add(target, md);
+	else
+		myuser_vhost_index_delete(target, md);
+}
+
+/*
+ * myuser_find_by_vhost(const char *vhost)
+ *
+ * Finds the accounts a vhost is assigned to, either account-wide or
+ * for one of their nicks.
+ *
+ * Inputs:
+ *      - a vhost (compared case-insensitively, no wildcards)
+ *
+ * Outputs:
+ *      - a list of struct myuser, or NULL if the vhost is not assigned;
+ *        an account may appear more than once
+ *
+ * Side Effects:
+ *      - none
+ */
+const mowgli_list_t *
+myuser_find_by_vhost(const char *vhost)
+{
+	return_val_if_fail(vhost != NULL, NULL);
+
+	return mowgli_patricia_retrieve(vhostlist, vhost);
 }
 
 /*
- * myuser_set_email(struct myuser *mu, const char *name)
+ * myuser_set_flags(struct myuser *mu, unsigned int flags)
  *
- * Changes the email address of an account.
+ * Changes the flags (MU_*) of an account. All changes to mu->flags must
+ * go through here, so that the flag indexes stay accurate.
  *
  * Inputs:
  *      - account to change
- *      - new email address; this must be valid
+ *      - its new set of flags
  *
  * Outputs:
- *      - nothing
+ *      - none
  *
  * Side Effects:
- *      - email address is changed
+ *      - the flag indexes are updated
  */
 void
-myuser_set_email(struct myuser *mu, const char *newemail)
+myuser_set_flags(struct myuser *mu, unsigned int flags)
 {
 	return_if_fail(mu != NULL);
-	return_if_fail(newemail != NULL);
 
-	strshare_unref(mu->email);
-	strshare_unref(mu->email_canonical);
+	mu->flags = flags;
+	flag_index_update(&myuser_flagindex, mu->flagslot, flags);
+}
 
-	mu->email = strshare_get(newemail);
-	mu->email_canonical = canonicalize_email(newemail);
+/*
+ * myuser_count_with_flags(unsigned int flagset)
+ *
+ * Counts the accounts that have all of the given flags set, from the
+ * flag indexes. A flagset of 0 counts all accounts.
+ *
+ * Inputs:
+ *      - set of MU_* flags
+ *
+ * Outputs:
+ *      - number of matching accounts
+ *
+ * Side Effects:
+ *      - none
+ */
+unsigned int
+myuser_count_with_flags(unsigned int flagset)
+{
+	return flag_index_count(&myuser_flagindex, flagset);
+}
+
+/*
+ * myuser_foreach_with_flags(unsigned int flagset,
+ *     int (*cb)(struct myuser *mu, void *privdata), void *privdata)
+ *
+ * Calls a function for every account that has all of the given flags set,
+ * until it returns nonzero. The callback must not change the flags of,
+ * add or delete accounts.
+ *
+ * Inputs:
+ *      - set of MU_* flags
+ *      - callback and its private data
+ *
+ * Outputs:
+ *      - none
+ *
+ * Side Effects:
+ *      - the callback is called
+ */
+void
+myuser_foreach_with_flags(unsigned int flagset, int (*cb)(struct myuser *mu, void *privdata), void *privdata)
+{
+	struct flag_index_iteration it;
+	struct myuser *mu;
+
+	return_if_fail(cb != NULL);
+
+	flag_index_start(&myuser_flagindex, flagset, &it);
+
+	while ((mu = flag_index_next(&myuser_flagindex, &it)) != NULL)
+		if (cb(mu, privdata))
+			break;
 }
 
 /*
@@ -490,11 +1155,15 @@ myuser_notice(const char *from, struct myuser *target, const char *fmt, ...)
 	vsnprintf(buf, BUFSIZE, fmt, ap);
 	va_end(ap);
 
+	notice_batch_begin();
+
 	MOWGLI_ITER_FOREACH(n, target->logins.head)
 	{
 		u = (struct user *)n->data;
 		notice(from, u->nick, "%s", buf);
 	}
+
+	notice_batch_end();
 }
 
 /*
@@ -680,7 +1349,7 @@ mynick_add(struct myuser *mu, const char *name)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "mynick_add(): %s -> %s", name, entity(mu)->name);
 
-	mn = mowgli_heap_alloc(mynick_heap);
+	mn = slab_alloc(mynick_heap);
 	atheme_object_init(atheme_object(mn), name, (atheme_object_destructor_fn) mynick_delete);
 
 	mowgli_strlcpy(mn->nick, name, sizeof mn->nick);
@@ -692,6 +1361,8 @@ mynick_add(struct myuser *mu, const char *name)
 
 	myuser_name_restore(mn->nick, mu);
 
+	expiry_schedule(&mynick_expiryq, &mn->expiry, CURRTIME);
+
 	cnt.mynick++;
 
 	return mn;
@@ -721,10 +1392,12 @@ mynick_delete(struct mynick *mn)
 
 	myuser_name_remember(mn->nick, mn->owner);
 
+	expiry_unschedule(&mynick_expiryq, &mn->expiry);
+
 	mowgli_patricia_delete(nicklist, mn->nick);
 	mowgli_node_delete(&mn->node, &mn->owner->nicks);
 
-	mowgli_heap_free(mynick_heap, mn);
+	slab_free(mynick_heap, mn);
 
 	cnt.mynick--;
 }
@@ -760,7 +1433,7 @@ myuser_name_add(const char *name)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "myuser_name_add(): %s", name);
 
-	mun = mowgli_heap_alloc(myuser_name_heap);
+	mun = slab_alloc(myuser_name_heap);
 	atheme_object_init(atheme_object(mun), name, (atheme_object_destructor_fn) myuser_name_delete);
 
 	mowgli_strlcpy(mun->name, name, sizeof mun->name);
@@ -798,7 +1471,7 @@ myuser_name_delete(struct myuser_name *mun)
 
 	metadata_delete_all(mun);
 
-	mowgli_heap_free(myuser_name_heap, mun);
+	slab_free(myuser_name_heap, mun);
 
 	cnt.myuser_name--;
 }
@@ -866,7 +1539,7 @@ myuser_name_restore(const char *name, struct myuser *mu)
 {
 	struct myuser_name *mun;
 	struct metadata *md, *md2;
-	mowgli_patricia_iteration_state_t state;
+	struct metadata_iteration_state state;
 	char *copy;
 
 	mun = myuser_name_find(name);
@@ -889,24 +1562,21 @@ myuser_name_restore(const char *name, struct myuser *mu)
 				md2->value, entity(mu)->name, name);
 	}
 
-	if (atheme_object(mun)->metadata)
+	METADATA_FOREACH(md, &state, mun)
 	{
-		MOWGLI_PATRICIA_FOREACH(md, &state, atheme_object(mun)->metadata)
+		/* prefer current metadata to saved */
+		if (!metadata_find(mu, md->name))
 		{
-			/* prefer current metadata to saved */
-			if (!metadata_find(mu, md->name))
+			if (strcmp(md->name, "private:mark:reason") ||
+					!strncmp(md->value, "(restored) ", 11))
+				metadata_add(mu, md->name, md->value);
+			else
 			{
-				if (strcmp(md->name, "private:mark:reason") ||
-						!strncmp(md->value, "(restored) ", 11))
-					metadata_add(mu, md->name, md->value);
-				else
-				{
-					copy = smalloc(strlen(md->value) + 12);
-					memcpy(copy, "(restored) ", 11);
-					strcpy(copy + 11, md->value);
-					metadata_add(mu, md->name, copy);
-					sfree(copy);
-				}
+				copy = smalloc(strlen(md->value) + 12);
+				memcpy(copy, "(restored) ", 11);
+				strcpy(copy + 11, md->value);
+				metadata_add(mu, md->name, copy);
+				sfree(copy);
 			}
 		}
 	}
@@ -928,7 +1598,7 @@ mycertfp_add(struct myuser *mu, const char *certfp)
 	return_val_if_fail(mu != NULL, NULL);
 	return_val_if_fail(certfp != NULL, NULL);
 
-	mcfp = mowgli_heap_alloc(mycertfp_heap);
+	mcfp = slab_alloc(mycertfp_heap);
 	mcfp->mu = mu;
 	mcfp->certfp = sstrdup(certfp);
 
@@ -949,7 +1619,7 @@ mycertfp_delete(struct mycertfp *mcfp)
 	mowgli_patricia_delete(certfplist, mcfp->certfp);
 
 	sfree(mcfp->certfp);
-	mowgli_heap_free(mycertfp_heap, mcfp);
+	slab_free(mycertfp_heap, mcfp);
 }
 
 struct mycertfp *
@@ -984,11 +1654,14 @@ mychan_delete(struct mychan *mc)
 
 	metadata_delete_all(mc);
 
+	expiry_unschedule(&mychan_expiryq, &mc->expiry);
+	flag_index_detach(&mychan_flagindex, mc->flagslot);
+
 	mowgli_patricia_delete(mclist, mc->name);
 
 	strshare_unref(mc->name);
 
-	mowgli_heap_free(mychan_heap, mc);
+	slab_free(mychan_heap, mc);
 
 	cnt.mychan--;
 }
@@ -1004,7 +1677,7 @@ mychan_add(char *name)
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "mychan_add(): %s", name);
 
-	mc = mowgli_heap_alloc(mychan_heap);
+	mc = slab_alloc(mychan_heap);
 
 	atheme_object_init(atheme_object(mc), name, (atheme_object_destructor_fn) mychan_delete);
 	mc->name = strshare_get(name);
@@ -1016,11 +1689,60 @@ mychan_add(char *name)
 
 	mowgli_patricia_add(mclist, mc->name, mc);
 
+	expiry_schedule(&mychan_expiryq, &mc->expiry, CURRTIME);
+	mc->flagslot = flag_index_attach(&mychan_flagindex, mc, 0);
+
 	cnt.mychan++;
 
 	return mc;
 }
 
+/*
+ * mychan_set_flags(struct mychan *mc, unsigned int flags)
+ *
+ * Changes the flags (MC_*) of a channel registration. All changes to
+ * mc->flags must go through here, so that the flag indexes stay accurate.
+ *
+ * Inputs:
+ *      - channel registration to change
+ *      - its new set of flags
+ *
+ * Outputs:
+ *      - none
+ *
+ * Side Effects:
+ *      - the flag indexes are updated
+ */
+void
+mychan_set_flags(struct mychan *mc, unsigned int flags)
+{
+	return_if_fail(mc != NULL);
+
+	mc->flags = flags;
+	flag_index_update(&mychan_flagindex, mc->flagslot, flags);
+}
+
+unsigned int
+mychan_count_with_flags(unsigned int flagset)
+{
+	return flag_index_count(&mychan_flagindex, flagset);
+}
+
+void
+mychan_foreach_with_flags(unsigned int flagset, int (*cb)(struct mychan *mc, void *privdata), void *privdata)
+{
+	struct flag_index_iteration it;
+	struct mychan *mc;
+
+	return_if_fail(cb != NULL);
+
+	flag_index_start(&mychan_flagindex, flagset, &it);
+
+	while ((mc = flag_index_next(&mychan_flagindex, &it)) != NULL)
+		if (cb(mc, privdata))
+			break;
+}
+
 
 /* Check if there is anyone on the channel fulfilling the conditions.
  * Fairly expensive, but this is sometimes necessary to avoid
@@ -1398,7 +2120,7 @@ chanacs_delete(struct chanacs *ca)
 
 	sfree(ca->host);
 
-	mowgli_heap_free(chanacs_heap, ca);
+	slab_free(chanacs_heap, ca);
 
 	cnt.chanacs--;
 }
@@ -1436,7 +2158,7 @@ chanacs_add(struct mychan *mychan, struct myentity *mt, unsigned int level, time
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "chanacs_add(): %s -> %s", mychan->name, mt->name);
 
-	ca = mowgli_heap_alloc(chanacs_heap);
+	ca = slab_alloc(chanacs_heap);
 
 	atheme_object_init(atheme_object(ca), mt->name, (atheme_object_destructor_fn) chanacs_delete);
 	ca->mychan = mychan;
@@ -1491,7 +2213,7 @@ chanacs_add_host(struct mychan *mychan, const char *host, unsigned int level, ti
 	if (!(runflags & RF_STARTING))
 		slog(LG_DEBUG, "chanacs_add_host(): %s -> %s", mychan->name, host);
 
-	ca = mowgli_heap_alloc(chanacs_heap);
+	ca = slab_alloc(chanacs_heap);
 
 	atheme_object_init(atheme_object(ca), host, (atheme_object_destructor_fn) chanacs_delete);
 	ca->mychan = mychan;
@@ -2015,14 +2737,141 @@ chanacs_change_simple(struct mychan *mychan, struct myentity *mt, const char *ho
 	return chanacs_change(mychan, mt, hostmask, &a, &r, ca_all, setter);
 }
 
+static bool
+myuser_expiry_due(const struct myuser *const mu, time_t *const due)
+{
+	bool ret = false;
+
+	if (nicksvs.expiry > 0)
+	{
+		*due = mu->lastlogin + nicksvs.expiry;
+		ret = true;
+	}
+
+	if (mu->flags & MU_WAITAUTH)
+	{
+		const time_t authdue = mu->registered + SECONDS_PER_DAY;
+
+		if (! ret || authdue < *due)
+			*due = authdue;
+
+		ret = true;
+	}
+
+	return ret;
+}
+
+static bool
+mynick_expiry_due(const struct mynick *const mn, time_t *const due)
+{
+	if (nicksvs.expiry == 0)
+		return false;
+
+	/* do not drop main nick like this */
+	if (!irccasecmp(mn->nick, entity(mn->owner)->name))
+		return false;
+
+	*due = mn->lastseen + nicksvs.expiry;
+	return true;
+}
+
+/* Channels stay queued even when they cannot expire: their last used time
+ * has to be refreshed while they are in use, and a channel that is idle now
+ * can be joined later without anything touching the queue. An idle channel
+ * is looked at again once a day.
+ */
+static bool
+mychan_expiry_due(const struct mychan *const mc, time_t *const due)
+{
+	*due = mc->used + MYCHAN_USED_REFRESH;
+
+	if (*due <= CURRTIME)
+		*due = CURRTIME + MYCHAN_USED_REFRESH;
+
+	if (chansvs.expiry > 0)
+	{
+		const time_t expdue = mc->used + chansvs.expiry;
+
+		if (expdue < *due)
+			*due = expdue;
+	}
+
+	return true;
+}
+
+/* puts a record that was looked at and kept back at its projected expiry
+ * time, or takes it out of the queue if it can currently never expire
+ */
+static void
+expiry_requeue(struct expiry_queue *const q, struct expiry_entry *const e, const bool queue, time_t due)
+{
+	if (! queue)
+	{
+		expiry_unschedule(q, e);
+		return;
+	}
+
+	if (due <= CURRTIME)
+		due = CURRTIME + EXPIRY_RECHECK;
+
+	expiry_schedule(q, e, due);
+}
+
 static int
-expire_myuser_cb(struct myentity *mt, void *unused)
+expiry_rebuild_myuser_cb(struct myentity *mt, void *unused)
 {
-	struct hook_expiry_req req;
-	struct myuser *mu = user(mt);
+	struct myuser *const mu = user(mt);
+	time_t due;
 
 	return_val_if_fail(isuser(mt), 0);
 
+	if (myuser_expiry_due(mu, &due))
+		expiry_append(&myuser_expiryq, &mu->expiry, due);
+
+	return 0;
+}
+
+/* Recomputes the position of every record in the expiry queues. This is
+ * O(n), but only happens on the first expire_check() run after startup and
+ * when the configured expiry periods change.
+ */
+static void
+expiry_rebuild(void)
+{
+	struct mynick *mn;
+	struct mychan *mc;
+	mowgli_patricia_iteration_state_t state;
+	time_t due;
+
+	expiry_clear(&myuser_expiryq);
+	expiry_clear(&mynick_expiryq);
+	expiry_clear(&mychan_expiryq);
+
+	myentity_foreach_t(ENT_USER, expiry_rebuild_myuser_cb, NULL);
+
+	MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+		if (mynick_expiry_due(mn, &due))
+			expiry_append(&mynick_expiryq, &mn->expiry, due);
+
+	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
+		if (mychan_expiry_due(mc, &due))
+			expiry_append(&mychan_expiryq, &mc->expiry, due);
+
+	expiry_heapify(&myuser_expiryq);
+	expiry_heapify(&mynick_expiryq);
+	expiry_heapify(&mychan_expiryq);
+
+	slog(LG_DEBUG, "expiry_rebuild(): %zu accounts, %zu nicks, %zu channels queued",
+			myuser_expiryq.count, mynick_expiryq.count, mychan_expiryq.count);
+}
+
+static void
+expire_myuser(struct myuser *mu)
+{
+	struct hook_expiry_req req;
+	time_t due = 0;
+	bool expires;
+
 	/* If they're logged in, update lastlogin time.
 	 * To decrease db traffic, may want to only do
 	 * this if the account would otherwise be
@@ -2031,18 +2880,25 @@ expire_myuser_cb(struct myentity *mt, void *unused)
 	if (MOWGLI_LIST_LENGTH(&mu->logins) > 0)
 	{
 		mu->lastlogin = CURRTIME;
-		return 0;
+		expiry_requeue(&myuser_expiryq, &mu->expiry, myuser_expiry_due(mu, &due), due);
+		return;
+	}
+
+	if (!(expires = myuser_expiry_due(mu, &due)) || due > CURRTIME)
+	{
+		expiry_requeue(&myuser_expiryq, &mu->expiry, expires, due);
+		return;
 	}
 
 	if (MU_HOLD & mu->flags)
-		return 0;
+		return;
 
 	req.data.mu = mu;
 	req.do_expire = 1;
 	hook_call_user_check_expire(&req);
 
 	if (!req.do_expire)
-		return 0;
+		return;
 
 	if ((nicksvs.expiry > 0 && mu->lastlogin < CURRTIME && (unsigned int)(CURRTIME - mu->lastlogin) >= nicksvs.expiry) ||
 			(mu->flags & MU_WAITAUTH && (CURRTIME - mu->registered) >= SECONDS_PER_DAY))
@@ -2051,7 +2907,7 @@ expire_myuser_cb(struct myentity *mt, void *unused)
 		 * otherwise someone can reregister
 		 * them and take the privs -- jilles */
 		if (is_conf_soper(mu))
-			return 0;
+			return;
 
 		slog(LG_REGISTER, "EXPIRE: \2%s\2 from \2%s\2 ", entity(mu)->name, mu->email);
 		slog(LG_VERBOSE, "expire_check(): expiring account %s (unused %ds, email %s, nicks %zu, chanacs %zu)",
@@ -2059,107 +2915,173 @@ expire_myuser_cb(struct myentity *mt, void *unused)
 				mu->email, MOWGLI_LIST_LENGTH(&mu->nicks),
 				MOWGLI_LIST_LENGTH(&entity(mu)->chanacs));
 		atheme_object_dispose(mu);
+		return;
 	}
 
-	return 0;
+	expiry_requeue(&myuser_expiryq, &mu->expiry, myuser_expiry_due(mu, &due), due);
 }
 
-void
-expire_check(void *arg)
+static void
+expire_mynick(struct mynick *mn)
 {
-	struct mynick *mn;
-	struct mychan *mc;
 	struct user *u;
-	mowgli_patricia_iteration_state_t state;
 	struct hook_expiry_req req;
+	time_t due = 0;
+	bool expires;
 
-	/* Let them know about this and the likely subsequent db_save()
-	 * right away -- jilles */
-	if (curr_uplink != NULL && curr_uplink->conn != NULL)
-		sendq_flush(curr_uplink->conn);
+	if (!(expires = mynick_expiry_due(mn, &due)) || due > CURRTIME)
+	{
+		expiry_requeue(&mynick_expiryq, &mn->expiry, expires, due);
+		return;
+	}
 
-	myentity_foreach_t(ENT_USER, expire_myuser_cb, NULL);
+	req.do_expire = 1;
+	req.data.mn = mn;
 
-	MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
-	{
-		req.do_expire = 1;
-		req.data.mn = mn;
+	hook_call_nick_check_expire(&req);
 
-		hook_call_nick_check_expire(&req);
+	if (!req.do_expire)
+		return;
 
-		if (!req.do_expire)
-			continue;
+	if (nicksvs.expiry > 0 && mn->lastseen < CURRTIME &&
+			(unsigned int)(CURRTIME - mn->lastseen) >= nicksvs.expiry)
+	{
+		if (MU_HOLD & mn->owner->flags)
+			return;
 
-		if (nicksvs.expiry > 0 && mn->lastseen < CURRTIME &&
-				(unsigned int)(CURRTIME - mn->lastseen) >= nicksvs.expiry)
+		u = user_find_named(mn->nick);
+		if (u != NULL && u->myuser == mn->owner)
 		{
-			if (MU_HOLD & mn->owner->flags)
-				continue;
+			/* still logged in, bleh */
+			mn->lastseen = CURRTIME;
+			mn->owner->lastlogin = CURRTIME;
+			expiry_requeue(&mynick_expiryq, &mn->expiry, mynick_expiry_due(mn, &due), due);
+			return;
+		}
 
-			/* do not drop main nick like this */
-			if (!irccasecmp(mn->nick, entity(mn->owner)->name))
-				continue;
+		slog(LG_REGISTER, "EXPIRE: \2%s\2 from \2%s\2", mn->nick, entity(mn->owner)->name);
+		slog(LG_VERBOSE, "expire_check(): expiring nick %s (unused %lds, account %s)",
+				mn->nick, (long)(CURRTIME - mn->lastseen),
+				entity(mn->owner)->name);
+		atheme_object_unref(mn);
+	}
+}
 
-			u = user_find_named(mn->nick);
-			if (u != NULL && u->myuser == mn->owner)
-			{
-				/* still logged in, bleh */
-				mn->lastseen = CURRTIME;
-				mn->owner->lastlogin = CURRTIME;
-				continue;
-			}
+static void
+expire_mychan(struct mychan *mc)
+{
+	struct hook_expiry_req req;
+	time_t due = 0;
 
-			slog(LG_REGISTER, "EXPIRE: \2%s\2 from \2%s\2", mn->nick, entity(mn->owner)->name);
-			slog(LG_VERBOSE, "expire_check(): expiring nick %s (unused %lds, account %s)",
-					mn->nick, (long)(CURRTIME - mn->lastseen),
-					entity(mn->owner)->name);
-			atheme_object_unref(mn);
+	req.do_expire = 1;
+	req.data.mc = mc;
+
+	hook_call_channel_check_expire(&req);
+
+	if (!req.do_expire)
+		return;
+
+	if ((unsigned int) (CURRTIME - mc->used) >= MYCHAN_USED_REFRESH)
+	{
+		/* keep last used time accurate to
+		 * within a day, making sure an active
+		 * channel will never get "Last used"
+		 * in /cs info -- jilles */
+		if (mychan_isused(mc))
+		{
+			mc->used = CURRTIME;
+			slog(LG_DEBUG, "expire_check(): updating last used time on %s because it appears to be still in use", mc->name);
+			expiry_requeue(&mychan_expiryq, &mc->expiry, mychan_expiry_due(mc, &due), due);
+			return;
 		}
 	}
 
-	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
+	if (chansvs.expiry > 0 && mc->used < CURRTIME &&
+			(unsigned int)(CURRTIME - mc->used) >= chansvs.expiry)
 	{
-		req.do_expire = 1;
-		req.data.mc = mc;
+		if (MC_HOLD & mc->flags)
+			return;
 
-		hook_call_channel_check_expire(&req);
+		slog(LG_REGISTER, "EXPIRE: \2%s\2 from \2%s\2", mc->name, mychan_founder_names(mc));
+		slog(LG_VERBOSE, "expire_check(): expiring channel %s (unused %lds, founder %s, chanacs %zu)",
+				mc->name, (long)(CURRTIME - mc->used),
+				mychan_founder_names(mc),
+				MOWGLI_LIST_LENGTH(&mc->chanacs));
 
-		if (!req.do_expire)
-			continue;
+		hook_call_channel_drop(mc);
+		if (mc->chan != NULL && !(mc->chan->flags & CHAN_LOG))
+			part(mc->name, chansvs.nick);
 
-		if ((unsigned int) (CURRTIME - mc->used) >= (SECONDS_PER_DAY - SECONDS_PER_HOUR - SECONDS_PER_MINUTE))
-		{
-			/* keep last used time accurate to
-			 * within a day, making sure an active
-			 * channel will never get "Last used"
-			 * in /cs info -- jilles */
-			if (mychan_isused(mc))
-			{
-				mc->used = CURRTIME;
-				slog(LG_DEBUG, "expire_check(): updating last used time on %s because it appears to be still in use", mc->name);
-				continue;
-			}
-		}
+		atheme_object_unref(mc);
+		return;
+	}
 
-		if (chansvs.expiry > 0 && mc->used < CURRTIME &&
-				(unsigned int)(CURRTIME - mc->used) >= chansvs.expiry)
-		{
-			if (MC_HOLD & mc->flags)
-				continue;
+	expiry_requeue(&mychan_expiryq, &mc->expiry, mychan_expiry_due(mc, &due), due);
+}
 
-			slog(LG_REGISTER, "EXPIRE: \2%s\2 from \2%s\2", mc->name, mychan_founder_names(mc));
-			slog(LG_VERBOSE, "expire_check(): expiring channel %s (unused %lds, founder %s, chanacs %zu)",
-					mc->name, (long)(CURRTIME - mc->used),
-					mychan_founder_names(mc),
-					MOWGLI_LIST_LENGTH(&mc->chanacs));
+/*
+ * expire_check(void *arg)
+ *
+ * Expires accounts, nicks and channels that have not been used for longer
+ * than the configured expiry periods.
+ *
+ * Only the records at the front of the expiry queues, i.e. those that are
+ * actually due, are looked at. Each of them is first pushed back by
+ * EXPIRY_RECHECK so that it will be looked at again on a later run if it
+ * is kept for a reason that cannot be predicted (held, vetoed by a hook,
+ * ...); the expire_*() functions then either drop it or move it to its
+ * new projected expiry time.
+ */
+static void
+expire_check_run(void)
+{
+	static unsigned int nick_expiry, chan_expiry;
+	static bool rebuilt = false;
+	struct expiry_entry *e;
 
-			hook_call_channel_drop(mc);
-			if (mc->chan != NULL && !(mc->chan->flags & CHAN_LOG))
-				part(mc->name, chansvs.nick);
+	if (!rebuilt || nick_expiry != nicksvs.expiry || chan_expiry != chansvs.expiry)
+	{
+		nick_expiry = nicksvs.expiry;
+		chan_expiry = chansvs.expiry;
+		rebuilt = true;
 
-			atheme_object_unref(mc);
-		}
+		expiry_rebuild();
+	}
+
+	if (!expiry_next_due(&myuser_expiryq) && !expiry_next_due(&mynick_expiryq) && !expiry_next_due(&mychan_expiryq))
+		return;
+
+	/* Let them know about this and the likely subsequent db_save()
+	 * right away -- jilles */
+	if (curr_uplink != NULL && curr_uplink->conn != NULL)
+		sendq_flush(curr_uplink->conn);
+
+	while ((e = expiry_next_due(&myuser_expiryq)) != NULL)
+	{
+		expiry_schedule(&myuser_expiryq, e, CURRTIME + EXPIRY_RECHECK);
+		expire_myuser(EXPIRY_CONTAINER(e, struct myuser));
+	}
+
+	while ((e = expiry_next_due(&mynick_expiryq)) != NULL)
+	{
+		expiry_schedule(&mynick_expiryq, e, CURRTIME + EXPIRY_RECHECK);
+		expire_mynick(EXPIRY_CONTAINER(e, struct mynick));
 	}
+
+	while ((e = expiry_next_due(&mychan_expiryq)) != NULL)
+	{
+		expiry_schedule(&mychan_expiryq, e, CURRTIME + EXPIRY_RECHECK);
+		expire_mychan(EXPIRY_CONTAINER(e, struct mychan));
+	}
+}
+
+// A large expiry run can hold up the main loop for a while, so it is named for stall detection
+void
+expire_check(void *arg)
+{
+	stall_context_push("timer", "expire_check", NULL);
+	expire_check_run();
+	stall_context_pop();
 }
 
 static int
@@ -60,6 +60,7 @@ bool permissive_mode = false;
 bool database_create = false;
 
 void (*db_save) (void *arg, enum db_save_strategy strategy) = NULL;
+struct latency_histogram db_save_latency;
 void (*db_load) (const char *name) = NULL;
 
 /* *INDENT-OFF* */
@@ -381,10 +382,14 @@ db_save_periodic(void *unused)
 {
 	slog(LG_DEBUG, "db_save_periodic(): initiating periodic database write");
 
+	stall_context_push("timer", "db_save_periodic", NULL);
+
 	if (config_options.db_save_blocking)
 		db_save(unused, DB_SAVE_BLOCKING);
 	else
 		db_save(unused, DB_SAVE_BG_REGULAR);
+
+	stall_context_pop();
 }
 
 int
@@ -31,13 +31,13 @@ set_password(struct myuser *const restrict mu, const char *const restrict passwo
 
 	if (hash)
 	{
-		mu->flags |= MU_CRYPTPASS;
+		myuser_set_flags(mu, mu->flags | MU_CRYPTPASS);
 
 		(void) mowgli_strlcpy(mu->pass, hash, sizeof mu->pass);
 	}
 	else
 	{
-		mu->flags &= ~MU_CRYPTPASS;
+		myuser_set_flags(mu, mu->flags & ~MU_CRYPTPASS);
 
 		(void) mowgli_strlcpy(mu->pass, password, sizeof mu->pass);
 		(void) slog(LG_ERROR, "%s: failed to encrypt password for account '%s'",
@@ -17,12 +17,12 @@
 #include "internal.h"
 
 static mowgli_list_t authcookie_list;
-static mowgli_heap_t *authcookie_heap = NULL;
+static struct slab_type *authcookie_heap = NULL;
 
 void
 authcookie_init(void)
 {
-	authcookie_heap = sharedheap_get(sizeof(struct authcookie));
+	authcookie_heap = slab_type_create("authcookie", sizeof(struct authcookie));
 
 	if (!authcookie_heap)
 	{
@@ -46,7 +46,7 @@ authcookie_init(void)
 struct authcookie *
 authcookie_create(struct myuser *mu)
 {
-	struct authcookie *const au = mowgli_heap_alloc(authcookie_heap);
+	struct authcookie *const au = slab_alloc(authcookie_heap);
 	au->ticket = random_string(AUTHCOOKIE_LENGTH);
 	au->myuser = mu;
 	au->expire = CURRTIME + SECONDS_PER_HOUR;
@@ -131,7 +131,7 @@ authcookie_destroy(struct authcookie * ac)
 
 	mowgli_node_delete(&ac->node, &authcookie_list);
 	sfree(ac->ticket);
-	mowgli_heap_free(authcookie_heap, ac);
+	slab_free(authcookie_heap, ac);
 }
 
 /*
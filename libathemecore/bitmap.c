@@ -0,0 +1,455 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * bitmap.c: Compressed bitmaps of small integers.
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+// A sorted array of this many uint16_t is as large as a full bitmap
+#define BITMAP_ARRAY_MAX        4096U
+#define BITMAP_WORDS            (65536U / 64U)
+
+static unsigned int
+popcount64(uint64_t w)
+{
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+	return (unsigned int) ((w * 0x0101010101010101ULL) >> 56);
+}
+
+static unsigned int
+ctz64(uint64_t w)
+{
+	// w is never 0 here
+	return popcount64((w & -w) - 1U);
+}
+
+static bool
+container_find(const struct bitmap *const restrict bm, const uint16_t key, size_t *const restrict idx)
+{
+	size_t lo = 0, hi = bm->count;
+
+	while (lo < hi)
+	{
+		const size_t mid = lo + ((hi - lo) / 2U);
+
+		if (bm->containers[mid].key < key)
+			lo = mid + 1U;
+		else
+			hi = mid;
+	}
+
+	*idx = lo;
+
+	return (lo < bm->count && bm->containers[lo].key == key);
+}
+
+static struct bitmap_container *
+container_insert(struct bitmap *const restrict bm, const size_t idx, const uint16_t key)
+{
+	if (bm->count == bm->size)
+	{
+		bm->size = bm->size ? (bm->size * 2U) : 4U;
+		bm->containers = sreallocarray(bm->containers, bm->size, sizeof *bm->containers);
+	}
+
+	(void) memmove(&bm->containers[idx + 1U], &bm->containers[idx],
+	               (bm->count - idx) * sizeof *bm->containers);
+	bm->count++;
+
+	struct bitmap_container *const c = &bm->containers[idx];
+
+	(void) memset(c, 0x00, sizeof *c);
+	c->key = key;
+
+	return c;
+}
+
+static void
+container_delete(struct bitmap *const restrict bm, const size_t idx)
+{
+	struct bitmap_container *const c = &bm->containers[idx];
+
+	(void) sfree(c->array);
+	(void) sfree(c->words);
+
+	bm->count--;
+	(void) memmove(&bm->containers[idx], &bm->containers[idx + 1U],
+	               (bm->count - idx) * sizeof *bm->containers);
+}
+
+static bool
+array_find(const struct bitmap_container *const restrict c, const uint16_t low, unsigned int *const restrict pos)
+{
+	unsigned int lo = 0, hi = c->card;
+
+	while (lo < hi)
+	{
+		const unsigned int mid = lo + ((hi - lo) / 2U);
+
+		if (c->array[mid] < low)
+			lo = mid + 1U;
+		else
+			hi = mid;
+	}
+
+	*pos = lo;
+
+	return (lo < c->card && c->array[lo] == low);
+}
+
+static void
+container_to_words(struct bitmap_container *const restrict c)
+{
+	c->words = smalloc(BITMAP_WORDS * sizeof *c->words);
+
+	for (unsigned int i = 0; i < c->card; i++)
+		c->words[c->array[i] >> 6] |= (UINT64_C(1) << (c->array[i] & 63U));
+
+	(void) sfree(c->array);
+	c->array = NULL;
+	c->cap = 0;
+}
+
+static void
+container_to_array(struct bitmap_container *const restrict c)
+{
+	unsigned int n = 0;
+
+	c->cap = c->card;
+	c->array = smalloc(c->cap * sizeof *c->array);
+
+	for (unsigned int i = 0; i < BITMAP_WORDS; i++)
+	{
+		uint64_t w = c->words[i];
+
+		while (w)
+		{
+			c->array[n++] = (uint16_t) ((i << 6) | ctz64(w));
+			w &= (w - 1U);
+		}
+	}
+
+	(void) sfree(c->words);
+	c->words = NULL;
+}
+
+/*
+ * bitmap_add(struct bitmap *bm, uint32_t value)
+ *
+ * Adds a value to a bitmap. A zero-initialised struct bitmap is empty.
+ *
+ * Inputs:
+ *      - bitmap to modify
+ *      - value to add
+ *
+ * Outputs:
+ *      - true if the value was added, false if it was already present
+ *
+ * Side Effects:
+ *      - none
+ */
+bool
+bitmap_add(struct bitmap *const restrict bm, const uint32_t value)
+{
+	const uint16_t key = (uint16_t) (value >> 16);
+	const uint16_t low = (uint16_t) (value & 0xFFFFU);
+	struct bitmap_container *c;
+	unsigned int pos;
+	size_t idx;
+
+	return_val_if_fail(bm != NULL, false);
+
+	if (container_find(bm, key, &idx))
+		c = &bm->containers[idx];
+	else
+		c = container_insert(bm, idx, key);
+
+	if (c->words == NULL && c->card == BITMAP_ARRAY_MAX && !array_find(c, low, &pos))
+		container_to_words(c);
+
+	if (c->words != NULL)
+	{
+		const uint64_t bit = (UINT64_C(1) << (low & 63U));
+
+		if (c->words[low >> 6] & bit)
+			return false;
+
+		c->words[low >> 6] |= bit;
+	}
+	else
+	{
+		if (array_find(c, low, &pos))
+			return false;
+
+		if (c->card == c->cap)
+		{
+			c->cap = c->cap ? (c->cap * 2U) : 4U;
+			c->array = sreallocarray(c->array, c->cap, sizeof *c->array);
+		}
+
+		(void) memmove(&c->array[pos + 1U], &c->array[pos], (c->card - pos) * sizeof *c->array);
+		c->array[pos] = low;
+	}
+
+	c->card++;
+	bm->card++;
+
+	return true;
+}
+
+/*
+ * bitmap_remove(struct bitmap *bm, uint32_t value)
+ *
+ * Removes a value from a bitmap.
+ *
+ * Inputs:
+ *      - bitmap to modify
+ *      - value to remove
+ *
+ * Outputs:
+ *      - true if the value was removed, false if it was not present
+ *
+ * Side Effects:
+ *      - none
+ */
+bool
+bitmap_remove(struct bitmap *const restrict bm, const uint32_t value)
+{
+	const uint16_t key = (uint16_t) (value >> 16);
+	const uint16_t low = (uint16_t) (value & 0xFFFFU);
+	struct bitmap_container *c;
+	unsigned int pos;
+	size_t idx;
+
+	return_val_if_fail(bm != NULL, false);
+
+	if (!container_find(bm, key, &idx))
+		return false;
+
+	c = &bm->containers[idx];
+
+	if (c->words != NULL)
+	{
+		const uint64_t bit = (UINT64_C(1) << (low & 63U));
+
+		if (! (c->words[low >> 6] & bit))
+			return false;
+
+		c->words[low >> 6] &= ~bit;
+	}
+	else
+	{
+		if (!array_find(c, low, &pos))
+			return false;
+
+		(void) memmove(&c->array[pos], &c->array[pos + 1U], (c->card - pos - 1U) * sizeof *c->array);
+	}
+
+	c->card--;
+	bm->card--;
+
+	if (c->card == 0)
+		container_delete(bm, idx);
+	else if (c->words != NULL && c->card <= (BITMAP_ARRAY_MAX / 2U))
+		container_to_array(c);
+
+	return true;
+}
+
+bool
+bitmap_contains(const struct bitmap *const restrict bm, const uint32_t value)
+{
+	const uint16_t key = (uint16_t) (value >> 16);
+	const uint16_t low = (uint16_t) (value & 0xFFFFU);
+	const struct bitmap_container *c;
+	unsigned int pos;
+	size_t idx;
+
+	return_val_if_fail(bm != NULL, false);
+
+	if (!container_find(bm, key, &idx))
+		return false;
+
+	c = &bm->containers[idx];
+
+	if (c->words != NULL)
+		return (c->words[low >> 6] & (UINT64_C(1) << (low & 63U))) != 0;
+
+	return array_find(c, low, &pos);
+}
+
+void
+bitmap_clear(struct bitmap *const restrict bm)
+{
+	return_if_fail(bm != NULL);
+
+	for (size_t i = 0; i < bm->count; i++)
+	{
+		(void) sfree(bm->containers[i].array);
+		(void) sfree(bm->containers[i].words);
+	}
+
+	(void) sfree(bm->containers);
+	(void) memset(bm, 0x00, sizeof *bm);
+}
+
+static size_t
+container_and_count(const struct bitmap_container *const restrict a, const struct bitmap_container *const restrict b)
+{
+	size_t count = 0;
+
+	if (a->words != NULL && b->words != NULL)
+	{
+		for (unsigned int i = 0; i < BITMAP_WORDS; i++)
+			count += popcount64(a->words[i] & b->words[i]);
+	}
+	else if (a->words != NULL || b->words != NULL)
+	{
+		const struct bitmap_container *const arr = (a->words != NULL) ? b : a;
+		const struct bitmap_container *const bits = (a->words != NULL) ? a : b;
+
+		for (unsigned int i = 0; i < arr->card; i++)
+			if (bits->words[arr->array[i] >> 6] & (UINT64_C(1) << (arr->array[i] & 63U)))
+				count++;
+	}
+	else
+	{
+		unsigned int i = 0, j = 0;
+
+		while (i < a->card && j < b->card)
+		{
+			if (a->array[i] < b->array[j])
+				i++;
+			else if (a->array[i] > b->array[j])
+				j++;
+			else
+			{
+				count++;
+				i++;
+				j++;
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+ * bitmap_and_count(const struct bitmap *a, const struct bitmap *b)
+ *
+ * Counts the values present in both bitmaps, without building the
+ * intersection.
+ *
+ * Inputs:
+ *      - two bitmaps
+ *
+ * Outputs:
+ *      - the size of their intersection
+ *
+ * Side Effects:
+ *      - none
+ */
+size_t
+bitmap_and_count(const struct bitmap *const restrict a, const struct bitmap *const restrict b)
+{
+	size_t i = 0, j = 0, count = 0;
+
+	return_val_if_fail(a != NULL, 0);
+	return_val_if_fail(b != NULL, 0);
+
+	while (i < a->count && j < b->count)
+	{
+		if (a->containers[i].key < b->containers[j].key)
+			i++;
+		else if (a->containers[i].key > b->containers[j].key)
+			j++;
+		else
+			count += container_and_count(&a->containers[i++], &b->containers[j++]);
+	}
+
+	return count;
+}
+
+void
+bitmap_iteration_start(struct bitmap_iteration_state *const restrict state)
+{
+	return_if_fail(state != NULL);
+
+	state->container = 0;
+	state->pos = 0;
+}
+
+/*
+ * bitmap_iteration_next(const struct bitmap *bm, struct bitmap_iteration_state *state, uint32_t *value)
+ *
+ * Returns the values of a bitmap in ascending order. The bitmap must not
+ * be modified during the iteration.
+ *
+ * Inputs:
+ *      - bitmap to iterate
+ *      - iteration state, set up with bitmap_iteration_start()
+ *
+ * Outputs:
+ *      - true and the next value in *value, or false at the end
+ *
+ * Side Effects:
+ *      - the iteration state is advanced
+ */
+bool
+bitmap_iteration_next(const struct bitmap *const restrict bm, struct bitmap_iteration_state *const restrict state,
+                      uint32_t *const restrict value)
+{
+	return_val_if_fail(bm != NULL, false);
+	return_val_if_fail(state != NULL, false);
+	return_val_if_fail(value != NULL, false);
+
+	while (state->container < bm->count)
+	{
+		const struct bitmap_container *const c = &bm->containers[state->container];
+		const uint32_t high = ((uint32_t) c->key << 16);
+
+		if (c->words == NULL)
+		{
+			if (state->pos < c->card)
+			{
+				*value = high | c->array[state->pos++];
+				return true;
+			}
+		}
+		else
+		{
+			while (state->pos < 65536U)
+			{
+				const uint64_t w = (c->words[state->pos >> 6] >> (state->pos & 63U));
+
+				if (w == 0)
+				{
+					state->pos = ((state->pos | 63U) + 1U);
+					continue;
+				}
+
+				state->pos += ctz64(w);
+				*value = high | state->pos++;
+				return true;
+			}
+		}
+
+		state->container++;
+		state->pos = 0;
+	}
+
+	return false;
+}
@@ -18,9 +18,12 @@
 
 mowgli_patricia_t *chanlist;
 
-static mowgli_heap_t *chan_heap = NULL;
-static mowgli_heap_t *chanuser_heap = NULL;
-static mowgli_heap_t *chanban_heap = NULL;
+static struct slab_type *chan_heap = NULL;
+static struct slab_type *chanuser_heap = NULL;
+static struct slab_type *chanban_heap = NULL;
+
+static unsigned int channel_sweep_depth = 0;
+static mowgli_list_t channel_sweep_list;
 
 /*
  * init_channels()
@@ -39,9 +42,9 @@ static mowgli_heap_t *chanban_heap = NULL;
 void
 init_channels(void)
 {
-	chan_heap = sharedheap_get(sizeof(struct channel));
-	chanuser_heap = sharedheap_get(sizeof(struct chanuser));
-	chanban_heap = sharedheap_get(sizeof(struct chanban));
+	chan_heap = slab_type_create("channel", sizeof(struct channel));
+	chanuser_heap = slab_type_create("chanuser", sizeof(struct chanuser));
+	chanban_heap = slab_type_create("chanban", sizeof(struct chanban));
 
 	if (chan_heap == NULL || chanuser_heap == NULL || chanban_heap == NULL)
 	{
@@ -96,7 +99,7 @@ channel_add(const char *name, time_t ts, struct server *creator)
 
 	slog(LG_DEBUG, "channel_add(): %s by %s", name, creator->name);
 
-	c = mowgli_heap_alloc(chan_heap);
+	c = slab_alloc(chan_heap);
 
 	c->name = sstrdup(name);
 	c->ts = ts;
@@ -154,6 +157,12 @@ channel_delete(struct channel *c)
 
 	slog(LG_DEBUG, "channel_delete(): %s", c->name);
 
+	if (c->flags & CHAN_SWEEP)
+	{
+		mowgli_node_delete(&c->sweepnode, &channel_sweep_list);
+		c->flags &= ~CHAN_SWEEP;
+	}
+
 	modestack_finalize_channel(c);
 
 	/* If this is called from uplink_close(), there may still be services
@@ -166,7 +175,9 @@ channel_delete(struct channel *c)
 		soft_assert(is_internal_client(cu->user) && !me.connected);
 		mowgli_node_delete(&cu->cnode, &c->members);
 		mowgli_node_delete(&cu->unode, &cu->user->channels);
-		mowgli_heap_free(chanuser_heap, cu);
+		if (is_internal_client(cu->user))
+			mowgli_node_delete(&cu->snode, &c->svcmembers);
+		slab_free(chanuser_heap, cu);
 		cnt.chanuser--;
 	}
 	c->nummembers = 0;
@@ -187,7 +198,7 @@ channel_delete(struct channel *c)
 	sfree(c->topic);
 	sfree(c->topic_setter);
 
-	mowgli_heap_free(chan_heap, c);
+	slab_free(chan_heap, c);
 
 	cnt.chan--;
 }
@@ -234,7 +245,7 @@ chanban_add(struct channel *chan, const char *mask, int type)
 
 	slog(LG_DEBUG, "chanban_add(): %s +%c %s", chan->name, type, mask);
 
-	c = mowgli_heap_alloc(chanban_heap);
+	c = slab_alloc(chanban_heap);
 
 	c->chan = chan;
 	c->mask = sstrdup(mask);
@@ -267,7 +278,7 @@ chanban_delete(struct chanban * c)
 	mowgli_node_delete(&c->node, &c->chan->bans);
 
 	sfree(c->mask);
-	mowgli_heap_free(chanban_heap, c);
+	slab_free(chanban_heap, c);
 }
 
 /*
@@ -307,6 +318,78 @@ chanban_find(struct channel *chan, const char *mask, int type)
 	return NULL;
 }
 
+/*
+ * channel_sweep_begin()
+ *
+ * Defers destroying channels that lose their last member until the
+ * matching channel_sweep_end(), so that removing many users at once
+ * (e.g. a netsplit) destroys each emptied channel exactly once, after
+ * everyone has gone. Calls may be nested.
+ *
+ * Inputs:
+ *     - nothing
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - emptied channels stay in the channel list, with no members,
+ *       until the sweep ends
+ */
+void
+channel_sweep_begin(void)
+{
+	channel_sweep_depth++;
+}
+
+/*
+ * channel_sweep_end()
+ *
+ * Ends a channel_sweep_begin() and, once the outermost one ends, destroys
+ * every channel emptied in the meantime that is still empty.
+ *
+ * Inputs:
+ *     - nothing
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - channel_delete() is called for each such channel
+ */
+void
+channel_sweep_end(void)
+{
+	mowgli_node_t *n;
+	struct channel *c;
+	unsigned int swept = 0;
+
+	return_if_fail(channel_sweep_depth != 0);
+
+	if (--channel_sweep_depth != 0)
+		return;
+
+	/* a channel_delete hook may empty or delete other queued channels,
+	 * so always take the head of the list
+	 */
+	while ((n = channel_sweep_list.head) != NULL)
+	{
+		c = n->data;
+		mowgli_node_delete(&c->sweepnode, &channel_sweep_list);
+		c->flags &= ~CHAN_SWEEP;
+
+		/* someone may have joined or set it permanent since */
+		if (c->nummembers != 0 || (c->modes & ircd->perm_mode))
+			continue;
+
+		channel_delete(c);
+		swept++;
+	}
+
+	if (swept != 0)
+		slog(LG_DEBUG, "channel_sweep_end(): removed %u empty channels", swept);
+}
+
 /*
  * chanuser_add(struct channel *chan, const char *nick)
  *
@@ -390,7 +473,7 @@ chanuser_add(struct channel *chan, const char *nick)
 
 	slog(LG_DEBUG, "chanuser_add(): %s -> %s", chan->name, u->nick);
 
-	cu = mowgli_heap_alloc(chanuser_heap);
+	cu = slab_alloc(chanuser_heap);
 
 	cu->chan = chan;
 	cu->user = u;
@@ -398,7 +481,10 @@ chanuser_add(struct channel *chan, const char *nick)
 
 	chan->nummembers++;
 	if (is_internal_client(u))
+	{
 		chan->numsvcmembers++;
+		mowgli_node_add(cu, &cu->snode, &chan->svcmembers);
+	}
 
 	mowgli_node_add(cu, &cu->cnode, &chan->members);
 	mowgli_node_add(cu, &cu->unode, &u->channels);
@@ -436,7 +522,6 @@ void
 chanuser_delete(struct channel *chan, struct user *user)
 {
 	struct chanuser *cu;
-	struct hook_channel_joinpart hdata;
 
 	return_if_fail(chan != NULL);
 	return_if_fail(user != NULL);
@@ -445,6 +530,38 @@ chanuser_delete(struct channel *chan, struct user *user)
 	if (cu == NULL)
 		return;
 
+	chanuser_delete_member(cu);
+}
+
+/*
+ * chanuser_delete_member(struct chanuser *cu)
+ *
+ * Destroys a channel user object that the caller already has, such as
+ * one found by walking the user's channel list.
+ *
+ * Inputs:
+ *     - the channel user object
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - same as chanuser_delete(), except that between channel_sweep_begin()
+ *       and channel_sweep_end() an emptied channel is only queued for
+ *       destruction
+ */
+void
+chanuser_delete_member(struct chanuser *cu)
+{
+	struct channel *chan;
+	struct user *user;
+	struct hook_channel_joinpart hdata;
+
+	return_if_fail(cu != NULL);
+
+	chan = cu->chan;
+	user = cu->user;
+
 	/* this is called BEFORE we remove the user */
 	hdata.cu = cu;
 	hook_call_channel_part(&hdata);
@@ -454,16 +571,30 @@ chanuser_delete(struct channel *chan, struct user *user)
 	mowgli_node_delete(&cu->cnode, &chan->members);
 	mowgli_node_delete(&cu->unode, &user->channels);
 
-	mowgli_heap_free(chanuser_heap, cu);
+	if (is_internal_client(user))
+	{
+		mowgli_node_delete(&cu->snode, &chan->svcmembers);
+		chan->numsvcmembers--;
+	}
+
+	slab_free(chanuser_heap, cu);
 
 	chan->nummembers--;
 	cnt.chanuser--;
 
-	if (is_internal_client(user))
-		chan->numsvcmembers--;
-
 	if (chan->nummembers == 0 && !(chan->modes & ircd->perm_mode))
 	{
+		if (channel_sweep_depth != 0)
+		{
+			if (!(chan->flags & CHAN_SWEEP))
+			{
+				chan->flags |= CHAN_SWEEP;
+				mowgli_node_add(chan, &chan->sweepnode, &channel_sweep_list);
+			}
+
+			return;
+		}
+
 		/* empty channels die */
 		slog(LG_DEBUG, "chanuser_delete(): `%s' is empty, removing", chan->name);
 
@@ -918,7 +918,7 @@ check_modes(struct mychan *mychan, bool sendnow)
 
 	if (!mychan || !mychan->chan)
 		return;
-	mychan->flags &= ~MC_MLOCK_CHECK;
+	mychan_set_flags(mychan, mychan->flags & ~MC_MLOCK_CHECK);
 
 	/* check what's locked on */
 	modes = ~mychan->chan->modes & mychan->mlock_on;
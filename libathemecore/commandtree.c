@@ -16,6 +16,25 @@
 #include <atheme.h>
 #include "internal.h"
 
+/* A dispatch table is a flat, case-insensitive hash table of every name a
+ * command tree can be invoked by, with aliases already resolved to the
+ * command they run. It uses linear probing at no more than half load, and
+ * keeps each name's full hash so that a probe only compares strings when
+ * the hashes match.
+ */
+struct command_dispatch_slot
+{
+	const char *                    name;   // NULL if the slot is empty
+	struct command *                cmd;    // NULL for an alias to a missing command
+	uint32_t                        hash;
+};
+
+struct command_dispatch
+{
+	size_t                          mask;
+	struct command_dispatch_slot    slots[];
+};
+
 static bool permissive_mode_fallback = false;
 
 static int
@@ -122,6 +141,178 @@ command_find(mowgli_patricia_t *commandtree, const char *command)
 	return mowgli_patricia_retrieve(commandtree, command);
 }
 
+// FNV-1a over the name folded the same way as strcasecanon()
+static inline uint32_t
+command_dispatch_hash(const char *name)
+{
+	uint32_t hash = 0x811C9DC5U;
+
+	for (; *name != '\0'; name++)
+	{
+		hash ^= (uint32_t) toupper((unsigned char) *name);
+		hash *= 0x01000193U;
+	}
+
+	return hash;
+}
+
+// The slot holding a name, or the empty slot it would go in
+static size_t
+command_dispatch_slot(const struct command_dispatch *const restrict dispatch, const char *const restrict name,
+                      const uint32_t hash)
+{
+	size_t i = hash & dispatch->mask;
+
+	while (dispatch->slots[i].name != NULL)
+	{
+		if (dispatch->slots[i].hash == hash && strcasecmp(dispatch->slots[i].name, name) == 0)
+			break;
+
+		i = (i + 1U) & dispatch->mask;
+	}
+
+	return i;
+}
+
+// The first name added wins, so aliases are added before the commands they may shadow
+static void
+command_dispatch_insert(struct command_dispatch *const restrict dispatch, const char *const restrict name,
+                        struct command *const restrict cmd)
+{
+	const uint32_t hash = command_dispatch_hash(name);
+	struct command_dispatch_slot *const slot = &dispatch->slots[command_dispatch_slot(dispatch, name, hash)];
+
+	if (slot->name != NULL)
+		return;
+
+	slot->name = name;
+	slot->cmd = cmd;
+	slot->hash = hash;
+}
+
+struct command_dispatch_build
+{
+	struct command_dispatch *       dispatch;
+	mowgli_patricia_t *             commandtree;
+};
+
+static int
+command_dispatch_add_alias(const char *const restrict name, void *const restrict target, void *const restrict priv)
+{
+	const struct command_dispatch_build *const build = priv;
+
+	(void) command_dispatch_insert(build->dispatch, name, mowgli_patricia_retrieve(build->commandtree, target));
+	return 0;
+}
+
+static int
+command_dispatch_add_command(const char ATHEME_VATTR_UNUSED *const restrict name, void *const restrict cmd,
+                             void *const restrict priv)
+{
+	const struct command_dispatch_build *const build = priv;
+
+	(void) command_dispatch_insert(build->dispatch, ((const struct command *) cmd)->name, cmd);
+	return 0;
+}
+
+/*
+ * command_dispatch_create(mowgli_patricia_t *commandtree, mowgli_patricia_t *aliases)
+ *
+ * Builds a dispatch table for a command tree and its aliases.
+ *
+ * Inputs:
+ *     - the command tree
+ *     - the aliases for it, mapping names to command names, or NULL
+ *
+ * Outputs:
+ *     - the new dispatch table
+ *
+ * Side Effects:
+ *     - the table refers to the names of the commands and aliases, so it
+ *       must be destroyed before either tree is changed
+ */
+struct command_dispatch *
+command_dispatch_create(mowgli_patricia_t *const restrict commandtree, mowgli_patricia_t *const restrict aliases)
+{
+	struct command_dispatch_build build;
+	size_t names;
+	size_t size = 8U;
+
+	return_val_if_fail(commandtree != NULL, NULL);
+
+	names = mowgli_patricia_size(commandtree);
+
+	if (aliases != NULL)
+		names += mowgli_patricia_size(aliases);
+
+	while (size < (names * 2U))
+		size <<= 1U;
+
+	build.dispatch = smalloc(sizeof *build.dispatch + (size * sizeof build.dispatch->slots[0]));
+	build.dispatch->mask = size - 1U;
+	build.commandtree = commandtree;
+
+	if (aliases != NULL)
+		(void) mowgli_patricia_foreach(aliases, &command_dispatch_add_alias, &build);
+
+	(void) mowgli_patricia_foreach(commandtree, &command_dispatch_add_command, &build);
+
+	return build.dispatch;
+}
+
+void
+command_dispatch_destroy(struct command_dispatch *const restrict dispatch)
+{
+	(void) sfree(dispatch);
+}
+
+/*
+ * command_dispatch_find(const struct command_dispatch *dispatch, const char *name)
+ *
+ * Finds the command a name runs, the same way as looking the name up in
+ * the aliases and then the result in the command tree would.
+ *
+ * Inputs:
+ *     - the dispatch table
+ *     - the name of a command or an alias
+ *
+ * Outputs:
+ *     - the command, or NULL if there is none
+ *
+ * Side Effects:
+ *     - none
+ */
+struct command *
+command_dispatch_find(const struct command_dispatch *const restrict dispatch, const char *const restrict name)
+{
+	return_val_if_fail(dispatch != NULL, NULL);
+	return_val_if_fail(name != NULL, NULL);
+
+	return dispatch->slots[command_dispatch_slot(dispatch, name, command_dispatch_hash(name))].cmd;
+}
+
+static void
+command_exec_timed(const struct service *const restrict svs, struct sourceinfo *const restrict si,
+                   struct command *const restrict c, const int parc, char *parv[])
+{
+	if (! c->latency)
+	{
+		char name[BUFSIZE];
+
+		(void) snprintf(name, sizeof name, "%s %s", svs->internal_name, c->name);
+
+		c->latency = latency_stat_get(LATENCY_COMMAND, name);
+	}
+
+	struct latency_stat *const stat = c->latency;
+	const uint64_t begin = latency_clock();
+
+	c->cmd(si, parc, parv);
+
+	// a command can unload the module it is in
+	(void) latency_record(stat, latency_clock() - begin);
+}
+
 void
 command_exec(struct service *svs, struct sourceinfo *si, struct command *c, int parc, char *parv[])
 {
@@ -146,7 +337,16 @@ command_exec(struct service *svs, struct sourceinfo *si, struct command *c, int
 			language_set_active(si->force_language);
 
 		si->command = c;
-		c->cmd(si, parc, parv);
+
+		(void) stall_context_push("command", c->name, svs->internal_name);
+
+		if (latency_enabled)
+			(void) command_exec_timed(svs, si, c, parc, parv);
+		else
+			c->cmd(si, parc, parv);
+
+		(void) stall_context_pop();
+
 		language_set_active(NULL);
 		return;
 	}
@@ -195,8 +395,12 @@ command_exec_split(struct service *svs, struct sourceinfo *si, const char *cmd,
 	char *parv[20];
         struct command *c;
 
-	cmd = service_resolve_alias(svs, commandtree == svs->commands ? NULL : "unknown", cmd);
-	if ((c = command_find(commandtree, cmd)))
+	if (commandtree == svs->commands)
+		c = service_find_command(svs, cmd);
+	else
+		c = command_find(commandtree, service_resolve_alias(svs, "unknown", cmd));
+
+	if (c != NULL)
 	{
 		parc = text_to_parv(text, c->maxparc, parv);
 		for (i = parc; i < (int)(sizeof(parv) / sizeof(parv[0])); i++)
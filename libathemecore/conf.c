@@ -305,6 +305,9 @@ init_newconf(void)
 	add_bool_conf_item("CLONE_IDENTIFIED_INCREASE_LIMIT", &conf_gi_table, 0, &config_options.clone_increase, false);
 
 	add_uint_conf_item("UPLINK_SENDQ_LIMIT", &conf_gi_table, 0, &config_options.uplink_sendq_limit, 10240, INT_MAX, 1048576);
+	add_uint_conf_item("REPLY_RATE", &conf_gi_table, 0, &config_options.reply_rate, 0, INT_MAX, 1000);
+	add_uint_conf_item("REPLY_QUEUE_MAX", &conf_gi_table, 0, &config_options.reply_queue_max, 0, INT_MAX, 5000);
+	add_uint_conf_item("STALL_THRESHOLD", &conf_gi_table, 0, &config_options.stall_threshold, 0, INT_MAX, 0);
 	add_dupstr_conf_item("LANGUAGE", &conf_gi_table, 0, &config_options.language, "en");
 	add_conf_item("EXEMPTS", &conf_gi_table, c_gi_exempts);
 	add_bool_conf_item("ALLOW_TAINT", &conf_gi_table, 0, &config_options.allow_taint, false);
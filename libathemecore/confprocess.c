@@ -65,7 +65,7 @@ struct ConfTable
 };
 
 static mowgli_list_t confblocks;
-static mowgli_heap_t *conftable_heap = NULL;
+static struct slab_type *conftable_heap = NULL;
 
 bool conf_need_rehash;
 
@@ -437,7 +437,7 @@ add_top_conf(const char *name, int (*handler) (mowgli_config_file_entry_t *ce))
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_HANDLER;
 	ct->flags = 0;
@@ -459,7 +459,7 @@ add_subblock_top_conf(const char *name, mowgli_list_t *list)
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_SUBBLOCK;
 	ct->flags = 0;
@@ -482,7 +482,7 @@ add_conf_item(const char *name, mowgli_list_t *conflist, int (*handler) (mowgli_
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_HANDLER;
 	ct->flags = 0;
@@ -501,7 +501,7 @@ add_uint_conf_item(const char *name, mowgli_list_t *conflist, unsigned int flags
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_UINT;
 	ct->flags = flags;
@@ -523,7 +523,7 @@ add_duration_conf_item(const char *name, mowgli_list_t *conflist, unsigned int f
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_DURATION;
 	ct->flags = flags;
@@ -544,7 +544,7 @@ add_dupstr_conf_item(const char *name, mowgli_list_t *conflist, unsigned int fla
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_DUPSTR;
 	ct->flags = flags;
@@ -564,7 +564,7 @@ add_bool_conf_item(const char *name, mowgli_list_t *conflist, unsigned int flags
 		return;
 	}
 
-	struct ConfTable *const ct = mowgli_heap_alloc(conftable_heap);
+	struct ConfTable *const ct = slab_alloc(conftable_heap);
 	ct->name = sstrdup(name);
 	ct->type = CONF_BOOL;
 	ct->flags = flags;
@@ -592,7 +592,7 @@ del_top_conf(const char *name)
 
 	sfree(ct->name);
 
-	mowgli_heap_free(conftable_heap, ct);
+	slab_free(conftable_heap, ct);
 }
 
 void
@@ -618,7 +618,7 @@ del_conf_item(const char *name, mowgli_list_t *conflist)
 
 	sfree(ct->name);
 
-	mowgli_heap_free(conftable_heap, ct);
+	slab_free(conftable_heap, ct);
 }
 
 conf_handler_fn
@@ -653,7 +653,7 @@ token_to_value(struct Token token_table[], const char *token)
 void
 init_confprocess(void)
 {
-	conftable_heap = sharedheap_get(sizeof(struct ConfTable));
+	conftable_heap = slab_type_create("conftable", sizeof(struct ConfTable));
 
 	if (!conftable_heap)
 	{
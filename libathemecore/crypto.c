@@ -18,6 +18,9 @@
 
 static mowgli_list_t crypt_impl_list = { NULL, NULL, 0 };
 
+struct latency_histogram crypt_verify_latency;
+struct latency_histogram crypt_latency;
+
 static inline void
 crypt_log_modchg(const char *const restrict caller, const char *const restrict which,
                  const struct crypt_impl *const restrict impl)
@@ -119,9 +122,9 @@ crypt_get_named_provider(const char *const restrict id)
 	return NULL;
 }
 
-const struct crypt_impl * ATHEME_FATTR_WUR
-crypt_verify_password(const char *const restrict password, const char *const restrict parameters,
-                      unsigned int *const restrict flags)
+static const struct crypt_impl * ATHEME_FATTR_WUR
+crypt_verify_password_impl(const char *const restrict password, const char *const restrict parameters,
+                           unsigned int *const restrict flags)
 {
 	mowgli_node_t *n;
 
@@ -168,8 +171,20 @@ crypt_verify_password(const char *const restrict password, const char *const res
 	return NULL;
 }
 
-const char *
-crypt_password(const char *const restrict password)
+const struct crypt_impl * ATHEME_FATTR_WUR
+crypt_verify_password(const char *const restrict password, const char *const restrict parameters,
+                      unsigned int *const restrict flags)
+{
+	const uint64_t begin = latency_clock();
+	const struct crypt_impl *const ci = crypt_verify_password_impl(password, parameters, flags);
+
+	(void) latency_histogram_record(&crypt_verify_latency, latency_clock() - begin);
+
+	return ci;
+}
+
+static const char *
+crypt_password_impl(const char *const restrict password)
 {
 	bool encryption_capable_module = false;
 
@@ -206,3 +221,14 @@ crypt_password(const char *const restrict password)
 
 	return NULL;
 }
+
+const char *
+crypt_password(const char *const restrict password)
+{
+	const uint64_t begin = latency_clock();
+	const char *const result = crypt_password_impl(password);
+
+	(void) latency_histogram_record(&crypt_latency, latency_clock() - begin);
+
+	return result;
+}
@@ -32,6 +32,17 @@ struct sendq {
 	char buf[SENDQSIZE];
 };
 
+static struct slab_type *sendq_heap = NULL;
+
+static struct sendq *
+sendq_chunk_new(void)
+{
+	if (sendq_heap == NULL)
+		sendq_heap = slab_type_create("sendq", sizeof(struct sendq));
+
+	return slab_alloc(sendq_heap);
+}
+
 void
 sendq_add(struct connection * cptr, char *buf, size_t len)
 {
@@ -78,7 +89,7 @@ sendq_add(struct connection * cptr, char *buf, size_t len)
 
 	while (len > 0)
 	{
-		sq = smalloc(sizeof *sq);
+		sq = sendq_chunk_new();
 		mowgli_node_add(sq, &sq->node, &cptr->sendq);
 		l = SENDQSIZE;
 		if (l > len)
@@ -142,7 +153,7 @@ sendq_flush(struct connection * cptr)
 			if (MOWGLI_LIST_LENGTH(&cptr->sendq) > 1)
 			{
                         	mowgli_node_delete(&sq->node, &cptr->sendq);
-				sfree(sq);
+				slab_free(sendq_heap, sq);
 			}
 			else
 				/* keep one struct sendq */
@@ -188,6 +199,15 @@ sendq_set_limit(struct connection *cptr, size_t len)
 	cptr->sendq_limit = len;
 }
 
+// Upper bound on the bytes waiting, as checked against the sendq limit
+size_t
+sendq_length(struct connection *cptr)
+{
+	return_val_if_fail(cptr != NULL, 0);
+
+	return MOWGLI_LIST_LENGTH(&cptr->sendq) * SENDQSIZE;
+}
+
 int
 recvq_length(struct connection *cptr)
 {
@@ -236,7 +256,7 @@ recvq_put(struct connection *cptr)
 	}
 	if (sq == NULL)
 	{
-		sq = smalloc(sizeof *sq);
+		sq = sendq_chunk_new();
 		mowgli_node_add(sq, &sq->node, &cptr->recvq);
 		l = SENDQSIZE;
 	}
@@ -298,7 +318,7 @@ recvq_get(struct connection *cptr, char *buf, size_t len)
 			if (MOWGLI_LIST_LENGTH(&cptr->recvq) > 1)
 			{
 				mowgli_node_delete(&sq->node, &cptr->recvq);
-				sfree(sq);
+				slab_free(sendq_heap, sq);
 			}
 			else
 				/* keep one struct sendq */
@@ -358,7 +378,7 @@ recvq_getline(struct connection *cptr, char *buf, size_t len)
 			if (MOWGLI_LIST_LENGTH(&cptr->recvq) > 1)
 			{
 				mowgli_node_delete(&sq->node, &cptr->recvq);
-				sfree(sq);
+				slab_free(sendq_heap, sq);
 			}
 			else
 				/* keep one struct sendq */
@@ -381,7 +401,7 @@ sendqrecvq_free(struct connection *cptr)
 		sq = nptr->data;
 
 		mowgli_node_delete(&sq->node, &cptr->recvq);
-		sfree(sq);
+		slab_free(sendq_heap, sq);
 	}
 
 	MOWGLI_ITER_FOREACH_SAFE(nptr, nptr2, cptr->sendq.head)
@@ -389,7 +409,7 @@ sendqrecvq_free(struct connection *cptr)
 		sq = nptr->data;
 
 		mowgli_node_delete(&sq->node, &cptr->sendq);
-		sfree(sq);
+		slab_free(sendq_heap, sq);
 	}
 }
 
@@ -14,6 +14,7 @@
  */
 
 #include <atheme.h>
+#include "internal.h"
 
 static mowgli_list_t email_canonicalizers;
 
@@ -70,8 +71,10 @@ canonicalize_emails(void)
 	{
 		struct myuser *mu = user(mt);
 
+		myuser_email_index_delete(mu);
 		strshare_unref(mu->email_canonical);
 		mu->email_canonical = canonicalize_email(mu->email);
+		myuser_email_index_add(mu);
 	}
 }
 
@@ -201,11 +204,7 @@ bool
 email_within_limits(const char *email)
 {
 	mowgli_node_t *n;
-	struct myentity_iteration_state state;
-	struct myentity *mt;
-	unsigned int tcnt = 0;
-	stringref email_canonical;
-	bool result = true;
+	const mowgli_list_t *l;
 
 	if (me.maxusers <= 0)
 		return true;
@@ -216,24 +215,10 @@ email_within_limits(const char *email)
 			return true;
 	}
 
-	email_canonical = canonicalize_email(email);
-
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
-	{
-		struct myuser *mu = user(mt);
-
-		if (mu->email_canonical == email_canonical)
-			tcnt++;
-
-		/* optimization: if tcnt >= me.maxusers, quit iterating. -nenolod */
-		if (tcnt >= me.maxusers) {
-			result = false;
-			break;
-		}
-	}
+	if ((l = myuser_find_by_email(email)) == NULL)
+		return true;
 
-	strshare_unref(email_canonical);
-	return result;
+	return MOWGLI_LIST_LENGTH(l) < me.maxusers;
 }
 
 /* send the specified type of email.
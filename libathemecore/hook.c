@@ -18,8 +18,8 @@
 #include "internal.h"
 
 static mowgli_patricia_t *hooks = NULL;
-static mowgli_heap_t *hook_heap = NULL;
-static mowgli_heap_t *hook_privfn_heap = NULL;
+static struct slab_type *hook_heap = NULL;
+static struct slab_type *hook_privfn_heap = NULL;
 
 typedef struct {
 	struct hook *hook;
@@ -31,6 +31,8 @@ typedef struct {
 typedef struct {
 	hook_fn hookfn;
 	mowgli_node_t node;
+	stringref owner;                        // the module that added it, for latency_stat_get()
+	struct latency_stat *latency;
 } hook_privfn_ctx_t;
 
 #define HF_RUN		0x1
@@ -42,8 +44,8 @@ void
 hooks_init(void)
 {
 	hooks = mowgli_patricia_create(strcasecanon);
-	hook_heap = sharedheap_get(sizeof(struct hook));
-	hook_privfn_heap = sharedheap_get(sizeof(hook_privfn_ctx_t));
+	hook_heap = slab_type_create("hook", sizeof(struct hook));
+	hook_privfn_heap = slab_type_create("hook_privfn", sizeof(hook_privfn_ctx_t));
 
 	if (hook_heap == NULL || hook_privfn_heap == NULL || hooks == NULL)
 	{
@@ -66,7 +68,7 @@ hook_add_event(const char *name)
 	if((nh = hook_find(name)) != NULL)
 		return nh;
 
-	nh = mowgli_heap_alloc(hook_heap);
+	nh = slab_alloc(hook_heap);
 	nh->name = strshare_get(name);
 
 	mowgli_patricia_add(hooks, nh->name, nh);
@@ -78,7 +80,8 @@ static inline void
 hook_destroy(struct hook *hook, hook_privfn_ctx_t *priv)
 {
 	mowgli_node_delete(&priv->node, &hook->hooks);
-	mowgli_heap_free(hook_privfn_heap, priv);
+	strshare_unref(priv->owner);
+	slab_free(hook_privfn_heap, priv);
 }
 
 void
@@ -113,8 +116,11 @@ hook_create_and_add(struct hook *hook, hook_fn handler,
 	return_val_if_fail(handler != NULL, NULL);
 	return_val_if_fail(addfn != NULL, NULL);
 
-	priv = mowgli_heap_alloc(hook_privfn_heap);
+	const struct module *const owner = module_current();
+
+	priv = slab_alloc(hook_privfn_heap);
 	priv->hookfn = handler;
+	priv->owner = strshare_get(owner ? owner->name : "core");
 
 	addfn(priv, &priv->node, &hook->hooks);
 
@@ -152,12 +158,33 @@ hook_add_hook_first(const char *event, hook_fn handler)
 	hook_create_and_add(h, handler, mowgli_node_add_head);
 }
 
+static void
+hook_call_timed(const struct hook *hook, hook_privfn_ctx_t *priv, void *dptr)
+{
+	if (! priv->latency)
+	{
+		char name[BUFSIZE];
+
+		(void) snprintf(name, sizeof name, "%s (%s)", hook->name, priv->owner);
+
+		priv->latency = latency_stat_get(LATENCY_HOOK, name);
+	}
+
+	struct latency_stat *const stat = priv->latency;
+	const uint64_t begin = latency_clock();
+
+	priv->hookfn(dptr);
+
+	// the handler may have removed itself, so only the stat can be touched now
+	(void) latency_record(stat, latency_clock() - begin);
+}
+
 void
 hook_call_event(const char *event, void *dptr)
 {
 	hook_run_ctx_t ctx;
 	mowgli_node_t *n, *tn;
-	void (*func)(void *data);
+	const bool latency = latency_enabled;
 
 	return_if_fail(event != NULL);
 
@@ -174,7 +201,15 @@ hook_call_event(const char *event, void *dptr)
 	{
 		hook_privfn_ctx_t *priv = n->data;
 
-		priv->hookfn(ctx.dptr);
+		(void) stall_context_push("hook", ctx.hook->name, priv->owner);
+
+		if (latency)
+			(void) hook_call_timed(ctx.hook, priv, ctx.dptr);
+		else
+			priv->hookfn(ctx.dptr);
+
+		(void) stall_context_pop();
+
 		if (ctx.flags & HF_STOP)
 			goto out;
 	}
@@ -23,4 +23,7 @@ void init_signal_handlers(void);
 
 void language_init(void);
 
+void myuser_email_index_add(struct myuser *mu);
+void myuser_email_index_delete(struct myuser *mu);
+
 #endif /* !ATHEME_LAC_INTERNAL_H */
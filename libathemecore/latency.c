@@ -0,0 +1,297 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * latency.c: Latency histograms for hook handlers and commands.
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+/* Whether hook handlers, protocol commands and service commands are timed.
+ * When it is off, each of them costs a single test of this flag.
+ */
+bool latency_enabled = false;
+
+// Every stat, keyed by kind and name
+static mowgli_patricia_t *latency_stats = NULL;
+
+static const char *const latency_kind_names[] = {
+
+	[LATENCY_HOOK]          = "HOOK",
+	[LATENCY_PCOMMAND]      = "PCOMMAND",
+	[LATENCY_COMMAND]       = "COMMAND",
+};
+
+static inline unsigned int
+latency_log2(uint64_t value)
+{
+	unsigned int log = 0;
+
+	for (unsigned int shift = 32U; shift != 0; shift >>= 1U)
+	{
+		if (value >> shift)
+		{
+			value >>= shift;
+			log += shift;
+		}
+	}
+
+	return log;
+}
+
+static inline unsigned int
+latency_bucket(const uint64_t nsec)
+{
+	if (nsec < LATENCY_SUB_BUCKETS)
+		return (unsigned int) nsec;
+
+	const unsigned int log = latency_log2(nsec);
+
+	if (log >= LATENCY_MAX_BITS)
+		return LATENCY_BUCKETS - 1U;
+
+	const unsigned int sub = (unsigned int) (nsec >> (log - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1U);
+
+	return ((log - LATENCY_SUB_BITS + 1U) * LATENCY_SUB_BUCKETS) + sub;
+}
+
+// The highest duration that is counted in a bucket
+uint64_t
+latency_bucket_limit(const unsigned int bucket)
+{
+	if (bucket < LATENCY_SUB_BUCKETS)
+		return bucket;
+
+	const unsigned int log = (bucket / LATENCY_SUB_BUCKETS) + LATENCY_SUB_BITS - 1U;
+	const uint64_t sub = (bucket % LATENCY_SUB_BUCKETS) + LATENCY_SUB_BUCKETS;
+
+	return ((sub + 1U) << (log - LATENCY_SUB_BITS)) - 1U;
+}
+
+/*
+ * latency_stat_get(enum latency_kind kind, const char *name)
+ *
+ * Finds the stat for something that is timed, creating it if necessary.
+ *
+ * Inputs:
+ *     - the kind of thing that is timed
+ *     - its name, e.g. "user_add (nickserv/main)" for a hook handler,
+ *       "EUID" for a protocol command or "nickserv IDENTIFY" for a
+ *       service command
+ *
+ * Outputs:
+ *     - the stat, which is never freed
+ *
+ * Side Effects:
+ *     - the stat is created if it didn't exist
+ */
+struct latency_stat *
+latency_stat_get(const enum latency_kind kind, const char *const restrict name)
+{
+	struct latency_stat *stat;
+	char key[BUFSIZE];
+
+	return_val_if_fail(name != NULL, NULL);
+
+	if (! latency_stats)
+		latency_stats = mowgli_patricia_create(noopcanon);
+
+	(void) snprintf(key, sizeof key, "%s %s", latency_kind_name(kind), name);
+
+	if ((stat = mowgli_patricia_retrieve(latency_stats, key)) != NULL)
+		return stat;
+
+	stat = smalloc(sizeof *stat);
+	stat->name = sstrdup(name);
+	stat->kind = kind;
+
+	(void) mowgli_patricia_add(latency_stats, key, stat);
+
+	return stat;
+}
+
+void
+latency_histogram_record(struct latency_histogram *const restrict hist, const uint64_t nsec)
+{
+	hist->count++;
+	hist->total += nsec;
+	hist->buckets[latency_bucket(nsec)]++;
+
+	if (nsec > hist->max)
+		hist->max = nsec;
+}
+
+void
+latency_record(struct latency_stat *const restrict stat, const uint64_t nsec)
+{
+	(void) latency_histogram_record(&stat->hist, nsec);
+}
+
+void
+latency_reset(void)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct latency_stat *stat;
+
+	if (! latency_stats)
+		return;
+
+	MOWGLI_PATRICIA_FOREACH(stat, &state, latency_stats)
+		(void) memset(&stat->hist, 0x00, sizeof stat->hist);
+}
+
+void
+latency_foreach(const latency_foreach_fn fn, void *const restrict priv)
+{
+	mowgli_patricia_iteration_state_t state;
+	const struct latency_stat *stat;
+
+	return_if_fail(fn != NULL);
+
+	if (! latency_stats)
+		return;
+
+	MOWGLI_PATRICIA_FOREACH(stat, &state, latency_stats)
+		(void) fn(stat, priv);
+}
+
+static int
+latency_stat_compare(const void *const restrict a, const void *const restrict b)
+{
+	const struct latency_stat *const sa = *((const struct latency_stat *const *) a);
+	const struct latency_stat *const sb = *((const struct latency_stat *const *) b);
+
+	if (sa->hist.total != sb->hist.total)
+		return (sa->hist.total < sb->hist.total) ? 1 : -1;
+
+	return strcmp(sa->name, sb->name);
+}
+
+/*
+ * latency_top(const enum latency_kind *kind, const struct latency_stat **stats, size_t max)
+ *
+ * Finds the stats that have taken the most time in total.
+ *
+ * Inputs:
+ *     - the kind of stats wanted, or NULL for all of them
+ *     - an array to put them in
+ *     - the size of the array
+ *
+ * Outputs:
+ *     - how many stats were put in the array, the one with the most time
+ *       first; stats that have nothing recorded are left out
+ *
+ * Side Effects:
+ *     - none
+ */
+size_t
+latency_top(const enum latency_kind *const restrict kind, const struct latency_stat **const restrict stats,
+            const size_t max)
+{
+	mowgli_patricia_iteration_state_t state;
+	const struct latency_stat **all;
+	const struct latency_stat *stat;
+	size_t count = 0;
+
+	return_val_if_fail(stats != NULL, 0);
+
+	if (! latency_stats || ! max)
+		return 0;
+
+	all = smalloc(mowgli_patricia_size(latency_stats) * sizeof *all);
+
+	MOWGLI_PATRICIA_FOREACH(stat, &state, latency_stats)
+		if (stat->hist.count && (! kind || stat->kind == *kind))
+			all[count++] = stat;
+
+	(void) qsort(all, count, sizeof *all, &latency_stat_compare);
+
+	if (count > max)
+		count = max;
+
+	(void) memcpy(stats, all, count * sizeof *all);
+	(void) sfree(all);
+
+	return count;
+}
+
+/*
+ * latency_percentile(const struct latency_histogram *hist, unsigned int permille)
+ *
+ * Estimates a percentile of the durations in a histogram.
+ *
+ * Inputs:
+ *     - the histogram
+ *     - the percentile wanted, in tenths of a percent (e.g. 990 for the
+ *       99th percentile)
+ *
+ * Outputs:
+ *     - the highest duration that falls in the same bucket as the
+ *       percentile, but no more than the highest duration recorded, or 0
+ *       if the histogram is empty
+ *
+ * Side Effects:
+ *     - none
+ */
+uint64_t
+latency_percentile(const struct latency_histogram *const restrict hist, const unsigned int permille)
+{
+	uint64_t rank, seen = 0;
+
+	return_val_if_fail(hist != NULL, 0);
+	return_val_if_fail(permille <= 1000U, 0);
+
+	if (! hist->count)
+		return 0;
+
+	// The rank of the percentile, rounded up, and at least the first duration
+	if (! (rank = ((hist->count * permille) + 999U) / 1000U))
+		rank = 1;
+
+	for (unsigned int i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		if ((seen += hist->buckets[i]) < rank)
+			continue;
+
+		const uint64_t value = latency_bucket_limit(i);
+
+		return (value < hist->max) ? value : hist->max;
+	}
+
+	return hist->max;
+}
+
+const char *
+latency_kind_name(const enum latency_kind kind)
+{
+	if ((size_t) kind >= ARRAY_SIZE(latency_kind_names))
+		return "UNKNOWN";
+
+	return latency_kind_names[kind];
+}
+
+bool
+latency_kind_parse(const char *const restrict name, enum latency_kind *const restrict kind)
+{
+	return_val_if_fail(name != NULL, false);
+	return_val_if_fail(kind != NULL, false);
+
+	for (size_t i = 0; i < ARRAY_SIZE(latency_kind_names); i++)
+	{
+		if (strcasecmp(name, latency_kind_names[i]) == 0)
+		{
+			*kind = (enum latency_kind) i;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -207,6 +207,21 @@ match(const char *mask, const char *name)
 }
 
 
+/*
+ * match_is_literal()
+ *
+ * Returns true if the mask contains none of the characters match() treats
+ * specially, so that it can only match strings equal to it ignoring case
+ * and lookups can use a casemapped index instead of trying every string.
+ */
+bool
+match_is_literal(const char *mask)
+{
+	return_val_if_fail(mask != NULL, false);
+
+	return strpbrk(mask, "*?&#%\\") == NULL;
+}
+
 /*
 ** collapse a pattern string into minimal components.
 ** This particular version is "in place", so that it changes the pattern
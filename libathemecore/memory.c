@@ -81,6 +81,18 @@ smalloc(const size_t len)
 	return scalloc(1, len);
 }
 
+// alignment must be a power of two and a multiple of sizeof(void *); the memory is not zeroed
+void * ATHEME_FATTR_ALLOC_SIZE(2) ATHEME_FATTR_MALLOC ATHEME_FATTR_RETURNS_NONNULL
+smemalign(const size_t alignment, const size_t len)
+{
+	void *buf = NULL;
+
+	if (posix_memalign(&buf, alignment, len) != 0)
+		RAISE_EXCEPTION;
+
+	return buf;
+}
+
 void * ATHEME_FATTR_ALLOC_SIZE_PRODUCT(2, 3) ATHEME_FATTR_WUR
 sreallocarray(void *const restrict ptr, const size_t num, const size_t len)
 {
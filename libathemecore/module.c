@@ -22,7 +22,7 @@
 #endif
 
 static mowgli_list_t modules_being_loaded;
-static mowgli_heap_t *module_heap = NULL;
+static struct slab_type *module_heap = NULL;
 static struct module *current_module = NULL;
 
 mowgli_list_t modules;
@@ -30,7 +30,7 @@ mowgli_list_t modules;
 void
 modules_init(void)
 {
-	if (! (module_heap = sharedheap_get(sizeof(struct module))))
+	if (! (module_heap = slab_type_create("module", sizeof(struct module))))
 	{
 		(void) slog(LG_ERROR, "%s: block allocator failed", MOWGLI_FUNC_NAME);
 
@@ -111,7 +111,7 @@ module_load_internal(const char *const restrict pathname, char *const restrict e
 		return NULL;
 	}
 
-	struct module *const m = mowgli_heap_alloc(module_heap);
+	struct module *const m = slab_alloc(module_heap);
 
 	(void) mowgli_strlcpy(m->modpath, pathname, sizeof m->modpath);
 	(void) mowgli_strlcpy(m->name, h->name, sizeof m->name);
@@ -349,7 +349,7 @@ module_unload(struct module *const restrict m, const enum module_unload_intent i
 	if (m->handle)
 	{
 		(void) mowgli_module_close(m->handle);
-		(void) mowgli_heap_free(module_heap, m);
+		(void) slab_free(module_heap, m);
 	}
 	else if (m->unload_handler)
 		(void) m->unload_handler(m, intent);
@@ -426,6 +426,23 @@ module_find(const char *const restrict name)
 	return NULL;
 }
 
+/* module_current()
+ *
+ * inputs:
+ *       none
+ *
+ * outputs:
+ *       the module whose modinit function is running, or NULL.
+ *
+ * side effects:
+ *       none
+ */
+struct module *
+module_current(void)
+{
+	return current_module;
+}
+
 /* module_find_published()
  *
  * inputs:
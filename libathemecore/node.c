@@ -20,9 +20,13 @@ mowgli_list_t klnlist;
 mowgli_list_t xlnlist;
 mowgli_list_t qlnlist;
 
-static mowgli_heap_t *kline_heap = NULL;	/* 16 */
-static mowgli_heap_t *xline_heap = NULL;	/* 16 */
-static mowgli_heap_t *qline_heap = NULL;	/* 16 */
+static struct slab_type *kline_heap = NULL;	/* 16 */
+static struct slab_type *xline_heap = NULL;	/* 16 */
+static struct slab_type *qline_heap = NULL;	/* 16 */
+
+// klines added by kline_add_bulk() that have not been sent to the ircd yet
+static mowgli_list_t kline_pending;
+static mowgli_eventloop_timer_t *kline_pending_timer = NULL;
 
 /*************
  * L I S T S *
@@ -31,9 +35,9 @@ static mowgli_heap_t *qline_heap = NULL;	/* 16 */
 void
 init_nodes(void)
 {
-	kline_heap = sharedheap_get(sizeof(struct kline));
-	xline_heap = sharedheap_get(sizeof(struct xline));
-	qline_heap = sharedheap_get(sizeof(struct qline));
+	kline_heap = slab_type_create("kline", 0);
+	xline_heap = slab_type_create("xline", 0);
+	qline_heap = slab_type_create("qline", 0);
 
 	if (kline_heap == NULL || xline_heap == NULL || qline_heap == NULL)
 	{
@@ -110,39 +114,85 @@ remove_illegals()
 	}
 }
 
+/* K/X/Q-lines are allocated together with their strings, which follow the
+ * struct. These give the size of such a record and copy a string into it.
+ */
+static inline size_t
+node_strlen(const char *str)
+{
+	return str ? (strlen(str) + 1) : 0;
+}
+
+static char *
+node_strcpy(char **pos, const char *str)
+{
+	char *const dst = *pos;
+
+	if (! str)
+		return NULL;
+
+	const size_t len = strlen(str) + 1;
+
+	(void) memcpy(dst, str, len);
+	*pos += len;
+
+	return dst;
+}
+
 /*************
  * K L I N E *
  *************/
 
-struct kline *
-kline_add_with_id(const char *user, const char *host, const char *reason, long duration, const char *setby, unsigned long id)
+static inline size_t
+kline_size(const char *user, const char *host, const char *reason, const char *setby)
 {
-	struct kline *k;
-	mowgli_node_t *n = mowgli_node_create();
-
-	slog(LG_DEBUG, "kline_add(): %s@%s -> %s (%ld)", user, host, reason, duration);
+	return sizeof(struct kline) + node_strlen(user) + node_strlen(host) + node_strlen(reason) + node_strlen(setby);
+}
 
-	k = mowgli_heap_alloc(kline_heap);
+static struct kline *
+kline_create(const char *user, const char *host, const char *reason, long duration, const char *setby, unsigned long id)
+{
+	struct kline *const k = slab_alloc_bytes(kline_heap, kline_size(user, host, reason, setby));
+	char *pos = (char *) (k + 1);
 
-	mowgli_node_add(k, n, &klnlist);
+	(void) memset(k, 0x00, sizeof *k);
 
-	k->user = sstrdup(user);
-	k->host = sstrdup(host);
-	k->reason = sstrdup(reason);
-	k->setby = sstrdup(setby);
+	k->user = node_strcpy(&pos, user);
+	k->host = node_strcpy(&pos, host);
+	k->reason = node_strcpy(&pos, reason);
+	k->setby = node_strcpy(&pos, setby);
 	k->duration = duration;
 	k->settime = CURRTIME;
 	k->expires = CURRTIME + duration;
 	k->number = id;
 
+	mowgli_node_add(k, &k->node, &klnlist);
+
 	cnt.kline++;
 
+	return k;
+}
 
+static void
+kline_announce(const struct kline *k)
+{
 	char treason[BUFSIZE];
+
 	snprintf(treason, sizeof(treason), "[#%lu] %s", k->number, k->reason);
+	kline_sts("*", k->user, k->host, k->duration, treason);
+}
+
+struct kline *
+kline_add_with_id(const char *user, const char *host, const char *reason, long duration, const char *setby, unsigned long id)
+{
+	struct kline *k;
+
+	slog(LG_DEBUG, "kline_add(): %s@%s -> %s (%ld)", user, host, reason, duration);
+
+	k = kline_create(user, host, reason, duration, setby, id);
 
 	if (me.connected)
-		kline_sts("*", user, host, duration, treason);
+		kline_announce(k);
 
 	return k;
 }
@@ -161,29 +211,101 @@ kline_add_user(struct user *u, const char *reason, long duration, const char *se
 	return kline_add (use_ident ? u->user : "*", u->ip ? u->ip : u->host, reason, duration, setby);
 }
 
+static void
+kline_pending_drain(void *arg)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, kline_pending.head)
+	{
+		struct kline *const k = n->data;
+
+		// like kline_add(), klines are only sent while we are linked
+		if (me.connected)
+		{
+			if (uplink_sendq_busy())
+				return;
+
+			kline_announce(k);
+		}
+
+		mowgli_node_delete(&k->pending_node, &kline_pending);
+		k->pending = false;
+	}
+
+	if (kline_pending_timer != NULL)
+	{
+		mowgli_timer_destroy(base_eventloop, kline_pending_timer);
+		kline_pending_timer = NULL;
+	}
+}
+
+/*
+ * kline_add_bulk(const struct kline_bulk_entry *entries, size_t count)
+ *
+ * Adds many klines at once, such as when importing a ban list. Nothing is
+ * sent to the ircd until all of them are added; they are then sent as fast
+ * as the uplink's sendq allows.
+ *
+ * Inputs:
+ *      - klines to add
+ *      - number of klines
+ *
+ * Outputs:
+ *      - the number of klines added
+ *
+ * Side Effects:
+ *      - the klines are added and numbered like kline_add() does
+ */
+size_t
+kline_add_bulk(const struct kline_bulk_entry *entries, size_t count)
+{
+	size_t i;
+
+	return_val_if_fail(entries != NULL || count == 0, 0);
+
+	slog(LG_DEBUG, "kline_add_bulk(): %zu klines", count);
+
+	for (i = 0; i < count; i++)
+	{
+		const struct kline_bulk_entry *const e = &entries[i];
+		struct kline *const k = kline_create(e->user, e->host, e->reason, e->duration, e->setby, ++me.kline_id);
+
+		if (me.connected)
+		{
+			mowgli_node_add(k, &k->pending_node, &kline_pending);
+			k->pending = true;
+		}
+	}
+
+	if (kline_pending.head != NULL)
+	{
+		kline_pending_drain(NULL);
+
+		if (kline_pending.head != NULL && kline_pending_timer == NULL)
+			kline_pending_timer = mowgli_timer_add(base_eventloop, "kline_pending_drain", kline_pending_drain, NULL, 1);
+	}
+
+	return i;
+}
+
 void
 kline_delete(struct kline *k)
 {
-	mowgli_node_t *n;
-
 	return_if_fail(k != NULL);
 
 	slog(LG_DEBUG, "kline_delete(): %s@%s -> %s", k->user, k->host, k->reason);
 
+	// a kline that kline_add_bulk() has not sent yet is simply never sent
+	if (k->pending)
+		mowgli_node_delete(&k->pending_node, &kline_pending);
 	/* only unkline if ircd has not already removed this -- jilles */
-	if (me.connected && (k->duration == 0 || k->expires > CURRTIME))
+	else if (me.connected && (k->duration == 0 || k->expires > CURRTIME))
 		unkline_sts("*", k->user, k->host);
 
-	n = mowgli_node_find(k, &klnlist);
-	mowgli_node_delete(n, &klnlist);
-	mowgli_node_free(n);
+	mowgli_node_delete(&k->node, &klnlist);
 
-	sfree(k->user);
-	sfree(k->host);
-	sfree(k->reason);
-	sfree(k->setby);
-
-	mowgli_heap_free(kline_heap, k);
+	slab_free_bytes(kline_heap, k, kline_size(k->user, k->host, k->reason, k->setby));
 
 	cnt.kline--;
 }
@@ -275,22 +397,30 @@ kline_expire(void *arg)
  * X L I N E *
  *************/
 
+static inline size_t
+xline_size(const char *realname, const char *reason, const char *setby)
+{
+	return sizeof(struct xline) + node_strlen(realname) + node_strlen(reason) + node_strlen(setby);
+}
+
 struct xline *
 xline_add(const char *realname, const char *reason, long duration, const char *setby)
 {
 	struct xline *x;
-	mowgli_node_t *n = mowgli_node_create();
+	char *pos;
 	static unsigned int xcnt = 0;
 
 	slog(LG_DEBUG, "xline_add(): %s -> %s (%ld)", realname, reason, duration);
 
-	x = mowgli_heap_alloc(xline_heap);
+	x = slab_alloc_bytes(xline_heap, xline_size(realname, reason, setby));
+	(void) memset(x, 0x00, sizeof *x);
 
-	mowgli_node_add(x, n, &xlnlist);
+	mowgli_node_add(x, &x->node, &xlnlist);
 
-	x->realname = sstrdup(realname);
-	x->reason = sstrdup(reason);
-	x->setby = sstrdup(setby);
+	pos = (char *) (x + 1);
+	x->realname = node_strcpy(&pos, realname);
+	x->reason = node_strcpy(&pos, reason);
+	x->setby = node_strcpy(&pos, setby);
 	x->duration = duration;
 	x->settime = CURRTIME;
 	x->expires = CURRTIME + duration;
@@ -308,7 +438,6 @@ void
 xline_delete(const char *realname)
 {
 	struct xline *x = xline_find(realname);
-	mowgli_node_t *n;
 
 	if (!x)
 	{
@@ -322,15 +451,9 @@ xline_delete(const char *realname)
 	if (me.connected && (x->duration == 0 || x->expires > CURRTIME))
 		unxline_sts("*", x->realname);
 
-	n = mowgli_node_find(x, &xlnlist);
-	mowgli_node_delete(n, &xlnlist);
-	mowgli_node_free(n);
+	mowgli_node_delete(&x->node, &xlnlist);
 
-	sfree(x->realname);
-	sfree(x->reason);
-	sfree(x->setby);
-
-	mowgli_heap_free(xline_heap, x);
+	slab_free_bytes(xline_heap, x, xline_size(x->realname, x->reason, x->setby));
 
 	cnt.xline--;
 }
@@ -419,21 +542,30 @@ xline_expire(void *arg)
  * Q L I N E *
  *************/
 
+static inline size_t
+qline_size(const char *mask, const char *reason, const char *setby)
+{
+	return sizeof(struct qline) + node_strlen(mask) + node_strlen(reason) + node_strlen(setby);
+}
+
 struct qline *
 qline_add(const char *mask, const char *reason, long duration, const char *setby)
 {
 	struct qline *q;
-	mowgli_node_t *n = mowgli_node_create();
+	char *pos;
 	static unsigned int qcnt = 0;
 
 	slog(LG_DEBUG, "qline_add(): %s -> %s (%ld)", mask, reason, duration);
 
-	q = mowgli_heap_alloc(qline_heap);
-	mowgli_node_add(q, n, &qlnlist);
+	q = slab_alloc_bytes(qline_heap, qline_size(mask, reason, setby));
+	(void) memset(q, 0x00, sizeof *q);
+
+	mowgli_node_add(q, &q->node, &qlnlist);
 
-	q->mask = sstrdup(mask);
-	q->reason = sstrdup(reason);
-	q->setby = sstrdup(setby);
+	pos = (char *) (q + 1);
+	q->mask = node_strcpy(&pos, mask);
+	q->reason = node_strcpy(&pos, reason);
+	q->setby = node_strcpy(&pos, setby);
 	q->duration = duration;
 	q->settime = CURRTIME;
 	q->expires = CURRTIME + duration;
@@ -451,7 +583,6 @@ void
 qline_delete(const char *mask)
 {
 	struct qline *q = qline_find(mask);
-	mowgli_node_t *n;
 
 	if (!q)
 	{
@@ -465,15 +596,9 @@ qline_delete(const char *mask)
 	if (me.connected && (q->duration == 0 || q->expires > CURRTIME))
 		unqline_sts("*", q->mask);
 
-	n = mowgli_node_find(q, &qlnlist);
-	mowgli_node_delete(n, &qlnlist);
-	mowgli_node_free(n);
-
-	sfree(q->mask);
-	sfree(q->reason);
-	sfree(q->setby);
+	mowgli_node_delete(&q->node, &qlnlist);
 
-	mowgli_heap_free(qline_heap, q);
+	slab_free_bytes(qline_heap, q, qline_size(q->mask, q->reason, q->setby));
 
 	cnt.qline--;
 }
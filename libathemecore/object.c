@@ -20,18 +20,391 @@
 mowgli_list_t object_list = { NULL, NULL, 0 };
 #endif
 
-static mowgli_heap_t *metadata_heap = NULL;	/* HEAP_CHANUSER */
+// Tables up to this many entries are kept as sorted vectors
+#define METADATA_VECTOR_MAX     16U
+
+// Number of values per key seen before deciding whether to share them
+#define METADATA_SHARE_SAMPLE   64U
+
+struct metadata_key
+{
+	stringref       name;
+	unsigned int    id;
+	unsigned int    refcount;       // entries using this key
+	unsigned int    sampled;        // values added while deciding on sharing
+	unsigned int    repeated;       // ... that someone else already had
+};
+
+struct metadata_table
+{
+	unsigned int    count;
+	unsigned int    size;
+	bool            hashed;
+	struct metadata *slots[];
+};
+
+static struct slab_type *metadata_heap = NULL;
+static struct slab_type *metadata_value_heap = NULL;
+static mowgli_patricia_t *metadata_keys = NULL;
+
+// Interned keys by ID, and the IDs of deleted keys available for reuse
+static struct metadata_key **metadata_key_ids = NULL;
+static unsigned int metadata_key_ids_size = 0;
+static unsigned int metadata_key_next_id = 0;
+static unsigned int *metadata_key_free = NULL;
+static unsigned int metadata_key_free_count = 0;
+static unsigned int metadata_key_free_size = 0;
+
+static struct metadata_stats metadata_totals;
 
 void
 init_metadata(void)
 {
-	metadata_heap = sharedheap_get(sizeof(struct metadata));
+	metadata_heap = slab_type_create("metadata", sizeof(struct metadata));
+	metadata_value_heap = slab_type_create("metadata values", 0);
 
-	if (metadata_heap == NULL)
+	if (metadata_heap == NULL || metadata_value_heap == NULL)
 	{
 		slog(LG_ERROR, "init_metadata(): block allocator failure.");
 		exit(EXIT_FAILURE);
 	}
+
+	metadata_keys = mowgli_patricia_create(strcasecanon);
+}
+
+static struct metadata_key *
+metadata_key_get(const char *name)
+{
+	struct metadata_key *key = mowgli_patricia_retrieve(metadata_keys, name);
+
+	if (key != NULL)
+	{
+		key->refcount++;
+		return key;
+	}
+
+	key = smalloc(sizeof *key);
+	key->name = strshare_get(name);
+	key->refcount = 1;
+
+	if (metadata_key_free_count)
+		key->id = metadata_key_free[--metadata_key_free_count];
+	else
+	{
+		if (metadata_key_next_id == metadata_key_ids_size)
+		{
+			metadata_key_ids_size = metadata_key_ids_size ? (metadata_key_ids_size * 2U) : 64U;
+			metadata_key_ids = sreallocarray(metadata_key_ids, metadata_key_ids_size,
+			                                 sizeof *metadata_key_ids);
+		}
+
+		key->id = metadata_key_next_id++;
+	}
+
+	metadata_key_ids[key->id] = key;
+	(void) mowgli_patricia_add(metadata_keys, key->name, key);
+
+	metadata_totals.keys++;
+	metadata_totals.key_bytes += sizeof *key + strlen(key->name) + 1;
+
+	return key;
+}
+
+static void
+metadata_key_unref(const unsigned int id)
+{
+	struct metadata_key *const key = metadata_key_ids[id];
+
+	if (--key->refcount)
+		return;
+
+	if (metadata_key_free_count == metadata_key_free_size)
+	{
+		metadata_key_free_size = metadata_key_free_size ? (metadata_key_free_size * 2U) : 64U;
+		metadata_key_free = sreallocarray(metadata_key_free, metadata_key_free_size,
+		                                  sizeof *metadata_key_free);
+	}
+
+	metadata_key_free[metadata_key_free_count++] = id;
+	metadata_key_ids[id] = NULL;
+
+	metadata_totals.keys--;
+	metadata_totals.key_bytes -= sizeof *key + strlen(key->name) + 1;
+
+	(void) mowgli_patricia_delete(metadata_keys, key->name);
+	strshare_unref(key->name);
+	sfree(key);
+}
+
+/* Values that many objects have in common (flags, "1", timestamps from a
+ * mass import and the like) are kept once in the shared string table,
+ * everything else gets its own copy. Which kind a key holds is decided
+ * from the first values added under it.
+ */
+static void
+metadata_value_set(struct metadata_key *key, struct metadata *md, const char *value)
+{
+	if (key->sampled < METADATA_SHARE_SAMPLE || (key->repeated * 2U) >= key->sampled)
+	{
+		stringref ref = strshare_get(value);
+
+		if (key->sampled < METADATA_SHARE_SAMPLE)
+		{
+			key->sampled++;
+
+			if (strshare_is_shared(ref))
+				key->repeated++;
+		}
+
+		// intermediate cast to suppress gcc -Wcast-qual
+		md->value = (char *)(uintptr_t) ref;
+		md->shared = true;
+
+		metadata_totals.shared_values++;
+		return;
+	}
+
+	md->value = slab_strdup(metadata_value_heap, value);
+	md->shared = false;
+
+	metadata_totals.private_values++;
+	metadata_totals.private_value_bytes += strlen(value) + 1;
+}
+
+static void
+metadata_value_release(struct metadata *md)
+{
+	if (md->shared)
+	{
+		strshare_unref(md->value);
+		metadata_totals.shared_values--;
+		return;
+	}
+
+	metadata_totals.private_values--;
+	metadata_totals.private_value_bytes -= strlen(md->value) + 1;
+	slab_strfree(metadata_value_heap, md->value);
+}
+
+static void
+metadata_entry_free(struct metadata *md)
+{
+	metadata_value_release(md);
+	metadata_key_unref(md->key);
+	slab_free(metadata_heap, md);
+
+	metadata_totals.entries--;
+	metadata_totals.entry_bytes -= sizeof *md;
+}
+
+static inline unsigned int
+metadata_hash_home(const struct metadata_table *t, unsigned int id)
+{
+	return (id * 2654435761U) & (t->size - 1U);
+}
+
+static struct metadata_table *
+metadata_table_alloc(unsigned int size, bool hashed)
+{
+	struct metadata_table *t = smalloc(sizeof *t + size * sizeof t->slots[0]);
+
+	t->size = size;
+	t->hashed = hashed;
+
+	metadata_totals.tables++;
+	metadata_totals.table_bytes += sizeof *t + size * sizeof t->slots[0];
+
+	return t;
+}
+
+static void
+metadata_table_free(struct metadata_table *t)
+{
+	metadata_totals.tables--;
+	metadata_totals.table_bytes -= sizeof *t + t->size * sizeof t->slots[0];
+
+	sfree(t);
+}
+
+/* Finds the slot holding key id, or in a vector the position it would be
+ * inserted at and in a hash table the empty slot ending its probe chain.
+ */
+static bool
+metadata_table_slot(const struct metadata_table *t, unsigned int id, unsigned int *slot)
+{
+	if (t->hashed)
+	{
+		unsigned int i = metadata_hash_home(t, id);
+
+		while (t->slots[i] != NULL && t->slots[i]->key != id)
+			i = (i + 1U) & (t->size - 1U);
+
+		*slot = i;
+
+		return t->slots[i] != NULL;
+	}
+
+	unsigned int lo = 0, hi = t->count;
+
+	while (lo < hi)
+	{
+		const unsigned int mid = lo + ((hi - lo) / 2U);
+
+		if (t->slots[mid]->key < id)
+			lo = mid + 1U;
+		else
+			hi = mid;
+	}
+
+	*slot = lo;
+
+	return lo < t->count && t->slots[lo]->key == id;
+}
+
+static void
+metadata_hash_insert(struct metadata_table *t, struct metadata *md)
+{
+	unsigned int i;
+
+	(void) metadata_table_slot(t, md->key, &i);
+
+	t->slots[i] = md;
+	t->count++;
+}
+
+// Moves every entry of t into a new hash table of the given size
+static struct metadata_table *
+metadata_table_rehash(struct metadata_table *t, unsigned int size)
+{
+	struct metadata_table *n = metadata_table_alloc(size, true);
+
+	for (unsigned int i = 0; i < t->size; i++)
+		if (t->slots[i] != NULL)
+			metadata_hash_insert(n, t->slots[i]);
+
+	metadata_table_free(t);
+
+	return n;
+}
+
+static int
+metadata_key_compare(const void *a, const void *b)
+{
+	const unsigned int ka = (*(struct metadata *const *) a)->key;
+	const unsigned int kb = (*(struct metadata *const *) b)->key;
+
+	return (ka > kb) - (ka < kb);
+}
+
+static struct metadata_table *
+metadata_table_unhash(struct metadata_table *t)
+{
+	struct metadata_table *n = metadata_table_alloc(METADATA_VECTOR_MAX, false);
+
+	for (unsigned int i = 0; i < t->size; i++)
+		if (t->slots[i] != NULL)
+			n->slots[n->count++] = t->slots[i];
+
+	qsort(n->slots, n->count, sizeof n->slots[0], metadata_key_compare);
+	metadata_table_free(t);
+
+	return n;
+}
+
+static struct metadata_table *
+metadata_table_insert(struct metadata_table *t, unsigned int slot, struct metadata *md)
+{
+	if (t == NULL)
+		t = metadata_table_alloc(4U, false);
+
+	if (t->hashed)
+	{
+		if ((t->count + 1U) * 2U > t->size)
+		{
+			t = metadata_table_rehash(t, t->size * 2U);
+			metadata_hash_insert(t, md);
+		}
+		else
+		{
+			t->slots[slot] = md;
+			t->count++;
+		}
+
+		return t;
+	}
+
+	if (t->count == METADATA_VECTOR_MAX)
+	{
+		t = metadata_table_rehash(t, METADATA_VECTOR_MAX * 4U);
+		metadata_hash_insert(t, md);
+
+		return t;
+	}
+
+	if (t->count == t->size)
+	{
+		const size_t old_bytes = sizeof *t + t->size * sizeof t->slots[0];
+		const unsigned int size = t->size * 2U;
+
+		t = srealloc(t, sizeof *t + size * sizeof t->slots[0]);
+		(void) memset(&t->slots[t->size], 0x00, (size - t->size) * sizeof t->slots[0]);
+		t->size = size;
+
+		metadata_totals.table_bytes += (sizeof *t + size * sizeof t->slots[0]) - old_bytes;
+	}
+
+	(void) memmove(&t->slots[slot + 1U], &t->slots[slot], (t->count - slot) * sizeof t->slots[0]);
+	t->slots[slot] = md;
+	t->count++;
+
+	return t;
+}
+
+// Unlinks the entry in the given slot without freeing anything
+static void
+metadata_table_remove(struct metadata_table *t, unsigned int slot)
+{
+	t->count--;
+
+	if (! t->hashed)
+	{
+		(void) memmove(&t->slots[slot], &t->slots[slot + 1U], (t->count - slot) * sizeof t->slots[0]);
+		t->slots[t->count] = NULL;
+		return;
+	}
+
+	// backward-shift deletion keeps every probe chain unbroken
+	const unsigned int mask = t->size - 1U;
+	unsigned int i = slot, j = slot;
+
+	for (;;)
+	{
+		j = (j + 1U) & mask;
+
+		if (t->slots[j] == NULL)
+			break;
+
+		const unsigned int home = metadata_hash_home(t, t->slots[j]->key);
+
+		if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j))
+		{
+			t->slots[i] = t->slots[j];
+			i = j;
+		}
+	}
+
+	t->slots[i] = NULL;
+}
+
+// Frees whatever entries are left in a table, and the table itself
+static void
+metadata_table_destroy(struct metadata_table *t)
+{
+	for (unsigned int i = 0; i < t->size; i++)
+		if (t->slots[i] != NULL)
+			metadata_entry_free(t->slots[i]);
+
+	metadata_table_free(t);
 }
 
 /*
@@ -57,6 +430,7 @@ atheme_object_init(struct atheme_object *obj, const char *name, atheme_object_de
 	return_if_fail(obj != NULL);
 
 	obj->destructor = des;
+	obj->metadata_changed = NULL;
 	obj->refcount = 1;
 
 #ifdef OBJECT_DEBUG
@@ -179,7 +553,8 @@ void
 atheme_object_dispose(void *object)
 {
 	struct atheme_object *obj;
-	mowgli_patricia_t *privatedata, *metadata;
+	mowgli_patricia_t *privatedata;
+	struct metadata_table *metadata;
 
 	return_if_fail(object != NULL);
 	obj = atheme_object(object);
@@ -190,7 +565,9 @@ atheme_object_dispose(void *object)
 	 */
 	return_if_fail(obj->refcount != -1);
 
-	/* set refcount to -1 to ensure that atheme_object_unref() doesn't cause a loop */
+	/* set refcount to -1 to ensure that atheme_object_unref() doesn't cause a loop;
+	 * this also keeps the metadata table in place while the destructor runs.
+	 */
 	obj->refcount = -1;
 
 	privatedata = obj->privatedata;
@@ -212,31 +589,58 @@ atheme_object_dispose(void *object)
 		mowgli_patricia_destroy(privatedata, NULL, NULL);
 
 	if (metadata != NULL)
-		mowgli_patricia_destroy(metadata, NULL, NULL);
+		metadata_table_destroy(metadata);
+}
+
+/* Lets the owner of an object mirror some of its metadata elsewhere,
+ * like accounts do with their vhosts.
+ */
+static inline void
+metadata_notify(struct atheme_object *obj, void *target, const struct metadata *md, bool added)
+{
+	if (obj->metadata_changed != NULL)
+		obj->metadata_changed(target, md, added);
 }
 
 struct metadata *
 metadata_add(void *target, const char *name, const char *value)
 {
 	struct atheme_object *obj;
+	struct metadata_key *key;
 	struct metadata *md;
+	unsigned int slot = 0;
 
 	return_val_if_fail(name != NULL, NULL);
 	return_val_if_fail(value != NULL, NULL);
 
 	obj = atheme_object(target);
 
-	if (obj->metadata == NULL)
-		obj->metadata = mowgli_patricia_create(strcasecanon);
-	else if (metadata_find(target, name))
-		metadata_delete(target, name);
+	/* take the new key and value before letting go of any old entry,
+	 * callers may pass strings that belong to it
+	 */
+	key = metadata_key_get(name);
+
+	md = slab_alloc(metadata_heap);
+	md->key = key->id;
+	md->name = key->name;
+	metadata_value_set(key, md, value);
 
-	md = mowgli_heap_alloc(metadata_heap);
+	metadata_totals.entries++;
+	metadata_totals.entry_bytes += sizeof *md;
 
-	md->name = strshare_get(name);
-	md->value = sstrdup(value);
+	if (obj->metadata != NULL && metadata_table_slot(obj->metadata, key->id, &slot))
+	{
+		struct metadata *old = obj->metadata->slots[slot];
 
-	mowgli_patricia_add(obj->metadata, md->name, md);
+		metadata_notify(obj, target, old, false);
+
+		obj->metadata->slots[slot] = md;
+		metadata_entry_free(old);
+	}
+	else
+		obj->metadata = metadata_table_insert(obj->metadata, slot, md);
+
+	metadata_notify(obj, target, md, true);
 
 	return md;
 }
@@ -245,55 +649,207 @@ void
 metadata_delete(void *target, const char *name)
 {
 	struct atheme_object *obj;
-	struct metadata *md = metadata_find(target, name);
+	struct metadata_key *key;
+	struct metadata *md;
+	unsigned int slot;
 
-	if (!md)
-		return;
+	return_if_fail(target != NULL);
+	return_if_fail(name != NULL);
 
 	obj = atheme_object(target);
 
-	return_if_fail(obj->metadata != NULL);
+	if (obj->metadata == NULL || (key = mowgli_patricia_retrieve(metadata_keys, name)) == NULL)
+		return;
 
-	mowgli_patricia_delete(obj->metadata, name);
+	if (!metadata_table_slot(obj->metadata, key->id, &slot))
+		return;
 
-	strshare_unref(md->name);
-	sfree(md->value);
+	md = obj->metadata->slots[slot];
+	metadata_table_remove(obj->metadata, slot);
 
-	mowgli_heap_free(metadata_heap, md);
+	metadata_notify(obj, target, md, false);
+
+	metadata_entry_free(md);
+
+	// a disposing object's table is freed by atheme_object_dispose()
+	if (obj->refcount == -1)
+		return;
+
+	if (obj->metadata->count == 0)
+	{
+		metadata_table_free(obj->metadata);
+		obj->metadata = NULL;
+	}
+	else if (obj->metadata->hashed && obj->metadata->count <= (METADATA_VECTOR_MAX / 2U))
+		obj->metadata = metadata_table_unhash(obj->metadata);
 }
 
 struct metadata *
 metadata_find(void *target, const char *name)
 {
 	struct atheme_object *obj;
+	struct metadata_key *key;
+	unsigned int slot;
 
 	return_val_if_fail(target != NULL, NULL);
 	return_val_if_fail(name != NULL, NULL);
 
 	obj = atheme_object(target);
 
-	if (obj->metadata == NULL)
+	if (obj->metadata == NULL || (key = mowgli_patricia_retrieve(metadata_keys, name)) == NULL)
 		return NULL;
 
-	return mowgli_patricia_retrieve(obj->metadata, name);
+	if (!metadata_table_slot(obj->metadata, key->id, &slot))
+		return NULL;
+
+	return obj->metadata->slots[slot];
 }
 
 void
 metadata_delete_all(void *target)
 {
 	struct atheme_object *obj;
-	struct metadata *md;
-	mowgli_patricia_iteration_state_t state;
+	struct metadata_table *t;
+
+	return_if_fail(target != NULL);
 
 	obj = atheme_object(target);
 
-	if (obj->metadata == NULL)
+	if ((t = obj->metadata) == NULL)
 		return;
 
-	MOWGLI_PATRICIA_FOREACH(md, &state, obj->metadata)
+	for (unsigned int i = 0; i < t->size; i++)
 	{
-		metadata_delete(obj, md->name);
+		struct metadata *md = t->slots[i];
+
+		if (md == NULL)
+			continue;
+
+		t->slots[i] = NULL;
+		t->count--;
+
+		metadata_notify(obj, target, md, false);
+
+		metadata_entry_free(md);
 	}
+
+	if (obj->refcount == -1)
+		return;
+
+	metadata_table_free(t);
+	obj->metadata = NULL;
+}
+
+unsigned int
+metadata_count(void *target)
+{
+	struct atheme_object *obj;
+
+	return_val_if_fail(target != NULL, 0);
+
+	obj = atheme_object(target);
+
+	return (obj->metadata != NULL) ? obj->metadata->count : 0;
+}
+
+void
+metadata_iteration_start(void *target, struct metadata_iteration_state *state)
+{
+	return_if_fail(target != NULL);
+	return_if_fail(state != NULL);
+
+	state->last = NULL;
+}
+
+/* Key names are unique under strcasecanon(), so this orders them the way
+ * the patricia the metadata used to live in did.
+ */
+static int
+metadata_name_cmp(const char *a, const char *b)
+{
+	const unsigned char *ua = (const unsigned char *) a;
+	const unsigned char *ub = (const unsigned char *) b;
+
+	while (*ua != '\0' && toupper(*ua) == toupper(*ub))
+	{
+		ua++;
+		ub++;
+	}
+
+	return toupper(*ua) - toupper(*ub);
+}
+
+/*
+ * metadata_iteration_next
+ *
+ * Returns the next metadata entry of an object, in case-insensitive
+ * alphabetical order of the key names. Each step scans the whole table,
+ * which is cheap for the handful of entries most objects carry. The
+ * object's metadata must not be changed during the iteration.
+ *
+ * Inputs:
+ *      - the object
+ *      - iteration state, set up with metadata_iteration_start()
+ *
+ * Outputs:
+ *      - the next entry, or NULL at the end
+ *
+ * Side Effects:
+ *      - the iteration state is advanced
+ */
+struct metadata *
+metadata_iteration_next(void *target, struct metadata_iteration_state *state)
+{
+	struct metadata_table *t;
+	struct metadata *next = NULL;
+
+	return_val_if_fail(target != NULL, NULL);
+	return_val_if_fail(state != NULL, NULL);
+
+	if ((t = atheme_object(target)->metadata) == NULL)
+		return NULL;
+
+	for (unsigned int i = 0; i < t->size; i++)
+	{
+		struct metadata *md = t->slots[i];
+
+		if (md == NULL)
+			continue;
+
+		if (state->last != NULL && metadata_name_cmp(md->name, state->last) <= 0)
+			continue;
+
+		if (next == NULL || metadata_name_cmp(md->name, next->name) < 0)
+			next = md;
+	}
+
+	if (next != NULL)
+		state->last = next->name;
+
+	return next;
+}
+
+/*
+ * metadata_get_stats
+ *
+ * Reports how much memory all metadata currently takes. Bytes held by
+ * shared values are accounted to the shared string table.
+ *
+ * Inputs:
+ *      - where to store the figures
+ *
+ * Outputs:
+ *      - none
+ *
+ * Side Effects:
+ *      - none
+ */
+void
+metadata_get_stats(struct metadata_stats *stats)
+{
+	return_if_fail(stats != NULL);
+
+	*stats = metadata_totals;
 }
 
 void *
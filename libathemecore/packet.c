@@ -37,6 +37,7 @@ irc_recvq_handler(struct connection *cptr)
 	/* ignore the excessive part of a too long line */
 	if (wasnonl)
 		return;
+	cnt.lines_in++;
 	me.uplinkpong = CURRTIME;
 	if (parsebuf[count - 1] == '\n')
 		count--;
@@ -28,6 +28,7 @@ void (*notice_user_sts) (struct user *from, struct user *target, const char *tex
 void (*notice_global_sts) (struct user *from, const char *mask, const char *text) = generic_notice_global_sts;
 void (*notice_channel_sts) (struct user *from, struct channel *target, const char *text) = generic_notice_channel_sts;
 void (*wallchops) (struct user *source, struct channel *target, const char *message) = generic_wallchops;
+void (*notice_users_sts) (struct user *from, struct user **targets, size_t count, const char *text) = generic_notice_users_sts;
 void (*numeric_sts) (struct server *from, int numeric, struct user *target, const char *fmt, ...) = generic_numeric_sts;
 void (*kill_id_sts) (struct user *killer, const char *id, const char *reason) = generic_kill_id_sts;
 void (*part_sts) (struct channel *c, struct user *u) = generic_part_sts;
@@ -163,12 +164,56 @@ generic_wallchops(struct user *sender, struct channel *channel, const char *mess
 	mowgli_node_t *n;
 	struct chanuser *cu;
 
+	notice_batch_begin();
+
 	MOWGLI_ITER_FOREACH(n, channel->members.head)
 	{
 		cu = (struct chanuser *)n->data;
 		if (cu->user->server != me.me && cu->modes & CSTATUS_OP)
 			notice(sender->nick, cu->user->nick, "[@%s] %s", channel->name, message);
 	}
+
+	notice_batch_end();
+}
+
+void
+generic_notice_users_sts(struct user *from, struct user **targets, size_t count, const char *text)
+{
+	for (size_t i = 0; i < count; i++)
+		notice_user_sts(from, targets[i], text);
+}
+
+/* Sends ":<source> NOTICE a,b,c :<text>" with at most maxtargets targets
+ * per line, keeping each line within the 510 bytes an ircd accepts.
+ */
+void
+notice_users_multi_sts(const char *source, struct user **targets, size_t count, const char *text, size_t maxtargets)
+{
+	const size_t overhead = strlen(":") + strlen(source) + strlen(" NOTICE ") + strlen(" :") + strlen(text);
+	char buf[BUFSIZE];
+	size_t len = 0, n = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const char *name = CLIENT_NAME(targets[i]);
+		const size_t namelen = strlen(name);
+
+		if (n && (n == maxtargets || overhead + len + 1 + namelen > 510))
+		{
+			sts(":%s NOTICE %s :%s", source, buf, text);
+			len = n = 0;
+		}
+
+		if (n)
+			buf[len++] = ',';
+
+		(void) memcpy(buf + len, name, namelen + 1);
+		len += namelen;
+		n++;
+	}
+
+	if (n)
+		sts(":%s NOTICE %s :%s", source, buf, text);
 }
 
 void ATHEME_FATTR_PRINTF(4, 5)
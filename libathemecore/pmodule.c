@@ -18,7 +18,7 @@
 
 mowgli_patricia_t *pcommands;
 
-mowgli_heap_t *pcommand_heap;
+struct slab_type *pcommand_heap;
 mowgli_heap_t *messagetree_heap;
 
 const struct cmode *mode_list = NULL;
@@ -30,10 +30,119 @@ const struct cmode *user_mode_list = NULL;
 struct ircd *ircd = NULL;
 bool backend_loaded = false;
 
+/* pcommands keeps the registrations, but every line from the uplink is
+ * looked up in a table compiled from it instead. Three-digit numerics
+ * index an array directly. Every other token has a slot of its own in a
+ * hash table whose seed is picked, whenever the set of tokens changes,
+ * so that no two tokens collide; a lookup is then one hash and at most
+ * one strcmp().
+ */
+#define PCOMMAND_NUMERICS       1000U
+#define PCOMMAND_TABLE_SPARSITY 8U      // slots per token to start with
+#define PCOMMAND_TABLE_SEEDS    64U     // seeds to try before doubling the table
+#define PCOMMAND_TABLE_MAX      65536U  // past this, pcommands is searched instead
+
+static struct proto_cmd *pcommand_numerics[PCOMMAND_NUMERICS];
+static struct proto_cmd **pcommand_table = NULL;
+static size_t pcommand_table_mask = 0;
+static uint32_t pcommand_table_seed = 0;
+static bool pcommand_table_stale = true;
+
+// Index of a three-digit numeric, or -1 if the token is anything else
+static inline int
+pcommand_numeric(const char *const restrict token)
+{
+	if (! isdigit((unsigned char) token[0]) || ! isdigit((unsigned char) token[1]) ||
+	    ! isdigit((unsigned char) token[2]) || token[3] != '\0')
+		return -1;
+
+	return ((token[0] - '0') * 100) + ((token[1] - '0') * 10) + (token[2] - '0');
+}
+
+static inline uint32_t
+pcommand_hash(const char *token, const uint32_t seed)
+{
+	uint32_t hash = 0x811C9DC5U ^ seed;
+
+	for (; *token != '\0'; token++)
+	{
+		hash ^= (unsigned char) *token;
+		hash *= 0x01000193U;
+	}
+
+	// FNV-1a on its own leaves the low bits too alike across seeds
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6BU;
+	hash ^= hash >> 13;
+
+	return hash;
+}
+
+static bool
+pcommand_table_fill(struct proto_cmd **const restrict table, const size_t mask, const uint32_t seed)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct proto_cmd *pcmd;
+
+	MOWGLI_PATRICIA_FOREACH(pcmd, &state, pcommands)
+	{
+		if (pcommand_numeric(pcmd->token) != -1)
+			continue;
+
+		const size_t slot = pcommand_hash(pcmd->token, seed) & mask;
+
+		if (table[slot] != NULL)
+			return false;
+
+		table[slot] = pcmd;
+	}
+
+	return true;
+}
+
+static void
+pcommand_table_build(void)
+{
+	size_t size = 16U;
+
+	while (size < (mowgli_patricia_size(pcommands) * PCOMMAND_TABLE_SPARSITY))
+		size <<= 1U;
+
+	sfree(pcommand_table);
+
+	while (size <= PCOMMAND_TABLE_MAX)
+	{
+		pcommand_table = smalloc(size * sizeof *pcommand_table);
+
+		for (unsigned int i = 0; i < PCOMMAND_TABLE_SEEDS; i++)
+		{
+			pcommand_table_seed = atheme_random();
+
+			if (pcommand_table_fill(pcommand_table, size - 1U, pcommand_table_seed))
+			{
+				pcommand_table_mask = size - 1U;
+				pcommand_table_stale = false;
+				return;
+			}
+
+			(void) memset(pcommand_table, 0x00, size * sizeof *pcommand_table);
+		}
+
+		sfree(pcommand_table);
+		size <<= 1U;
+	}
+
+	slog(LG_DEBUG, "pcommand_table_build(): no collision-free table for %u tokens, using the tree",
+	     mowgli_patricia_size(pcommands));
+
+	pcommand_table = NULL;
+	pcommand_table_stale = false;
+}
+
 void
 pcommand_init(void)
 {
-	pcommand_heap = sharedheap_get(sizeof(struct proto_cmd));
+	pcommand_heap = slab_type_create("pcommand", sizeof(struct proto_cmd));
 
 	if (!pcommand_heap)
 	{
@@ -48,28 +157,35 @@ void
 pcommand_add(const char *token, void (*handler) (struct sourceinfo *si, int parc, char *parv[]), int minparc, int sourcetype)
 {
 	struct proto_cmd *pcmd;
+	int numeric;
 
-	if (pcommand_find(token))
+	if (mowgli_patricia_retrieve(pcommands, token))
 	{
 		slog(LG_INFO, "pcommand_add(): token %s is already registered", token);
 		return;
 	}
 
-	pcmd = mowgli_heap_alloc(pcommand_heap);
+	pcmd = slab_alloc(pcommand_heap);
 	pcmd->token = sstrdup(token);
 	pcmd->handler = handler;
 	pcmd->minparc = minparc;
 	pcmd->sourcetype = sourcetype;
 
 	mowgli_patricia_add(pcommands, pcmd->token, pcmd);
+
+	if ((numeric = pcommand_numeric(pcmd->token)) != -1)
+		pcommand_numerics[numeric] = pcmd;
+	else
+		pcommand_table_stale = true;
 }
 
 void
 pcommand_delete(const char *token)
 {
 	struct proto_cmd *pcmd;
+	int numeric;
 
-	if (!(pcmd = pcommand_find(token)))
+	if (!(pcmd = mowgli_patricia_retrieve(pcommands, token)))
 	{
 		slog(LG_INFO, "pcommand_delete(): token %s is not registered", token);
 		return;
@@ -77,15 +193,74 @@ pcommand_delete(const char *token)
 
 	mowgli_patricia_delete(pcommands, pcmd->token);
 
+	if ((numeric = pcommand_numeric(pcmd->token)) != -1)
+		pcommand_numerics[numeric] = NULL;
+	else
+		pcommand_table_stale = true;
+
 	sfree(pcmd->token);
 	pcmd->handler = NULL;
-	mowgli_heap_free(pcommand_heap, pcmd);
+	slab_free(pcommand_heap, pcmd);
 }
 
 struct proto_cmd *
 pcommand_find(const char *token)
 {
-	return mowgli_patricia_retrieve(pcommands, token);
+	struct proto_cmd *pcmd;
+	int numeric;
+
+	return_val_if_fail(token != NULL, NULL);
+
+	if ((numeric = pcommand_numeric(token)) != -1)
+		return pcommand_numerics[numeric];
+
+	if (pcommand_table_stale)
+		(void) pcommand_table_build();
+
+	if (pcommand_table == NULL)
+		return mowgli_patricia_retrieve(pcommands, token);
+
+	pcmd = pcommand_table[pcommand_hash(token, pcommand_table_seed) & pcommand_table_mask];
+
+	if (pcmd == NULL || strcmp(pcmd->token, token) != 0)
+		return NULL;
+
+	return pcmd;
+}
+
+/* Runs a command's handler, which the parsers call once they've checked
+ * the source and the parameters.
+ */
+void
+pcommand_exec(struct proto_cmd *pcmd, struct sourceinfo *si, int parc, char *parv[])
+{
+	struct latency_stat *stat;
+	uint64_t begin;
+
+	return_if_fail(pcmd != NULL);
+
+	if (pcmd->handler == NULL)
+		return;
+
+	stall_context_push("pcommand", pcmd->token, NULL);
+
+	if (! latency_enabled)
+	{
+		pcmd->handler(si, parc, parv);
+		stall_context_pop();
+		return;
+	}
+
+	if (pcmd->latency == NULL)
+		pcmd->latency = latency_stat_get(LATENCY_PCOMMAND, pcmd->token);
+
+	stat = pcmd->latency;
+	begin = latency_clock();
+
+	pcmd->handler(si, parc, parv);
+
+	latency_record(stat, latency_clock() - begin);
+	stall_context_pop();
 }
 
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
@@ -16,6 +16,9 @@
 #include <atheme.h>
 #include "internal.h"
 
+// Services collected on the stack per channel message before falling back to the heap
+#define CHANMSG_SERVICES_MAX    16U
+
 void
 handle_info(struct user *u)
 {
@@ -107,6 +110,14 @@ connection_stats_cb(const char *line, void *privdata)
 	numeric_sts(me.me, 249, ((struct user *)privdata), "F :%s", line);
 }
 
+static void
+slab_stats_cb(const struct slab_type_stats *stats, void *privdata)
+{
+	numeric_sts(me.me, 249, ((struct user *)privdata), "Z :%-26s %7zu live %7zu peak %9zu B %9zu B peak (size %zu/%zu)",
+			stats->name, stats->live, stats->peak, stats->bytes, stats->peak_bytes,
+			stats->size, stats->class_size);
+}
+
 void
 handle_stats(struct user *u, char req)
 {
@@ -116,6 +127,8 @@ handle_stats(struct user *u, char req)
 	mowgli_node_t *n;
 	struct uplink *uplink;
 	struct soper *soper;
+	struct replyq_stats rqstats;
+	struct slab_stats slstats;
 	int j;
 	char fl[10];
 
@@ -275,6 +288,13 @@ handle_stats(struct user *u, char req)
 		  numeric_sts(me.me, 249, u, "T :objects    %7zu", MOWGLI_LIST_LENGTH(&object_list));
 #endif
 
+		  replyq_get_stats(&rqstats);
+		  numeric_sts(me.me, 249, u, "T :replyq     %7u", rqstats.queues);
+		  numeric_sts(me.me, 249, u, "T :replyq_lin %7zu", rqstats.lines);
+		  numeric_sts(me.me, 249, u, "T :replyq_max %7zu (peak %zu)", rqstats.max_depth, rqstats.peak_depth);
+		  numeric_sts(me.me, 249, u, "T :replyq_out %7" PRIu64 " direct, %" PRIu64 " queued, %" PRIu64 " dropped",
+		              rqstats.sent_direct, rqstats.sent_queued, rqstats.dropped);
+
 		  numeric_sts(me.me, 249, u, "T :bytes sent %7.2f%s", (double) bytes(cnt.bout), sbytes(cnt.bout));
 		  numeric_sts(me.me, 249, u, "T :bytes recv %7.2f%s", (double) bytes(cnt.bin), sbytes(cnt.bin));
 		  break;
@@ -338,6 +358,19 @@ handle_stats(struct user *u, char req)
 				  me.recontime, config_options.uplink_sendq_limit);
 		  break;
 
+	  case 'z':
+	  case 'Z':
+		  if (!has_priv_user(u, PRIV_SERVER_AUSPEX))
+			  break;
+
+		  slab_foreach_type(slab_stats_cb, u);
+
+		  slab_get_stats(&slstats);
+		  numeric_sts(me.me, 249, u, "Z :slabs %zu in %zu arenas (%zu spare), %zu B reserved, %zu B used, %zu B outside slabs",
+				  slstats.slabs, slstats.arenas, slstats.spare_slabs, slstats.reserved_bytes,
+				  slstats.used_bytes, slstats.large_bytes);
+		  break;
+
 	  default:
 		  break;
 	}
@@ -502,9 +535,11 @@ handle_channel_message(struct sourceinfo *si, char *target, bool is_notice, char
 {
 	char *vec[3];
 	struct hook_channel_message cdata;
-	mowgli_node_t *n, *tn;
-	mowgli_list_t l = { NULL, NULL, 0 };
+	mowgli_node_t *n;
+	struct service *svsbuf[CHANMSG_SERVICES_MAX];
+	struct service **svsv = svsbuf;
 	struct service *svs;
+	unsigned int svsc = 0;
 
 	/* Call hook here */
 	cdata.u = si->su;
@@ -517,40 +552,46 @@ handle_channel_message(struct sourceinfo *si, char *target, bool is_notice, char
 
 	hook_call_channel_message(&cdata);
 
+	if (cdata.c->numsvcmembers == 0)
+		return;
+
 	vec[0] = target;
 	vec[1] = message;
 	vec[2] = NULL;
 
-	MOWGLI_ITER_FOREACH(n, cdata.c->members.head)
-	{
-		struct chanuser *cu = (struct chanuser *) n->data;
+	/* Handlers may make services part or the channel go away, so
+	 * collect the services first. Channels rarely have more than a
+	 * few of them, so the stack buffer nearly always suffices.
+	 */
+	if (cdata.c->numsvcmembers > CHANMSG_SERVICES_MAX)
+		svsv = smalloc(cdata.c->numsvcmembers * sizeof *svsv);
 
-		if (!is_internal_client(cu->user))
-			continue;
+	MOWGLI_ITER_FOREACH(n, cdata.c->svcmembers.head)
+	{
+		const struct chanuser *const cu = n->data;
 
 		svs = service_find_nick(cu->user->nick);
 
-		if (svs == NULL)
-			continue;
-
-		if (svs->chanmsg == false)
+		if (svs == NULL || svs->chanmsg == false)
 			continue;
 
-		mowgli_node_add(svs, mowgli_node_create(), &l);
+		svsv[svsc++] = svs;
 	}
+
 	/* Note: this assumes a fantasy command will not remove another
 	 * service.
 	 */
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, l.head)
+	for (unsigned int i = 0; i < svsc; i++)
 	{
-		si->service = n->data;
+		si->service = svsv[i];
 		if (is_notice)
 			si->service->notice_handler(si, 2, vec);
 		else
 			si->service->handler(si, 2, vec);
-		mowgli_node_delete(n, &l);
-		mowgli_node_free(n);
 	}
+
+	if (svsv != svsbuf)
+		sfree(svsv);
 }
 
 void
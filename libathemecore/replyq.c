@@ -0,0 +1,320 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * replyq.c: Fair queueing of command replies.
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#define REPLYQ_PRIVDATA         "core:replyq"
+
+struct replyq_line
+{
+	mowgli_node_t           node;
+	struct service *        svs;
+	bool                    privmsg;
+	char                    text[];
+};
+
+struct replyq
+{
+	struct user *           u;
+	mowgli_list_t           lines;
+	mowgli_node_t           node;           // in replyq_active
+};
+
+// Recipients with replies waiting, in the order they get their next turn
+static mowgli_list_t replyq_active = { NULL, NULL, 0 };
+
+static mowgli_eventloop_timer_t *replyq_timer = NULL;
+static unsigned int replyq_budget = 0;
+static time_t replyq_budget_time = 0;
+static struct replyq_stats replyq_totals;
+
+// Takes one line from this second's budget
+static bool
+replyq_budget_take(void)
+{
+	if (! config_options.reply_rate)
+		return true;
+
+	if (replyq_budget_time != CURRTIME)
+	{
+		replyq_budget_time = CURRTIME;
+		replyq_budget = config_options.reply_rate;
+	}
+
+	if (! replyq_budget)
+		return false;
+
+	replyq_budget--;
+	return true;
+}
+
+// Returns false if the service has no client to send from
+static bool
+replyq_deliver(struct service *svs, struct user *u, const char *text, bool privmsg)
+{
+	if (svs->me == NULL)
+		return false;
+
+	if (privmsg)
+		msg(svs->nick, u->nick, "%s", text);
+	else
+		notice_user_sts(svs->me, u, text);
+
+	return true;
+}
+
+static void
+replyq_line_free(struct replyq *q, struct replyq_line *l)
+{
+	mowgli_node_delete(&l->node, &q->lines);
+	sfree(l);
+
+	replyq_totals.lines--;
+}
+
+static void
+replyq_destroy(struct replyq *q)
+{
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, q->lines.head)
+	{
+		replyq_line_free(q, n->data);
+		replyq_totals.dropped++;
+	}
+
+	(void) privatedata_delete(q->u, REPLYQ_PRIVDATA);
+	mowgli_node_delete(&q->node, &replyq_active);
+	sfree(q);
+
+	replyq_totals.queues--;
+}
+
+static void
+replyq_drain(void *arg)
+{
+	while (replyq_active.head != NULL && ! uplink_sendq_busy() && replyq_budget_take())
+	{
+		struct replyq *q = replyq_active.head->data;
+		struct replyq_line *l = q->lines.head->data;
+
+		if (replyq_deliver(l->svs, q->u, l->text, l->privmsg))
+			replyq_totals.sent_queued++;
+		else
+			replyq_totals.dropped++;
+
+		replyq_line_free(q, l);
+
+		// the recipient goes to the back of the line either way
+		mowgli_node_delete(&q->node, &replyq_active);
+
+		if (MOWGLI_LIST_LENGTH(&q->lines))
+			mowgli_node_add(q, &q->node, &replyq_active);
+		else
+		{
+			(void) privatedata_delete(q->u, REPLYQ_PRIVDATA);
+			sfree(q);
+			replyq_totals.queues--;
+		}
+	}
+
+	if (replyq_active.head == NULL && replyq_timer != NULL)
+	{
+		(void) mowgli_timer_destroy(base_eventloop, replyq_timer);
+		replyq_timer = NULL;
+	}
+}
+
+static void
+replyq_append(struct replyq *q, struct service *svs, const char *line, bool privmsg)
+{
+	struct replyq_line *l;
+
+	// past the cap, the rest of the reply is cut off rather than the start of it
+	if (config_options.reply_queue_max && MOWGLI_LIST_LENGTH(&q->lines) >= config_options.reply_queue_max)
+	{
+		replyq_totals.dropped++;
+		return;
+	}
+
+	l = smalloc(sizeof *l + strlen(line) + 1);
+	l->svs = svs;
+	l->privmsg = privmsg;
+	(void) strcpy(l->text, line);
+
+	mowgli_node_add(l, &l->node, &q->lines);
+	replyq_totals.lines++;
+
+	if (MOWGLI_LIST_LENGTH(&q->lines) > replyq_totals.peak_depth)
+		replyq_totals.peak_depth = MOWGLI_LIST_LENGTH(&q->lines);
+}
+
+/*
+ * replyq_send(struct service *svs, struct user *u, const char *line, bool privmsg)
+ *
+ * Sends one line of a command reply, or queues it behind the replies the
+ * user is already waiting for.
+ *
+ * Inputs:
+ *      - service the reply comes from
+ *      - user to send it to
+ *      - the line
+ *      - whether to send it as a PRIVMSG rather than a NOTICE
+ *
+ * Outputs:
+ *      - none
+ *
+ * Side Effects:
+ *      - the line is sent now or from the drain timer, or dropped if the
+ *        user already has general::reply_queue_max lines waiting
+ */
+void
+replyq_send(struct service *svs, struct user *u, const char *line, bool privmsg)
+{
+	struct replyq *q = NULL;
+
+	return_if_fail(svs != NULL);
+	return_if_fail(u != NULL);
+	return_if_fail(line != NULL);
+
+	if (replyq_active.head != NULL)
+		q = privatedata_get(u, REPLYQ_PRIVDATA);
+
+	if (q == NULL && ! uplink_sendq_busy() && replyq_budget_take())
+	{
+		if (replyq_deliver(svs, u, line, privmsg))
+			replyq_totals.sent_direct++;
+		else
+			replyq_totals.dropped++;
+
+		return;
+	}
+
+	if (q == NULL)
+	{
+		q = smalloc(sizeof *q);
+		q->u = u;
+
+		privatedata_set(u, REPLYQ_PRIVDATA, q);
+		mowgli_node_add(q, &q->node, &replyq_active);
+		replyq_totals.queues++;
+	}
+
+	replyq_append(q, svs, line, privmsg);
+
+	if (replyq_timer == NULL)
+		replyq_timer = mowgli_timer_add(base_eventloop, "replyq_drain", replyq_drain, NULL, 1);
+}
+
+/*
+ * replyq_send_if_waiting(const char *from, struct user *u, const char *line, bool privmsg)
+ *
+ * Queues a line from a service behind the replies a user is waiting for, if
+ * there are any, so that it does not overtake them. It does not use the
+ * reply budget.
+ *
+ * Inputs:
+ *      - nick the line comes from
+ *      - user to send it to
+ *      - the line
+ *      - whether to send it as a PRIVMSG rather than a NOTICE
+ *
+ * Outputs:
+ *      - true if the line was queued (or dropped at general::reply_queue_max),
+ *        false if the user has nothing waiting or the nick is not a service,
+ *        and the caller should send it
+ *
+ * Side Effects:
+ *      - the line may be queued
+ */
+bool
+replyq_send_if_waiting(const char *from, struct user *u, const char *line, bool privmsg)
+{
+	struct replyq *q;
+	struct service *svs;
+
+	return_val_if_fail(from != NULL, false);
+	return_val_if_fail(u != NULL, false);
+	return_val_if_fail(line != NULL, false);
+
+	if (replyq_active.head == NULL || (q = privatedata_get(u, REPLYQ_PRIVDATA)) == NULL)
+		return false;
+
+	if ((svs = service_find_nick(from)) == NULL)
+		return false;
+
+	replyq_append(q, svs, line, privmsg);
+	return true;
+}
+
+void
+replyq_user_delete(struct user *u)
+{
+	struct replyq *q;
+
+	return_if_fail(u != NULL);
+
+	if (replyq_active.head == NULL || (q = privatedata_get(u, REPLYQ_PRIVDATA)) == NULL)
+		return;
+
+	replyq_destroy(q);
+}
+
+// Drops the replies of a service that is going away
+void
+replyq_service_delete(struct service *svs)
+{
+	mowgli_node_t *n, *tn, *n2, *tn2;
+
+	return_if_fail(svs != NULL);
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, replyq_active.head)
+	{
+		struct replyq *q = n->data;
+
+		MOWGLI_ITER_FOREACH_SAFE(n2, tn2, q->lines.head)
+		{
+			struct replyq_line *l = n2->data;
+
+			if (l->svs != svs)
+				continue;
+
+			replyq_line_free(q, l);
+			replyq_totals.dropped++;
+		}
+
+		if (! MOWGLI_LIST_LENGTH(&q->lines))
+			replyq_destroy(q);
+	}
+}
+
+void
+replyq_get_stats(struct replyq_stats *stats)
+{
+	mowgli_node_t *n;
+
+	return_if_fail(stats != NULL);
+
+	*stats = replyq_totals;
+	stats->max_depth = 0;
+
+	MOWGLI_ITER_FOREACH(n, replyq_active.head)
+	{
+		const struct replyq *q = n->data;
+
+		if (MOWGLI_LIST_LENGTH(&q->lines) > stats->max_depth)
+			stats->max_depth = MOWGLI_LIST_LENGTH(&q->lines);
+	}
+}
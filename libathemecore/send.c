@@ -66,9 +66,18 @@ io_loop(void)
 	while (!(runflags & (RF_SHUTDOWN | RF_RESTART)))
 	{
 		CURRTIME = mowgli_eventloop_get_time(base_eventloop);
-		mowgli_eventloop_run_once(base_eventloop);
+
+		const unsigned int timeout = stall_loop_tick();
+
+		if (timeout)
+			mowgli_eventloop_timeout_once(base_eventloop, (int) timeout);
+		else
+			mowgli_eventloop_run_once(base_eventloop);
+
 		check_signals();
 	}
+
+	stall_loop_stop();
 }
 
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
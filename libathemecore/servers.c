@@ -17,10 +17,12 @@
 #include "internal.h"
 
 static void server_delete_serv(struct server *s);
+static size_t server_split_count(const struct server *s);
+static size_t server_split_mark(const struct server *s, struct user **users);
 
 static mowgli_patricia_t *sidlist = NULL;
-static mowgli_heap_t *serv_heap = NULL;
-static mowgli_heap_t *tld_heap = NULL;
+static struct slab_type *serv_heap = NULL;
+static struct slab_type *tld_heap = NULL;
 
 mowgli_patricia_t *servlist;
 mowgli_list_t tldlist;
@@ -43,8 +45,8 @@ mowgli_list_t tldlist;
 void
 init_servers(void)
 {
-	serv_heap = sharedheap_get(sizeof(struct server));
-	tld_heap = sharedheap_get(sizeof(struct tld));
+	serv_heap = slab_type_create("server", sizeof(struct server));
+	tld_heap = slab_type_create("tld", sizeof(struct tld));
 
 	if (serv_heap == NULL || tld_heap == NULL)
 	{
@@ -98,7 +100,7 @@ server_add(const char *name, unsigned int hops, struct server *uplink, const cha
 	else
 		slog(LG_DEBUG, "server_add(): %s, root", name);
 
-	s = mowgli_heap_alloc(serv_heap);
+	s = slab_alloc(serv_heap);
 
 	if (id != NULL)
 	{
@@ -160,11 +162,15 @@ server_add(const char *name, unsigned int hops, struct server *uplink, const cha
  *
  * Side Effects:
  *     - all users and servers attached to the target are recursively deleted
+ *     - the server_split hook is called once for all of those users
+ *     - channels emptied by the split are destroyed after all users are gone
  */
 void
 server_delete(const char *name)
 {
 	struct server *s = server_find(name);
+	struct user **users;
+	size_t count;
 
 	if (!s)
 	{
@@ -172,7 +178,59 @@ server_delete(const char *name)
 
 		return;
 	}
+
+	if (s == me.me)
+	{
+		server_delete_serv(s);
+		return;
+	}
+
+	count = server_split_count(s);
+	users = (count != 0) ? scalloc(count, sizeof *users) : NULL;
+	(void) server_split_mark(s, users);
+
+	slog(LG_DEBUG, "server_delete(): %s split, %zu users", s->name, count);
+
+	hook_call_server_split((&(struct hook_server_split){ .s = s, .users = users, .count = count }));
+
+	channel_sweep_begin();
 	server_delete_serv(s);
+	channel_sweep_end();
+
+	sfree(users);
+}
+
+static size_t
+server_split_count(const struct server *s)
+{
+	const mowgli_node_t *n;
+	size_t count = MOWGLI_LIST_LENGTH(&s->userlist);
+
+	MOWGLI_ITER_FOREACH(n, s->children.head)
+		count += server_split_count(n->data);
+
+	return count;
+}
+
+/* Collects and marks every user behind s; returns how many were stored. */
+static size_t
+server_split_mark(const struct server *s, struct user **users)
+{
+	const mowgli_node_t *n;
+	size_t count = 0;
+
+	MOWGLI_ITER_FOREACH(n, s->userlist.head)
+	{
+		struct user *u = n->data;
+
+		u->flags |= UF_SPLIT;
+		users[count++] = u;
+	}
+
+	MOWGLI_ITER_FOREACH(n, s->children.head)
+		count += server_split_mark(n->data, users + count);
+
+	return count;
 }
 
 static void
@@ -212,7 +270,7 @@ server_delete_serv(struct server *s)
 		 * XXX should we do this here?
 		 * -- jilles */
 		if (u->myuser != NULL)
-			u->myuser->flags &= ~MU_NOBURSTLOGIN;
+			myuser_set_flags(u->myuser, u->myuser->flags & ~MU_NOBURSTLOGIN);
 		user_delete(u, "*.net *.split");
 	}
 
@@ -246,7 +304,7 @@ server_delete_serv(struct server *s)
 	sfree(s->desc);
 	sfree(s->sid);
 
-	mowgli_heap_free(serv_heap, s);
+	slab_free(serv_heap, s);
 
 	cnt.server--;
 }
@@ -301,7 +359,7 @@ tld_add(const char *name)
 
         slog(LG_DEBUG, "tld_add(): %s", name);
 
-        tld = mowgli_heap_alloc(tld_heap);
+        tld = slab_alloc(tld_heap);
 
         mowgli_node_add(tld, n, &tldlist);
 
@@ -346,7 +404,7 @@ tld_delete(const char *name)
         mowgli_node_free(n);
 
         sfree(tld->name);
-        mowgli_heap_free(tld_heap, tld);
+        slab_free(tld_heap, tld);
 
         cnt.tld--;
 }
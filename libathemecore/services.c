@@ -16,7 +16,7 @@
 #include <atheme.h>
 #include "internal.h"
 
-static mowgli_heap_t *sourceinfo_heap = NULL;
+static struct slab_type *sourceinfo_heap = NULL;
 
 int authservice_loaded = 0;
 int use_myuser_access = 0;
@@ -503,7 +503,7 @@ handle_burstlogin(struct user *u, const char *login, time_t ts)
 	if (mu->flags & MU_PENDINGLOGIN && authservice_loaded)
 	{
 		slog(LG_DEBUG, "handle_burstlogin(): handling pending login hooks for %s", u->nick);
-		mu->flags &= ~MU_PENDINGLOGIN;
+		myuser_set_flags(mu, mu->flags & ~MU_PENDINGLOGIN);
 		hook_call_user_identify(u);
 	}
 }
@@ -762,6 +762,106 @@ myuser_login(struct service *svs, struct user *u, struct myuser *mu, bool sendac
 	hook_call_user_identify(u);
 }
 
+/* Between notice_batch_begin() and notice_batch_end(), notices to users
+ * are collected instead of sent, and users who get the same text from the
+ * same source are sent it together through notice_users_sts(). A user is
+ * only added to a group of recipients created after the last one they were
+ * put in, so everyone still gets their notices in order.
+ */
+struct notice_batch_group
+{
+	mowgli_node_t           node;
+	unsigned int            seq;
+	struct user *           from;
+	struct user **          targets;
+	size_t                  count;
+	size_t                  size;
+	char                    text[];
+};
+
+static unsigned int notice_batch_depth = 0;
+static unsigned int notice_batch_seq = 0;
+static mowgli_list_t notice_batch_groups = { NULL, NULL, 0 };
+static mowgli_patricia_t *notice_batch_texts = NULL;    // source and text -> latest group
+static mowgli_patricia_t *notice_batch_targets = NULL;  // recipient -> latest group
+
+void
+notice_batch_begin(void)
+{
+	if (notice_batch_depth++)
+		return;
+
+	notice_batch_texts = mowgli_patricia_create(noopcanon);
+	notice_batch_targets = mowgli_patricia_create(noopcanon);
+}
+
+static void
+notice_batch_add(struct user *from, struct user *target, const char *text)
+{
+	struct notice_batch_group *g, *last;
+	char key[BUFSIZE + NICKLEN + 2];
+
+	(void) snprintf(key, sizeof key, "%s %s", from != NULL ? CLIENT_NAME(from) : "", text);
+
+	g = mowgli_patricia_retrieve(notice_batch_texts, key);
+	last = mowgli_patricia_retrieve(notice_batch_targets, CLIENT_NAME(target));
+
+	if (g == NULL || (last != NULL && last->seq >= g->seq))
+	{
+		g = smalloc(sizeof *g + strlen(text) + 1);
+		g->seq = notice_batch_seq++;
+		g->from = from;
+		(void) strcpy(g->text, text);
+
+		mowgli_node_add(g, &g->node, &notice_batch_groups);
+
+		(void) mowgli_patricia_delete(notice_batch_texts, key);
+		(void) mowgli_patricia_add(notice_batch_texts, key, g);
+	}
+
+	if (g->count == g->size)
+	{
+		g->size = g->size ? (g->size * 2) : 4;
+		g->targets = sreallocarray(g->targets, g->size, sizeof *g->targets);
+	}
+
+	g->targets[g->count++] = target;
+
+	(void) mowgli_patricia_delete(notice_batch_targets, CLIENT_NAME(target));
+	(void) mowgli_patricia_add(notice_batch_targets, CLIENT_NAME(target), g);
+}
+
+void
+notice_batch_end(void)
+{
+	mowgli_node_t *n, *tn;
+
+	return_if_fail(notice_batch_depth > 0);
+
+	if (--notice_batch_depth)
+		return;
+
+	mowgli_patricia_destroy(notice_batch_texts, NULL, NULL);
+	mowgli_patricia_destroy(notice_batch_targets, NULL, NULL);
+	notice_batch_texts = notice_batch_targets = NULL;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, notice_batch_groups.head)
+	{
+		struct notice_batch_group *g = n->data;
+
+		if (g->count == 1)
+			notice_user_sts(g->from, g->targets[0], g->text);
+		else
+			notice_users_sts(g->from, g->targets, g->count, g->text);
+
+		mowgli_node_delete(&g->node, &notice_batch_groups);
+		sfree(g->targets);
+		sfree(g);
+	}
+
+	notice_batch_seq = 0;
+}
+
 /* this could be done with more finesse, but hey! */
 static void ATHEME_FATTR_PRINTF(3, 4)
 generic_notice(const char *from, const char *to, const char *fmt, ...)
@@ -786,8 +886,16 @@ generic_notice(const char *from, const char *to, const char *fmt, ...)
 		u = user_find_named(to);
 		if (u != NULL)
 		{
-			if (u->myuser != NULL && u->myuser->flags & MU_USE_PRIVMSG)
+			const bool privmsg = u->myuser != NULL && u->myuser->flags & MU_USE_PRIVMSG;
+
+			// don't overtake the command replies the user is still waiting for
+			if (replyq_send_if_waiting(from, u, buf, privmsg))
+				return;
+
+			if (privmsg)
 				msg(from, to, "%s", buf);
+			else if (notice_batch_depth)
+				notice_batch_add(user_find_named(from), u, buf);
 			else
 				notice_user_sts(user_find_named(from), u, buf);
 		}
@@ -905,7 +1013,7 @@ bad_password(struct sourceinfo *si, struct myuser *mu)
 static void
 sourceinfo_delete(struct sourceinfo *si)
 {
-	mowgli_heap_free(sourceinfo_heap, si);
+	slab_free(sourceinfo_heap, si);
 }
 
 struct sourceinfo *
@@ -914,9 +1022,9 @@ sourceinfo_create(void)
 	struct sourceinfo *out;
 
 	if (sourceinfo_heap == NULL)
-		sourceinfo_heap = sharedheap_get(sizeof(struct sourceinfo));
+		sourceinfo_heap = slab_type_create("sourceinfo", sizeof(struct sourceinfo));
 
-	out = mowgli_heap_alloc(sourceinfo_heap);
+	out = slab_alloc(sourceinfo_heap);
 	atheme_object_init(atheme_object(out), "<sourceinfo>", (atheme_object_destructor_fn) sourceinfo_delete);
 
 	return out;
@@ -940,10 +1048,7 @@ command_fail(struct sourceinfo *si, enum cmd_faultcode code, const char *fmt, ..
 	if (si->su == NULL)
 		return;
 
-	if (use_privmsg && si->smu != NULL && si->smu->flags & MU_USE_PRIVMSG)
-		msg(si->service->nick, si->su->nick, "%s", buf);
-	else
-		notice_user_sts(si->service->me, si->su, buf);
+	replyq_send(si->service, si->su, buf, use_privmsg && si->smu != NULL && si->smu->flags & MU_USE_PRIVMSG);
 }
 
 void ATHEME_FATTR_PRINTF(2, 3)
@@ -953,6 +1058,7 @@ command_success_nodata(struct sourceinfo *si, const char *fmt, ...)
 	char buf[BUFSIZE];
 	char *p, *q;
 	char space[] = " ";
+	bool privmsg;
 
 	if (si->output_limit && si->output_count > si->output_limit)
 		return;
@@ -970,9 +1076,12 @@ command_success_nodata(struct sourceinfo *si, const char *fmt, ...)
 	if (si->su == NULL)
 		return;
 
+	privmsg = use_privmsg && si->smu != NULL && si->smu->flags & MU_USE_PRIVMSG;
+
 	if (si->output_limit && si->output_count > si->output_limit)
 	{
-		notice(si->service->nick, si->su->nick, _("Output limit (%u) exceeded, halting output"), si->output_limit);
+		snprintf(buf, sizeof buf, _("Output limit (%u) exceeded, halting output"), si->output_limit);
+		replyq_send(si->service, si->su, buf, privmsg);
 		return;
 	}
 
@@ -988,10 +1097,7 @@ command_success_nodata(struct sourceinfo *si, const char *fmt, ...)
 		}
 		if (*p == '\0')
 			p = space; /* replace empty lines with a space */
-		if (use_privmsg && si->smu != NULL && si->smu->flags & MU_USE_PRIVMSG)
-			msg(si->service->nick, si->su->nick, "%s", p);
-		else
-			notice_user_sts(si->service->me, si->su, p);
+		replyq_send(si->service, si->su, p, privmsg);
 		p = q;
 	} while (p != NULL);
 }
@@ -1014,10 +1120,7 @@ command_success_string(struct sourceinfo *si, const char *result, const char *fm
 	if (si->su == NULL)
 		return;
 
-	if (use_privmsg && si->smu != NULL && si->smu->flags & MU_USE_PRIVMSG)
-		msg(si->service->nick, si->su->nick, "%s", buf);
-	else
-		notice_user_sts(si->service->me, si->su, buf);
+	replyq_send(si->service, si->su, buf, use_privmsg && si->smu != NULL && si->smu->flags & MU_USE_PRIVMSG);
 }
 
 static void
@@ -16,7 +16,7 @@
 #include <atheme.h>
 #include "internal.h"
 
-static mowgli_heap_t *service_heap = NULL;
+static struct slab_type *service_heap = NULL;
 
 mowgli_patricia_t *services_name;
 mowgli_patricia_t *services_nick;
@@ -65,7 +65,7 @@ service_default_handler(struct sourceinfo *si, int parc, char *parv[])
 void
 servtree_init(void)
 {
-	service_heap = sharedheap_get(sizeof(struct service));
+	service_heap = slab_type_create("service", sizeof(struct service));
 	services_name = mowgli_patricia_create(strcasecanon);
 	services_nick = mowgli_patricia_create(strcasecanon);
 
@@ -199,6 +199,17 @@ conf_service_real(mowgli_config_file_entry_t *ce)
 	return 0;
 }
 
+// Forgets a service's dispatch table after its commands or aliases change
+static void
+service_dispatch_reset(struct service *const restrict sptr)
+{
+	if (sptr->dispatch == NULL)
+		return;
+
+	(void) command_dispatch_destroy(sptr->dispatch);
+	sptr->dispatch = NULL;
+}
+
 static int
 conf_service_aliases(mowgli_config_file_entry_t *ce)
 {
@@ -209,6 +220,8 @@ conf_service_aliases(mowgli_config_file_entry_t *ce)
 	if (!sptr)
 		return -1;
 
+	(void) service_dispatch_reset(sptr);
+
 	if (sptr->aliases)
 		mowgli_patricia_destroy(sptr->aliases, free_alias_string, NULL);
 
@@ -291,7 +304,7 @@ service_add(const char *name, void (*handler)(struct sourceinfo *si, int parc, c
 	return_val_if_fail(name != NULL, NULL);
 	return_val_if_fail(service_find(name) == NULL, NULL);
 
-	if (! (sptr = mowgli_heap_alloc(service_heap)))
+	if (! (sptr = slab_alloc(service_heap)))
 		return NULL;
 
 	sptr->internal_name = sstrdup(name);
@@ -352,6 +365,8 @@ service_delete(struct service *sptr)
 	mowgli_patricia_delete(services_name, sptr->internal_name);
 	mowgli_patricia_delete(services_nick, sptr->nick);
 
+	replyq_service_delete(sptr);
+
 	del_conf_item("ACCESS", &sptr->conf_table);
 	del_conf_item("ALIASES", &sptr->conf_table);
 	del_conf_item("REAL", &sptr->conf_table);
@@ -373,6 +388,8 @@ service_delete(struct service *sptr)
 
 	sptr->handler = NULL;
 
+	(void) service_dispatch_reset(sptr);
+
 	if (sptr->access)
 		mowgli_patricia_destroy(sptr->access, &free_access_string, NULL);
 
@@ -389,7 +406,7 @@ service_delete(struct service *sptr)
 	sfree(sptr->host);
 	sfree(sptr->real);
 
-	mowgli_heap_free(service_heap, sptr);
+	slab_free(service_heap, sptr);
 }
 
 struct service *
@@ -560,6 +577,35 @@ service_resolve_alias(struct service *sptr, const char *context, const char *cmd
 	return alias != NULL ? alias : cmd;
 }
 
+/*
+ * service_find_command(struct service *sptr, const char *cmd)
+ *
+ * Finds the command a name runs on a service, resolving the service's
+ * aliases first, as service_resolve_alias() and command_find() would.
+ *
+ * Inputs:
+ *     - the service
+ *     - the name of a command or an alias
+ *
+ * Outputs:
+ *     - the command, or NULL if there is none
+ *
+ * Side Effects:
+ *     - the service's dispatch table is built if it has changed since
+ *       the last lookup
+ */
+struct command *
+service_find_command(struct service *const restrict sptr, const char *const restrict cmd)
+{
+	return_val_if_fail(sptr != NULL, NULL);
+	return_val_if_fail(cmd != NULL, NULL);
+
+	if (sptr->dispatch == NULL)
+		sptr->dispatch = command_dispatch_create(sptr->commands, sptr->aliases);
+
+	return command_dispatch_find(sptr->dispatch, cmd);
+}
+
 const char *
 service_set_access(struct service *sptr, const char *cmd, const char *oldaccess)
 {
@@ -578,6 +624,8 @@ service_bind_command(struct service *sptr, struct command *cmd)
 	return_if_fail(sptr != NULL);
 	return_if_fail(cmd != NULL);
 
+	(void) service_dispatch_reset(sptr);
+
 	command_add(cmd, sptr->commands);
 }
 
@@ -587,6 +635,8 @@ service_unbind_command(struct service *sptr, struct command *cmd)
 	return_if_fail(sptr != NULL);
 	return_if_fail(cmd != NULL);
 
+	(void) service_dispatch_reset(sptr);
+
 	command_delete(cmd, sptr->commands);
 }
 
@@ -0,0 +1,494 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * slab.c: Size-class slab allocator.
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#if defined(ATHEME_ENABLE_LARGE_NET) && !defined(MOWGLI_OS_WIN)
+#  include <sys/mman.h>
+#endif
+
+/* Memory is reserved from the system in arenas, which are cut into
+ * aligned slabs. A slab belongs to one size class at a time and starts
+ * with a header, so the slab (and size class) of any object is found by
+ * masking its address. Empty slabs go back to a common spare list and can
+ * be reused by any class; arenas are never returned to the system.
+ *
+ * All allocation state lives in struct slab_class, so a per-thread cache
+ * of free objects could later be put in front of slab_class_alloc()
+ * without changing the callers.
+ *
+ * With --disable-heap-allocator, objects come from smalloc() instead, but
+ * they are still counted against their type.
+ */
+#define SLAB_SIZE               (64U * 1024U)
+#define SLAB_ARENA_SIZE         (2U * 1024U * 1024U)
+#define SLAB_ARENA_SLABS        (SLAB_ARENA_SIZE / SLAB_SIZE)
+#define SLAB_MAX_SIZE           4096U
+#define SLAB_GRANULE            16U
+
+struct slab_class
+{
+	mowgli_list_t           partial;        // slabs with free objects
+	size_t                  size;
+	unsigned int            per_slab;
+	size_t                  slabs;
+	size_t                  inuse;
+};
+
+struct slab
+{
+	mowgli_node_t           node;
+	struct slab_class *     class;
+	void *                  freelist;
+	unsigned int            inuse;
+	unsigned int            carved;         // objects handed out from the end of the slab so far
+};
+
+struct slab_type
+{
+	char *                  name;
+	size_t                  size;
+	struct slab_class *     class;
+	size_t                  live;
+	size_t                  peak;
+	size_t                  bytes;
+	size_t                  peak_bytes;
+	uint64_t                allocs;
+};
+
+#define SLAB_HEADER_SIZE        (((sizeof(struct slab) + SLAB_GRANULE - 1U) / SLAB_GRANULE) * SLAB_GRANULE)
+
+static const unsigned short slab_class_sizes[] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256, 320, 384, 448, 512,
+	640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+	2560, 3072, 3584, 4096,
+};
+
+#define SLAB_CLASSES            (ARRAY_SIZE(slab_class_sizes))
+
+static struct slab_class slab_classes[SLAB_CLASSES];
+static unsigned char slab_class_index[(SLAB_MAX_SIZE / SLAB_GRANULE) + 1U];
+static mowgli_patricia_t *slab_types = NULL;
+
+static void *slab_spare = NULL;                 // unused slabs, linked through their first word
+static size_t slab_spare_count = 0;
+static size_t slab_arena_count = 0;
+static size_t slab_large_bytes = 0;
+
+static void
+slab_init(void)
+{
+	unsigned int c = 0;
+
+	for (unsigned int i = 0; i < SLAB_CLASSES; i++)
+	{
+		slab_classes[i].size = slab_class_sizes[i];
+		slab_classes[i].per_slab = (SLAB_SIZE - SLAB_HEADER_SIZE) / slab_class_sizes[i];
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(slab_class_index); i++)
+	{
+		while (slab_class_sizes[c] < (i * SLAB_GRANULE))
+			c++;
+
+		slab_class_index[i] = (unsigned char) c;
+	}
+
+	slab_types = mowgli_patricia_create(noopcanon);
+}
+
+static inline struct slab_class *
+slab_class_for(const size_t size)
+{
+	if (size > SLAB_MAX_SIZE)
+		return NULL;
+
+	return &slab_classes[slab_class_index[(size + SLAB_GRANULE - 1U) / SLAB_GRANULE]];
+}
+
+static void
+slab_arena_new(void)
+{
+#if defined(ATHEME_ENABLE_LARGE_NET) && defined(MADV_HUGEPAGE)
+	// Aligned to the arena size so that the kernel can back it with a huge page
+	unsigned char *const arena = smemalign(SLAB_ARENA_SIZE, SLAB_ARENA_SIZE);
+
+	(void) madvise(arena, SLAB_ARENA_SIZE, MADV_HUGEPAGE);
+#else
+	unsigned char *const arena = smemalign(SLAB_SIZE, SLAB_ARENA_SIZE);
+#endif
+
+	for (unsigned int i = 0; i < SLAB_ARENA_SLABS; i++)
+	{
+		void *const slab = arena + (i * SLAB_SIZE);
+
+		*(void **) slab = slab_spare;
+		slab_spare = slab;
+	}
+
+	slab_spare_count += SLAB_ARENA_SLABS;
+	slab_arena_count++;
+}
+
+static struct slab *
+slab_new(struct slab_class *const restrict c)
+{
+	if (! slab_spare)
+		(void) slab_arena_new();
+
+	struct slab *const s = slab_spare;
+
+	slab_spare = *(void **) slab_spare;
+	slab_spare_count--;
+
+	(void) memset(s, 0x00, sizeof *s);
+	s->class = c;
+
+	(void) mowgli_node_add_head(s, &s->node, &c->partial);
+	c->slabs++;
+
+	return s;
+}
+
+static void *
+slab_class_alloc(struct slab_class *const restrict c)
+{
+	struct slab *const s = c->partial.head ? c->partial.head->data : slab_new(c);
+	void *obj;
+
+	if (s->freelist)
+	{
+		obj = s->freelist;
+		s->freelist = *(void **) obj;
+	}
+	else
+		obj = ((unsigned char *) s) + SLAB_HEADER_SIZE + (s->carved++ * c->size);
+
+	c->inuse++;
+
+	// A full slab leaves the partial list until something in it is freed
+	if (++s->inuse == c->per_slab)
+		(void) mowgli_node_delete(&s->node, &c->partial);
+
+	return obj;
+}
+
+static void
+slab_class_free(struct slab_class *const restrict c, void *const restrict obj)
+{
+	struct slab *const s = (struct slab *) (((uintptr_t) obj) & ~((uintptr_t) (SLAB_SIZE - 1U)));
+
+	return_if_fail(s->class == c);
+
+	if (s->inuse == c->per_slab)
+		(void) mowgli_node_add_head(s, &s->node, &c->partial);
+
+	*(void **) obj = s->freelist;
+	s->freelist = obj;
+	c->inuse--;
+
+	// Keep the last partial slab of a class around, so that it does not bounce
+	if (--s->inuse == 0 && MOWGLI_LIST_LENGTH(&c->partial) > 1)
+	{
+		(void) mowgli_node_delete(&s->node, &c->partial);
+		c->slabs--;
+
+		*(void **) s = slab_spare;
+		slab_spare = s;
+		slab_spare_count++;
+	}
+}
+
+static inline void
+slab_type_count(struct slab_type *const restrict type, const size_t bytes)
+{
+	type->live++;
+	type->allocs++;
+	type->bytes += bytes;
+
+	if (type->live > type->peak)
+		type->peak = type->live;
+
+	if (type->bytes > type->peak_bytes)
+		type->peak_bytes = type->bytes;
+}
+
+static inline void
+slab_type_uncount(struct slab_type *const restrict type, const size_t bytes)
+{
+	type->live--;
+	type->bytes -= bytes;
+}
+
+/*
+ * slab_type_create(const char *name, size_t size)
+ *
+ * Registers a type of object to be allocated with slab_alloc(), or, if
+ * size is 0, of objects and strings of any length to be allocated with
+ * slab_alloc_bytes() and slab_strdup(). Registering a
+ * name again with the same size returns the existing type, so modules can
+ * do this on every load.
+ *
+ * Inputs:
+ *      - name the type is reported under
+ *      - size of each object, or 0 if it varies
+ *
+ * Outputs:
+ *      - the type, or NULL if the name is already used with another size
+ *
+ * Side Effects:
+ *      - the type is added to the statistics
+ */
+struct slab_type *
+slab_type_create(const char *const restrict name, const size_t size)
+{
+	struct slab_type *type;
+
+	return_val_if_fail(name != NULL, NULL);
+
+	if (! slab_types)
+		(void) slab_init();
+
+	if ((type = mowgli_patricia_retrieve(slab_types, name)) != NULL)
+	{
+		if (type->size == size)
+			return type;
+
+		(void) slog(LG_ERROR, "%s: type '%s' already exists with size %zu (not %zu)",
+		            MOWGLI_FUNC_NAME, name, type->size, size);
+		return NULL;
+	}
+
+	type = smalloc(sizeof *type);
+	type->name = sstrdup(name);
+	type->size = size;
+
+#ifdef ATHEME_ENABLE_HEAP_ALLOCATOR
+	if (size)
+		type->class = slab_class_for(size);
+#endif
+
+	(void) mowgli_patricia_add(slab_types, type->name, type);
+
+	return type;
+}
+
+/*
+ * slab_alloc(struct slab_type *type)
+ *
+ * Allocates a zeroed object of the given type.
+ *
+ * Inputs:
+ *      - type of object
+ *
+ * Outputs:
+ *      - the object
+ *
+ * Side Effects:
+ *      - a new arena is reserved if no slab has room for the object
+ */
+void *
+slab_alloc(struct slab_type *const restrict type)
+{
+	void *obj;
+
+	return_val_if_fail(type != NULL, NULL);
+	return_val_if_fail(type->size != 0, NULL);
+
+	if (type->class)
+	{
+		obj = slab_class_alloc(type->class);
+		(void) memset(obj, 0x00, type->size);
+		(void) slab_type_count(type, type->class->size);
+	}
+	else
+	{
+		obj = smalloc(type->size);
+		slab_large_bytes += type->size;
+		(void) slab_type_count(type, type->size);
+	}
+
+	return obj;
+}
+
+void
+slab_free(struct slab_type *const restrict type, void *const restrict obj)
+{
+	return_if_fail(type != NULL);
+
+	if (! obj)
+		return;
+
+	if (type->class)
+	{
+		(void) slab_class_free(type->class, obj);
+		(void) slab_type_uncount(type, type->class->size);
+	}
+	else
+	{
+		(void) sfree(obj);
+		slab_large_bytes -= type->size;
+		(void) slab_type_uncount(type, type->size);
+	}
+}
+
+/*
+ * slab_alloc_bytes(struct slab_type *type, size_t len)
+ *
+ * Allocates len bytes from the size class that fits them, for types whose
+ * objects vary in size. More than the largest size class is allocated
+ * with smalloc().
+ *
+ * Inputs:
+ *      - type created with a size of 0
+ *      - number of bytes
+ *
+ * Outputs:
+ *      - the memory, not zeroed, to be released with slab_free_bytes()
+ *        and the same length
+ *
+ * Side Effects:
+ *      - a new arena is reserved if no slab has room for it
+ */
+void *
+slab_alloc_bytes(struct slab_type *const restrict type, const size_t len)
+{
+	return_val_if_fail(type != NULL, NULL);
+	return_val_if_fail(type->size == 0, NULL);
+	return_val_if_fail(len != 0, NULL);
+
+#ifdef ATHEME_ENABLE_HEAP_ALLOCATOR
+	struct slab_class *const c = slab_class_for(len);
+
+	if (c)
+	{
+		(void) slab_type_count(type, c->size);
+		return slab_class_alloc(c);
+	}
+#endif
+
+	slab_large_bytes += len;
+	(void) slab_type_count(type, len);
+
+	return smalloc(len);
+}
+
+void
+slab_free_bytes(struct slab_type *const restrict type, void *const restrict ptr, const size_t len)
+{
+	return_if_fail(type != NULL);
+	return_if_fail(type->size == 0);
+
+	if (! ptr)
+		return;
+
+#ifdef ATHEME_ENABLE_HEAP_ALLOCATOR
+	struct slab_class *const c = slab_class_for(len);
+
+	if (c)
+	{
+		(void) slab_class_free(c, ptr);
+		(void) slab_type_uncount(type, c->size);
+		return;
+	}
+#endif
+
+	(void) sfree(ptr);
+	slab_large_bytes -= len;
+	(void) slab_type_uncount(type, len);
+}
+
+char *
+slab_strdup(struct slab_type *const restrict type, const char *const restrict str)
+{
+	if (! str)
+		return NULL;
+
+	const size_t len = strlen(str) + 1;
+
+	return memcpy(slab_alloc_bytes(type, len), str, len);
+}
+
+void
+slab_strfree(struct slab_type *const restrict type, char *const restrict str)
+{
+	if (! str)
+		return;
+
+	(void) slab_free_bytes(type, str, strlen(str) + 1);
+}
+
+void
+slab_get_stats(struct slab_stats *const restrict stats)
+{
+	return_if_fail(stats != NULL);
+
+	(void) memset(stats, 0x00, sizeof *stats);
+
+	for (unsigned int i = 0; i < SLAB_CLASSES; i++)
+	{
+		stats->slabs += slab_classes[i].slabs;
+		stats->used_bytes += slab_classes[i].inuse * slab_classes[i].size;
+	}
+
+	stats->arenas = slab_arena_count;
+	stats->spare_slabs = slab_spare_count;
+	stats->reserved_bytes = slab_arena_count * SLAB_ARENA_SIZE;
+	stats->large_bytes = slab_large_bytes;
+}
+
+/*
+ * slab_foreach_type(slab_type_stats_fn fn, void *priv)
+ *
+ * Reports the statistics of every type, in order of name.
+ *
+ * Inputs:
+ *      - function to call for each type
+ *      - opaque pointer passed to it
+ *
+ * Outputs:
+ *      - none
+ *
+ * Side Effects:
+ *      - fn is called once per type
+ */
+void
+slab_foreach_type(const slab_type_stats_fn fn, void *const restrict priv)
+{
+	mowgli_patricia_iteration_state_t state;
+	struct slab_type *type;
+
+	return_if_fail(fn != NULL);
+
+	if (! slab_types)
+		return;
+
+	MOWGLI_PATRICIA_FOREACH(type, &state, slab_types)
+	{
+		const struct slab_type_stats stats = {
+			.name           = type->name,
+			.size           = type->size,
+			.class_size     = type->class ? type->class->size : 0,
+			.live           = type->live,
+			.peak           = type->peak,
+			.bytes          = type->bytes,
+			.peak_bytes     = type->peak_bytes,
+			.allocs         = type->allocs,
+		};
+
+		(void) fn(&stats, priv);
+	}
+}
@@ -0,0 +1,472 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * stall.c: Event loop stall detection.
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+#ifdef HAVE_USABLE_PTHREAD
+#  define STALL_HAVE_WATCHDOG 1
+#  include <pthread.h>
+#endif
+
+#if defined(STALL_HAVE_WATCHDOG) && defined(HAVE_USABLE_BACKTRACE) && defined(HAVE_EXECINFO_H)
+#  define STALL_HAVE_BACKTRACE 1
+#  include <execinfo.h>
+#endif
+
+/* stall_signal_handler() interrupts the main thread, so the compiler only
+ * has to be kept from moving the stores to a context past the store to
+ * stall_depth that makes it visible to the handler.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#  include <stdatomic.h>
+#  define STALL_SIGNAL_FENCE()  atomic_signal_fence(memory_order_release)
+#elif defined(__ATOMIC_RELEASE)
+#  define STALL_SIGNAL_FENCE()  __atomic_signal_fence(__ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+#  define STALL_SIGNAL_FENCE()  __asm__ __volatile__ ("" : : : "memory")
+#else
+#  define STALL_SIGNAL_FENCE()  do { } while (0)
+#endif
+
+/* When general::stall_threshold is set, a watchdog thread watches the
+ * iteration counter of io_loop(). If one iteration takes longer than the
+ * threshold, it sends SIGURG to the main thread, whose handler notes what
+ * the main thread is in the middle of and where. That is turned into a
+ * record and logged once the main loop gets going again. The watchdog
+ * shares nothing with the main thread but the counter and the threshold.
+ */
+
+// Stalls since startup
+unsigned int stall_count = 0;
+
+// What the main thread is doing; only kept up while the watchdog is watching
+static struct stall_context stall_stack[STALL_CONTEXT_MAX];
+static volatile sig_atomic_t stall_depth = 0;
+static bool stall_tracking = false;
+
+static struct stall_record stall_records[STALL_RECORDS_MAX];
+static unsigned int stall_records_next = 0;
+static unsigned int stall_records_used = 0;
+
+#ifdef STALL_HAVE_WATCHDOG
+
+static pthread_t stall_main_thread;
+static bool stall_started = false;
+static bool stall_running = false;
+static uint64_t stall_iteration_begin = 0;
+
+/* Shared with the watchdog thread, under stall_lock. They are only ever
+ * written by the main thread, which can read them without the lock.
+ */
+static pthread_mutex_t stall_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long stall_iteration = 0;
+static unsigned int stall_threshold = 0;
+
+// Filled in by stall_signal_handler(), which runs on the main thread
+static struct
+{
+	volatile sig_atomic_t           taken;
+	unsigned int                    depth;
+	struct stall_context            context[STALL_CONTEXT_MAX];
+	int                             frames;
+	void *                          addrs[STALL_FRAMES_MAX];
+} stall_capture;
+
+#else /* STALL_HAVE_WATCHDOG */
+
+static bool stall_warned = false;
+
+#endif /* !STALL_HAVE_WATCHDOG */
+
+/*
+ * stall_context_push(const char *kind, const char *name, const char *detail)
+ *
+ * Notes that the main thread is about to run something, so that it can be
+ * named if the main loop stalls while it runs. Every call must be paired
+ * with a call to stall_context_pop() once it has finished.
+ *
+ * Inputs:
+ *     - what kind of thing it is ("hook", "pcommand", "command" or
+ *       "timer"), which must be a string constant
+ *     - its name
+ *     - something that qualifies the name, e.g. the module of a hook
+ *       handler, or NULL
+ *
+ * Outputs:
+ *     - none
+ *
+ * Side Effects:
+ *     - the names are copied onto the context stack if stall detection is
+ *       on
+ */
+void
+stall_context_push(const char *const restrict kind, const char *const restrict name,
+                   const char *const restrict detail)
+{
+	if (! stall_tracking)
+		return;
+
+	const unsigned int depth = (unsigned int) stall_depth;
+
+	// Only the outermost contexts are kept, but every push is counted to match the pops
+	if (depth < STALL_CONTEXT_MAX)
+	{
+		struct stall_context *const ctx = &stall_stack[depth];
+
+		ctx->kind = kind;
+
+		(void) mowgli_strlcpy(ctx->name, name ? name : "", sizeof ctx->name);
+		(void) mowgli_strlcpy(ctx->detail, detail ? detail : "", sizeof ctx->detail);
+	}
+
+	STALL_SIGNAL_FENCE();
+
+	stall_depth = (sig_atomic_t) (depth + 1U);
+}
+
+void
+stall_context_pop(void)
+{
+	// Tracking only starts or stops between iterations, when nothing is pushed
+	if (stall_depth > 0)
+		stall_depth--;
+}
+
+const char *
+stall_record_describe(const struct stall_record *const restrict rec, char *const restrict buf, const size_t len)
+{
+	return_val_if_fail(rec != NULL, NULL);
+	return_val_if_fail(buf != NULL, NULL);
+	return_val_if_fail(len != 0, NULL);
+
+	*buf = '\0';
+
+	if (! rec->depth)
+	{
+		(void) mowgli_strlcpy(buf, "a timer or I/O handler", len);
+		return buf;
+	}
+
+	// Innermost first
+	for (unsigned int i = rec->depth; i != 0; i--)
+	{
+		const struct stall_context *const ctx = &rec->context[i - 1U];
+		char part[BUFSIZE];
+
+		if (*ctx->detail)
+			(void) snprintf(part, sizeof part, "%s %s (%s)", ctx->kind, ctx->name, ctx->detail);
+		else
+			(void) snprintf(part, sizeof part, "%s %s", ctx->kind, ctx->name);
+
+		if (i != rec->depth)
+			(void) mowgli_strlcat(buf, " < ", len);
+
+		(void) mowgli_strlcat(buf, part, len);
+	}
+
+	return buf;
+}
+
+/*
+ * stall_record_get(unsigned int num)
+ *
+ * Finds a recent stall.
+ *
+ * Inputs:
+ *     - which stall is wanted, 0 for the most recent one
+ *
+ * Outputs:
+ *     - the record of the stall, or NULL if there are not that many
+ *
+ * Side Effects:
+ *     - none
+ */
+const struct stall_record *
+stall_record_get(const unsigned int num)
+{
+	if (num >= stall_records_used)
+		return NULL;
+
+	return &stall_records[(stall_records_next + STALL_RECORDS_MAX - 1U - num) % STALL_RECORDS_MAX];
+}
+
+void
+stall_clear(void)
+{
+	for (unsigned int i = 0; i < STALL_RECORDS_MAX; i++)
+	{
+		// Allocated by backtrace_symbols(3)
+		if (stall_records[i].symbols)
+			(void) free(stall_records[i].symbols);
+
+		(void) memset(&stall_records[i], 0x00, sizeof stall_records[i]);
+	}
+
+	stall_records_next = 0;
+	stall_records_used = 0;
+}
+
+#ifdef STALL_HAVE_WATCHDOG
+
+static void
+stall_signal_handler(const int ATHEME_VATTR_UNUSED signum)
+{
+	if (stall_capture.taken)
+		return;
+
+	unsigned int depth = (unsigned int) stall_depth;
+
+	if (depth > STALL_CONTEXT_MAX)
+		depth = STALL_CONTEXT_MAX;
+
+	stall_capture.depth = depth;
+
+	(void) memcpy(stall_capture.context, stall_stack, depth * sizeof *stall_stack);
+
+#ifdef STALL_HAVE_BACKTRACE
+	stall_capture.frames = backtrace(stall_capture.addrs, (int) STALL_FRAMES_MAX);
+#else
+	stall_capture.frames = 0;
+#endif
+
+	stall_capture.taken = 1;
+}
+
+// How often the watchdog looks at the counter, in milliseconds
+static inline unsigned int
+stall_interval(const unsigned int threshold)
+{
+	if (! threshold || (threshold / 4U) > 1000U)
+		return 1000U;
+
+	if ((threshold / 4U) < 10U)
+		return 10U;
+
+	return threshold / 4U;
+}
+
+static void *
+stall_watchdog(void ATHEME_VATTR_UNUSED *const restrict unused)
+{
+	unsigned long seen = 0;
+	uint64_t since = latency_clock();
+	bool fired = false;
+
+	for (;;)
+	{
+		(void) pthread_mutex_lock(&stall_lock);
+		const unsigned int threshold = stall_threshold;
+		(void) pthread_mutex_unlock(&stall_lock);
+
+		const unsigned int interval = stall_interval(threshold);
+		const struct timespec ts = {
+			.tv_sec         = (time_t) (interval / 1000U),
+			.tv_nsec        = (long) (interval % 1000U) * 1000000L,
+		};
+
+		(void) nanosleep(&ts, NULL);
+
+		(void) pthread_mutex_lock(&stall_lock);
+		const unsigned long iteration = stall_iteration;
+		(void) pthread_mutex_unlock(&stall_lock);
+
+		const uint64_t now = latency_clock();
+
+		if (iteration != seen || ! threshold)
+		{
+			seen = iteration;
+			since = now;
+			fired = false;
+			continue;
+		}
+
+		// Once per iteration is enough; the record gets the full duration when it ends
+		if (fired || (now - since) < (threshold * UINT64_C(1000000)))
+			continue;
+
+		fired = true;
+
+		(void) pthread_kill(stall_main_thread, SIGURG);
+	}
+
+	return NULL;
+}
+
+static bool
+stall_watchdog_start(void)
+{
+	pthread_t thread;
+	sigset_t all, old;
+	int ret;
+
+#ifdef STALL_HAVE_BACKTRACE
+	// The first call can load libgcc, which must not happen in the signal handler
+	void *addr;
+
+	(void) backtrace(&addr, 1);
+#endif
+
+	stall_main_thread = pthread_self();
+
+	(void) mowgli_signal_install_handler(SIGURG, &stall_signal_handler);
+
+	// Every other signal is still meant for the main thread
+	(void) sigfillset(&all);
+	(void) pthread_sigmask(SIG_SETMASK, &all, &old);
+
+	ret = pthread_create(&thread, NULL, &stall_watchdog, NULL);
+
+	(void) pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (ret != 0)
+	{
+		(void) slog(LG_ERROR, "%s: pthread_create(): %s; stall detection is disabled", MOWGLI_FUNC_NAME,
+		            strerror(ret));
+		return false;
+	}
+
+	(void) pthread_detach(thread);
+	(void) slog(LG_DEBUG, "%s: watchdog thread started", MOWGLI_FUNC_NAME);
+
+	return true;
+}
+
+static void
+stall_capture_save(const uint64_t nsec)
+{
+	struct stall_record *const rec = &stall_records[stall_records_next];
+	char where[BUFSIZE];
+
+	if (rec->symbols)
+		(void) free(rec->symbols);
+
+	(void) memset(rec, 0x00, sizeof *rec);
+
+	rec->when = CURRTIME;
+	rec->nsec = nsec;
+	rec->depth = stall_capture.depth;
+
+	(void) memcpy(rec->context, stall_capture.context, rec->depth * sizeof *rec->context);
+
+#ifdef STALL_HAVE_BACKTRACE
+	if (stall_capture.frames > 0 && (rec->symbols = backtrace_symbols(stall_capture.addrs,
+	                                                                  stall_capture.frames)) != NULL)
+		rec->frames = (unsigned int) stall_capture.frames;
+#endif
+
+	stall_capture.taken = 0;
+
+	stall_records_next = (stall_records_next + 1U) % STALL_RECORDS_MAX;
+
+	if (stall_records_used < STALL_RECORDS_MAX)
+		stall_records_used++;
+
+	stall_count++;
+
+	(void) slog(LG_ERROR, "stall: the main loop was blocked for %.3fs in %s", nsec / 1e9,
+	            stall_record_describe(rec, where, sizeof where));
+
+	for (unsigned int i = 0; i < rec->frames; i++)
+		(void) slog(LG_INFO, "stall:     #%u %s", i, rec->symbols[i]);
+}
+
+#endif /* STALL_HAVE_WATCHDOG */
+
+/*
+ * stall_loop_tick(void)
+ *
+ * Called by io_loop() at the start of each iteration. Starts the watchdog
+ * the first time general::stall_threshold is set, and saves the record of
+ * the last iteration if it stalled.
+ *
+ * Inputs:
+ *     - none
+ *
+ * Outputs:
+ *     - the longest time in milliseconds that the iteration may wait for
+ *       something to happen, or 0 for no limit; waiting is not stalling,
+ *       so it has to be kept well under the threshold
+ *
+ * Side Effects:
+ *     - the watchdog thread may be started
+ *     - a stall may be logged
+ */
+unsigned int
+stall_loop_tick(void)
+{
+	const unsigned int threshold = config_options.stall_threshold;
+
+#ifdef STALL_HAVE_WATCHDOG
+	if (threshold && ! stall_started)
+	{
+		stall_started = true;
+		stall_threshold = threshold;
+		stall_running = stall_watchdog_start();
+	}
+
+	if (! stall_running)
+		return 0;
+
+	const uint64_t now = latency_clock();
+
+	if (stall_capture.taken)
+		(void) stall_capture_save(now - stall_iteration_begin);
+
+	stall_iteration_begin = now;
+	stall_tracking = (threshold != 0);
+
+	(void) pthread_mutex_lock(&stall_lock);
+	stall_iteration++;
+	stall_threshold = threshold;
+	(void) pthread_mutex_unlock(&stall_lock);
+
+	if (! threshold)
+		return 0;
+
+	return (threshold > 1U) ? (threshold / 2U) : 1U;
+#else
+	if (threshold && ! stall_warned)
+	{
+		(void) slog(LG_ERROR, "%s: stall detection is not supported on this platform", MOWGLI_FUNC_NAME);
+
+		stall_warned = true;
+	}
+
+	return 0;
+#endif
+}
+
+// Shutting down can legitimately take a while
+void
+stall_loop_stop(void)
+{
+#ifdef STALL_HAVE_WATCHDOG
+	(void) pthread_mutex_lock(&stall_lock);
+	stall_threshold = 0;
+	(void) pthread_mutex_unlock(&stall_lock);
+#endif
+
+	stall_tracking = false;
+}
+
+bool
+stall_watchdog_running(void)
+{
+#ifdef STALL_HAVE_WATCHDOG
+	return stall_running && stall_threshold != 0;
+#else
+	return false;
+#endif
+}
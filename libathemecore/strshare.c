@@ -16,17 +16,97 @@
 #include <atheme.h>
 #include "internal.h"
 
-static mowgli_patricia_t *strshare_dict = NULL;
+/* Shared strings live in an open-addressing hash table with linear
+ * probing. The hashes are kept in their own array next to the entries,
+ * so a probe walks a few contiguous 32-bit words and only looks at a
+ * string when its full hash matches. Deletion shifts later entries of the
+ * probe run back instead of leaving tombstones. The hash is seeded at
+ * startup so that nicknames cannot be chosen to collide.
+ */
+#define STRSHARE_MIN_SIZE       1024U
 
 struct strshare
 {
-	int refcount;
+	uint32_t        hash;
+	int             refcount;
 };
 
+static uint32_t *strshare_hashes = NULL;
+static struct strshare **strshare_entries = NULL;
+static size_t strshare_size = 0;
+static size_t strshare_count = 0;
+static uint64_t strshare_seed = 0;
+
+static inline uint64_t
+strshare_mix(uint64_t h)
+{
+	h ^= (h >> 33);
+	h *= UINT64_C(0xFF51AFD7ED558CCD);
+	h ^= (h >> 33);
+	h *= UINT64_C(0xC4CEB9FE1A85EC53);
+	h ^= (h >> 33);
+
+	return h;
+}
+
+static uint32_t
+strshare_hash(const char *str, size_t len)
+{
+	uint64_t h = strshare_seed ^ (len * UINT64_C(0x9E3779B97F4A7C15));
+	uint64_t w;
+
+	for (; len >= sizeof w; str += sizeof w, len -= sizeof w)
+	{
+		(void) memcpy(&w, str, sizeof w);
+		h = (h ^ w) * UINT64_C(0x9E3779B97F4A7C15);
+		h ^= (h >> 29);
+	}
+
+	w = 0;
+	(void) memcpy(&w, str, len);
+	h = strshare_mix(h ^ w);
+
+	return (uint32_t) (h ^ (h >> 32));
+}
+
+static void
+strshare_resize(size_t size)
+{
+	uint32_t *const hashes = smalloc(size * sizeof *hashes);
+	struct strshare **const entries = smalloc(size * sizeof *entries);
+	const size_t mask = size - 1;
+
+	for (size_t i = 0; i < strshare_size; i++)
+	{
+		if (strshare_entries[i] == NULL)
+			continue;
+
+		size_t j = strshare_hashes[i] & mask;
+
+		while (entries[j] != NULL)
+			j = (j + 1) & mask;
+
+		hashes[j] = strshare_hashes[i];
+		entries[j] = strshare_entries[i];
+	}
+
+	(void) sfree(strshare_hashes);
+	(void) sfree(strshare_entries);
+
+	strshare_hashes = hashes;
+	strshare_entries = entries;
+	strshare_size = size;
+}
+
 void
 strshare_init(void)
 {
-	strshare_dict = mowgli_patricia_create(noopcanon);
+	if (strshare_entries != NULL)
+		return;
+
+	atheme_random_buf(&strshare_seed, sizeof strshare_seed);
+
+	strshare_resize(STRSHARE_MIN_SIZE);
 }
 
 stringref
@@ -37,17 +117,37 @@ strshare_get(const char *str)
 	if (str == NULL)
 		return NULL;
 
-	ss = mowgli_patricia_retrieve(strshare_dict, str);
-	if (ss != NULL)
-		ss->refcount++;
-	else
+	const size_t len = strlen(str);
+	const uint32_t hash = strshare_hash(str, len);
+	const size_t mask = strshare_size - 1;
+	size_t i = hash & mask;
+
+	for (; strshare_entries[i] != NULL; i = (i + 1) & mask)
 	{
-		ss = smalloc((sizeof *ss) + strlen(str) + 1);
-		ss->refcount = 1;
-		strcpy((char *)(ss + 1), str);
-		mowgli_patricia_add(strshare_dict, (char *)(ss + 1), ss);
+		if (strshare_hashes[i] != hash)
+			continue;
+
+		ss = strshare_entries[i];
+
+		if (strcmp((const char *)(ss + 1), str) == 0)
+		{
+			ss->refcount++;
+			return (char *)(ss + 1);
+		}
 	}
 
+	ss = smalloc((sizeof *ss) + len + 1);
+	ss->hash = hash;
+	ss->refcount = 1;
+	(void) memcpy(ss + 1, str, len + 1);
+
+	strshare_hashes[i] = hash;
+	strshare_entries[i] = ss;
+
+	// keep the load factor at or below 3/4
+	if (++strshare_count > ((strshare_size / 4) * 3))
+		strshare_resize(strshare_size * 2);
+
 	return (char *)(ss + 1);
 }
 
@@ -66,6 +166,34 @@ strshare_ref(stringref str)
 	return str;
 }
 
+static void
+strshare_remove(const struct strshare *const ss)
+{
+	const size_t mask = strshare_size - 1;
+	size_t i = ss->hash & mask;
+
+	while (strshare_entries[i] != ss)
+		i = (i + 1) & mask;
+
+	// move back any entry of the run that would become unreachable
+	for (size_t j = (i + 1) & mask; strshare_entries[j] != NULL; j = (j + 1) & mask)
+	{
+		const size_t home = strshare_hashes[j] & mask;
+
+		if (((j - home) & mask) >= ((j - i) & mask))
+		{
+			strshare_hashes[i] = strshare_hashes[j];
+			strshare_entries[i] = strshare_entries[j];
+			i = j;
+		}
+	}
+
+	strshare_entries[i] = NULL;
+
+	if (--strshare_count < (strshare_size / 8) && strshare_size > STRSHARE_MIN_SIZE)
+		strshare_resize(strshare_size / 2);
+}
+
 void
 strshare_unref(stringref str)
 {
@@ -79,11 +207,70 @@ strshare_unref(stringref str)
 	ss->refcount--;
 	if (ss->refcount == 0)
 	{
-		mowgli_patricia_delete(strshare_dict, str);
+		strshare_remove(ss);
 		sfree(ss);
 	}
 }
 
+/*
+ * strshare_is_shared(stringref str)
+ *
+ * Tells whether a shared string has more than one reference.
+ *
+ * Inputs:
+ *      - string obtained from strshare_get() or strshare_ref()
+ *
+ * Outputs:
+ *      - true if something else holds a reference to the same string
+ *
+ * Side Effects:
+ *      - none
+ */
+bool
+strshare_is_shared(stringref str)
+{
+	const struct strshare *ss;
+
+	if (str == NULL)
+		return false;
+
+	/* intermediate cast to suppress gcc -Wcast-qual */
+	ss = (const struct strshare *)(uintptr_t)str - 1;
+
+	return ss->refcount > 1;
+}
+
+/*
+ * strshare_share_bytes(stringref str)
+ *
+ * Tells how much memory one reference to a shared string accounts for.
+ *
+ * Inputs:
+ *      - string obtained from strshare_get() or strshare_ref()
+ *
+ * Outputs:
+ *      - the bytes allocated for the string, divided among its references
+ *
+ * Side Effects:
+ *      - none
+ */
+size_t
+strshare_share_bytes(stringref str)
+{
+	const struct strshare *ss;
+
+	if (str == NULL)
+		return 0;
+
+	/* intermediate cast to suppress gcc -Wcast-qual */
+	ss = (const struct strshare *)(uintptr_t)str - 1;
+
+	const size_t bytes = (sizeof *ss) + strlen(str) + 1;
+	const size_t refs = (size_t) ss->refcount;
+
+	return (bytes + (refs / 2)) / refs;
+}
+
 /* vim:cinoptions=>s,e0,n0,f0,{0,}0,^0,=s,ps,t0,c3,+s,(2s,us,)20,*30,gs,hs
  * vim:ts=8
  * vim:sw=8
@@ -0,0 +1,344 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * atheme-services: A collection of minimalist IRC services
+ * timerwheel.c: Hierarchical timing wheel for per-entity timeouts.
+ */
+
+#include <atheme.h>
+#include "internal.h"
+
+/* Level 0 has one slot per second for the next 64 seconds, level 1 one
+ * slot per 64 seconds for the next 64 of those, and so on; four levels
+ * reach about 194 days ahead, and entries further out than that wait in
+ * the last level until they come into range. Each time level 0 wraps,
+ * the next slot of level 1 is cascaded down into it (and likewise for the
+ * higher levels), so an entry is moved at most once per level.
+ *
+ * The wheel only wakes up for seconds whose level 0 slot is occupied, and
+ * at each wrap of level 0 (at most once every 64 seconds) to cascade.
+ */
+#define TIMERWHEEL_LEVELS       4U
+#define TIMERWHEEL_BITS         6U
+#define TIMERWHEEL_SLOTS        (1U << TIMERWHEEL_BITS)
+#define TIMERWHEEL_MASK         (TIMERWHEEL_SLOTS - 1U)
+
+static mowgli_list_t timerwheel_slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+static time_t timerwheel_base = 0;              // the next second to process
+static size_t timerwheel_count = 0;
+static bool timerwheel_running = false;
+static mowgli_eventloop_timer_t *timerwheel_timer = NULL;
+static time_t timerwheel_timer_when = 0;
+
+static void timerwheel_tick(void *unused);
+
+static inline unsigned int
+timerwheel_index(const time_t when, const unsigned int level)
+{
+	return (unsigned int) ((uint64_t) when >> (level * TIMERWHEEL_BITS)) & TIMERWHEEL_MASK;
+}
+
+static void
+timerwheel_insert(struct timerwheel_entry *const restrict entry)
+{
+	const time_t delta = entry->expires - timerwheel_base;
+	unsigned int level;
+	time_t when = entry->expires;
+
+	if (delta < 0)
+		when = timerwheel_base;
+
+	for (level = 0; level < TIMERWHEEL_LEVELS - 1U; level++)
+		if (delta < (time_t) 1 << ((level + 1U) * TIMERWHEEL_BITS))
+			break;
+
+	// too far ahead for the last level; it gets cascaded back into it until it isn't
+	if (level == TIMERWHEEL_LEVELS - 1U && delta >= (time_t) 1 << (TIMERWHEEL_LEVELS * TIMERWHEEL_BITS))
+		when = timerwheel_base + ((time_t) 1 << (TIMERWHEEL_LEVELS * TIMERWHEEL_BITS)) - 1;
+
+	entry->slot = &timerwheel_slots[level][timerwheel_index(when, level)];
+	mowgli_node_add(entry, &entry->node, entry->slot);
+}
+
+// How many seconds from timerwheel_base until the wheel next needs to run
+static time_t
+timerwheel_next_delta(void)
+{
+	for (unsigned int i = 0; i < TIMERWHEEL_SLOTS; i++)
+	{
+		const time_t when = timerwheel_base + i;
+
+		// a wrap of level 0 has to be processed even if nothing expires then
+		if (timerwheel_index(when, 0) == 0)
+			return i;
+
+		if (MOWGLI_LIST_LENGTH(&timerwheel_slots[0][timerwheel_index(when, 0)]) != 0)
+			return i;
+	}
+
+	return TIMERWHEEL_SLOTS;
+}
+
+static void
+timerwheel_arm(void)
+{
+	time_t when;
+
+	if (timerwheel_running)
+		return;
+
+	if (timerwheel_count == 0)
+	{
+		if (timerwheel_timer != NULL)
+			(void) mowgli_timer_destroy(base_eventloop, timerwheel_timer);
+
+		timerwheel_timer = NULL;
+		return;
+	}
+
+	when = timerwheel_base + timerwheel_next_delta();
+
+	if (timerwheel_timer != NULL)
+	{
+		if (timerwheel_timer_when <= when)
+			return;
+
+		(void) mowgli_timer_destroy(base_eventloop, timerwheel_timer);
+	}
+
+	timerwheel_timer_when = when;
+	timerwheel_timer = mowgli_timer_add_once(base_eventloop, "timerwheel_tick", &timerwheel_tick, NULL,
+	                                         (when > CURRTIME) ? (when - CURRTIME) : 0);
+}
+
+static void
+timerwheel_cascade(const unsigned int level)
+{
+	mowgli_list_t *const slot = &timerwheel_slots[level][timerwheel_index(timerwheel_base, level)];
+	mowgli_node_t *n, *tn;
+
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, slot->head)
+	{
+		struct timerwheel_entry *const entry = n->data;
+
+		(void) mowgli_node_delete(&entry->node, slot);
+		(void) timerwheel_insert(entry);
+	}
+}
+
+static void
+timerwheel_advance(void)
+{
+	mowgli_list_t *const slot = &timerwheel_slots[0][timerwheel_index(timerwheel_base, 0)];
+	mowgli_list_t expired = { NULL, NULL, 0 };
+	mowgli_node_t *n;
+
+	for (unsigned int level = 1; level < TIMERWHEEL_LEVELS; level++)
+	{
+		if (timerwheel_index(timerwheel_base, level - 1U) != 0)
+			break;
+
+		(void) timerwheel_cascade(level);
+	}
+
+	/* Take the due entries out of the wheel before calling anything, and
+	 * move on to the next second first, so that entries scheduled by the
+	 * callbacks for the past run on the next pass instead of this one.
+	 */
+	while ((n = slot->head) != NULL)
+	{
+		struct timerwheel_entry *const entry = n->data;
+
+		(void) mowgli_node_delete(&entry->node, slot);
+		(void) mowgli_node_add(entry, &entry->node, &expired);
+		entry->slot = &expired;
+	}
+
+	timerwheel_base++;
+
+	while ((n = expired.head) != NULL)
+	{
+		struct timerwheel_entry *const entry = n->data;
+		struct timerwheel_handle *const handle = entry->handle;
+
+		(void) timerwheel_cancel(entry);
+		(void) stall_context_push("timer", handle->name, NULL);
+		(void) handle->expire(entry);
+		(void) stall_context_pop();
+	}
+}
+
+static void
+timerwheel_tick(void ATHEME_VATTR_UNUSED *const restrict unused)
+{
+	timerwheel_timer = NULL;
+	timerwheel_running = true;
+
+	while (timerwheel_count != 0 && timerwheel_base <= CURRTIME)
+		(void) timerwheel_advance();
+
+	timerwheel_running = false;
+
+	if (timerwheel_count == 0)
+		timerwheel_base = CURRTIME + 1;
+
+	(void) timerwheel_arm();
+}
+
+/*
+ * timerwheel_handle_create(const char *name, timerwheel_fn expire)
+ *
+ * Creates a handle for one kind of timeout.
+ *
+ * Inputs:
+ *     - a name for the handle, used in logging
+ *     - the function to call when an entry of this handle expires
+ *
+ * Outputs:
+ *     - the new handle
+ *
+ * Side Effects:
+ *     - none
+ */
+struct timerwheel_handle *
+timerwheel_handle_create(const char *const restrict name, const timerwheel_fn expire)
+{
+	struct timerwheel_handle *handle;
+
+	return_val_if_fail(name != NULL, NULL);
+	return_val_if_fail(expire != NULL, NULL);
+
+	handle = smalloc(sizeof *handle);
+	handle->name = sstrdup(name);
+	handle->expire = expire;
+
+	return handle;
+}
+
+/*
+ * timerwheel_handle_destroy(struct timerwheel_handle *handle, timerwheel_fn cancelled)
+ *
+ * Cancels every pending entry of a handle and destroys it.
+ *
+ * Inputs:
+ *     - the handle to destroy
+ *     - a function to call for each cancelled entry (e.g. to free it),
+ *       or NULL
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - the handle is freed
+ */
+void
+timerwheel_handle_destroy(struct timerwheel_handle *const restrict handle, const timerwheel_fn cancelled)
+{
+	mowgli_node_t *n;
+
+	return_if_fail(handle != NULL);
+
+	if (MOWGLI_LIST_LENGTH(&handle->entries) != 0)
+		slog(LG_DEBUG, "timerwheel_handle_destroy(): %s: cancelling %zu entries", handle->name,
+		     MOWGLI_LIST_LENGTH(&handle->entries));
+
+	while ((n = handle->entries.head) != NULL)
+	{
+		struct timerwheel_entry *const entry = n->data;
+
+		(void) timerwheel_cancel(entry);
+
+		if (cancelled != NULL)
+			(void) cancelled(entry);
+	}
+
+	(void) timerwheel_arm();
+
+	sfree(handle->name);
+	sfree(handle);
+}
+
+/*
+ * timerwheel_schedule(struct timerwheel_handle *handle, struct timerwheel_entry *entry, time_t expires)
+ *
+ * Schedules an entry to expire at a given time, rescheduling it if it is
+ * already pending.
+ *
+ * Inputs:
+ *     - the handle whose callback should be called on expiry
+ *     - the entry, embedded in the object that times out
+ *     - when the entry should expire; times in the past expire as
+ *       soon as possible
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - the handle's expire callback is called for the entry no earlier
+ *       than the given time, unless it is cancelled first
+ */
+void
+timerwheel_schedule(struct timerwheel_handle *const restrict handle, struct timerwheel_entry *const restrict entry,
+                    const time_t expires)
+{
+	return_if_fail(handle != NULL);
+	return_if_fail(entry != NULL);
+
+	if (timerwheel_pending(entry))
+		(void) timerwheel_cancel(entry);
+
+	// nothing is waiting, so the wheel can start from now instead of catching up
+	if (timerwheel_count == 0 && ! timerwheel_running)
+		timerwheel_base = CURRTIME + 1;
+
+	entry->handle = handle;
+	entry->expires = expires;
+
+	(void) timerwheel_insert(entry);
+	(void) mowgli_node_add(entry, &entry->hnode, &handle->entries);
+
+	timerwheel_count++;
+
+	(void) timerwheel_arm();
+}
+
+/*
+ * timerwheel_cancel(struct timerwheel_entry *entry)
+ *
+ * Cancels a pending entry. Cancelling an entry that is not pending does
+ * nothing.
+ *
+ * Inputs:
+ *     - the entry to cancel
+ *
+ * Outputs:
+ *     - nothing
+ *
+ * Side Effects:
+ *     - the entry will not expire
+ */
+void
+timerwheel_cancel(struct timerwheel_entry *const restrict entry)
+{
+	return_if_fail(entry != NULL);
+
+	if (! timerwheel_pending(entry))
+		return;
+
+	(void) mowgli_node_delete(&entry->node, entry->slot);
+	(void) mowgli_node_delete(&entry->hnode, &entry->handle->entries);
+
+	entry->slot = NULL;
+	timerwheel_count--;
+
+	/* There is no need to re-arm the timer here: if it goes off with
+	 * nothing left to do, it simply doesn't arm itself again.
+	 */
+}
@@ -18,7 +18,7 @@
 
 static void uplink_close(struct connection *cptr);
 
-static mowgli_heap_t *uplink_heap = NULL;
+static struct slab_type *uplink_heap = NULL;
 
 mowgli_list_t uplinks;
 struct uplink *curr_uplink;
@@ -30,7 +30,7 @@ init_uplinks(void)
 {
 	(void) memset(&uplinks, 0x00, sizeof uplinks);
 
-	uplink_heap = sharedheap_get(sizeof(struct uplink));
+	uplink_heap = slab_type_create("uplink", sizeof(struct uplink));
 	if (!uplink_heap)
 	{
 		slog(LG_INFO, "init_uplinks(): block allocator failed.");
@@ -65,7 +65,7 @@ uplink_add(const char *name, const char *host, const char *send_password, const
 	}
 	else
 	{
-		u = mowgli_heap_alloc(uplink_heap);
+		u = slab_alloc(uplink_heap);
 		mowgli_node_add(u, &u->node, &uplinks);
 		cnt.uplink++;
 	}
@@ -90,7 +90,7 @@ uplink_delete(struct uplink * u)
 	sfree(u->vhost);
 
 	mowgli_node_delete(&u->node, &uplinks);
-	mowgli_heap_free(uplink_heap, u);
+	slab_free(uplink_heap, u);
 
 	cnt.uplink--;
 }
@@ -111,6 +111,20 @@ uplink_find(const char *name)
 	return NULL;
 }
 
+/* Whether the uplink's sendq is more than half full, so that anything that
+ * can wait (queued replies, bulk announcements) should.
+ */
+bool
+uplink_sendq_busy(void)
+{
+	struct connection *conn;
+
+	if (curr_uplink == NULL || (conn = curr_uplink->conn) == NULL || ! conn->sendq_limit)
+		return false;
+
+	return sendq_length(conn) > (conn->sendq_limit / 2);
+}
+
 static void
 reconn(void *arg)
 {
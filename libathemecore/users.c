@@ -16,7 +16,7 @@
 #include <atheme.h>
 #include "internal.h"
 
-static mowgli_heap_t *user_heap = NULL;
+static struct slab_type *user_heap = NULL;
 
 mowgli_patricia_t *userlist;
 mowgli_patricia_t *uidlist;
@@ -44,7 +44,7 @@ user_delete_cb(void *const restrict user)
 void
 init_users(void)
 {
-	user_heap = sharedheap_get(sizeof(struct user));
+	user_heap = slab_type_create("user", sizeof(struct user));
 
 	if (user_heap == NULL)
 	{
@@ -151,7 +151,7 @@ user_add(const char *nick, const char *user, const char *host,
 		}
 	}
 
-	u = mowgli_heap_alloc(user_heap);
+	u = slab_alloc(user_heap);
 	atheme_object_init(atheme_object(u), nick, &user_delete_cb);
 
 	if (uid != NULL)
@@ -228,6 +228,8 @@ user_delete(struct user *u, const char *comment)
 	hook_call_user_delete_info((&(struct hook_user_delete_info){.u = u, .comment = comment}));
 	hook_call_user_delete(u);
 
+	replyq_user_delete(u);
+
 	u->server->users--;
 	if (is_ircop(u))
 		u->server->opers--;
@@ -241,7 +243,7 @@ user_delete(struct user *u, const char *comment)
 	{
 		cu = (struct chanuser *)n->data;
 
-		chanuser_delete(cu->chan, u);
+		chanuser_delete_member(cu);
 	}
 
 	mowgli_patricia_delete(userlist, u->nick);
@@ -278,7 +280,7 @@ user_delete(struct user *u, const char *comment)
 	strshare_unref(u->chost);
 	strshare_unref(u->ip);
 
-	mowgli_heap_free(user_heap, u);
+	slab_free(user_heap, u);
 
 	cnt.user--;
 
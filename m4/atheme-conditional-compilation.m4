@@ -7,6 +7,12 @@
 # -*- Atheme IRC Services -*-
 # Atheme Build System Component
 
+AC_DEFUN([ATHEME_COND_BENCHMARKS_ENABLE], [
+
+    BENCHMARKS_COND_D="burst-replay command-benchmark parse-benchmark sasl-benchmark strshare-benchmark"
+    AC_SUBST([BENCHMARKS_COND_D])
+])
+
 AC_DEFUN([ATHEME_COND_CRYPTO_BENCHMARK_ENABLE], [
 
     CRYPTO_BENCHMARK_COND_D="crypto-benchmark"
@@ -14,7 +14,7 @@ AC_DEFUN([ATHEME_FEATURETEST_CRYPTO_BENCHMARKING], [
     CRYPTO_BENCHMARKING="No"
 
     AC_ARG_ENABLE([crypto-benchmarking],
-        [AS_HELP_STRING([--disable-crypto-benchmarking], [Don't build the crypto benchmarking utility])],
+        [AS_HELP_STRING([--disable-crypto-benchmarking], [Don't build the crypto and other benchmarking utilities])],
         [], [enable_crypto_benchmarking="auto"])
 
     AS_CASE(["x${enable_crypto_benchmarking}"], [xno], [], [xyes], [], [xauto], [], [
@@ -50,13 +50,14 @@ AC_DEFUN([ATHEME_FEATURETEST_CRYPTO_BENCHMARKING], [
                 AC_MSG_RESULT([yes])
                 CRYPTO_BENCHMARKING="Yes"
                 ATHEME_COND_CRYPTO_BENCHMARK_ENABLE
+                ATHEME_COND_BENCHMARKS_ENABLE
             ], [
                 AC_MSG_RESULT([no])
                 CLOCK_GETTIME_LIBS=""
                 AS_IF([test "${enable_crypto_benchmarking}" = "yes"], [
                     AC_MSG_FAILURE([--enable-crypto-benchmarking was given but clock_gettime(2) does not appear to be usable])
                 ], [
-                    AC_MSG_WARN([the crypto benchmarking utility will not be available])
+                    AC_MSG_WARN([the benchmarking utilities will not be available])
                 ])
             ])
         ], [
@@ -64,7 +65,7 @@ AC_DEFUN([ATHEME_FEATURETEST_CRYPTO_BENCHMARKING], [
             AS_IF([test "${enable_crypto_benchmarking}" = "yes"], [
                 AC_MSG_FAILURE([--enable-crypto-benchmarking was given but clock_gettime(2) is not available])
             ], [
-                AC_MSG_WARN([the crypto benchmarking utility will not be available])
+                AC_MSG_WARN([the benchmarking utilities will not be available])
             ])
         ], [])
     ])
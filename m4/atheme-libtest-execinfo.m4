@@ -0,0 +1,48 @@
+# SPDX-License-Identifier: ISC
+# SPDX-URL: https://spdx.org/licenses/ISC.html
+#
+# Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+#
+# -*- Atheme IRC Services -*-
+# Atheme Build System Component
+
+AC_DEFUN([ATHEME_LIBTEST_EXECINFO], [
+
+    LIBS_SAVED="${LIBS}"
+
+    LIBEXECINFO_LIBS=""
+
+    AC_SEARCH_LIBS([backtrace], [execinfo], [
+        AC_CHECK_HEADERS([execinfo.h], [], [], [])
+        AC_MSG_CHECKING([if backtrace(3) appears to be usable])
+        AC_LINK_IFELSE([
+            AC_LANG_PROGRAM([[
+                #ifdef HAVE_STDLIB_H
+                #  include <stdlib.h>
+                #endif
+                #ifdef HAVE_EXECINFO_H
+                #  include <execinfo.h>
+                #endif
+            ]], [[
+                void *addrs[8];
+                const int frames = backtrace(addrs, 8);
+                char **const symbols = backtrace_symbols(addrs, frames);
+                (void) free(symbols);
+            ]])
+        ], [
+            AC_MSG_RESULT([yes])
+            AC_DEFINE([HAVE_USABLE_BACKTRACE], [1], [Define to 1 if backtrace(3) appears to be usable])
+            AS_IF([test "x${ac_cv_search_backtrace}" != "xnone required"], [
+                LIBEXECINFO_LIBS="${ac_cv_search_backtrace}"
+            ])
+        ], [
+            AC_MSG_RESULT([no])
+        ])
+    ], [])
+
+    AC_SUBST([LIBEXECINFO_LIBS])
+
+    LIBS="${LIBS_SAVED}"
+
+    unset LIBS_SAVED
+])
@@ -0,0 +1,55 @@
+# SPDX-License-Identifier: ISC
+# SPDX-URL: https://spdx.org/licenses/ISC.html
+#
+# Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+#
+# -*- Atheme IRC Services -*-
+# Atheme Build System Component
+
+AC_DEFUN([ATHEME_LIBTEST_PTHREAD], [
+
+    LIBS_SAVED="${LIBS}"
+
+    LIBPTHREAD_LIBS=""
+
+    AC_SEARCH_LIBS([pthread_create], [pthread], [
+        AC_CHECK_HEADERS([pthread.h signal.h], [], [], [])
+        AC_MSG_CHECKING([if POSIX threads appear to be usable])
+        AC_LINK_IFELSE([
+            AC_LANG_PROGRAM([[
+                #ifdef HAVE_STDDEF_H
+                #  include <stddef.h>
+                #endif
+                #ifdef HAVE_SIGNAL_H
+                #  include <signal.h>
+                #endif
+                #ifdef HAVE_PTHREAD_H
+                #  include <pthread.h>
+                #endif
+                static void *start(void *arg) { return arg; }
+            ]], [[
+                pthread_t thread;
+                sigset_t all, old;
+                (void) sigfillset(&all);
+                (void) pthread_sigmask(SIG_SETMASK, &all, &old);
+                (void) pthread_create(&thread, NULL, &start, NULL);
+                (void) pthread_detach(thread);
+                (void) pthread_kill(pthread_self(), SIGURG);
+            ]])
+        ], [
+            AC_MSG_RESULT([yes])
+            AC_DEFINE([HAVE_USABLE_PTHREAD], [1], [Define to 1 if POSIX threads and pthread_kill(3) appear to be usable])
+            AS_IF([test "x${ac_cv_search_pthread_create}" != "xnone required"], [
+                LIBPTHREAD_LIBS="${ac_cv_search_pthread_create}"
+            ])
+        ], [
+            AC_MSG_RESULT([no])
+        ])
+    ], [])
+
+    AC_SUBST([LIBPTHREAD_LIBS])
+
+    LIBS="${LIBS_SAVED}"
+
+    unset LIBS_SAVED
+])
@@ -28,8 +28,27 @@ static unsigned int their_ca_all;
 
 static bool mdep_load_mdeps = true;
 
+/* Channel access rows and their metadata are looked up by mask while
+ * loading; a linear chanacs_find_by_mask() per row makes channels with
+ * large access lists quadratic to load. This index only lives for the
+ * duration of corestorage_db_load().
+ */
+struct load_chan
+{
+	struct mychan *         mc;
+	mowgli_patricia_t *     entities;       // entity ID -> struct chanacs
+	mowgli_patricia_t *     hosts;          // host mask -> struct chanacs
+};
+
+static mowgli_patricia_t *load_chans = NULL;
+
+// Rows for the same object are usually consecutive
+static struct load_chan *load_chan_last = NULL;
+static struct myuser *load_mu_last = NULL;
+
 #ifdef HAVE_FORK
 static pid_t child_pid;
+static uint64_t child_start;
 #endif
 
 // write atheme.db (core fields)
@@ -50,6 +69,7 @@ corestorage_db_save(struct database_handle *db)
 	mowgli_node_t *n, *tn;
 	mowgli_patricia_iteration_state_t state;
 	struct myentity_iteration_state mestate;
+	struct metadata_iteration_state mdstate;
 
 	errno = 0;
 
@@ -100,16 +120,13 @@ corestorage_db_save(struct database_handle *db)
 		db_write_word(db, language_get_name(mu->language));
 		db_commit_row(db);
 
-		if (atheme_object(mu)->metadata)
+		METADATA_FOREACH(md, &mdstate, mu)
 		{
-			MOWGLI_PATRICIA_FOREACH(md, &state, atheme_object(mu)->metadata)
-			{
-				db_start_row(db, "MDU");
-				db_write_word(db, entity(mu)->name);
-				db_write_word(db, md->name);
-				db_write_str(db, md->value);
-				db_commit_row(db);
-			}
+			db_start_row(db, "MDU");
+			db_write_word(db, entity(mu)->name);
+			db_write_word(db, md->name);
+			db_write_str(db, md->value);
+			db_commit_row(db);
 		}
 
 		MOWGLI_ITER_FOREACH(tn, mu->memos.head)
@@ -171,7 +188,7 @@ corestorage_db_save(struct database_handle *db)
 
 	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
 	{
-		mowgli_patricia_iteration_state_t state2;
+		struct metadata_iteration_state state2;
 
 		char *flags = gflags_tostr(mc_flags, mc->flags);
 
@@ -217,52 +234,43 @@ corestorage_db_save(struct database_handle *db)
 
 			db_commit_row(db);
 
-			if (atheme_object(ca)->metadata)
+			METADATA_FOREACH(md, &state2, ca)
 			{
-				MOWGLI_PATRICIA_FOREACH(md, &state2, atheme_object(ca)->metadata)
-				{
-					db_start_row(db, "MDA");
-					db_write_word(db, ca->mychan->name);
-					db_write_word(db, (ca->entity) ? ca->entity->name : ca->host);
-					db_write_word(db, md->name);
-					db_write_str(db, md->value);
-					db_commit_row(db);
-				}
-			}
-		}
-
-		if (atheme_object(mc)->metadata)
-		{
-			MOWGLI_PATRICIA_FOREACH(md, &state2, atheme_object(mc)->metadata)
-			{
-				db_start_row(db, "MDC");
-				db_write_word(db, mc->name);
+				db_start_row(db, "MDA");
+				db_write_word(db, ca->mychan->name);
+				db_write_word(db, (ca->entity) ? ca->entity->name : ca->host);
 				db_write_word(db, md->name);
 				db_write_str(db, md->value);
 				db_commit_row(db);
 			}
 		}
+
+		METADATA_FOREACH(md, &state2, mc)
+		{
+			db_start_row(db, "MDC");
+			db_write_word(db, mc->name);
+			db_write_word(db, md->name);
+			db_write_str(db, md->value);
+			db_commit_row(db);
+		}
 	}
 
 	// Old names
 	MOWGLI_PATRICIA_FOREACH(mun, &state, oldnameslist)
 	{
-		mowgli_patricia_iteration_state_t state2;
+		struct metadata_iteration_state state2;
 
 		db_start_row(db, "NAM");
 		db_write_word(db, mun->name);
 		db_commit_row(db);
 
-		if (atheme_object(mun)->metadata)
+		METADATA_FOREACH(md, &state2, mun)
 		{
-			MOWGLI_PATRICIA_FOREACH(md, &state2, atheme_object(mun)->metadata)
-			{
-				db_start_row(db, "MDN");
-				db_write_word(db, mun->name);
-				db_write_word(db, md->name);
-				db_write_str(db, md->value);
-				db_commit_row(db);
-			}
+			db_start_row(db, "MDN");
+			db_write_word(db, mun->name);
+			db_write_word(db, md->name);
+			db_write_str(db, md->value);
+			db_commit_row(db);
 		}
 	}
 
@@ -666,6 +674,96 @@ corestorage_h_so(struct database_handle *db, const char *type)
 	soper_add(entity(mu)->name, class, flags & ~SOPER_CONF, pass);
 }
 
+static void
+load_chanacs_index(struct load_chan *lc, struct chanacs *ca)
+{
+	// Keep the first of any duplicates, as chanacs_find_by_mask() would
+	if (ca->entity != NULL)
+		mowgli_patricia_add(lc->entities, ca->entity->id, ca);
+	else if (ca->host != NULL)
+		mowgli_patricia_add(lc->hosts, ca->host, ca);
+}
+
+static struct load_chan *
+load_chan_find(const char *name)
+{
+	struct load_chan *lc;
+	struct mychan *mc;
+	mowgli_node_t *n;
+
+	if (load_chan_last != NULL && !irccasecmp(load_chan_last->mc->name, name))
+		return load_chan_last;
+
+	if (load_chans == NULL)
+		load_chans = mowgli_patricia_create(irccasecanon);
+
+	if ((lc = mowgli_patricia_retrieve(load_chans, name)) == NULL)
+	{
+		if ((mc = mychan_find(name)) == NULL)
+			return NULL;
+
+		lc = smalloc(sizeof *lc);
+		lc->mc = mc;
+		lc->entities = mowgli_patricia_create(noopcanon);
+		lc->hosts = mowgli_patricia_create(strcasecanon);
+
+		// pick up entries that did not come from CA rows
+		MOWGLI_ITER_FOREACH(n, mc->chanacs.head)
+			load_chanacs_index(lc, n->data);
+
+		mowgli_patricia_add(load_chans, mc->name, lc);
+	}
+
+	load_chan_last = lc;
+	return lc;
+}
+
+static struct chanacs *
+load_chanacs_find(struct load_chan *lc, const char *mask)
+{
+	struct myentity *mt;
+	struct chanacs *ca;
+
+	if (lc == NULL)
+		return NULL;
+
+	if ((mt = myentity_find(mask)) != NULL && (ca = mowgli_patricia_retrieve(lc->entities, mt->id)) != NULL)
+		return ca;
+
+	return mowgli_patricia_retrieve(lc->hosts, mask);
+}
+
+static struct myuser *
+load_myuser_find(const char *name)
+{
+	if (load_mu_last != NULL && !irccasecmp(entity(load_mu_last)->name, name))
+		return load_mu_last;
+
+	load_mu_last = myuser_find(name);
+	return load_mu_last;
+}
+
+static void
+load_chan_destroy(const char *key, void *data, void *privdata)
+{
+	struct load_chan *lc = data;
+
+	mowgli_patricia_destroy(lc->entities, NULL, NULL);
+	mowgli_patricia_destroy(lc->hosts, NULL, NULL);
+	sfree(lc);
+}
+
+static void
+load_index_clear(void)
+{
+	if (load_chans != NULL)
+		mowgli_patricia_destroy(load_chans, load_chan_destroy, NULL);
+
+	load_chans = NULL;
+	load_chan_last = NULL;
+	load_mu_last = NULL;
+}
+
 static void
 corestorage_h_mc(struct database_handle *db, const char *type)
 {
@@ -689,7 +787,7 @@ corestorage_h_mc(struct database_handle *db, const char *type)
 		flags = db_sread_uint(db);
 	}
 
-	mc->flags = flags;
+	mychan_set_flags(mc, flags);
 	mc->mlock_on = db_sread_uint(db);
 	mc->mlock_off = db_sread_uint(db);
 	mc->mlock_limit = db_sread_uint(db);
@@ -742,11 +840,13 @@ corestorage_h_md(struct database_handle *db, const char *type)
 
 	if (!strcmp(type, "MDU"))
 	{
-		obj = myuser_find(name);
+		obj = load_myuser_find(name);
 	}
 	else if (!strcmp(type, "MDC"))
 	{
-		obj = mychan_find(name);
+		struct load_chan *lc = load_chan_find(name);
+
+		obj = lc != NULL ? lc->mc : NULL;
 		if (!(their_ca_all & CA_EXEMPT) &&
 				!strcmp(prop, "private:templates"))
 		{
@@ -760,7 +860,7 @@ corestorage_h_md(struct database_handle *db, const char *type)
 		if (mask != NULL)
 		{
 			*mask++ = '\0';
-			obj = chanacs_find_by_mask(mychan_find(name), mask, CA_NONE);
+			obj = load_chanacs_find(load_chan_find(name), mask);
 		}
 	}
 	else if (!strcmp(type, "MDN"))
@@ -799,7 +899,7 @@ corestorage_h_mda(struct database_handle *db, const char *type)
 	prop = db_sread_word(db);
 	value = db_sread_str(db);
 
-	obj = chanacs_find_by_mask(mychan_find(name), mask, CA_NONE);
+	obj = load_chanacs_find(load_chan_find(name), mask);
 
 	if (obj == NULL)
 	{
@@ -817,9 +917,11 @@ corestorage_h_ca(struct database_handle *db, const char *type)
 	const char *chan, *target;
 	time_t tmod;
 	unsigned int flags;
+	struct load_chan *lc;
 	struct mychan *mc;
 	struct myentity *mt;
 	struct myentity *setter;
+	struct chanacs *ca;
 
 	chan = db_sread_word(db);
 	target = db_sread_word(db);
@@ -831,7 +933,8 @@ corestorage_h_ca(struct database_handle *db, const char *type)
 
 	tmod = db_sread_time(db);
 
-	mc = mychan_find(chan);
+	lc = load_chan_find(chan);
+	mc = lc != NULL ? lc->mc : NULL;
 	mt = myentity_find(target);
 
 	setter = NULL;
@@ -856,12 +959,15 @@ corestorage_h_ca(struct database_handle *db, const char *type)
 
 	if (mt == NULL && validhostmask(target))
 	{
-		chanacs_add_host(mc, target, flags, tmod, setter);
+		ca = chanacs_add_host(mc, target, flags, tmod, setter);
 	}
 	else
 	{
-		chanacs_add(mc, mt, flags, tmod, setter);
+		ca = chanacs_add(mc, mt, flags, tmod, setter);
 	}
+
+	if (ca != NULL)
+		load_chanacs_index(lc, ca);
 }
 
 static void
@@ -1007,12 +1113,15 @@ corestorage_db_load(const char *filename)
 
 	db_parse(db);
 	db_close(db);
+
+	load_index_clear();
 }
 
 static void
 corestorage_db_write_blocking(void *filename)
 {
 	struct database_handle *db;
+	const uint64_t begin = latency_clock();
 
 	db = db_open(filename, DB_WRITE);
 
@@ -1026,6 +1135,9 @@ corestorage_db_write_blocking(void *filename)
 	hook_call_db_write(db);
 
 	db_close(db);
+
+	// in a child doing a background write, this is thrown away; the parent times it instead
+	latency_histogram_record(&db_save_latency, latency_clock() - begin);
 }
 
 #ifdef HAVE_FORK
@@ -1038,6 +1150,9 @@ corestorage_db_saved_cb(pid_t pid, int status, void *data)
 	{
 		child_pid = 0;
 		slog(LG_DEBUG, "db_save(): finished asynchronous DB write");
+
+		if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)
+			latency_histogram_record(&db_save_latency, latency_clock() - child_start);
 	}
 }
 #endif
@@ -1085,6 +1200,7 @@ corestorage_db_write(void *filename, enum db_save_strategy strategy)
 
 		default:
 			child_pid = pid;
+			child_start = latency_clock();
 			childproc_add(pid, "db_save", corestorage_db_saved_cb, NULL);
 			return;
 	}
@@ -363,7 +363,7 @@ flatfile_db_load(const char *filename)
 
 				mc->registered = atoi(strtok(NULL, " "));
 				mc->used = atoi(strtok(NULL, " "));
-				mc->flags = atoi(strtok(NULL, " "));
+				mychan_set_flags(mc, atoi(strtok(NULL, " ")));
 
 				mc->mlock_on = atoi(strtok(NULL, " "));
 				mc->mlock_off = atoi(strtok(NULL, " "));
@@ -377,7 +377,7 @@ flatfile_db_load(const char *filename)
 				}
 
 				if (versn < 5 && config_options.join_chans)
-					mc->flags |= MC_GUARD;
+					mychan_set_flags(mc, mc->flags | MC_GUARD);
 			}
 		}
 		else if (!strcmp("MD", item))
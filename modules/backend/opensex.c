@@ -12,6 +12,73 @@
 
 #include <atheme.h>
 
+#ifdef HAVE_USABLE_PTHREAD
+#  include <pthread.h>
+#endif
+
+/* Large databases are split into chunks of whole rows, which worker
+ * threads tokenize ahead of the main thread; the main thread still
+ * applies every row in file order, it just no longer has to find the
+ * words in them or parse their numbers. Without POSIX threads, every
+ * database is read a row at a time.
+ */
+#define OPENSEX_PARALLEL_MIN    (1024U * 1024U)
+#define OPENSEX_CHUNK_SIZE      (256U * 1024U)
+#define OPENSEX_THREADS_MAX     16U
+
+// How many chunks the workers may tokenize ahead of the main thread, per thread
+#define OPENSEX_WINDOW          4U
+
+struct opensex_token
+{
+	uint32_t        start;          // offsets into the chunk
+	uint32_t        end;
+	bool            uint_ok;        // strtoul() would accept the whole word
+	bool            int_ok;         // strtol() would accept the whole word
+	unsigned long   uint_val;
+	long            int_val;
+};
+
+struct opensex_row
+{
+	uint32_t        first_token;
+	uint32_t        ntokens;
+};
+
+struct opensex_chunk
+{
+	char *                  base;
+	size_t                  len;
+	struct opensex_row *    rows;
+	size_t                  nrows;
+	struct opensex_token *  tokens;
+	size_t                  ntokens;
+	bool                    ready;
+};
+
+struct opensex_pipeline
+{
+	char *                  data;
+	struct opensex_chunk *  chunks;
+	size_t                  nchunks;
+
+#ifdef HAVE_USABLE_PTHREAD
+	pthread_t *             threads;
+	unsigned int            nthreads;
+	unsigned int            window;
+
+	pthread_mutex_t         lock;
+	pthread_cond_t          ready;          // a chunk has been tokenized
+	pthread_cond_t          space;          // the main thread has moved on
+#endif
+	size_t                  claimed;        // chunks handed out so far
+	size_t                  current;        // chunk the main thread is reading
+
+	// Main thread position
+	size_t                  row;
+	uint32_t                token;
+};
+
 struct opensex
 {
 	// Lexing state
@@ -19,6 +86,7 @@ struct opensex
 	unsigned int bufsize;
 	char *token;
 	FILE *f;
+	struct opensex_pipeline *pl;
 
 	// Interpreting state
 	unsigned int grver;
@@ -28,16 +96,395 @@ struct opensex
 static int lockfd;
 #endif
 
+#ifdef HAVE_USABLE_PTHREAD
+
+static void
+opensex_token_parse(struct opensex_token *t, const char *base)
+{
+	const char *const s = base + t->start;
+	const char *const e = base + t->end;
+	char *rp;
+
+	if (t->start == t->end)
+		return;
+
+	if (!isdigit((unsigned char) *s) && *s != '-' && *s != '+')
+		return;
+
+	/* the word is followed by a space or a NUL, which stop both
+	 * conversions just like the NUL that read_word() puts there
+	 */
+	t->uint_val = strtoul(s, &rp, 0);
+	t->uint_ok = (rp == e);
+
+	t->int_val = strtol(s, &rp, 0);
+	t->int_ok = (rp == e);
+}
+
+static void
+opensex_chunk_tokenize(struct opensex_chunk *c)
+{
+	size_t rows_size = 64, tokens_size = 256;
+	size_t pos = 0;
+
+	c->rows = smalloc(rows_size * sizeof *c->rows);
+	c->tokens = smalloc(tokens_size * sizeof *c->tokens);
+
+	while (pos < c->len)
+	{
+		char *const nl = memchr(c->base + pos, '\n', c->len - pos);
+		const size_t eol = (nl != NULL) ? (size_t) (nl - c->base) : c->len;
+		struct opensex_row *row;
+
+		if (nl != NULL)
+			*nl = '\0';
+
+		if (c->nrows == rows_size)
+		{
+			rows_size *= 2;
+			c->rows = sreallocarray(c->rows, rows_size, sizeof *c->rows);
+		}
+
+		row = &c->rows[c->nrows++];
+		row->first_token = c->ntokens;
+		row->ntokens = 0;
+
+		// every space separates two words, which may be empty
+		for (;;)
+		{
+			const char *const sp = memchr(c->base + pos, ' ', eol - pos);
+			struct opensex_token *t;
+
+			if (c->ntokens == tokens_size)
+			{
+				tokens_size *= 2;
+				c->tokens = sreallocarray(c->tokens, tokens_size, sizeof *c->tokens);
+			}
+
+			t = &c->tokens[c->ntokens++];
+			(void) memset(t, 0x00, sizeof *t);
+			t->start = pos;
+			t->end = (sp != NULL) ? (size_t) (sp - c->base) : eol;
+			row->ntokens++;
+
+			opensex_token_parse(t, c->base);
+
+			if (sp == NULL)
+				break;
+
+			pos = t->end + 1;
+		}
+
+		pos = eol + 1;
+	}
+}
+
+static void
+opensex_chunk_release(struct opensex_chunk *c)
+{
+	sfree(c->rows);
+	sfree(c->tokens);
+	c->rows = NULL;
+	c->tokens = NULL;
+}
+
+static void *
+opensex_worker(void *arg)
+{
+	struct opensex_pipeline *pl = arg;
+
+	pthread_mutex_lock(&pl->lock);
+
+	for (;;)
+	{
+		while (pl->claimed < pl->nchunks && pl->claimed >= pl->current + pl->window)
+			pthread_cond_wait(&pl->space, &pl->lock);
+
+		if (pl->claimed >= pl->nchunks)
+			break;
+
+		struct opensex_chunk *c = &pl->chunks[pl->claimed++];
+
+		pthread_mutex_unlock(&pl->lock);
+		opensex_chunk_tokenize(c);
+		pthread_mutex_lock(&pl->lock);
+
+		c->ready = true;
+		pthread_cond_broadcast(&pl->ready);
+	}
+
+	pthread_mutex_unlock(&pl->lock);
+
+	return NULL;
+}
+
+static unsigned int
+opensex_thread_count(void)
+{
+	long ncpu = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	// leave one core to the main thread, which applies the rows
+	if (ncpu <= 1)
+		return 0;
+
+	return (ncpu > OPENSEX_THREADS_MAX) ? OPENSEX_THREADS_MAX : (unsigned int) ncpu - 1;
+}
+
+/* Reads the rest of the file into memory and starts the workers. Returns
+ * false to keep reading it a row at a time, when it is small or there is
+ * only one CPU to work with.
+ */
+static bool
+opensex_pipeline_start(struct database_handle *db)
+{
+	struct opensex *rs = db->priv;
+	struct opensex_pipeline *pl;
+	const unsigned int nthreads = opensex_thread_count();
+	struct stat sb;
+	size_t size, pos;
+
+	if (nthreads == 0 || fstat(fileno(rs->f), &sb) != 0 || sb.st_size < (off_t) OPENSEX_PARALLEL_MIN)
+		return false;
+
+	if ((uintmax_t) sb.st_size >= SIZE_MAX)
+		return false;
+
+	pl = smalloc(sizeof *pl);
+	pl->data = smalloc((size_t) sb.st_size + 1);
+
+	size = fread(pl->data, 1, (size_t) sb.st_size, rs->f);
+	if (ferror(rs->f))
+	{
+		slog(LG_ERROR, "opensex-pipeline-start: error reading %s: %s", db->file, strerror(errno));
+		slog(LG_ERROR, "opensex-pipeline-start: exiting to avoid data loss");
+		exit(EXIT_FAILURE);
+	}
+
+	pl->data[size] = '\0';
+
+	// cut the file after the first newline following every chunk-sized step
+	for (pos = 0; pos < size; )
+	{
+		size_t end = pos + OPENSEX_CHUNK_SIZE;
+
+		if (end >= size)
+			end = size;
+		else
+		{
+			const char *nl = memchr(pl->data + end, '\n', size - end);
+
+			end = (nl != NULL) ? (size_t) (nl - pl->data) + 1 : size;
+		}
+
+		if (pl->nchunks % 64 == 0)
+			pl->chunks = sreallocarray(pl->chunks, pl->nchunks + 64, sizeof *pl->chunks);
+
+		(void) memset(&pl->chunks[pl->nchunks], 0x00, sizeof *pl->chunks);
+		pl->chunks[pl->nchunks].base = pl->data + pos;
+		pl->chunks[pl->nchunks].len = end - pos;
+		pl->nchunks++;
+
+		pos = end;
+	}
+
+	pthread_mutex_init(&pl->lock, NULL);
+	pthread_cond_init(&pl->ready, NULL);
+	pthread_cond_init(&pl->space, NULL);
+
+	pl->window = nthreads * OPENSEX_WINDOW;
+	pl->threads = smalloc(nthreads * sizeof *pl->threads);
+
+	for (unsigned int i = 0; i < nthreads; i++)
+	{
+		const int err = pthread_create(&pl->threads[pl->nthreads], NULL, opensex_worker, pl);
+
+		if (err != 0)
+		{
+			slog(LG_ERROR, "opensex-pipeline-start: cannot create worker thread: %s", strerror(err));
+			break;
+		}
+
+		pl->nthreads++;
+	}
+
+	slog(LG_DEBUG, "opensex-pipeline-start: %zu chunks, %u worker threads", pl->nchunks, pl->nthreads);
+
+	rs->pl = pl;
+
+	return true;
+}
+
+static void
+opensex_pipeline_stop(struct opensex *rs)
+{
+	struct opensex_pipeline *pl = rs->pl;
+
+	if (pl == NULL)
+		return;
+
+	// nothing left to hand out, so idle workers return
+	pthread_mutex_lock(&pl->lock);
+	pl->claimed = pl->nchunks;
+	pthread_cond_broadcast(&pl->space);
+	pthread_mutex_unlock(&pl->lock);
+
+	for (unsigned int i = 0; i < pl->nthreads; i++)
+		pthread_join(pl->threads[i], NULL);
+
+	for (size_t i = 0; i < pl->nchunks; i++)
+		opensex_chunk_release(&pl->chunks[i]);
+
+	pthread_cond_destroy(&pl->space);
+	pthread_cond_destroy(&pl->ready);
+	pthread_mutex_destroy(&pl->lock);
+
+	sfree(pl->threads);
+	sfree(pl->chunks);
+	sfree(pl->data);
+	sfree(pl);
+
+	rs->pl = NULL;
+}
+
+// Waits for the chunk the main thread is on, tokenizing it here if no worker has taken it yet
+static struct opensex_chunk *
+opensex_pipeline_chunk(struct opensex_pipeline *pl)
+{
+	struct opensex_chunk *c = &pl->chunks[pl->current];
+
+	pthread_mutex_lock(&pl->lock);
+
+	if (pl->claimed == pl->current)
+	{
+		pl->claimed++;
+		pthread_mutex_unlock(&pl->lock);
+
+		opensex_chunk_tokenize(c);
+
+		pthread_mutex_lock(&pl->lock);
+		c->ready = true;
+	}
+
+	while (!c->ready)
+		pthread_cond_wait(&pl->ready, &pl->lock);
+
+	pthread_mutex_unlock(&pl->lock);
+
+	return c;
+}
+
+static bool
+opensex_pipeline_next_row(struct database_handle *hdl, struct opensex_pipeline *pl)
+{
+	while (pl->current < pl->nchunks)
+	{
+		struct opensex_chunk *c = &pl->chunks[pl->current];
+
+		if (pl->row == 0)
+			(void) opensex_pipeline_chunk(pl);
+
+		if (pl->row < c->nrows)
+		{
+			pl->token = c->rows[pl->row++].first_token;
+
+			hdl->line++;
+			hdl->token = 0;
+			return true;
+		}
+
+		opensex_chunk_release(c);
+
+		pthread_mutex_lock(&pl->lock);
+		pl->current++;
+		pthread_cond_broadcast(&pl->space);
+		pthread_mutex_unlock(&pl->lock);
+
+		pl->row = 0;
+	}
+
+	return false;
+}
+
+#else /* HAVE_USABLE_PTHREAD */
+
+static inline bool
+opensex_pipeline_start(struct database_handle ATHEME_VATTR_UNUSED *const restrict db)
+{
+	return false;
+}
+
+static inline void
+opensex_pipeline_stop(struct opensex ATHEME_VATTR_UNUSED *const restrict rs)
+{
+	return;
+}
+
+static inline bool
+opensex_pipeline_next_row(struct database_handle ATHEME_VATTR_UNUSED *const restrict hdl,
+                          struct opensex_pipeline ATHEME_VATTR_UNUSED *const restrict pl)
+{
+	return false;
+}
+
+#endif /* !HAVE_USABLE_PTHREAD */
+
+// The current word of the current row, or NULL past its end
+static struct opensex_token *
+opensex_pipeline_token(struct opensex_pipeline *pl, struct opensex_chunk **cp)
+{
+	struct opensex_chunk *c = &pl->chunks[pl->current];
+	const struct opensex_row *row = &c->rows[pl->row - 1];
+
+	*cp = c;
+
+	if (pl->token >= row->first_token + row->ntokens)
+		return NULL;
+
+	return &c->tokens[pl->token];
+}
+
+static struct opensex_token *
+opensex_pipeline_read_word(struct database_handle *db, const char **word)
+{
+	struct opensex *rs = db->priv;
+	struct opensex_chunk *c;
+	struct opensex_token *t = opensex_pipeline_token(rs->pl, &c);
+
+	if (t == NULL)
+	{
+		*word = NULL;
+		return NULL;
+	}
+
+	c->base[t->end] = '\0';
+	*word = c->base + t->start;
+
+	rs->pl->token++;
+	db->token++;
+
+	return t;
+}
+
 static void
 opensex_db_parse(struct database_handle *db)
 {
+	struct opensex *rs = (struct opensex *)db->priv;
 	const char *cmd;
+
+	(void) opensex_pipeline_start(db);
+
 	while (db_read_next_row(db))
 	{
 		cmd = db_read_word(db);
 		if (!cmd || !*cmd || strchr("#\n\t \r", *cmd)) continue;
 		db_process(db, cmd);
 	}
+
+	opensex_pipeline_stop(rs);
 }
 
 static void
@@ -58,6 +505,9 @@ opensex_read_next_row(struct database_handle *hdl)
 	unsigned int n = 0;
 	struct opensex *rs = (struct opensex *)hdl->priv;
 
+	if (rs->pl != NULL)
+		return opensex_pipeline_next_row(hdl, rs->pl);
+
 	while ((c = getc(rs->f)) != EOF && c != '\n')
 	{
 		rs->buf[n++] = c;
@@ -93,6 +543,14 @@ opensex_read_word(struct database_handle *db)
 	char *res;
 	static char buf[BUFSIZE];
 
+	if (rs->pl != NULL)
+	{
+		const char *word;
+
+		(void) opensex_pipeline_read_word(db, &word);
+		return word;
+	}
+
 	res = rs->token;
 	if (res == NULL)
 		return NULL;
@@ -117,6 +575,15 @@ opensex_read_str(struct database_handle *db)
 	struct opensex *rs = (struct opensex *)db->priv;
 	char *res;
 
+	if (rs->pl != NULL)
+	{
+		struct opensex_chunk *c;
+		const struct opensex_token *t = opensex_pipeline_token(rs->pl, &c);
+
+		db->token++;
+		return (t != NULL) ? c->base + t->start : NULL;
+	}
+
 	res = rs->token;
 
 	db->token++;
@@ -126,9 +593,23 @@ opensex_read_str(struct database_handle *db)
 static bool
 opensex_read_int(struct database_handle *db, int *res)
 {
-	const char *s = db_read_word(db);
+	struct opensex *rs = (struct opensex *)db->priv;
+	const char *s;
 	char *rp;
 
+	if (rs->pl != NULL)
+	{
+		const struct opensex_token *t = opensex_pipeline_read_word(db, &s);
+
+		if (t != NULL && t->int_ok)
+		{
+			*res = t->int_val;
+			return true;
+		}
+	}
+	else
+		s = db_read_word(db);
+
 	if (!s) return false;
 
 	*res = strtol(s, &rp, 0);
@@ -138,9 +619,23 @@ opensex_read_int(struct database_handle *db, int *res)
 static bool
 opensex_read_uint(struct database_handle *db, unsigned int *res)
 {
-	const char *s = db_read_word(db);
+	struct opensex *rs = (struct opensex *)db->priv;
+	const char *s;
 	char *rp;
 
+	if (rs->pl != NULL)
+	{
+		const struct opensex_token *t = opensex_pipeline_read_word(db, &s);
+
+		if (t != NULL && t->uint_ok)
+		{
+			*res = t->uint_val;
+			return true;
+		}
+	}
+	else
+		s = db_read_word(db);
+
 	if (!s) return false;
 
 	*res = strtoul(s, &rp, 0);
@@ -150,9 +645,23 @@ opensex_read_uint(struct database_handle *db, unsigned int *res)
 static bool
 opensex_read_time(struct database_handle *db, time_t *res)
 {
-	const char *s = db_read_word(db);
+	struct opensex *rs = (struct opensex *)db->priv;
+	const char *s;
 	char *rp;
 
+	if (rs->pl != NULL)
+	{
+		const struct opensex_token *t = opensex_pipeline_read_word(db, &s);
+
+		if (t != NULL && t->uint_ok)
+		{
+			*res = t->uint_val;
+			return true;
+		}
+	}
+	else
+		s = db_read_word(db);
+
 	if (!s) return false;
 
 	*res = strtoul(s, &rp, 0);
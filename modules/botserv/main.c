@@ -378,9 +378,9 @@ botserv_channel_handler(struct sourceinfo *si, int parc, char *parv[])
 		/* fantasy commands are always verbose
 		 * (a little ugly but this way we can !set verbose)
 		 */
-		mc->flags |= MC_FORCEVERBOSE;
+		mychan_set_flags(mc, mc->flags | MC_FORCEVERBOSE);
 		command_exec_split(si->service, si, realcmd, newargs, sptr->commands);
-		mc->flags &= ~MC_FORCEVERBOSE;
+		mychan_set_flags(mc, mc->flags & ~MC_FORCEVERBOSE);
 	}
 	else if (!strncasecmp(cmd, si->service->me->nick, strlen(si->service->me->nick)) && (cmd = strtok(NULL, "")) != NULL)
 	{
@@ -408,9 +408,9 @@ botserv_channel_handler(struct sourceinfo *si, int parc, char *parv[])
 		/* fantasy commands are always verbose
 		 * (a little ugly but this way we can !set verbose)
 		 */
-		mc->flags |= MC_FORCEVERBOSE;
+		mychan_set_flags(mc, mc->flags | MC_FORCEVERBOSE);
 		command_exec_split(si->service, si, realcmd, newargs, sptr->commands);
-		mc->flags &= ~MC_FORCEVERBOSE;
+		mychan_set_flags(mc, mc->flags & ~MC_FORCEVERBOSE);
 	}
 }
 
@@ -283,6 +283,8 @@ write_chanfixdb(struct database_handle *db)
 
 	MOWGLI_PATRICIA_FOREACH(chan, &state, chanfix_channels)
 	{
+		struct metadata_iteration_state state2;
+		struct metadata *md;
 		mowgli_node_t *n;
 
 		db_start_row(db, "CFCHAN");
@@ -314,19 +316,13 @@ write_chanfixdb(struct database_handle *db)
 			db_commit_row(db);
 		}
 
-		if (atheme_object(chan)->metadata != NULL)
+		METADATA_FOREACH(md, &state2, chan)
 		{
-			mowgli_patricia_iteration_state_t state2;
-			struct metadata *md;
-
-			MOWGLI_PATRICIA_FOREACH(md, &state2, atheme_object(chan)->metadata)
-			{
-				db_start_row(db, "CFMD");
-				db_write_word(db, chan->name);
-				db_write_word(db, md->name);
-				db_write_str(db, md->value);
-				db_commit_row(db);
-			}
+			db_start_row(db, "CFMD");
+			db_write_word(db, chan->name);
+			db_write_word(db, md->name);
+			db_write_str(db, md->value);
+			db_commit_row(db);
 		}
 	}
 }
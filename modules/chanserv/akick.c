@@ -11,7 +11,7 @@
 
 struct akick_timeout
 {
-	time_t expiration;
+	struct timerwheel_entry entry;
 
 	struct myentity *entity;
 	struct mychan *chan;
@@ -21,12 +21,13 @@ struct akick_timeout
 	mowgli_node_t node;
 };
 
-static time_t akickdel_next;
+#define AKICK_TIMEOUT(e)        ((struct akick_timeout *) (void *) ((char *) (e) - offsetof(struct akick_timeout, entry)))
+
 static mowgli_list_t akickdel_list;
 
 static mowgli_heap_t *akick_timeout_heap = NULL;
+static struct timerwheel_handle *akick_timeout_handle = NULL;
 static mowgli_patricia_t *cs_akick_cmds = NULL;
-static mowgli_eventloop_timer_t *akick_timeout_check_timer = NULL;
 
 static void
 clear_bans_matching_entity(struct mychan *mc, struct myentity *mt)
@@ -103,92 +104,71 @@ cs_cmd_akick(struct sourceinfo *const restrict si, const int parc, char **const
 	(void) subcommand_dispatch_simple(chansvs.me, si, parc, parv, cs_akick_cmds, "AKICK");
 }
 
-static struct akick_timeout *
-akick_add_timeout(struct mychan *mc, struct myentity *mt, const char *host, time_t expireson)
+static void
+akick_timeout_free(struct akick_timeout *timeout)
 {
-	mowgli_node_t *n;
-	struct akick_timeout *timeout, *timeout2;
-
-	timeout = mowgli_heap_alloc(akick_timeout_heap);
-
-	timeout->entity = mt;
-	timeout->chan = mc;
-	timeout->expiration = expireson;
-
-	mowgli_strlcpy(timeout->host, host, sizeof timeout->host);
-
-	MOWGLI_ITER_FOREACH_PREV(n, akickdel_list.tail)
-	{
-		timeout2 = n->data;
-		if (timeout2->expiration <= timeout->expiration)
-			break;
-	}
-	if (n == NULL)
-		mowgli_node_add_head(timeout, &timeout->node, &akickdel_list);
-	else if (n->next == NULL)
-		mowgli_node_add(timeout, &timeout->node, &akickdel_list);
-	else
-		mowgli_node_add_before(timeout, &timeout->node, &akickdel_list, n->next);
-
-	return timeout;
+	timerwheel_cancel(&timeout->entry);
+	mowgli_node_delete(&timeout->node, &akickdel_list);
+	mowgli_heap_free(akick_timeout_heap, timeout);
 }
 
 static void
-akick_timeout_check(void *arg)
+akick_timeout_cancelled(struct timerwheel_entry *entry)
 {
-	mowgli_node_t *n, *tn;
-	struct akick_timeout *timeout;
-	struct chanacs *ca;
-	struct mychan *mc;
+	akick_timeout_free(AKICK_TIMEOUT(entry));
+}
 
+static void
+akick_timeout_expire(struct timerwheel_entry *entry)
+{
+	struct akick_timeout *timeout = AKICK_TIMEOUT(entry);
+	struct mychan *mc = timeout->chan;
+	struct chanacs *ca = NULL;
 	struct chanban *cb;
-	akickdel_next = 0;
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, akickdel_list.head)
+	if (timeout->entity == NULL)
 	{
-		timeout = n->data;
-		mc = timeout->chan;
-
-		if (timeout->expiration > CURRTIME)
+		if ((ca = chanacs_find_host_literal(mc, timeout->host, CA_AKICK)) && mc->chan != NULL && (cb = chanban_find(mc->chan, ca->host, 'b')))
 		{
-			akickdel_next = timeout->expiration;
-			akick_timeout_check_timer = mowgli_timer_add_once(base_eventloop, "akick_timeout_check", akick_timeout_check, NULL, akickdel_next - CURRTIME);
-			break;
+			modestack_mode_param(chansvs.nick, mc->chan, MTYPE_DEL, cb->type, cb->mask);
+			chanban_delete(cb);
 		}
-
-		ca = NULL;
-
-		if (timeout->entity == NULL)
+	}
+	else
+	{
+		ca = chanacs_find_literal(mc, timeout->entity, CA_AKICK);
+		if (ca == NULL)
 		{
-			if ((ca = chanacs_find_host_literal(mc, timeout->host, CA_AKICK)) && mc->chan != NULL && (cb = chanban_find(mc->chan, ca->host, 'b')))
-			{
-				modestack_mode_param(chansvs.nick, mc->chan, MTYPE_DEL, cb->type, cb->mask);
-				chanban_delete(cb);
-			}
+			akick_timeout_free(timeout);
+			return;
 		}
-		else
-		{
-			ca = chanacs_find_literal(mc, timeout->entity, CA_AKICK);
-			if (ca == NULL)
-			{
-				mowgli_node_delete(&timeout->node, &akickdel_list);
-				mowgli_heap_free(akick_timeout_heap, timeout);
 
-				continue;
-			}
+		clear_bans_matching_entity(mc, timeout->entity);
+	}
 
-			clear_bans_matching_entity(mc, timeout->entity);
-		}
+	if (ca)
+	{
+		chanacs_modify_simple(ca, 0, CA_AKICK, NULL);
+		chanacs_close(ca);
+	}
 
-		if (ca)
-		{
-			chanacs_modify_simple(ca, 0, CA_AKICK, NULL);
-			chanacs_close(ca);
-		}
+	akick_timeout_free(timeout);
+}
 
-		mowgli_node_delete(&timeout->node, &akickdel_list);
-		mowgli_heap_free(akick_timeout_heap, timeout);
-	}
+static void
+akick_add_timeout(struct mychan *mc, struct myentity *mt, const char *host, time_t expireson)
+{
+	struct akick_timeout *timeout;
+
+	timeout = mowgli_heap_alloc(akick_timeout_heap);
+
+	timeout->entity = mt;
+	timeout->chan = mc;
+
+	mowgli_strlcpy(timeout->host, host, sizeof timeout->host);
+
+	mowgli_node_add(timeout, &timeout->node, &akickdel_list);
+	timerwheel_schedule(akick_timeout_handle, &timeout->entry, expireson);
 }
 
 static void
@@ -363,7 +343,6 @@ cs_cmd_akick_add(struct sourceinfo *si, int parc, char *parv[])
 
 		if (duration > 0)
 		{
-			struct akick_timeout *timeout;
 			time_t expireson = ca2->tmodified+duration;
 
 			snprintf(expiry, sizeof expiry, "%ld", expireson);
@@ -373,16 +352,7 @@ cs_cmd_akick_add(struct sourceinfo *si, int parc, char *parv[])
 			logcommand(si, CMDLOG_SET, "AKICK:ADD: \2%s\2 on \2%s\2, expires in %s.", uname, mc->name,timediff(duration));
 			command_success_nodata(si, _("AKICK on \2%s\2 was successfully added for \2%s\2 and will expire in %s."), uname, mc->name,timediff(duration) );
 
-			timeout = akick_add_timeout(mc, NULL, uname, expireson);
-
-			if (akickdel_next == 0 || akickdel_next > timeout->expiration)
-			{
-				if (akickdel_next != 0)
-					mowgli_timer_destroy(base_eventloop, akick_timeout_check_timer);
-
-				akickdel_next = timeout->expiration;
-				akick_timeout_check_timer = mowgli_timer_add_once(base_eventloop, "akick_timeout_check", akick_timeout_check, NULL, akickdel_next - CURRTIME);
-			}
+			akick_add_timeout(mc, NULL, uname, expireson);
 		}
 		else
 		{
@@ -429,7 +399,6 @@ cs_cmd_akick_add(struct sourceinfo *si, int parc, char *parv[])
 
 		if (duration > 0)
 		{
-			struct akick_timeout *timeout;
 			time_t expireson = ca2->tmodified+duration;
 
 			snprintf(expiry, sizeof expiry, "%ld", expireson);
@@ -439,16 +408,7 @@ cs_cmd_akick_add(struct sourceinfo *si, int parc, char *parv[])
 			verbose(mc, "\2%s\2 added \2%s\2 to the AKICK list, expires in %s.", get_source_name(si), mt->name, timediff(duration));
 			logcommand(si, CMDLOG_SET, "AKICK:ADD: \2%s\2 on \2%s\2, expires in %s", mt->name, mc->name, timediff(duration));
 
-			timeout = akick_add_timeout(mc, mt, mt->name, expireson);
-
-			if (akickdel_next == 0 || akickdel_next > timeout->expiration)
-			{
-				if (akickdel_next != 0)
-					mowgli_timer_destroy(base_eventloop, akick_timeout_check_timer);
-
-				akickdel_next = timeout->expiration;
-				akick_timeout_check_timer = mowgli_timer_add_once(base_eventloop, "akick_timeout_check", akick_timeout_check, NULL, akickdel_next - CURRTIME);
-			}
+			akick_add_timeout(mc, mt, mt->name, expireson);
 		}
 		else
 		{
@@ -537,10 +497,7 @@ cs_cmd_akick_del(struct sourceinfo *si, int parc, char *parv[])
 		{
 			timeout = n->data;
 			if (!match(timeout->host, uname) && timeout->chan == mc)
-			{
-				mowgli_node_delete(&timeout->node, &akickdel_list);
-				mowgli_heap_free(akick_timeout_heap, timeout);
-			}
+				akick_timeout_free(timeout);
 		}
 
 		if (mc->chan != NULL && (cb = chanban_find(mc->chan, uname, 'b')))
@@ -564,10 +521,7 @@ cs_cmd_akick_del(struct sourceinfo *si, int parc, char *parv[])
 	{
 		timeout = n->data;
 		if (timeout->entity == mt && timeout->chan == mc)
-		{
-			mowgli_node_delete(&timeout->node, &akickdel_list);
-			mowgli_heap_free(akick_timeout_heap, timeout);
-		}
+			akick_timeout_free(timeout);
 	}
 
 	req.ca = ca;
@@ -766,7 +720,7 @@ chanuser_sync(struct hook_chanuser_sync *hdata)
 		// Stay on channel if this would empty it -- jilles
 		if (chan->nummembers - chan->numsvcmembers == 1)
 		{
-			mc->flags |= MC_INHABIT;
+			mychan_set_flags(mc, mc->flags | MC_INHABIT);
 			if (chan->numsvcmembers == 0)
 				join(chan->name, chansvs.nick);
 		}
@@ -879,6 +833,8 @@ mod_init(struct module *const restrict m)
 		return;
 	}
 
+	akick_timeout_handle = timerwheel_handle_create("chanserv/akick", &akick_timeout_expire);
+
 	(void) command_add(&cs_akick_add, cs_akick_cmds);
 	(void) command_add(&cs_akick_del, cs_akick_cmds);
 	(void) command_add(&cs_akick_list, cs_akick_cmds);
@@ -893,8 +849,7 @@ mod_init(struct module *const restrict m)
 static void
 mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 {
-	if (akick_timeout_check_timer)
-		(void) mowgli_timer_destroy(base_eventloop, akick_timeout_check_timer);
+	(void) timerwheel_handle_destroy(akick_timeout_handle, &akick_timeout_cancelled);
 
 	(void) hook_del_chanuser_sync(&chanuser_sync);
 
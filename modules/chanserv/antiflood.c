@@ -33,97 +33,149 @@ struct antiflood_enforce_method_impl
 	void (*unenforce)(struct channel *);
 };
 
-struct flood_message_queue
+/* Each channel remembers its last ANTIFLOOD_MSG_COUNT messages in a ring.
+ * Messages are kept only as hashes, so tracking a channel costs the same
+ * small fixed amount of memory however long its messages are, and nothing
+ * is allocated per message.
+ */
+#define ANTIFLOOD_MSG_COUNT             10U
+#define ANTIFLOOD_MSG_TIME              SECONDS_PER_MINUTE
+
+// Two messages count as the same if their simhashes differ in at most this many bits
+#define ANTIFLOOD_SIMHASH_DISTANCE      8U
+
+#define ANTIFLOOD_PRIVDATA_KEY          "chanserv:antiflood"
+
+struct flood_message
 {
-	char *name;
-	size_t max;
-	time_t last_used;
-	mowgli_list_t entries;
+	uint64_t        source;         // hash of the sender's UID or nickname
+	uint64_t        hash;           // hash of the message, ignoring case
+	uint64_t        simhash;        // only if antiflood_near_duplicates
+	time_t          time;
 };
 
-struct flood_message
+struct flood_message_queue
 {
-	stringref source;
-	char *message;
-	time_t time;
-	mowgli_node_t node;
+	struct mychan *         mc;
+	mowgli_node_t           node;   // in mqueue_list
+	time_t                  last_used;
+	unsigned int            head;   // next slot to write
+	unsigned int            count;
+	struct flood_message    entries[ANTIFLOOD_MSG_COUNT];
 };
 
 static struct chanban *(*place_quietmask)(struct channel *, int, const char *) = NULL;
 
 static enum antiflood_enforce_method antiflood_enforce_method = ANTIFLOOD_ENFORCE_QUIET;
+static bool antiflood_near_duplicates = false;
+
+static struct slab_type *mqueue_heap = NULL;
 
-static mowgli_heap_t *msg_heap = NULL;
-static mowgli_heap_t *mqueue_heap = NULL;
-static mowgli_patricia_t *mqueue_trie = NULL;
+// Every channel that has a queue, the least recently used first
+static mowgli_list_t mqueue_list = { NULL, NULL, 0 };
 static mowgli_patricia_t **cs_set_cmdtree = NULL;
 static mowgli_eventloop_timer_t *mqueue_gc_timer = NULL;
 static mowgli_eventloop_timer_t *antiflood_unenforce_timer = NULL;
 
-static time_t antiflood_msg_time = SECONDS_PER_MINUTE;
-static size_t antiflood_msg_count = 10;
-
-static void
-msg_destroy(struct flood_message *mesg, struct flood_message_queue *mq)
+// FNV-1a over the case-folded string
+static uint64_t
+antiflood_hash(const char *str)
 {
-	sfree(mesg->message);
-	strshare_unref(mesg->source);
-	mowgli_node_delete(&mesg->node, &mq->entries);
+	uint64_t hash = UINT64_C(0xCBF29CE484222325);
+
+	for (; *str != '\0'; str++)
+	{
+		hash ^= ToLowerTab[(unsigned char) *str];
+		hash *= UINT64_C(0x100000001B3);
+	}
 
-	mowgli_heap_free(msg_heap, mesg);
+	return hash;
 }
 
-static struct flood_message *
-msg_create(struct flood_message_queue *mq, struct user *u, const char *message)
+/* Charikar's simhash over overlapping three-byte shingles, so that messages
+ * which differ only by a few characters (a counter, some punctuation) hash
+ * to values only a few bits apart.
+ */
+static uint64_t
+antiflood_simhash(const char *str)
 {
-	struct flood_message *mesg;
-
-	mesg = mowgli_heap_alloc(msg_heap);
-	mesg->message = sstrdup(message);
-	mesg->time = CURRTIME;
-	mesg->source = u->uid != NULL ? strshare_ref(u->uid) : strshare_ref(u->nick);
+	int weights[64] = { 0 };
+	uint64_t simhash = 0;
+	uint32_t shingle = 0;
+	size_t len = 0;
 
-	if (MOWGLI_LIST_LENGTH(&mq->entries) > mq->max)
+	for (; *str != '\0'; str++)
 	{
-		struct flood_message *head_mesg = mq->entries.head->data;
-		msg_destroy(head_mesg, mq);
+		shingle = ((shingle << 8) | ToLowerTab[(unsigned char) *str]) & 0xFFFFFFU;
+
+		if (++len < 3)
+			continue;
+
+		// splitmix64 finalizer to spread the shingle over all 64 bits
+		uint64_t h = shingle + UINT64_C(0x9E3779B97F4A7C15);
+		h = (h ^ (h >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+		h = (h ^ (h >> 27)) * UINT64_C(0x94D049BB133111EB);
+		h ^= h >> 31;
+
+		for (unsigned int i = 0; i < 64; i++)
+			weights[i] += ((h >> i) & 1U) ? 1 : -1;
 	}
 
-	mowgli_node_add(mesg, &mesg->node, &mq->entries);
-	mq->last_used = CURRTIME;
+	if (len < 3)
+		return antiflood_hash(str - len);
 
-	return mesg;
+	for (unsigned int i = 0; i < 64; i++)
+		if (weights[i] > 0)
+			simhash |= (UINT64_C(1) << i);
+
+	return simhash;
 }
 
-static struct flood_message_queue *
-mqueue_create(const char *name)
+static unsigned int
+antiflood_popcount(uint64_t x)
 {
-	struct flood_message_queue *mq;
+	unsigned int n = 0;
 
-	mq = mowgli_heap_alloc(mqueue_heap);
-	mq->name = sstrdup(name);
-	mq->last_used = CURRTIME;
-	mq->max = antiflood_msg_count;
+	for (; x != 0; x &= x - 1)
+		n++;
 
-	mowgli_patricia_add(mqueue_trie, mq->name, mq);
+	return n;
+}
 
-	return mq;
+static inline bool
+msg_matches(const struct flood_message *a, const struct flood_message *b)
+{
+	if (a->hash == b->hash)
+		return true;
+
+	return antiflood_near_duplicates && antiflood_popcount(a->simhash ^ b->simhash) <= ANTIFLOOD_SIMHASH_DISTANCE;
+}
+
+// entries are indexed from the oldest (0) to the newest (count - 1)
+static inline const struct flood_message *
+mqueue_entry(const struct flood_message_queue *mq, unsigned int i)
+{
+	return &mq->entries[(mq->head + ANTIFLOOD_MSG_COUNT - mq->count + i) % ANTIFLOOD_MSG_COUNT];
 }
 
 static void
-mqueue_free(struct flood_message_queue *mq)
+msg_create(struct flood_message_queue *mq, struct user *u, const char *message)
 {
-	mowgli_node_t *n, *tn;
+	struct flood_message *const mesg = &mq->entries[mq->head];
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, mq->entries.head)
-	{
-		struct flood_message *mesg = n->data;
+	mesg->source = antiflood_hash(u->uid != NULL ? u->uid : u->nick);
+	mesg->hash = antiflood_hash(message);
+	mesg->simhash = antiflood_near_duplicates ? antiflood_simhash(message) : 0;
+	mesg->time = CURRTIME;
 
-		msg_destroy(mesg, mq);
-	}
+	mq->head = (mq->head + 1U) % ANTIFLOOD_MSG_COUNT;
+	if (mq->count < ANTIFLOOD_MSG_COUNT)
+		mq->count++;
+
+	mq->last_used = CURRTIME;
 
-	sfree(mq->name);
-	mowgli_heap_free(mqueue_heap, mq);
+	mowgli_node_delete(&mq->node, &mqueue_list);
+	mowgli_node_add(mq, &mq->node, &mqueue_list);
 }
 
 static struct flood_message_queue *
@@ -131,88 +183,87 @@ mqueue_get(struct mychan *mc)
 {
 	struct flood_message_queue *mq;
 
-	mq = mowgli_patricia_retrieve(mqueue_trie, mc->name);
+	mq = privatedata_get(mc, ANTIFLOOD_PRIVDATA_KEY);
 	if (mq == NULL)
-		mq = mqueue_create(mc->name);
+	{
+		mq = slab_alloc(mqueue_heap);
+		mq->mc = mc;
+		mq->last_used = CURRTIME;
+
+		privatedata_set(mc, ANTIFLOOD_PRIVDATA_KEY, mq);
+		mowgli_node_add(mq, &mq->node, &mqueue_list);
+	}
 
 	return mq;
 }
 
 static void
-mqueue_destroy(struct flood_message_queue *mq)
+mqueue_destroy(struct mychan *mc)
 {
-	mowgli_patricia_delete(mqueue_trie, mq->name);
-
-	mqueue_free(mq);
-}
+	struct flood_message_queue *mq;
 
-static void
-mqueue_trie_destroy_cb(const char *key, void *data, void *privdata)
-{
-	struct flood_message_queue *mq = data;
+	mq = privatedata_delete(mc, ANTIFLOOD_PRIVDATA_KEY);
+	if (mq == NULL)
+		return;
 
-	mqueue_free(mq);
+	mowgli_node_delete(&mq->node, &mqueue_list);
+	slab_free(mqueue_heap, mq);
 }
 
 static void
 mqueue_gc(void *unused)
 {
-	mowgli_patricia_iteration_state_t iter;
-	struct flood_message_queue *mq;
-
-	MOWGLI_PATRICIA_FOREACH(mq, &iter, mqueue_trie)
+	// the list is in order of last use, so stop at the first queue still in use
+	while (mqueue_list.head != NULL)
 	{
-		if ((mq->last_used + SECONDS_PER_HOUR) < CURRTIME)
-			mqueue_destroy(mq);
+		struct flood_message_queue *const mq = mqueue_list.head->data;
+
+		if ((mq->last_used + SECONDS_PER_HOUR) >= CURRTIME)
+			break;
+
+		mqueue_destroy(mq->mc);
 	}
 }
 
 static enum mqueue_enforce_strategy
 mqueue_should_enforce(struct flood_message_queue *mq)
 {
-	struct flood_message *oldest, *newest;
-	time_t age_delta;
+	const struct flood_message *oldest, *newest;
+	unsigned int msg_matches_count = 0, usr_matches = 0;
+	time_t usr_first_seen = 0;
 
-	if (MOWGLI_LIST_LENGTH(&mq->entries) < mq->max)
+	if (mq->count < ANTIFLOOD_MSG_COUNT)
 		return MQ_ENFORCE_NONE;
 
-	oldest = mq->entries.head->data;
-	newest = mq->entries.tail->data;
+	oldest = mqueue_entry(mq, 0);
+	newest = mqueue_entry(mq, mq->count - 1U);
 
-	if (oldest == NULL || newest == NULL || oldest == newest)
+	if ((newest->time - oldest->time) > ANTIFLOOD_MSG_TIME)
 		return MQ_ENFORCE_NONE;
 
-	age_delta = newest->time - oldest->time;
-
-	if (age_delta <= antiflood_msg_time)
+	// the sliding window is the ring itself; count within it per message and per source
+	for (unsigned int i = 0; i < mq->count; i++)
 	{
-		mowgli_node_t *n;
-		size_t msg_matches = 0, usr_matches = 0;
-		time_t usr_first_seen = 0;
+		const struct flood_message *const mesg = mqueue_entry(mq, i);
 
-		MOWGLI_ITER_FOREACH(n, mq->entries.head)
-		{
-			struct flood_message *mesg = n->data;
+		if (msg_matches(mesg, newest))
+			msg_matches_count++;
 
-			if (!strcasecmp(mesg->message, newest->message))
-				msg_matches++;
-
-			if (mesg->source == newest->source)
-			{
-				usr_matches++;
+		if (mesg->source == newest->source)
+		{
+			usr_matches++;
 
-				if (!usr_first_seen)
-					usr_first_seen = mesg->time;
-			}
+			if (!usr_first_seen)
+				usr_first_seen = mesg->time;
 		}
+	}
 
-		if (msg_matches > (antiflood_msg_count / 2))
-			return MQ_ENFORCE_MSG;
+	if (msg_matches_count > (ANTIFLOOD_MSG_COUNT / 2))
+		return MQ_ENFORCE_MSG;
 
-		if (usr_matches > (antiflood_msg_count / 2) &&
-			((newest->time - usr_first_seen) < antiflood_msg_time / 4))
-			return MQ_ENFORCE_LINE;
-	}
+	if (usr_matches > (ANTIFLOOD_MSG_COUNT / 2) &&
+		((newest->time - usr_first_seen) < ANTIFLOOD_MSG_TIME / 4))
+		return MQ_ENFORCE_LINE;
 
 	return MQ_ENFORCE_NONE;
 }
@@ -374,12 +425,7 @@ on_channel_message(struct hook_channel_message *data)
 static void
 on_channel_drop(struct mychan *mc)
 {
-	struct flood_message_queue *mq;
-
-	mq = mqueue_get(mc);
-	return_if_fail(mq != NULL);
-
-	mqueue_destroy(mq);
+	mqueue_destroy(mc);
 }
 
 static void
@@ -409,7 +455,7 @@ cs_set_cmd_antiflood(struct sourceinfo *si, int parc, char *parv[])
 
 	if (!strcasecmp(parv[1], "OFF"))
 	{
-		mc->flags &= ~MC_ANTIFLOOD;
+		mychan_set_flags(mc, mc->flags & ~MC_ANTIFLOOD);
 		metadata_delete(mc, METADATA_KEY_ENFORCE_METHOD);
 
 		logcommand(si, CMDLOG_SET, "ANTIFLOOD:NONE: \2%s\2",  mc->name);
@@ -423,7 +469,7 @@ cs_set_cmd_antiflood(struct sourceinfo *si, int parc, char *parv[])
 			command_fail(si, fault_nochange, _("The \2%s\2 flag is already set for channel \2%s\2."), "ANTIFLOOD", mc->name);
 			return;
 		}
-		mc->flags |= MC_ANTIFLOOD;
+		mychan_set_flags(mc, mc->flags | MC_ANTIFLOOD);
 		metadata_delete(mc, METADATA_KEY_ENFORCE_METHOD);
 
 		logcommand(si, CMDLOG_SET, "ANTIFLOOD: %s (%s)",  mc->name, "DEFAULT");
@@ -432,7 +478,7 @@ cs_set_cmd_antiflood(struct sourceinfo *si, int parc, char *parv[])
 	}
 	else if (!strcasecmp(parv[1], "QUIET"))
 	{
-		mc->flags |= MC_ANTIFLOOD;
+		mychan_set_flags(mc, mc->flags | MC_ANTIFLOOD);
 		metadata_add(mc, METADATA_KEY_ENFORCE_METHOD, "QUIET");
 
 		logcommand(si, CMDLOG_SET, "ANTIFLOOD: %s (%s)",  mc->name, "QUIET");
@@ -441,7 +487,7 @@ cs_set_cmd_antiflood(struct sourceinfo *si, int parc, char *parv[])
 	}
 	else if (!strcasecmp(parv[1], "KICKBAN"))
 	{
-		mc->flags |= MC_ANTIFLOOD;
+		mychan_set_flags(mc, mc->flags | MC_ANTIFLOOD);
 		metadata_add(mc, METADATA_KEY_ENFORCE_METHOD, "KICKBAN");
 
 		logcommand(si, CMDLOG_SET, "ANTIFLOOD: %s (%s)",  mc->name, "KICKBAN");
@@ -452,7 +498,7 @@ cs_set_cmd_antiflood(struct sourceinfo *si, int parc, char *parv[])
 	{
 		if (has_priv(si, PRIV_AKILL))
 		{
-			mc->flags |= MC_ANTIFLOOD;
+			mychan_set_flags(mc, mc->flags | MC_ANTIFLOOD);
 			metadata_add(mc, METADATA_KEY_ENFORCE_METHOD, "AKILL");
 
 			logcommand(si, CMDLOG_SET, "ANTIFLOOD: %s (%s)",  mc->name, "AKILL");
@@ -513,10 +559,7 @@ mod_init(struct module *m)
 	hook_add_channel_message(on_channel_message);
 	hook_add_channel_drop(on_channel_drop);
 
-	msg_heap = sharedheap_get(sizeof(struct flood_message));
-
-	mqueue_heap = sharedheap_get(sizeof(struct flood_message_queue));
-	mqueue_trie = mowgli_patricia_create(irccasecanon);
+	mqueue_heap = slab_type_create("chanserv/antiflood:queue", sizeof(struct flood_message_queue));
 	mqueue_gc_timer = mowgli_timer_add(base_eventloop, "mqueue_gc", mqueue_gc, NULL, 5 * SECONDS_PER_MINUTE);
 
 	antiflood_unenforce_timer = mowgli_timer_add(base_eventloop, "antiflood_unenforce", antiflood_unenforce_timer_cb, NULL, SECONDS_PER_HOUR);
@@ -524,6 +567,7 @@ mod_init(struct module *m)
 	command_add(&cs_set_antiflood, *cs_set_cmdtree);
 
 	add_conf_item("ANTIFLOOD_ENFORCE_METHOD", &chansvs.me->conf_table, c_ci_antiflood_enforce_method);
+	add_bool_conf_item("ANTIFLOOD_NEAR_DUPLICATES", &chansvs.me->conf_table, 0, &antiflood_near_duplicates, false);
 }
 
 static void
@@ -534,11 +578,18 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 	hook_del_channel_message(on_channel_message);
 	hook_del_channel_drop(on_channel_drop);
 
-	mowgli_patricia_destroy(mqueue_trie, mqueue_trie_destroy_cb, NULL);
+	while (mqueue_list.head != NULL)
+	{
+		struct flood_message_queue *const mq = mqueue_list.head->data;
+
+		mqueue_destroy(mq->mc);
+	}
+
 	mowgli_timer_destroy(base_eventloop, mqueue_gc_timer);
 	mowgli_timer_destroy(base_eventloop, antiflood_unenforce_timer);
 
 	del_conf_item("ANTIFLOOD_ENFORCE_METHOD", &chansvs.me->conf_table);
+	del_conf_item("ANTIFLOOD_NEAR_DUPLICATES", &chansvs.me->conf_table);
 }
 
 SIMPLE_DECLARE_MODULE_V1("chanserv/antiflood", MODULE_UNLOAD_CAPABILITY_OK)
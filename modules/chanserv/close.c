@@ -28,7 +28,7 @@ close_check_join(struct hook_channel_joinpart *data)
 			join(cu->chan->name, chansvs.nick);
 
 		// stay for a bit to stop rejoin floods
-		mc->flags |= MC_INHABIT;
+		mychan_set_flags(mc, mc->flags | MC_INHABIT);
 
 		// lock it down
 		channel_mode_va(chansvs.me->me, cu->chan, 3, "+isbl", "*!*@*", "1");
@@ -95,7 +95,7 @@ cs_cmd_close(struct sourceinfo *si, int parc, char *parv[])
 				join(target, chansvs.nick);
 
 			// stay for a bit to stop rejoin floods
-			mc->flags |= MC_INHABIT;
+			mychan_set_flags(mc, mc->flags | MC_INHABIT);
 
 			// lock it down
 			channel_mode_va(chansvs.me->me, c, 3, "+isbl", "*!*@*", "1");
@@ -125,7 +125,7 @@ cs_cmd_close(struct sourceinfo *si, int parc, char *parv[])
 		metadata_delete(mc, "private:close:closer");
 		metadata_delete(mc, "private:close:reason");
 		metadata_delete(mc, "private:close:timestamp");
-		mc->flags &= ~MC_INHABIT;
+		mychan_set_flags(mc, mc->flags & ~MC_INHABIT);
 		c = channel_find(target);
 		if (c != NULL)
 			if (chanuser_find(c, user_find_named(chansvs.nick)))
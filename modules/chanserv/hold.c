@@ -43,7 +43,7 @@ cs_cmd_hold(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mc->flags |= MC_HOLD;
+		mychan_set_flags(mc, mc->flags | MC_HOLD);
 
 		wallops("\2%s\2 set the HOLD option for the channel \2%s\2.", get_oper_name(si), target);
 		logcommand(si, CMDLOG_ADMIN, "HOLD:ON: \2%s\2", mc->name);
@@ -57,7 +57,7 @@ cs_cmd_hold(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mc->flags &= ~MC_HOLD;
+		mychan_set_flags(mc, mc->flags & ~MC_HOLD);
 
 		wallops("\2%s\2 removed the HOLD option on the channel \2%s\2.", get_oper_name(si), target);
 		logcommand(si, CMDLOG_ADMIN, "HOLD:OFF: \2%s\2", mc->name);
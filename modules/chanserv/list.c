@@ -14,6 +14,7 @@ enum list_opttype
 {
 	OPT_BOOL,
 	OPT_INT,
+	OPT_UINT,
 	OPT_STRING,
 	OPT_FLAG,
 	OPT_AGE,
@@ -26,6 +27,7 @@ struct list_option
 	union {
 		bool *boolval;
 		int *intval;
+		unsigned int *uintval;
 		const char **strval;
 		unsigned int *flagval;
 		time_t *ageval;
@@ -56,8 +58,8 @@ parse_age(const char *s)
 	return duration;
 }
 
-static void
-process_parvarray(const struct list_option *opts, size_t optsize, int parc, char *parv[])
+static bool
+process_parvarray(struct sourceinfo *si, const struct list_option *opts, size_t optsize, int parc, char *parv[])
 {
 	int i;
 	size_t j;
@@ -80,6 +82,19 @@ process_parvarray(const struct list_option *opts, size_t optsize, int parc, char
 						i++;
 					}
 					break;
+				case OPT_UINT:
+					if (i + 1 >= parc)
+					{
+						command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
+						return false;
+					}
+					if (!string_to_uint(parv[i + 1], opts[j].optval.uintval))
+					{
+						command_fail(si, fault_badparams, STR_INVALID_PARAMS, parv[i]);
+						return false;
+					}
+					i++;
+					break;
 				case OPT_STRING:
 					if (i + 1 < parc)
 					{
@@ -101,6 +116,8 @@ process_parvarray(const struct list_option *opts, size_t optsize, int parc, char
 			}
 		}
 	}
+
+	return true;
 }
 
 static void
@@ -149,207 +166,300 @@ check_extmlock(const struct metadata *md, const bool *modes, bool on)
 	return true;
 }
 
+// A parsed LIST query
+struct list_query
+{
+	const char *chanpattern;
+	const char *markpattern;
+	const char *closedpattern;
+	unsigned int flagset;
+	int aclsize;
+	time_t age;
+	time_t lastused;
+	bool closed;
+	bool marked;
+
+	unsigned int mlock_on;
+	unsigned int mlock_off;
+	bool mlock_key;
+	bool mlock_limit;
+	bool *extmlock_on;
+	bool *extmlock_off;
+};
+
 static void
-cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
+parse_mlock(struct list_query *q, const char *mlock)
 {
-	const char *chanpattern = NULL, *markpattern = NULL, *closedpattern = NULL, *mlock = NULL;
-	unsigned int flagset = 0;
-	int aclsize = 0;
-	time_t age = 0, lastused = 0;
-	bool closed = false, marked = false;
-	struct list_option optstable[] = {
-		{"pattern",      OPT_STRING,    {.strval = &chanpattern}, 0},
-		{"mark-reason",  OPT_STRING,    {.strval = &markpattern}, 0},
-		{"close-reason", OPT_STRING,    {.strval = &closedpattern}, 0},
-		{"noexpire",     OPT_FLAG,      {.flagval = &flagset}, MC_HOLD},
-		{"held",         OPT_FLAG,      {.flagval = &flagset}, MC_HOLD},
-		{"hold",         OPT_FLAG,      {.flagval = &flagset}, MC_HOLD},
-		{"noop",         OPT_FLAG,      {.flagval = &flagset}, MC_NOOP},
-		{"limitflags",   OPT_FLAG,      {.flagval = &flagset}, MC_LIMITFLAGS},
-		{"secure",       OPT_FLAG,      {.flagval = &flagset}, MC_SECURE},
-		{"nosync",       OPT_FLAG,      {.flagval = &flagset}, MC_NOSYNC},
-		{"verbose",      OPT_FLAG,      {.flagval = &flagset}, MC_VERBOSE},
-		{"restricted",   OPT_FLAG,      {.flagval = &flagset}, MC_RESTRICTED},
-		{"keeptopic",    OPT_FLAG,      {.flagval = &flagset}, MC_KEEPTOPIC},
-		{"verbose-ops",  OPT_FLAG,      {.flagval = &flagset}, MC_VERBOSE_OPS},
-		{"topiclock",    OPT_FLAG,      {.flagval = &flagset}, MC_TOPICLOCK},
-		{"guard",        OPT_FLAG,      {.flagval = &flagset}, MC_GUARD},
-		{"private",      OPT_FLAG,      {.flagval = &flagset}, MC_PRIVATE},
-		{"pubacl",       OPT_FLAG,      {.flagval = &flagset}, MC_PUBACL},
-		{"mlock",        OPT_STRING,    {.strval = &mlock}, 0},
-		{"closed",       OPT_BOOL,      {.boolval = &closed}, 0},
-		{"marked",       OPT_BOOL,      {.boolval = &marked}, 0},
-		{"aclsize",      OPT_INT,       {.intval = &aclsize}, 0},
-		{"registered",   OPT_AGE,       {.ageval = &age}, 0},
-		{"lastused",     OPT_AGE,       {.ageval = &lastused}, 0},
-	};
+	int dir = MTYPE_NUL;
 
-	// This isn't a channel-specific command. Exclude it from fantasy;
-	// this also allows bots to react to it without us interfering,
-	// cf chanserv/register for precedent
-	if (si->c != NULL)
-		return;
+	for (const char *c = mlock; *c; c++)
+	{
+		int flag;
+		switch (*c)
+		{
+			case '+':
+				dir = MTYPE_ADD;
+				break;
+
+			case '-':
+				dir = MTYPE_DEL;
+				break;
+
+			case 'l':
+				if (dir == MTYPE_DEL)
+					q->mlock_off |= CMODE_LIMIT;
+				else
+					q->mlock_limit = true;
+				break;
+
+			case 'k':
+				if (dir == MTYPE_DEL)
+					q->mlock_off |= CMODE_KEY;
+				else
+					q->mlock_key = true;
+				break;
+
+			default:
+				flag = mode_to_flag(*c);
+				if (flag)
+				{
+					if (dir == MTYPE_DEL)
+						q->mlock_off |= flag;
+					else
+						q->mlock_on |= flag;
+				}
+				else
+				{
+					size_t i;
+					for (i = 0; ignore_mode_list[i].mode != '\0'; i++)
+					{
+						if (*c == ignore_mode_list[i].mode)
+							break;
+					}
 
-	process_parvarray(optstable, ARRAY_SIZE(optstable), parc, parv);
+					if (ignore_mode_list[i].mode == '\0')
+						continue;
 
-	char criteriastr[BUFSIZE];
-	build_criteriastr(criteriastr, parc, parv);
+					if (dir == MTYPE_DEL)
+						q->extmlock_off[i] = true;
+					else
+						q->extmlock_on[i] = true;
+				}
+				break;
+		}
+	}
+}
 
-	unsigned int mlock_on = 0, mlock_off = 0;
-	bool mlock_key = false, mlock_limit = false;
-	bool extmlock_on[ignore_mode_list_size];
-	bool extmlock_off[ignore_mode_list_size];
-	memset(extmlock_on, 0, sizeof extmlock_on);
-	memset(extmlock_off, 0, sizeof extmlock_off);
+static bool
+cs_list_match(const struct list_query *q, struct mychan *mc)
+{
+	if (q->chanpattern != NULL && match(q->chanpattern, mc->name))
+		return false;
 
-	if (mlock)
+	if (q->markpattern)
 	{
-		int dir = MTYPE_NUL;
+		const struct metadata *md = metadata_find(mc, "private:mark:reason");
+		if (md == NULL || match(q->markpattern, md->value) != 0)
+			return false;
+	}
 
-		for (const char *c = mlock; *c; c++)
-		{
-			int flag;
-			switch (*c)
-			{
-				case '+':
-					dir = MTYPE_ADD;
-					break;
+	if (q->closedpattern)
+	{
+		const struct metadata *md = metadata_find(mc, "private:close:reason");
+		if (md == NULL || match(q->closedpattern, md->value) != 0)
+			return false;
+	}
 
-				case '-':
-					dir = MTYPE_DEL;
-					break;
+	if (q->marked && !metadata_find(mc, "private:mark:setter"))
+		return false;
 
-				case 'l':
-					if (dir == MTYPE_DEL)
-						mlock_off |= CMODE_LIMIT;
-					else
-						mlock_limit = true;
-					break;
+	if (q->closed && !metadata_find(mc, "private:close:closer"))
+		return false;
 
-				case 'k':
-					if (dir == MTYPE_DEL)
-						mlock_off |= CMODE_KEY;
-					else
-						mlock_key = true;
-					break;
+	if (q->flagset && (mc->flags & q->flagset) != q->flagset)
+		return false;
 
-				default:
-					flag = mode_to_flag(*c);
-					if (flag)
-					{
-						if (dir == MTYPE_DEL)
-							mlock_off |= flag;
-						else
-							mlock_on |= flag;
-					}
-					else
-					{
-						size_t i;
-						for (i = 0; ignore_mode_list[i].mode != '\0'; i++)
-						{
-							if (*c == ignore_mode_list[i].mode)
-								break;
-						}
-
-						if (ignore_mode_list[i].mode == '\0')
-							continue;
-
-						if (dir == MTYPE_DEL)
-							extmlock_off[i] = true;
-						else
-							extmlock_on[i] = true;
-					}
-					break;
-			}
-		}
-	}
+	if (q->aclsize && MOWGLI_LIST_LENGTH(&mc->chanacs) < (unsigned int)q->aclsize)
+		return false;
 
-	command_success_nodata(si, _("Channels matching \2%s\2:"), criteriastr);
+	if (q->age && (CURRTIME - mc->registered) < q->age)
+		return false;
 
-	unsigned int matches = 0;
+	if (q->lastused && (CURRTIME - mc->used) < q->lastused)
+		return false;
 
-	struct mychan *mc;
-	mowgli_patricia_iteration_state_t state;
+	if ((q->mlock_on & mc->mlock_on) != q->mlock_on)
+		return false;
 
-	MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
-	{
-		if (chanpattern != NULL && match(chanpattern, mc->name))
-			continue;
+	if ((q->mlock_off & mc->mlock_off) != q->mlock_off)
+		return false;
 
-		if (markpattern)
-		{
-			const struct metadata *md = metadata_find(mc, "private:mark:reason");
-			if (md == NULL || match(markpattern, md->value) != 0)
-				continue;
-		}
+	if (q->mlock_key && !mc->mlock_key)
+		return false;
 
-		if (closedpattern)
-		{
-			const struct metadata *md = metadata_find(mc, "private:close:reason");
-			if (md == NULL || match(closedpattern, md->value) != 0)
-				continue;
-		}
+	if (q->mlock_limit && !mc->mlock_limit)
+		return false;
 
-		if (marked && !metadata_find(mc, "private:mark:setter"))
-			continue;
+	const struct metadata *extmlock_md = metadata_find(mc, "private:mlockext");
 
-		if (closed && !metadata_find(mc, "private:close:closer"))
-			continue;
+	if (!check_extmlock(extmlock_md, q->extmlock_on, true))
+		return false;
 
-		if (flagset && (mc->flags & flagset) != flagset)
-			continue;
+	if (!check_extmlock(extmlock_md, q->extmlock_off, false))
+		return false;
 
-		if (aclsize && MOWGLI_LIST_LENGTH(&mc->chanacs) < (unsigned int)aclsize)
-			continue;
+	return true;
+}
 
-		if (age && (CURRTIME - mc->registered) < age)
-			continue;
+static void
+cs_list_one(struct sourceinfo *si, struct mychan *mc)
+{
+	char buf[BUFSIZE] = { 0 };
 
-		if (lastused && (CURRTIME - mc->used) < lastused)
-			continue;
+	if (metadata_find(mc, "private:mark:setter")) {
+		mowgli_strlcat(buf, "\2[marked]\2", BUFSIZE);
+	}
+	if (metadata_find(mc, "private:close:closer")) {
+		if (*buf)
+			mowgli_strlcat(buf, " ", BUFSIZE);
 
-		if ((mlock_on & mc->mlock_on) != mlock_on)
-			continue;
+		mowgli_strlcat(buf, "\2[closed]\2", BUFSIZE);
+	}
+	if (mc->flags & MC_HOLD) {
+		if (*buf)
+			mowgli_strlcat(buf, " ", BUFSIZE);
 
-		if ((mlock_off & mc->mlock_off) != mlock_off)
-			continue;
+		mowgli_strlcat(buf, "\2[held]\2", BUFSIZE);
+	}
 
-		if (mlock_key && !mc->mlock_key)
-			continue;
+	command_success_nodata(si, "- %s (%s) %s", mc->name, mychan_founder_names(mc), buf);
+}
 
-		if (mlock_limit && !mc->mlock_limit)
-			continue;
+struct list_run
+{
+	struct sourceinfo *si;
+	const struct list_query *q;
+	unsigned int limit;
+	unsigned int offset;
+	unsigned int skipped;
+	unsigned int matches;
+};
 
-		const struct metadata *extmlock_md = metadata_find(mc, "private:mlockext");
+// Show the channel if it matches; returns nonzero once the limit is reached
+static int
+cs_list_visit(struct mychan *mc, void *privdata)
+{
+	struct list_run *run = privdata;
 
-		if (!check_extmlock(extmlock_md, extmlock_on, true))
-			continue;
+	if (!cs_list_match(run->q, mc))
+		return 0;
 
-		if (!check_extmlock(extmlock_md, extmlock_off, false))
-			continue;
+	if (run->skipped < run->offset)
+	{
+		run->skipped++;
+		return 0;
+	}
 
-		// in the future we could add a LIMIT parameter
-		char buf[BUFSIZE] = { 0 };
+	cs_list_one(run->si, mc);
+	run->matches++;
 
-		if (metadata_find(mc, "private:mark:setter")) {
-			mowgli_strlcat(buf, "\2[marked]\2", BUFSIZE);
-		}
-		if (metadata_find(mc, "private:close:closer")) {
-			if (*buf)
-				mowgli_strlcat(buf, " ", BUFSIZE);
+	return (run->limit > 0 && run->matches >= run->limit);
+}
 
-			mowgli_strlcat(buf, "\2[closed]\2", BUFSIZE);
-		}
-		if (mc->flags & MC_HOLD) {
-			if (*buf)
-				mowgli_strlcat(buf, " ", BUFSIZE);
+static void
+cs_cmd_list(struct sourceinfo *si, int parc, char *parv[])
+{
+	struct list_query q = { .chanpattern = NULL };
+	const char *mlock = NULL;
+	unsigned int limit = 0, offset = 0;
+	struct list_option optstable[] = {
+		{"pattern",      OPT_STRING,    {.strval = &q.chanpattern}, 0},
+		{"mark-reason",  OPT_STRING,    {.strval = &q.markpattern}, 0},
+		{"close-reason", OPT_STRING,    {.strval = &q.closedpattern}, 0},
+		{"noexpire",     OPT_FLAG,      {.flagval = &q.flagset}, MC_HOLD},
+		{"held",         OPT_FLAG,      {.flagval = &q.flagset}, MC_HOLD},
+		{"hold",         OPT_FLAG,      {.flagval = &q.flagset}, MC_HOLD},
+		{"noop",         OPT_FLAG,      {.flagval = &q.flagset}, MC_NOOP},
+		{"limitflags",   OPT_FLAG,      {.flagval = &q.flagset}, MC_LIMITFLAGS},
+		{"secure",       OPT_FLAG,      {.flagval = &q.flagset}, MC_SECURE},
+		{"nosync",       OPT_FLAG,      {.flagval = &q.flagset}, MC_NOSYNC},
+		{"verbose",      OPT_FLAG,      {.flagval = &q.flagset}, MC_VERBOSE},
+		{"restricted",   OPT_FLAG,      {.flagval = &q.flagset}, MC_RESTRICTED},
+		{"keeptopic",    OPT_FLAG,      {.flagval = &q.flagset}, MC_KEEPTOPIC},
+		{"verbose-ops",  OPT_FLAG,      {.flagval = &q.flagset}, MC_VERBOSE_OPS},
+		{"topiclock",    OPT_FLAG,      {.flagval = &q.flagset}, MC_TOPICLOCK},
+		{"guard",        OPT_FLAG,      {.flagval = &q.flagset}, MC_GUARD},
+		{"private",      OPT_FLAG,      {.flagval = &q.flagset}, MC_PRIVATE},
+		{"pubacl",       OPT_FLAG,      {.flagval = &q.flagset}, MC_PUBACL},
+		{"mlock",        OPT_STRING,    {.strval = &mlock}, 0},
+		{"closed",       OPT_BOOL,      {.boolval = &q.closed}, 0},
+		{"marked",       OPT_BOOL,      {.boolval = &q.marked}, 0},
+		{"aclsize",      OPT_INT,       {.intval = &q.aclsize}, 0},
+		{"registered",   OPT_AGE,       {.ageval = &q.age}, 0},
+		{"lastused",     OPT_AGE,       {.ageval = &q.lastused}, 0},
+		{"limit",        OPT_UINT,      {.uintval = &limit}, 0},
+		{"offset",       OPT_UINT,      {.uintval = &offset}, 0},
+	};
 
-			mowgli_strlcat(buf, "\2[held]\2", BUFSIZE);
-		}
+	// This isn't a channel-specific command. Exclude it from fantasy;
+	// this also allows bots to react to it without us interfering,
+	// cf chanserv/register for precedent
+	if (si->c != NULL)
+		return;
+
+	if (!process_parvarray(si, optstable, ARRAY_SIZE(optstable), parc, parv))
+		return;
+
+	char criteriastr[BUFSIZE];
+	build_criteriastr(criteriastr, parc, parv);
+
+	bool extmlock_on[ignore_mode_list_size];
+	bool extmlock_off[ignore_mode_list_size];
+	memset(extmlock_on, 0, sizeof extmlock_on);
+	memset(extmlock_off, 0, sizeof extmlock_off);
+	q.extmlock_on = extmlock_on;
+	q.extmlock_off = extmlock_off;
 
-		command_success_nodata(si, "- %s (%s) %s", mc->name, mychan_founder_names(mc), buf);
-		matches++;
+	if (mlock)
+		parse_mlock(&q, mlock);
+
+	command_success_nodata(si, _("Channels matching \2%s\2:"), criteriastr);
+
+	struct list_run run = {
+		.si = si,
+		.q = &q,
+		.limit = limit,
+		.offset = offset,
+	};
+
+	struct mychan *mc;
+	mowgli_patricia_iteration_state_t state;
+
+	/* A pattern without wildcards can only match the channel of that name.
+	 * match() lets a leading '#' or '&' also match a digit or letter, but
+	 * channel names never start with one.
+	 */
+	if (q.chanpattern != NULL && (*q.chanpattern == '#' || *q.chanpattern == '&') &&
+	    match_is_literal(q.chanpattern + 1))
+	{
+		if ((mc = mychan_find(q.chanpattern)) != NULL)
+			(void) cs_list_visit(mc, &run);
+	}
+	else if (q.flagset)
+	{
+		// only channels with all of the flags need to be looked at
+		mychan_foreach_with_flags(q.flagset, cs_list_visit, &run);
 	}
+	else
+	{
+		MOWGLI_PATRICIA_FOREACH(mc, &state, mclist)
+		{
+			if (cs_list_visit(mc, &run))
+				break;
+		}
+	}
+
+	const unsigned int matches = run.matches;
 
 	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, matches);
 	if (matches == 0)
@@ -128,9 +128,9 @@ chanserv(struct sourceinfo *si, int parc, char *parv[])
 			/* fantasy commands are always verbose
 			 * (a little ugly but this way we can !set verbose)
 			 */
-			mc->flags |= MC_FORCEVERBOSE;
+			mychan_set_flags(mc, mc->flags | MC_FORCEVERBOSE);
 			command_exec_split(si->service, si, realcmd, newargs, si->service->commands);
-			mc->flags &= ~MC_FORCEVERBOSE;
+			mychan_set_flags(mc, mc->flags & ~MC_FORCEVERBOSE);
 		}
 		else if (!ircncasecmp(cmd, chansvs.nick, strlen(chansvs.nick)) && !isalnum((unsigned char)cmd[strlen(chansvs.nick)]) && (cmd = strtok(NULL, "")) != NULL)
 		{
@@ -158,9 +158,9 @@ chanserv(struct sourceinfo *si, int parc, char *parv[])
 			/* fantasy commands are always verbose
 			 * (a little ugly but this way we can !set verbose)
 			 */
-			mc->flags |= MC_FORCEVERBOSE;
+			mychan_set_flags(mc, mc->flags | MC_FORCEVERBOSE);
 			command_exec_split(si->service, si, realcmd, newargs, si->service->commands);
-			mc->flags &= ~MC_FORCEVERBOSE;
+			mychan_set_flags(mc, mc->flags & ~MC_FORCEVERBOSE);
 		}
 	}
 }
@@ -405,7 +405,7 @@ cs_join(struct hook_channel_joinpart *hdata)
 	{
 		if (chan->nummembers - chan->numsvcmembers == 1)
 		{
-			mc->flags |= MC_INHABIT;
+			mychan_set_flags(mc, mc->flags | MC_INHABIT);
 			if (chan->numsvcmembers == 0)
 				join(chan->name, chansvs.nick);
 		}
@@ -440,7 +440,7 @@ cs_join(struct hook_channel_joinpart *hdata)
 	 */
 	if (mc->flags & MC_INHABIT && chan->nummembers - chan->numsvcmembers >= 2)
 	{
-		mc->flags &= ~MC_INHABIT;
+		mychan_set_flags(mc, mc->flags & ~MC_INHABIT);
 		if (!(mc->flags & MC_GUARD) && !(chan->flags & CHAN_LOG) && chanuser_find(chan, chansvs.me->me))
 			part(chan->name, chansvs.nick);
 	}
@@ -647,7 +647,7 @@ cs_newchan(struct channel *c)
 
 	/* schedule a mode lock check when we know the current modes
 	 * -- jilles */
-	mc->flags |= MC_MLOCK_CHECK;
+	mychan_set_flags(mc, mc->flags | MC_MLOCK_CHECK);
 
 	md = metadata_find(mc, "private:channelts");
 	if (md != NULL)
@@ -656,9 +656,9 @@ cs_newchan(struct channel *c)
 		channelts = mc->registered;
 
 	if (c->ts > channelts && channelts > 0)
-		mc->flags |= MC_RECREATED;
+		mychan_set_flags(mc, mc->flags | MC_RECREATED);
 	else
-		mc->flags &= ~MC_RECREATED;
+		mychan_set_flags(mc, mc->flags & ~MC_RECREATED);
 
 	if (chansvs.changets && c->ts > channelts && channelts > 0)
 	{
@@ -678,7 +678,7 @@ cs_newchan(struct channel *c)
 		cu->modes |= CSTATUS_OP;
 
 		// make sure it parts again sometime (empty SJOIN etc)
-		mc->flags |= MC_INHABIT;
+		mychan_set_flags(mc, mc->flags | MC_INHABIT);
 	}
 	else if (c->ts != channelts)
 	{
@@ -738,7 +738,7 @@ cs_tschange(struct channel *c)
 
 	/* schedule a mode lock check when we know the new modes
 	 * -- jilles */
-	mc->flags |= MC_MLOCK_CHECK;
+	mychan_set_flags(mc, mc->flags | MC_MLOCK_CHECK);
 
 	// reset the mlock if needed
 	mlock_sts(c);
@@ -768,7 +768,7 @@ cs_leave_empty(void *unused)
 		if (mc->chan != NULL && mc->chan->nummembers - mc->chan->numsvcmembers == 1)
 			continue;
 
-		mc->flags &= ~MC_INHABIT;
+		mychan_set_flags(mc, mc->flags & ~MC_INHABIT);
 		if (mc->chan != NULL &&
 				!(mc->chan->flags & CHAN_LOG) &&
 				(!(mc->flags & MC_GUARD) ||
@@ -54,7 +54,7 @@ cs_cmd_recover(struct sourceinfo *si, int parc, char *parv[])
 		{
 			// Otherwise, our modes are likely ignored.
 			join(mc->name, chansvs.nick);
-			mc->flags |= MC_INHABIT;
+			mychan_set_flags(mc, mc->flags | MC_INHABIT);
 		}
 		if (!mc->chan)
 		{
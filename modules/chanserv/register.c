@@ -124,7 +124,7 @@ cs_cmd_register(struct sourceinfo *si, int parc, char *parv[])
 	mc = mychan_add(name);
 	mc->registered = CURRTIME;
 	mc->used = CURRTIME;
-	mc->flags |= config_options.defcflags;
+	mychan_set_flags(mc, mc->flags | config_options.defcflags);
 
 	if (chansvs.default_mlock)
 	{
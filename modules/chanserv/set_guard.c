@@ -58,7 +58,7 @@ cs_cmd_set_guard(struct sourceinfo *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_SET, "SET:GUARD:ON: \2%s\2", mc->name);
 		verbose(mc, "\2%s\2 enabled the GUARD flag", get_source_name(si));
 
-		mc->flags |= MC_GUARD;
+		mychan_set_flags(mc, mc->flags | MC_GUARD);
 
 		if (!(mc->flags & MC_INHABIT))
 			join(mc->name, chansvs.nick);
@@ -77,7 +77,7 @@ cs_cmd_set_guard(struct sourceinfo *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_SET, "SET:GUARD:OFF: \2%s\2", mc->name);
 		verbose(mc, "\2%s\2 disabled the GUARD flag", get_source_name(si));
 
-		mc->flags &= ~MC_GUARD;
+		mychan_set_flags(mc, mc->flags & ~MC_GUARD);
 
 		if (mc->chan != NULL && !(mc->flags & MC_INHABIT) && !(mc->chan->flags & CHAN_LOG))
 			part(mc->name, chansvs.nick);
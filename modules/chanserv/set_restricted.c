@@ -33,7 +33,7 @@ chanuser_sync(struct hook_chanuser_sync *hdata)
 		// Stay on channel if this would empty it -- jilles
 		if (chan->nummembers - chan->numsvcmembers == 1)
 		{
-			mc->flags |= MC_INHABIT;
+			mychan_set_flags(mc, mc->flags | MC_INHABIT);
 			if (chan->numsvcmembers == 0)
 				join(chan->name, chansvs.nick);
 		}
@@ -98,7 +98,7 @@ cs_cmd_set_restricted(struct sourceinfo *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_SET, "SET:RESTRICTED:ON: \2%s\2", mc->name);
 		verbose(mc, "\2%s\2 enabled the RESTRICTED flag", get_source_name(si));
 
-		mc->flags |= MC_RESTRICTED;
+		mychan_set_flags(mc, mc->flags | MC_RESTRICTED);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for channel \2%s\2."), "RESTRICTED", mc->name);
 		return;
@@ -114,7 +114,7 @@ cs_cmd_set_restricted(struct sourceinfo *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_SET, "SET:RESTRICTED:OFF: \2%s\2", mc->name);
 		verbose(mc, "\2%s\2 disabled the RESTRICTED flag", get_source_name(si));
 
-		mc->flags &= ~MC_RESTRICTED;
+		mychan_set_flags(mc, mc->flags & ~MC_RESTRICTED);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for channel \2%s\2."), "RESTRICTED", mc->name);
 		return;
@@ -52,7 +52,7 @@ cs_cmd_set_topiclock(struct sourceinfo *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_SET, "SET:TOPICLOCK:ON: \2%s\2", mc->name);
 		verbose(mc, "\2%s\2 enabled the TOPICLOCK flag", get_source_name(si));
 
-		mc->flags |= MC_KEEPTOPIC | MC_TOPICLOCK;
+		mychan_set_flags(mc, mc->flags | MC_KEEPTOPIC | MC_TOPICLOCK);
 		topiclock_sts(mc->chan);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for channel \2%s\2."), "TOPICLOCK", mc->name);
@@ -70,7 +70,7 @@ cs_cmd_set_topiclock(struct sourceinfo *si, int parc, char *parv[])
 		logcommand(si, CMDLOG_SET, "SET:TOPICLOCK:OFF: \2%s\2", mc->name);
 		verbose(mc, "\2%s\2 disabled the TOPICLOCK flag", get_source_name(si));
 
-		mc->flags &= ~MC_TOPICLOCK;
+		mychan_set_flags(mc, mc->flags & ~MC_TOPICLOCK);
 		topiclock_sts(mc->chan);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for channel \2%s\2."), "TOPICLOCK", mc->name);
@@ -19,7 +19,7 @@ write_groupdb(struct database_handle *db)
 {
 	struct myentity *mt;
 	struct myentity_iteration_state state;
-	mowgli_patricia_iteration_state_t state2;
+	struct metadata_iteration_state state2;
 	struct metadata *md;
 
 	db_start_row(db, "GDBV");
@@ -45,16 +45,13 @@ write_groupdb(struct database_handle *db)
 		db_write_word(db, mgflags);
 		db_commit_row(db);
 
-		if (atheme_object(mg)->metadata)
+		METADATA_FOREACH(md, &state2, mg)
 		{
-			MOWGLI_PATRICIA_FOREACH(md, &state2, atheme_object(mg)->metadata)
-			{
-				db_start_row(db, "MDG");
-				db_write_word(db, entity(mg)->name);
-				db_write_word(db, md->name);
-				db_write_str(db, md->value);
-				db_commit_row(db);
-			}
+			db_start_row(db, "MDG");
+			db_write_word(db, entity(mg)->name);
+			db_write_word(db, md->name);
+			db_write_str(db, md->value);
+			db_commit_row(db);
 		}
 	}
 
@@ -15,12 +15,14 @@ struct help_ticket
 	time_t ticket_ts;
 	char *creator;
 	char *topic;
+	mowgli_node_t node;
 };
 
 static unsigned int ratelimit_count = 0;
 static time_t ratelimit_firsttime = 0;
 
-static mowgli_list_t helpserv_reqlist;
+static mowgli_list_t helpserv_reqlist;         // ordered by ticket_ts, oldest first
+static mowgli_patricia_t *helpserv_reqtree;     // account name -> struct help_ticket
 
 static void
 write_ticket_db(struct database_handle *db)
@@ -40,6 +42,48 @@ write_ticket_db(struct database_handle *db)
 	}
 }
 
+static struct help_ticket *
+help_ticket_find(const char *const restrict nick)
+{
+	return mowgli_patricia_retrieve(helpserv_reqtree, nick);
+}
+
+static struct help_ticket *
+help_ticket_add(stringref nick, const time_t ticket_ts, const char *const restrict creator,
+                const char *const restrict topic)
+{
+	struct help_ticket *const l = smalloc(sizeof *l);
+
+	l->nick = nick;
+	l->ticket_ts = ticket_ts;
+	l->creator = sstrdup(creator);
+	l->topic = sstrdup(topic);
+
+	if (! mowgli_patricia_add(helpserv_reqtree, l->nick, l))
+	{
+		strshare_unref(l->nick);
+		sfree(l->creator);
+		sfree(l->topic);
+		sfree(l);
+		return NULL;
+	}
+
+	mowgli_node_add(l, &l->node, &helpserv_reqlist);
+	return l;
+}
+
+static void
+help_ticket_delete(struct help_ticket *const restrict l)
+{
+	(void) mowgli_patricia_delete(helpserv_reqtree, l->nick);
+	mowgli_node_delete(&l->node, &helpserv_reqlist);
+
+	strshare_unref(l->nick);
+	sfree(l->creator);
+	sfree(l->topic);
+	sfree(l);
+}
+
 static void
 db_h_he(struct database_handle *db, const char *type)
 {
@@ -48,62 +92,34 @@ db_h_he(struct database_handle *db, const char *type)
 	const char *creator = db_sread_word(db);
 	const char *topic = db_sread_str(db);
 
-	struct help_ticket *const l = smalloc(sizeof *l);
-	l->nick = strshare_get(nick);
-	l->ticket_ts = ticket_ts;
-	l->creator = sstrdup(creator);
-	l->topic = sstrdup(topic);
-	mowgli_node_add(l, mowgli_node_create(), &helpserv_reqlist);
+	if (! help_ticket_add(strshare_get(nick), ticket_ts, creator, topic))
+		slog(LG_INFO, "db-h-he: line %u: skipping duplicate help request for %s", db->line, nick);
 }
 
 static void
 account_drop_request(struct myuser *mu)
 {
-        mowgli_node_t *n;
-        struct help_ticket *l;
-
-        MOWGLI_ITER_FOREACH(n, helpserv_reqlist.head)
-        {
-                l = n->data;
-                if (!irccasecmp(l->nick, entity(mu)->name))
-                {
-                        slog(LG_REGISTER, "HELP:REQUEST:DROPACCOUNT: \2%s\2 \2%s\2", l->nick, l->topic);
-
-                        mowgli_node_delete(n, &helpserv_reqlist);
-
-                        strshare_unref(l->nick);
-                        sfree(l->creator);
-                        sfree(l->topic);
-                        sfree(l);
-
-                        return;
-                }
-        }
+	struct help_ticket *const l = help_ticket_find(entity(mu)->name);
+
+	if (! l)
+		return;
+
+	slog(LG_REGISTER, "HELP:REQUEST:DROPACCOUNT: \2%s\2 \2%s\2", l->nick, l->topic);
+
+	help_ticket_delete(l);
 }
 
 static void
 account_delete_request(struct myuser *mu)
 {
-        mowgli_node_t *n;
-        struct help_ticket *l;
-
-        MOWGLI_ITER_FOREACH(n, helpserv_reqlist.head)
-        {
-                l = n->data;
-                if (!irccasecmp(l->nick, entity(mu)->name))
-                {
-                        slog(LG_REGISTER, "HELP:REQUEST:EXPIRE: \2%s\2 \2%s\2", l->nick, l->topic);
-
-                        mowgli_node_delete(n, &helpserv_reqlist);
-
-                        strshare_unref(l->nick);
-                        sfree(l->creator);
-                        sfree(l->topic);
-                        sfree(l);
-
-                        return;
-                }
-        }
+	struct help_ticket *const l = help_ticket_find(entity(mu)->name);
+
+	if (! l)
+		return;
+
+	slog(LG_REGISTER, "HELP:REQUEST:EXPIRE: \2%s\2 \2%s\2", l->nick, l->topic);
+
+	help_ticket_delete(l);
 }
 
 // REQUEST <topic>
@@ -111,7 +127,6 @@ static void
 helpserv_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 {
 	const char *topic = parv[0];
-	mowgli_node_t *n;
 	struct help_ticket *l;
 
 	if (!topic)
@@ -133,34 +148,32 @@ helpserv_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 		ratelimit_firsttime = CURRTIME;
 	}
 
-	// search for it
-	MOWGLI_ITER_FOREACH(n, helpserv_reqlist.head)
+	if ((l = help_ticket_find(entity(si->smu)->name)) != NULL)
 	{
-		l = n->data;
-
-		if (!irccasecmp(l->nick, entity(si->smu)->name))
+		if (!strcmp(topic, l->topic))
 		{
-			if (!strcmp(topic, l->topic))
-			{
-				command_success_nodata(si, _("You have already requested help about \2%s\2."), topic);
-				return;
-			}
-			if (ratelimit_count > config_options.ratelimit_uses && !has_priv(si, PRIV_FLOOD))
-			{
-				command_fail(si, fault_toomany, _("The system is currently too busy to process your help request, please try again later."));
-				slog(LG_INFO, "HELP:REQUEST:THROTTLED: %s", si->su->nick);
-				return;
-			}
-			sfree(l->topic);
-			l->topic = sstrdup(topic);
-			l->ticket_ts = CURRTIME;;
-
-			command_success_nodata(si, _("You have requested help about \2%s\2."), topic);
-			logcommand(si, CMDLOG_REQUEST, "REQUEST: \2%s\2", topic);
-			if (config_options.ratelimit_uses && config_options.ratelimit_period)
-				ratelimit_count++;
+			command_success_nodata(si, _("You have already requested help about \2%s\2."), topic);
 			return;
 		}
+		if (ratelimit_count > config_options.ratelimit_uses && !has_priv(si, PRIV_FLOOD))
+		{
+			command_fail(si, fault_toomany, _("The system is currently too busy to process your help request, please try again later."));
+			slog(LG_INFO, "HELP:REQUEST:THROTTLED: %s", si->su->nick);
+			return;
+		}
+		sfree(l->topic);
+		l->topic = sstrdup(topic);
+		l->ticket_ts = CURRTIME;
+
+		// keep the list ordered by submission time
+		mowgli_node_delete(&l->node, &helpserv_reqlist);
+		mowgli_node_add(l, &l->node, &helpserv_reqlist);
+
+		command_success_nodata(si, _("You have requested help about \2%s\2."), topic);
+		logcommand(si, CMDLOG_REQUEST, "REQUEST: \2%s\2", topic);
+		if (config_options.ratelimit_uses && config_options.ratelimit_period)
+			ratelimit_count++;
+		return;
 	}
 
 	if (ratelimit_count > config_options.ratelimit_uses && !has_priv(si, PRIV_FLOOD))
@@ -169,14 +182,7 @@ helpserv_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 		slog(LG_INFO, "HELP:REQUEST:THROTTLED: %s", si->su->nick);
 		return;
 	}
-	l = smalloc(sizeof *l);
-	l->nick = strshare_ref(entity(si->smu)->name);
-	l->ticket_ts = CURRTIME;;
-	l->creator = sstrdup(get_source_name(si));
-	l->topic = sstrdup(topic);
-
-	n = mowgli_node_create();
-	mowgli_node_add(l, n, &helpserv_reqlist);
+	(void) help_ticket_add(strshare_ref(entity(si->smu)->name), CURRTIME, get_source_name(si), topic);
 
 	command_success_nodata(si, _("You have requested help about \2%s\2."), topic);
 	logcommand(si, CMDLOG_REQUEST, "REQUEST: \2%s\2", topic);
@@ -192,7 +198,6 @@ helpserv_cmd_close(struct sourceinfo *si, int parc, char *parv[])
 	char *nick = parv[0];
 	struct user *u;
 	struct help_ticket *l;
-	mowgli_node_t *n;
 
 	if (!nick)
 	{
@@ -201,51 +206,41 @@ helpserv_cmd_close(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
-	MOWGLI_ITER_FOREACH(n, helpserv_reqlist.head)
+	if ((l = help_ticket_find(nick)) == NULL)
 	{
-		l = n->data;
-		if (!irccasecmp(l->nick, nick))
-		{
-			if ((u = user_find_named(nick)) != NULL)
-			{
-				if (parv[1] != NULL)
-					notice(si->service->nick, u->nick, "[auto notice] Your help request has been closed: %s", parv[1]);
-				else
-					notice(si->service->nick, u->nick, "[auto notice] Your help request has been closed.");
-			}
-			else
-			{
-				struct service *svs;
-				char buf[BUFSIZE];
-
-				if ((svs = service_find("memoserv")) != NULL && myuser_find(parv[0]) != NULL)
-				{
-					if (parv[1] != NULL)
-						snprintf(buf, BUFSIZE, "%s [auto memo] Your help request has been closed: %s", parv[0], parv[1]);
-					else
-						snprintf(buf, BUFSIZE, "%s [auto memo] Your help request has been closed.", parv[0]);
+		command_success_nodata(si, _("Nick \2%s\2 not found in help request database."), nick);
+		return;
+	}
 
-					command_exec_split(svs, si, "SEND", buf, svs->commands);
-				}
-			}
+	if ((u = user_find_named(nick)) != NULL)
+	{
+		if (parv[1] != NULL)
+			notice(si->service->nick, u->nick, "[auto notice] Your help request has been closed: %s", parv[1]);
+		else
+			notice(si->service->nick, u->nick, "[auto notice] Your help request has been closed.");
+	}
+	else
+	{
+		struct service *svs;
+		char buf[BUFSIZE];
 
+		if ((svs = service_find("memoserv")) != NULL && myuser_find(parv[0]) != NULL)
+		{
 			if (parv[1] != NULL)
-				logcommand(si, CMDLOG_REQUEST, "CLOSE: Help for \2%s\2 about \2%s\2 (\2%s\2)", nick, l->topic, parv[1]);
+				snprintf(buf, BUFSIZE, "%s [auto memo] Your help request has been closed: %s", parv[0], parv[1]);
 			else
-				logcommand(si, CMDLOG_REQUEST, "CLOSE: Help for \2%s\2 about \2%s\2", nick, l->topic);
-
-			mowgli_node_delete(n, &helpserv_reqlist);
-
-			strshare_unref(l->nick);
-			sfree(l->creator);
-			sfree(l->topic);
-			sfree(l);
+				snprintf(buf, BUFSIZE, "%s [auto memo] Your help request has been closed.", parv[0]);
 
-			return;
+			command_exec_split(svs, si, "SEND", buf, svs->commands);
 		}
 	}
 
-	command_success_nodata(si, _("Nick \2%s\2 not found in help request database."), nick);
+	if (parv[1] != NULL)
+		logcommand(si, CMDLOG_REQUEST, "CLOSE: Help for \2%s\2 about \2%s\2 (\2%s\2)", nick, l->topic, parv[1]);
+	else
+		logcommand(si, CMDLOG_REQUEST, "CLOSE: Help for \2%s\2 about \2%s\2", nick, l->topic);
+
+	help_ticket_delete(l);
 }
 
 // LIST
@@ -276,29 +271,18 @@ helpserv_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 static void
 helpserv_cmd_cancel(struct sourceinfo *si, int parc, char *parv[])
 {
-        struct help_ticket *l;
-        mowgli_node_t *n;
-
-        MOWGLI_ITER_FOREACH(n, helpserv_reqlist.head)
-        {
-                l = n->data;
-
-                if (!irccasecmp(l->nick, entity(si->smu)->name))
-                {
-                        mowgli_node_delete(n, &helpserv_reqlist);
+	struct help_ticket *const l = help_ticket_find(entity(si->smu)->name);
 
-                        strshare_unref(l->nick);
-                        sfree(l->creator);
-                        sfree(l->topic);
-                        sfree(l);
+	if (! l)
+	{
+		command_fail(si, fault_badparams, _("You do not have a help request to cancel."));
+		return;
+	}
 
-                        command_success_nodata(si, _("Your help request has been cancelled."));
+	help_ticket_delete(l);
 
-                        logcommand(si, CMDLOG_REQUEST, "CANCEL");
-                        return;
-                }
-        }
-        command_fail(si, fault_badparams, _("You do not have a help request to cancel."));
+	command_success_nodata(si, _("Your help request has been cancelled."));
+	logcommand(si, CMDLOG_REQUEST, "CANCEL");
 }
 
 static struct command helpserv_request = {
@@ -349,6 +333,8 @@ mod_init(struct module *const restrict m)
 
 	MODULE_TRY_REQUEST_DEPENDENCY(m, "helpserv/main")
 
+	helpserv_reqtree = mowgli_patricia_create(irccasecanon);
+
 	hook_add_user_drop(account_drop_request);
 	hook_add_myuser_delete(account_delete_request);
 	hook_add_db_write(write_ticket_db);
@@ -17,6 +17,7 @@ struct hsrequest
 	char *vhost;
 	time_t vhost_ts;
 	char *creator;
+	mowgli_node_t node;
 };
 
 static bool no_subsequent_requests;
@@ -26,7 +27,8 @@ static struct service *hostsvs;
 static unsigned int ratelimit_count = 0;
 static time_t ratelimit_firsttime = 0;
 
-static mowgli_list_t hs_reqlist;
+static mowgli_list_t hs_reqlist;        // ordered by vhost_ts, oldest first
+static mowgli_patricia_t *hs_reqtree;   // nick or account name -> struct hsrequest
 static char *groupmemo;
 
 static void
@@ -47,91 +49,109 @@ write_hsreqdb(struct database_handle *db)
 	}
 }
 
-static void
-db_h_hr(struct database_handle *db, const char *type)
+static struct hsrequest *
+hs_request_find(const char *const restrict nick)
 {
-	const char *nick = db_sread_word(db);
-	const char *vhost = db_sread_word(db);
-	time_t vhost_ts = db_sread_time(db);
-	const char *creator = db_sread_word(db);
+	return mowgli_patricia_retrieve(hs_reqtree, nick);
+}
 
+static struct hsrequest *
+hs_request_add(const char *const restrict nick, const char *const restrict vhost, const time_t vhost_ts,
+               const char *const restrict creator)
+{
 	struct hsrequest *const l = smalloc(sizeof *l);
+
 	l->nick = sstrdup(nick);
 	l->vhost = sstrdup(vhost);
 	l->vhost_ts = vhost_ts;
 	l->creator = sstrdup(creator);
-	mowgli_node_add(l, mowgli_node_create(), &hs_reqlist);
+
+	if (! mowgli_patricia_add(hs_reqtree, l->nick, l))
+	{
+		sfree(l->nick);
+		sfree(l->vhost);
+		sfree(l->creator);
+		sfree(l);
+		return NULL;
+	}
+
+	mowgli_node_add(l, &l->node, &hs_reqlist);
+	return l;
 }
 
 static void
-remove_request_from_list(mowgli_node_t *const restrict n)
+hs_request_update(struct hsrequest *const restrict l, const char *const restrict vhost)
 {
-	struct hsrequest *const l = n->data;
+	sfree(l->vhost);
+	l->vhost = sstrdup(vhost);
+	l->vhost_ts = CURRTIME;
+
+	// keep the list ordered by submission time
+	mowgli_node_delete(&l->node, &hs_reqlist);
+	mowgli_node_add(l, &l->node, &hs_reqlist);
+}
+
+static void
+hs_request_delete(struct hsrequest *const restrict l)
+{
+	(void) mowgli_patricia_delete(hs_reqtree, l->nick);
+	mowgli_node_delete(&l->node, &hs_reqlist);
 
 	sfree(l->nick);
 	sfree(l->vhost);
 	sfree(l->creator);
 	sfree(l);
+}
+
+static void
+db_h_hr(struct database_handle *db, const char *type)
+{
+	const char *nick = db_sread_word(db);
+	const char *vhost = db_sread_word(db);
+	time_t vhost_ts = db_sread_time(db);
+	const char *creator = db_sread_word(db);
 
-	mowgli_node_delete(n, &hs_reqlist);
-	mowgli_node_free(n);
+	if (! hs_request_add(nick, vhost, vhost_ts, creator))
+		slog(LG_INFO, "db-h-hr: line %u: skipping duplicate vhost request for %s", db->line, nick);
 }
 
 static void
 nick_drop_request(struct hook_user_req *hdata)
 {
-	mowgli_node_t *n;
-	struct hsrequest *l;
+	struct hsrequest *const l = hs_request_find(hdata->mn->nick);
 
-	MOWGLI_ITER_FOREACH(n, hs_reqlist.head)
-	{
-		l = n->data;
-		if (!irccasecmp(l->nick, hdata->mn->nick))
-		{
-			slog(LG_REGISTER, "VHOSTREQ:DROPNICK: \2%s\2 \2%s\2", l->nick, l->vhost);
+	if (! l)
+		return;
 
-			remove_request_from_list(n);
-			return;
-		}
-	}
+	slog(LG_REGISTER, "VHOSTREQ:DROPNICK: \2%s\2 \2%s\2", l->nick, l->vhost);
+
+	hs_request_delete(l);
 }
 
 static void
 account_drop_request(struct myuser *mu)
 {
-	mowgli_node_t *n;
-	struct hsrequest *l;
+	struct hsrequest *const l = hs_request_find(entity(mu)->name);
 
-	MOWGLI_ITER_FOREACH(n, hs_reqlist.head)
-	{
-		l = n->data;
-		if (!irccasecmp(l->nick, entity(mu)->name))
-		{
-			slog(LG_REGISTER, "VHOSTREQ:DROPACCOUNT: \2%s\2 \2%s\2", l->nick, l->vhost);
+	if (! l)
+		return;
 
-			remove_request_from_list(n);
-			return;
-		}
-	}
+	slog(LG_REGISTER, "VHOSTREQ:DROPACCOUNT: \2%s\2 \2%s\2", l->nick, l->vhost);
+
+	hs_request_delete(l);
 }
 
 static void
 account_delete_request(struct myuser *mu)
 {
-	mowgli_node_t *n;
-	struct hsrequest *l;
+	struct hsrequest *const l = hs_request_find(entity(mu)->name);
 
-	MOWGLI_ITER_FOREACH(n, hs_reqlist.head)
-	{
-		l = n->data;
-		if (!irccasecmp(l->nick, entity(mu)->name))
-		{
-			slog(LG_REGISTER, "VHOSTREQ:EXPIRE: \2%s\2 \2%s\2", l->nick, l->vhost);
+	if (! l)
+		return;
 
-			remove_request_from_list(n);
-			return;
-		}
-	}
+	slog(LG_REGISTER, "VHOSTREQ:EXPIRE: \2%s\2 \2%s\2", l->nick, l->vhost);
+
+	hs_request_delete(l);
 }
 
 static void
@@ -178,12 +198,8 @@ hs_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 	char *host = parv[0];
 	const char *target;
 	struct mynick *mn;
-	struct myentity *mt;
-	struct myuser *mu;
-	struct myentity_iteration_state state;
 	char buf[BUFSIZE], strfbuf[BUFSIZE];
 	struct metadata *md, *md_timestamp, *md_assigner;
-	mowgli_node_t *n;
 	struct hsrequest *l;
 	struct hook_host_request hdata;
 	int matches = 0;
@@ -254,29 +270,11 @@ hs_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 	if (!check_vhost_validity(si, host))
 		return;
 
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+	if (myuser_find_by_vhost(host) != NULL)
 	{
-		mu = user(mt);
-		md = metadata_find(mu, "private:usercloak");
-		if (md != NULL && !match(host, md->value))
-		{
-			command_fail(si, fault_noprivs, _("\2%s\2 is already assigned to another user.  You will need to request a \2different\2 vhost or see network staff."), host);
-			logcommand(si, CMDLOG_REQUEST, "REQUEST:FAILED: \2%s\2 is already assigned to another user.", host);
-				return;
-		}
-		MOWGLI_ITER_FOREACH(n, mu->nicks.head)
-		{
-			snprintf(buf, BUFSIZE, "%s:%s", "private:usercloak", ((struct mynick *)(n->data))->nick);
-			md = metadata_find(mu, buf);
-			if (md == NULL)
-				continue;
-			if (!match(host, md->value))
-			{
-			command_fail(si, fault_noprivs, _("\2%s\2 is already assigned to another user.  You will need to request a \2different\2 vhost or see network staff."), host);
-			logcommand(si, CMDLOG_REQUEST, "REQUEST:FAILED: \2%s\2 is already assigned to another user.", host);
-				return;
-			}
-		}
+		command_fail(si, fault_noprivs, _("\2%s\2 is already assigned to another user.  You will need to request a \2different\2 vhost or see network staff."), host);
+		logcommand(si, CMDLOG_REQUEST, "REQUEST:FAILED: \2%s\2 is already assigned to another user.", host);
+		return;
 	}
 
 	hdata.host = host;
@@ -292,45 +290,38 @@ hs_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 	if (hdata.approved != 0)
 		return;
 
-	// search for it
-	MOWGLI_ITER_FOREACH(n, hs_reqlist.head)
+	if ((l = hs_request_find(target)) != NULL)
 	{
-		l = n->data;
-
-		if (!irccasecmp(l->nick, target))
+		if (no_subsequent_requests)
+		{
+			command_fail(si, fault_badparams, _("You already have an outstanding vhost request. "
+			                                    "Please wait for network staff to approve or "
+			                                    "reject it."));
+			return;
+		}
+		if (!strcmp(host, l->vhost))
 		{
-			if (no_subsequent_requests)
-			{
-				command_fail(si, fault_badparams, _("You already have an outstanding vhost request. "
-				                                    "Please wait for network staff to approve or "
-				                                    "reject it."));
-				return;
-			}
-			if (!strcmp(host, l->vhost))
-			{
-				command_success_nodata(si, _("You have already requested vhost \2%s\2."), host);
-				return;
-			}
-			if (ratelimit_count > config_options.ratelimit_uses && !has_priv(si, PRIV_FLOOD))
-			{
-				command_fail(si, fault_toomany, _("The system is currently too busy to process your vHost request, please try again later."));
-				slog(LG_INFO, "VHOSTREQUEST:THROTTLED: %s", si->su->nick);
-				return;
-			}
-			sfree(l->vhost);
-			l->vhost = sstrdup(host);
-			l->vhost_ts = CURRTIME;
-
-			command_success_nodata(si, _("You have requested vhost \2%s\2."), host);
-
-			if (groupmemo != NULL)
-				send_group_memo(si, "[auto memo] Please review \2%s\2 for me!", host);
-
-			logcommand(si, CMDLOG_REQUEST, "REQUEST: \2%s\2", host);
-			if (config_options.ratelimit_uses && config_options.ratelimit_period)
-				ratelimit_count++;
+			command_success_nodata(si, _("You have already requested vhost \2%s\2."), host);
 			return;
 		}
+		if (ratelimit_count > config_options.ratelimit_uses && !has_priv(si, PRIV_FLOOD))
+		{
+			command_fail(si, fault_toomany, _("The system is currently too busy to process your vHost request, please try again later."));
+			slog(LG_INFO, "VHOSTREQUEST:THROTTLED: %s", si->su->nick);
+			return;
+		}
+
+		hs_request_update(l, host);
+
+		command_success_nodata(si, _("You have requested vhost \2%s\2."), host);
+
+		if (groupmemo != NULL)
+			send_group_memo(si, "[auto memo] Please review \2%s\2 for me!", host);
+
+		logcommand(si, CMDLOG_REQUEST, "REQUEST: \2%s\2", host);
+		if (config_options.ratelimit_uses && config_options.ratelimit_period)
+			ratelimit_count++;
+		return;
 	}
 
 	if (ratelimit_count > config_options.ratelimit_uses && !has_priv(si, PRIV_FLOOD))
@@ -340,14 +331,7 @@ hs_cmd_request(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
-	l = smalloc(sizeof *l);
-	l->nick = sstrdup(target);
-	l->vhost = sstrdup(host);
-	l->vhost_ts = CURRTIME;;
-	l->creator = sstrdup(get_source_name(si));
-
-	n = mowgli_node_create();
-	mowgli_node_add(l, n, &hs_reqlist);
+	(void) hs_request_add(target, host, CURRTIME, get_source_name(si));
 
 	command_success_nodata(si, _("You have requested vhost \2%s\2."), host);
 
@@ -377,43 +361,46 @@ hs_cmd_activate(struct sourceinfo *si, int parc, char *parv[])
 		return;
 	}
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, hs_reqlist.head)
+	if (irccasecmp("*", nick))
 	{
-		l = n->data;
-
-		if (!irccasecmp(l->nick, nick))
+		if ((l = hs_request_find(nick)) == NULL)
 		{
-			if ((u = user_find_named(nick)) != NULL)
-				notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been approved.", l->vhost, nick);
-
-			// VHOSTNICK command below will generate snoop
-			logcommand(si, CMDLOG_REQUEST, "ACTIVATE: \2%s\2 for \2%s\2", l->vhost, nick);
-			snprintf(buf, BUFSIZE, "%s %s", l->nick, l->vhost);
-			remove_request_from_list(n);
-
-			command_exec_split(si->service, si, request_per_nick ? "VHOSTNICK" : "VHOST", buf, si->service->commands);
+			command_success_nodata(si, _("Nick \2%s\2 not found in vhost request database."), nick);
 			return;
 		}
 
-		if (!irccasecmp("*", nick))
-		{
-			if ((u = user_find_named(l->nick)) != NULL)
-				notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been approved.", l->vhost, l->nick);
-
-			// VHOSTNICK command below will generate snoop
-			logcommand(si, CMDLOG_REQUEST, "ACTIVATE: \2%s\2 for \2%s\2", l->vhost, l->nick);
-			snprintf(buf, BUFSIZE, "%s %s", l->nick, l->vhost);
-			remove_request_from_list(n);
+		if ((u = user_find_named(nick)) != NULL)
+			notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been approved.", l->vhost, nick);
 
-			command_exec_split(si->service, si, request_per_nick ? "VHOSTNICK" : "VHOST", buf, si->service->commands);
+		// VHOSTNICK command below will generate snoop
+		logcommand(si, CMDLOG_REQUEST, "ACTIVATE: \2%s\2 for \2%s\2", l->vhost, nick);
+		snprintf(buf, BUFSIZE, "%s %s", l->nick, l->vhost);
+		hs_request_delete(l);
 
-			if (hs_reqlist.count == 0)
-				return;
-		}
+		command_exec_split(si->service, si, request_per_nick ? "VHOSTNICK" : "VHOST", buf, si->service->commands);
+		return;
+	}
 
+	if (! MOWGLI_LIST_LENGTH(&hs_reqlist))
+	{
+		command_success_nodata(si, _("Nick \2%s\2 not found in vhost request database."), nick);
+		return;
 	}
 
-	command_success_nodata(si, _("Nick \2%s\2 not found in vhost request database."), nick);
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, hs_reqlist.head)
+	{
+		l = n->data;
+
+		if ((u = user_find_named(l->nick)) != NULL)
+			notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been approved.", l->vhost, l->nick);
+
+		// VHOSTNICK command below will generate snoop
+		logcommand(si, CMDLOG_REQUEST, "ACTIVATE: \2%s\2 for \2%s\2", l->vhost, l->nick);
+		snprintf(buf, BUFSIZE, "%s %s", l->nick, l->vhost);
+		hs_request_delete(l);
+
+		command_exec_split(si->service, si, request_per_nick ? "VHOSTNICK" : "VHOST", buf, si->service->commands);
+	}
 }
 
 // REJECT <nick>
@@ -423,6 +410,7 @@ hs_cmd_reject(struct sourceinfo *si, int parc, char *parv[])
 	char *nick = parv[0];
 	char *reason = parv[1];
 	struct user *u;
+	struct service *svs;
 	char buf[BUFSIZE];
 	struct hsrequest *l;
 	mowgli_node_t *n, *tn;
@@ -444,71 +432,74 @@ hs_cmd_reject(struct sourceinfo *si, int parc, char *parv[])
 	if (reason && strcasecmp(reason, "SILENT") == 0)
 		silent = true;
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, hs_reqlist.head)
+	if (irccasecmp("*", nick))
 	{
-		struct service *svs;
+		if ((l = hs_request_find(nick)) == NULL)
+		{
+			command_success_nodata(si, _("Nick \2%s\2 not found in vhost request database."), nick);
+			return;
+		}
 
-		l = n->data;
-		if (!irccasecmp(l->nick, nick))
+		if (! silent && (svs = service_find("memoserv")) != NULL)
 		{
-			if (! silent && (svs = service_find("memoserv")) != NULL)
-			{
-				if (reason)
-					snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", nick, l->vhost, nick, reason);
-				else
-					snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", nick, l->vhost, nick);
-
-				command_exec_split(svs, si, "SEND", buf, svs->commands);
-			}
-			else if (! silent && (u = user_find_named(nick)) != NULL)
-			{
-				if (reason)
-					notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", l->vhost, nick, reason);
-				else
-					notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", l->vhost, nick);
-			}
-
-			if (reason && ! silent)
-				logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2, Reason: \2%s\2", l->vhost, nick, reason);
+			if (reason)
+				snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", nick, l->vhost, nick, reason);
 			else
-				logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2", l->vhost, nick);
+				snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", nick, l->vhost, nick);
 
-			remove_request_from_list(n);
-			return;
+			command_exec_split(svs, si, "SEND", buf, svs->commands);
 		}
-
-		if (!irccasecmp("*", nick))
+		else if (! silent && (u = user_find_named(nick)) != NULL)
 		{
-			if (! silent && (svs = service_find("memoserv")) != NULL)
-			{
-				if (reason)
-					snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", nick, l->vhost, nick, reason);
-				else
-					snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", nick, l->vhost, nick);
-
-				command_exec_split(svs, si, "SEND", buf, svs->commands);
-			}
-			else if (! silent && (u = user_find_named(l->nick)) != NULL)
-			{
-				if (reason)
-					notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", l->vhost, nick, reason);
-				else
-					notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", l->vhost, nick);
-			}
-
-			if (reason && ! silent)
-				logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2, Reason: \2%s\2", l->vhost, l->nick, reason);
+			if (reason)
+				notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", l->vhost, nick, reason);
 			else
-				logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2", l->vhost, l->nick);
+				notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", l->vhost, nick);
+		}
 
-			remove_request_from_list(n);
+		if (reason && ! silent)
+			logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2, Reason: \2%s\2", l->vhost, nick, reason);
+		else
+			logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2", l->vhost, nick);
 
-			if (hs_reqlist.count == 0)
-				return;
-		}
+		hs_request_delete(l);
+		return;
+	}
+
+	if (! MOWGLI_LIST_LENGTH(&hs_reqlist))
+	{
+		command_success_nodata(si, _("Nick \2%s\2 not found in vhost request database."), nick);
+		return;
 	}
 
-	command_success_nodata(si, _("Nick \2%s\2 not found in vhost request database."), nick);
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, hs_reqlist.head)
+	{
+		l = n->data;
+
+		if (! silent && (svs = service_find("memoserv")) != NULL)
+		{
+			if (reason)
+				snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", nick, l->vhost, nick, reason);
+			else
+				snprintf(buf, BUFSIZE, "%s [auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", nick, l->vhost, nick);
+
+			command_exec_split(svs, si, "SEND", buf, svs->commands);
+		}
+		else if (! silent && (u = user_find_named(l->nick)) != NULL)
+		{
+			if (reason)
+				notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected due to: %s", l->vhost, nick, reason);
+			else
+				notice(si->service->nick, u->nick, "[auto memo] Your requested vhost \2%s\2 for nick \2%s\2 has been rejected.", l->vhost, nick);
+		}
+
+		if (reason && ! silent)
+			logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2, Reason: \2%s\2", l->vhost, l->nick, reason);
+		else
+			logcommand(si, CMDLOG_REQUEST, "REJECT: \2%s\2 for \2%s\2", l->vhost, l->nick);
+
+		hs_request_delete(l);
+	}
 }
 
 // WAITING
@@ -582,6 +573,7 @@ mod_init(struct module *const restrict m)
 	MODULE_TRY_REQUEST_DEPENDENCY(m, "hostserv/main")
 
 	hostsvs = service_find("hostserv");
+	hs_reqtree = mowgli_patricia_create(irccasecanon);
 
 	hook_add_user_drop(account_drop_request);
 	hook_add_nick_ungroup(nick_drop_request);
@@ -55,13 +55,9 @@ hs_cmd_vhost(struct sourceinfo *si, int parc, char *parv[])
 	return;
 }
 
-static void
-hs_cmd_listvhost(struct sourceinfo *si, int parc, char *parv[])
+static unsigned int
+listvhost_account(struct sourceinfo *si, struct myuser *mu, const char *pattern)
 {
-	const char *pattern;
-	struct myentity_iteration_state state;
-	struct myentity *mt;
-	struct myuser *mu;
 	struct metadata *md, *md_timestamp, *md_assigner;
 	mowgli_node_t *n;
 	char buf[BUFSIZE], strfbuf[BUFSIZE];
@@ -70,50 +66,89 @@ hs_cmd_listvhost(struct sourceinfo *si, int parc, char *parv[])
 	time_t vhost_time;
 	unsigned int matches = 0;
 
-	pattern = parc >= 1 ? parv[0] : "*";
-
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+	md = metadata_find(mu, "private:usercloak");
+	if (md != NULL && !match(pattern, md->value))
 	{
-		mu = user(mt);
-		md = metadata_find(mu, "private:usercloak");
-		if (md != NULL && !match(pattern, md->value))
-		{
-			md_timestamp = metadata_find(mu, "private:usercloak-timestamp");
-			md_assigner = metadata_find(mu, "private:usercloak-assigner");
+		md_timestamp = metadata_find(mu, "private:usercloak-timestamp");
+		md_assigner = metadata_find(mu, "private:usercloak-assigner");
 
-			buf[0] = '\0';
-			len = 0;
+		buf[0] = '\0';
+		len = 0;
 
-			if (md_timestamp || md_assigner)
-				len += snprintf(buf + len, BUFSIZE - len, _(" assigned"));
+		if (md_timestamp || md_assigner)
+			len += snprintf(buf + len, BUFSIZE - len, _(" assigned"));
 
-			if (md_timestamp)
-			{
-				vhost_time = atoi(md_timestamp->value);
-				tm = localtime(&vhost_time);
-				strftime(strfbuf, sizeof strfbuf, TIME_FORMAT, tm);
-				len += snprintf(buf + len, BUFSIZE - len, _(" on %s (%s ago)"), strfbuf, time_ago(vhost_time));
-			}
+		if (md_timestamp)
+		{
+			vhost_time = atoi(md_timestamp->value);
+			tm = localtime(&vhost_time);
+			strftime(strfbuf, sizeof strfbuf, TIME_FORMAT, tm);
+			len += snprintf(buf + len, BUFSIZE - len, _(" on %s (%s ago)"), strfbuf, time_ago(vhost_time));
+		}
 
-			if (md_assigner)
-				len += snprintf(buf + len, BUFSIZE - len, _(" by %s"), md_assigner->value);
+		if (md_assigner)
+			len += snprintf(buf + len, BUFSIZE - len, _(" by %s"), md_assigner->value);
 
-			command_success_nodata(si, "- %-30s \2%s\2%s", entity(mu)->name, md->value, buf);
+		command_success_nodata(si, "- %-30s \2%s\2%s", entity(mu)->name, md->value, buf);
+		matches++;
+	}
+	MOWGLI_ITER_FOREACH(n, mu->nicks.head)
+	{
+		snprintf(buf, BUFSIZE, "%s:%s", "private:usercloak", ((struct mynick *)(n->data))->nick);
+		md = metadata_find(mu, buf);
+		if (md == NULL)
+			continue;
+		if (!match(pattern, md->value))
+		{
+			command_success_nodata(si, "- %-30s %s", ((struct mynick *)(n->data))->nick, md->value);
 			matches++;
 		}
-		MOWGLI_ITER_FOREACH(n, mu->nicks.head)
+	}
+
+	return matches;
+}
+
+static void
+hs_cmd_listvhost(struct sourceinfo *si, int parc, char *parv[])
+{
+	const char *pattern;
+	struct myentity_iteration_state state;
+	struct myentity *mt;
+	unsigned int matches = 0;
+
+	pattern = parc >= 1 ? parv[0] : "*";
+
+	if (match_is_literal(pattern))
+	{
+		// no wildcards, so only the accounts this exact vhost is assigned to can match
+		const mowgli_list_t *const l = myuser_find_by_vhost(pattern);
+		mowgli_patricia_t *seen;
+		mowgli_node_t *n;
+
+		if (l != NULL)
 		{
-			snprintf(buf, BUFSIZE, "%s:%s", "private:usercloak", ((struct mynick *)(n->data))->nick);
-			md = metadata_find(mu, buf);
-			if (md == NULL)
-				continue;
-			if (!match(pattern, md->value))
+			seen = mowgli_patricia_create(&noopcanon);
+
+			MOWGLI_ITER_FOREACH(n, l->head)
 			{
-				command_success_nodata(si, "- %-30s %s", ((struct mynick *)(n->data))->nick, md->value);
-				matches++;
+				struct myuser *const mu = n->data;
+
+				// an account is listed once for every nick it has this vhost on
+				if (mowgli_patricia_retrieve(seen, entity(mu)->name) != NULL)
+					continue;
+
+				mowgli_patricia_add(seen, entity(mu)->name, mu);
+				matches += listvhost_account(si, mu, pattern);
 			}
+
+			mowgli_patricia_destroy(seen, NULL, NULL);
 		}
 	}
+	else
+	{
+		MYENTITY_FOREACH_T(mt, &state, ENT_USER)
+			matches += listvhost_account(si, user(mt), pattern);
+	}
 
 	logcommand(si, CMDLOG_ADMIN, "LISTVHOST: \2%s\2 (\2%u\2 matches)", pattern, matches);
 	if (matches == 0)
@@ -72,6 +72,9 @@ ms_cmd_sendall(struct sourceinfo *si, int parc, char *parv[])
 	si->smu->memo_ratelimit_num++;
 	si->smu->memo_ratelimit_time = CURRTIME;
 
+	// recipients with the same number of memos get one multi-target notice
+	notice_batch_begin();
+
 	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
 	{
 		struct myuser *tmu = user(mt);
@@ -144,6 +147,8 @@ ms_cmd_sendall(struct sourceinfo *si, int parc, char *parv[])
 		              memoserv->disp, MOWGLI_LIST_LENGTH(&tmu->memos));
 	}
 
+	notice_batch_end();
+
 	// Tell user memo sent, return
 	if (sent > 4)
 		command_add_flood(si, FLOOD_HEAVY);
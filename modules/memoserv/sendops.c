@@ -88,6 +88,9 @@ ms_cmd_sendops(struct sourceinfo *si, int parc, char *parv[])
 	si->smu->memo_ratelimit_num++;
 	si->smu->memo_ratelimit_time = CURRTIME;
 
+	// recipients with the same number of memos get one multi-target notice
+	notice_batch_begin();
+
 	MOWGLI_ITER_FOREACH(tn, mc->chanacs.head)
 	{
 		struct chanacs *ca = (struct chanacs *) tn->data;
@@ -161,6 +164,8 @@ ms_cmd_sendops(struct sourceinfo *si, int parc, char *parv[])
 		              memoserv->disp, MOWGLI_LIST_LENGTH(&tmu->memos));
 	}
 
+	notice_batch_end();
+
 	// Tell user memo sent, return
 	if (sent > 4)
 		command_add_flood(si, FLOOD_HEAVY);
@@ -264,7 +264,13 @@ httpd_recvqhandler(struct connection *cptr)
 
 		hd->method[0] = '\0';
 
-		if (!handling_done)
+		if (handling_done && is_get && ph->get)
+		{
+			ph->handler(cptr, NULL);
+
+			clear_httpddata(hd);
+		}
+		else if (!handling_done)
 		{
 			in = open_file(hd->filename);
 			if (in == -1 || fstat(in, &sb) == -1 || !S_ISREG(sb.st_mode))
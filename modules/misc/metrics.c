@@ -0,0 +1,258 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * OpenMetrics exporter for the HTTP server
+ */
+
+#include <atheme.h>
+
+#define METRICS_BUF_INITIAL     16384U
+
+// Imported from misc/httpd
+static mowgli_list_t *httpd_path_handlers = NULL;
+
+/* The text of the last scrape. The buffer is kept between scrapes so that
+ * it only has to grow once, and the text is reused for scrapes that come in
+ * the same second.
+ */
+static char *metrics_buf = NULL;
+static size_t metrics_len = 0;
+static size_t metrics_alloc = 0;
+static time_t metrics_when = 0;
+
+static void ATHEME_FATTR_PRINTF(1, 2)
+metrics_printf(const char *const restrict fmt, ...)
+{
+	for (;;)
+	{
+		va_list ap;
+
+		va_start(ap, fmt);
+		const int ret = vsnprintf(metrics_buf + metrics_len, metrics_alloc - metrics_len, fmt, ap);
+		va_end(ap);
+
+		if (ret < 0)
+			return;
+
+		if ((size_t) ret < (metrics_alloc - metrics_len))
+		{
+			metrics_len += (size_t) ret;
+			return;
+		}
+
+		metrics_alloc *= 2U;
+		metrics_buf = srealloc(metrics_buf, metrics_alloc);
+	}
+}
+
+// Label values may not contain a raw backslash, double quote or newline
+static const char *
+metrics_escape(const char *restrict in, char *const restrict buf, const size_t len)
+{
+	size_t i = 0;
+
+	for (; *in != '\0' && i < (len - 2U); in++)
+	{
+		if (*in == '\\' || *in == '"')
+			buf[i++] = '\\';
+		else if (*in == '\n')
+		{
+			buf[i++] = '\\';
+			buf[i++] = 'n';
+			continue;
+		}
+
+		buf[i++] = *in;
+	}
+
+	buf[i] = '\0';
+	return buf;
+}
+
+static void
+metrics_family(const char *const restrict name, const char *const restrict type, const char *const restrict help)
+{
+	(void) metrics_printf("# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+static void
+metrics_gauge(const char *const restrict name, const char *const restrict help, const uint64_t value)
+{
+	(void) metrics_family(name, "gauge", help);
+	(void) metrics_printf("%s %" PRIu64 "\n", name, value);
+}
+
+static void
+metrics_counter(const char *const restrict name, const char *const restrict help, const uint64_t value)
+{
+	(void) metrics_family(name, "counter", help);
+	(void) metrics_printf("%s_total %" PRIu64 "\n", name, value);
+}
+
+/* The histograms in core have 8 buckets per power of two; only the last
+ * bucket of each power of two from 1 microsecond up is exposed.
+ */
+static void
+metrics_histogram(const char *const restrict name, const char *const restrict help,
+                  const struct latency_histogram *const restrict hist)
+{
+	uint64_t seen = 0;
+
+	(void) metrics_family(name, "histogram", help);
+
+	// The last bucket also counts everything that is too long for it, so it is left to +Inf
+	for (unsigned int i = 0; i < (LATENCY_BUCKETS - 1U); i++)
+	{
+		seen += hist->buckets[i];
+
+		if ((i % LATENCY_SUB_BUCKETS) != (LATENCY_SUB_BUCKETS - 1U) || latency_bucket_limit(i) < 1000U)
+			continue;
+
+		(void) metrics_printf("%s_bucket{le=\"%.11g\"} %" PRIu64 "\n", name, latency_bucket_limit(i) / 1e9, seen);
+	}
+
+	(void) metrics_printf("%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, hist->count);
+	(void) metrics_printf("%s_count %" PRIu64 "\n", name, hist->count);
+	(void) metrics_printf("%s_sum %.9f\n", name, hist->total / 1e9);
+}
+
+static void
+metrics_latency_stat(const struct latency_stat *const restrict stat, void ATHEME_VATTR_UNUSED *const restrict priv)
+{
+	static const unsigned int quantiles[] = { 500U, 900U, 990U, 999U };
+
+	const struct latency_histogram *const hist = &stat->hist;
+	char kind[BUFSIZE], name[BUFSIZE];
+
+	if (! hist->count)
+		return;
+
+	(void) metrics_escape(latency_kind_name(stat->kind), kind, sizeof kind);
+	(void) metrics_escape(stat->name, name, sizeof name);
+
+	for (size_t i = 0; i < ARRAY_SIZE(quantiles); i++)
+		(void) metrics_printf("atheme_latency_seconds{kind=\"%s\",name=\"%s\",quantile=\"%g\"} %.9f\n", kind,
+		                      name, quantiles[i] / 1000.0, latency_percentile(hist, quantiles[i]) / 1e9);
+
+	(void) metrics_printf("atheme_latency_seconds_count{kind=\"%s\",name=\"%s\"} %" PRIu64 "\n", kind, name,
+	                      hist->count);
+	(void) metrics_printf("atheme_latency_seconds_sum{kind=\"%s\",name=\"%s\"} %.9f\n", kind, name,
+	                      hist->total / 1e9);
+}
+
+static void
+metrics_generate(void)
+{
+	const struct sasl_core_functions *sasl = NULL;
+	size_t sendq_bytes = 0;
+	mowgli_node_t *n;
+
+	metrics_len = 0;
+	*metrics_buf = '\0';
+
+	MOWGLI_ITER_FOREACH(n, connection_list.head)
+		sendq_bytes += sendq_length(n->data);
+
+	(void) metrics_gauge("atheme_start_time_seconds", "When services were started.", (uint64_t) me.start);
+	(void) metrics_gauge("atheme_uplink_connected", "Whether services are linked to the network.",
+	                     me.connected ? 1U : 0U);
+	(void) metrics_gauge("atheme_servers", "Servers on the network.", cnt.server);
+	(void) metrics_gauge("atheme_users", "Users on the network.", cnt.user);
+	(void) metrics_gauge("atheme_channels", "Channels on the network.", cnt.chan);
+	(void) metrics_gauge("atheme_channel_members", "Users in channels, counted once per channel.", cnt.chanuser);
+	(void) metrics_gauge("atheme_accounts", "Registered accounts.", cnt.myuser);
+	(void) metrics_gauge("atheme_nicknames", "Registered nicknames.", cnt.mynick);
+	(void) metrics_gauge("atheme_registered_channels", "Registered channels.", cnt.mychan);
+	(void) metrics_gauge("atheme_chanacs", "Channel access list entries.", cnt.chanacs);
+	(void) metrics_gauge("atheme_connections", "Open connections, including listeners.", connection_count());
+	(void) metrics_gauge("atheme_sendq_bytes", "Bytes waiting to be sent on all connections.", sendq_bytes);
+
+	(void) metrics_counter("atheme_received_lines", "Lines received from the uplink.", cnt.lines_in);
+	(void) metrics_counter("atheme_received_bytes", "Bytes received, wrapping at 4 GiB.", cnt.bin);
+	(void) metrics_counter("atheme_sent_bytes", "Bytes sent, wrapping at 4 GiB.", cnt.bout);
+
+	(void) metrics_histogram("atheme_db_save_seconds", "How long writing the database takes.", &db_save_latency);
+	(void) metrics_histogram("atheme_password_verify_seconds", "How long checking a password takes.",
+	                         &crypt_verify_latency);
+	(void) metrics_histogram("atheme_password_hash_seconds", "How long hashing a new password takes.",
+	                         &crypt_latency);
+
+	if (module_find_published("saslserv/main"))
+		sasl = module_locate_symbol("saslserv/main", "sasl_core_functions");
+
+	if (sasl && sasl->session_count)
+		(void) metrics_gauge("atheme_sasl_sessions", "SASL sessions in progress.", sasl->session_count());
+
+	(void) metrics_gauge("atheme_latency_enabled", "Whether hook handlers and commands are being timed "
+	                     "(see OperServ LATENCY).", latency_enabled ? 1U : 0U);
+	(void) metrics_family("atheme_latency_seconds", "summary", "How long hook handlers and commands take.");
+	(void) latency_foreach(&metrics_latency_stat, NULL);
+
+	(void) metrics_printf("# EOF\n");
+}
+
+static void
+metrics_handle_request(struct connection *const restrict cptr, void ATHEME_VATTR_UNUSED *const restrict requestbuf)
+{
+	const struct httpddata *const hd = cptr->userdata;
+	char buf[BUFSIZE];
+
+	if (! metrics_len || metrics_when != CURRTIME)
+	{
+		(void) metrics_generate();
+
+		metrics_when = CURRTIME;
+	}
+
+	(void) snprintf(buf, sizeof buf,
+	                "HTTP/1.1 200 OK\r\n"
+	                "Server: %s/%s\r\n"
+	                "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+	                "Content-Length: %zu\r\n"
+	                "%s"
+	                "\r\n",
+	                PACKAGE_TARNAME, PACKAGE_VERSION, metrics_len,
+	                hd->connection_close ? "Connection: close\r\n" : "");
+
+	(void) sendq_add(cptr, buf, strlen(buf));
+	(void) sendq_add(cptr, metrics_buf, metrics_len);
+
+	if (hd->connection_close)
+		(void) sendq_add_eof(cptr);
+}
+
+static struct path_handler metrics_path_handler = {
+	.path           = "/metrics",
+	.handler        = &metrics_handle_request,
+	.get            = true,
+};
+
+static void
+mod_init(struct module *const restrict m)
+{
+	MODULE_TRY_REQUEST_SYMBOL(m, httpd_path_handlers, "misc/httpd", "httpd_path_handlers")
+
+	metrics_alloc = METRICS_BUF_INITIAL;
+	metrics_buf = smalloc(metrics_alloc);
+
+	(void) mowgli_node_add(&metrics_path_handler, mowgli_node_create(), httpd_path_handlers);
+}
+
+static void
+mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
+{
+	mowgli_node_t *n;
+
+	if ((n = mowgli_node_find(&metrics_path_handler, httpd_path_handlers)) != NULL)
+	{
+		(void) mowgli_node_delete(n, httpd_path_handlers);
+		(void) mowgli_node_free(n);
+	}
+
+	(void) sfree(metrics_buf);
+}
+
+SIMPLE_DECLARE_MODULE_V1("misc/metrics", MODULE_UNLOAD_CAPABILITY_OK)
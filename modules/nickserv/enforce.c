@@ -21,16 +21,17 @@ struct enforce_timeout
 {
 	char nick[NICKLEN + 1];
 	char host[HOSTLEN + 1];
-	time_t timelimit;
+	struct timerwheel_entry entry;
 	mowgli_node_t node;
 };
 
+#define ENFORCE_TIMEOUT(e)      ((struct enforce_timeout *) (void *) ((char *) (e) - offsetof(struct enforce_timeout, entry)))
+
 static mowgli_heap_t *enforce_timeout_heap = NULL;
-static mowgli_eventloop_timer_t *enforce_timeout_check_timer = NULL;
+static struct timerwheel_handle *enforce_timeout_handle = NULL;
 static mowgli_eventloop_timer_t *enforce_remove_enforcers_timer = NULL;
 
 static mowgli_list_t enforce_list;
-static time_t enforce_next;
 
 static mowgli_patricia_t **ns_set_cmdtree;
 
@@ -92,56 +93,76 @@ guest_nickname(struct user *u)
 }
 
 static void
-enforce_timeout_check(void *arg)
+enforce_timeout_free(struct enforce_timeout *timeout)
+{
+	timerwheel_cancel(&timeout->entry);
+	mowgli_node_delete(&timeout->node, &enforce_list);
+	mowgli_heap_free(enforce_timeout_heap, timeout);
+}
+
+static void
+enforce_timeout_cancelled(struct timerwheel_entry *entry)
+{
+	enforce_timeout_free(ENFORCE_TIMEOUT(entry));
+}
+
+// if this (nick, host) is waiting to be enforced, remove it
+static void
+enforce_timeout_remove(const char *nick, const struct user *u)
 {
 	mowgli_node_t *n, *tn;
 	struct enforce_timeout *timeout;
-	struct user *u;
-	struct mynick *mn;
-	bool valid;
 
-	enforce_next = 0;
 	MOWGLI_ITER_FOREACH_SAFE(n, tn, enforce_list.head)
 	{
 		timeout = n->data;
-		if (timeout->timelimit > CURRTIME)
-		{
-			enforce_next = timeout->timelimit;
-			enforce_timeout_check_timer = mowgli_timer_add_once(base_eventloop, "enforce_timeout_check", enforce_timeout_check, NULL, enforce_next - CURRTIME);
-			break; // assume sorted list
-		}
-		u = user_find_named(timeout->nick);
-		mn = mynick_find(timeout->nick);
-		valid = u != NULL && mn != NULL && (!strcmp(u->host, timeout->host) || !strcmp(u->vhost, timeout->host));
-		mowgli_node_delete(&timeout->node, &enforce_list);
-		mowgli_heap_free(enforce_timeout_heap, timeout);
-		if (!valid)
-			continue;
-		if (is_internal_client(u))
-			continue;
-		if (u->myuser == mn->owner)
-			continue;
-		if (myuser_access_verify(u, mn->owner))
-			continue;
-		if (!metadata_find(mn->owner, "private:doenforce"))
-			continue;
-
-		notice(nicksvs.nick, u->nick, "You failed to identify in time for the nickname %s", mn->nick);
-		guest_nickname(u);
-		if (ircd->flags & IRCD_HOLDNICK)
-			holdnick_sts(nicksvs.me->me, u->flags & UF_WASENFORCED ? SECONDS_PER_HOUR : 30, u->nick, mn->owner);
-		else
-			u->flags |= UF_DOENFORCE;
-		u->flags |= UF_WASENFORCED;
+		if (!irccasecmp(nick, timeout->nick) && (!strcmp(u->host, timeout->host) || !strcmp(u->vhost, timeout->host)))
+			enforce_timeout_free(timeout);
 	}
 }
 
+static void
+enforce_timeout_expire(struct timerwheel_entry *entry)
+{
+	struct enforce_timeout *timeout = ENFORCE_TIMEOUT(entry);
+	struct user *u;
+	struct mynick *mn;
+	bool valid;
+
+	u = user_find_named(timeout->nick);
+	mn = mynick_find(timeout->nick);
+	valid = u != NULL && mn != NULL && (!strcmp(u->host, timeout->host) || !strcmp(u->vhost, timeout->host));
+	enforce_timeout_free(timeout);
+	if (!valid)
+		return;
+	if (is_internal_client(u))
+		return;
+	if (u->myuser == mn->owner)
+		return;
+	if (myuser_access_verify(u, mn->owner))
+		return;
+	if (!metadata_find(mn->owner, "private:doenforce"))
+		return;
+
+	notice(nicksvs.nick, u->nick, "You failed to identify in time for the nickname %s", mn->nick);
+	guest_nickname(u);
+	if (ircd->flags & IRCD_HOLDNICK)
+		holdnick_sts(nicksvs.me->me, u->flags & UF_WASENFORCED ? SECONDS_PER_HOUR : 30, u->nick, mn->owner);
+	else
+		u->flags |= UF_DOENFORCE;
+	u->flags |= UF_WASENFORCED;
+}
+
 static void
 check_enforce(struct hook_nick_enforce *hdata)
 {
-	struct enforce_timeout *timeout, *timeout2;
+	struct enforce_timeout *timeout;
+#ifdef SHOW_CORRECT_TIMEOUT_BUT_BE_SLOW
+	struct enforce_timeout *timeout2;
 	mowgli_node_t *n;
+#endif
 	struct metadata *md;
+	time_t timelimit;
 
 	// nick is a service, ignore it
 	if (is_internal_client(hdata->u))
@@ -178,38 +199,19 @@ check_enforce(struct hook_nick_enforce *hdata)
 		mowgli_strlcpy(timeout->host, hdata->u->host, sizeof timeout->host);
 
 		if (!metadata_find(hdata->mn->owner, "private:enforcetime"))
-			timeout->timelimit = CURRTIME + nicksvs.enforce_delay;
+			timelimit = CURRTIME + nicksvs.enforce_delay;
 		else
 		{
 			md = metadata_find(hdata->mn->owner, "private:enforcetime");
 			int enforcetime = atoi(md->value);
-			timeout->timelimit = CURRTIME + enforcetime;
-		}
-
-		// insert in sorted order
-		MOWGLI_ITER_FOREACH_PREV(n, enforce_list.tail)
-		{
-			timeout2 = n->data;
-			if (timeout2->timelimit <= timeout->timelimit)
-				break;
+			timelimit = CURRTIME + enforcetime;
 		}
-		if (n == NULL)
-			mowgli_node_add_head(timeout, &timeout->node, &enforce_list);
-		else if (n->next == NULL)
-			mowgli_node_add(timeout, &timeout->node, &enforce_list);
-		else
-			mowgli_node_add_before(timeout, &timeout->node, &enforce_list, n->next);
 
-		if (enforce_next == 0 || enforce_next > timeout->timelimit)
-		{
-			if (enforce_next != 0)
-				mowgli_timer_destroy(base_eventloop, enforce_timeout_check_timer);
-			enforce_next = timeout->timelimit;
-			enforce_timeout_check_timer = mowgli_timer_add_once(base_eventloop, "enforce_timeout_check", enforce_timeout_check, NULL, enforce_next - CURRTIME);
-		}
+		mowgli_node_add(timeout, &timeout->node, &enforce_list);
+		timerwheel_schedule(enforce_timeout_handle, &timeout->entry, timelimit);
 	}
 
-	notice(nicksvs.nick, hdata->u->nick, "You have %u seconds to identify to your nickname before it is changed.", (unsigned int)(timeout->timelimit - CURRTIME));
+	notice(nicksvs.nick, hdata->u->nick, "You have %u seconds to identify to your nickname before it is changed.", (unsigned int)(timeout->entry.expires - CURRTIME));
 }
 
 static void
@@ -281,8 +283,6 @@ ns_cmd_release(struct sourceinfo *si, int parc, char *parv[])
 	const char *target = parv[0];
 	const char *password = parv[1];
 	struct user *u;
-	mowgli_node_t *n, *tn;
-	struct enforce_timeout *timeout;
 
 	// Absolutely do not do anything like this if nicks are not considered owned
 	if (nicksvs.no_nick_ownership)
@@ -329,19 +329,8 @@ ns_cmd_release(struct sourceinfo *si, int parc, char *parv[])
 	}
 	if ((si->smu == mn->owner) || verify_password(mn->owner, password))
 	{
-		// if this (nick, host) is waiting to be enforced, remove it
 		if (si->su != NULL)
-		{
-			MOWGLI_ITER_FOREACH_SAFE(n, tn, enforce_list.head)
-			{
-				timeout = n->data;
-				if (!irccasecmp(mn->nick, timeout->nick) && (!strcmp(si->su->host, timeout->host) || !strcmp(si->su->vhost, timeout->host)))
-				{
-					mowgli_node_delete(&timeout->node, &enforce_list);
-					mowgli_heap_free(enforce_timeout_heap, timeout);
-				}
-			}
-		}
+			enforce_timeout_remove(mn->nick, si->su);
 		if (u == NULL || is_internal_client(u))
 		{
 			logcommand(si, CMDLOG_DO, "RELEASE: \2%s\2", target);
@@ -392,7 +381,6 @@ ns_cmd_regain(struct sourceinfo *si, int parc, char *parv[])
 	const char *password = parv[1];
 	struct user *u;
 	mowgli_node_t *n, *tn;
-	struct enforce_timeout *timeout;
 	char lau[BUFSIZE];
 
 	// Absolutely do not do anything like this if nicks are not considered owned
@@ -501,19 +489,8 @@ ns_cmd_regain(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		// if this (nick, host) is waiting to be enforced, remove it
 		if (si->su != NULL)
-		{
-			MOWGLI_ITER_FOREACH_SAFE(n, tn, enforce_list.head)
-			{
-				timeout = n->data;
-				if (!irccasecmp(mn->nick, timeout->nick) && (!strcmp(si->su->host, timeout->host) || !strcmp(si->su->vhost, timeout->host)))
-				{
-					mowgli_node_delete(&timeout->node, &enforce_list);
-					mowgli_heap_free(enforce_timeout_heap, timeout);
-				}
-			}
-		}
+			enforce_timeout_remove(mn->nick, si->su);
 		if (u != NULL && is_service(u))
 		{
 			command_fail(si, fault_badparams, _("You cannot regain a network service."));
@@ -670,6 +647,7 @@ mod_init(struct module *const restrict m)
 		return;
 	}
 
+	enforce_timeout_handle = timerwheel_handle_create("nickserv/enforce", &enforce_timeout_expire);
 	enforce_remove_enforcers_timer = mowgli_timer_add(base_eventloop, "enforce_remove_enforcers", enforce_remove_enforcers, NULL, 5 * SECONDS_PER_MINUTE);
 
 	service_named_bind_command("nickserv", &ns_release);
@@ -687,8 +665,7 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 
 	mowgli_timer_destroy(base_eventloop, enforce_remove_enforcers_timer);
 
-	if (enforce_next)
-		mowgli_timer_destroy(base_eventloop, enforce_timeout_check_timer);
+	timerwheel_handle_destroy(enforce_timeout_handle, &enforce_timeout_cancelled);
 
 	service_named_unbind_command("nickserv", &ns_release);
 	service_named_unbind_command("nickserv", &ns_regain);
@@ -96,7 +96,7 @@ ns_cmd_freeze(struct sourceinfo *si, int parc, char *parv[])
 				mowgli_node_free(n);
 			}
 		}
-		mu->flags |= MU_NOBURSTLOGIN;
+		myuser_set_flags(mu, mu->flags | MU_NOBURSTLOGIN);
 		authcookie_destroy_all(mu);
 
 		wallops("\2%s\2 froze the account \2%s\2 (%s).", get_oper_name(si), target, reason);
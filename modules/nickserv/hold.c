@@ -47,7 +47,7 @@ ns_cmd_hold(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mu->flags |= MU_HOLD;
+		myuser_set_flags(mu, mu->flags | MU_HOLD);
 
 		wallops("\2%s\2 set the HOLD option for the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "HOLD:ON: \2%s\2", entity(mu)->name);
@@ -61,7 +61,7 @@ ns_cmd_hold(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mu->flags &= ~MU_HOLD;
+		myuser_set_flags(mu, mu->flags & ~MU_HOLD);
 
 		wallops("\2%s\2 removed the HOLD option on the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "HOLD:OFF: \2%s\2", entity(mu)->name);
@@ -95,6 +95,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param hold;
 	hold.opttype = OPT_BOOL;
 	hold.is_match = is_held;
+	hold.flag = MU_HOLD;
 
 	list_register("hold", &hold);
 	list_register("held", &hold);
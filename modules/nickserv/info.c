@@ -38,7 +38,7 @@ ns_cmd_info(struct sourceinfo *si, int parc, char *parv[])
 	struct tm *tm, *tm2;
 	struct metadata *md;
 	mowgli_node_t *n;
-	mowgli_patricia_iteration_state_t state;
+	struct metadata_iteration_state state;
 	const char *vhost;
 	const char *vhost_timestring;
 	const char *vhost_assigner;
@@ -309,7 +309,7 @@ ns_cmd_info(struct sourceinfo *si, int parc, char *parv[])
 					(mu->flags & MU_HIDEMAIL) ? " (hidden)": "");
 
 	unsigned int mdcount = 0;
-	MOWGLI_PATRICIA_FOREACH(md, &state, atheme_object(mu)->metadata)
+	METADATA_FOREACH(md, &state, mu)
 	{
 		if (!strncmp(md->name, "private:", 8))
 			continue;
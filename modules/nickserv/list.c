@@ -16,8 +16,34 @@
 extern void list_register(const char *, struct list_param *);
 extern void list_unregister(const char *);
 
+#define LIST_MAXPARC 10
+
 static mowgli_patricia_t *list_params;
 
+// A parsed LIST criterion
+struct list_criterion
+{
+	const struct list_param *       param;
+	const void *                    arg;
+	union {
+		bool                    boolval;
+		int                     intval;
+		time_t                  ageval;
+	} val;
+};
+
+// State of a LIST while matching nicks are sent
+struct list_state
+{
+	struct sourceinfo *             si;
+	const struct list_criterion *   crit;
+	size_t                          ncrit;
+	unsigned int                    limit;
+	unsigned int                    offset;
+	unsigned int                    skipped;
+	unsigned int                    matches;
+};
+
 static bool
 email_match(const struct mynick *mn, const void *arg)
 {
@@ -27,6 +53,44 @@ email_match(const struct mynick *mn, const void *arg)
 	return !match(cmpr, mu->email);
 }
 
+static bool
+email_candidates(const void *arg, size_t *count, list_candidate_fn fn, void *priv)
+{
+	const char *cmpr = (const char*)arg;
+	const mowgli_list_t *l;
+	mowgli_node_t *n, *n2;
+
+	if (!match_is_literal(cmpr))
+		return false;
+
+	*count = 0;
+
+	// addresses that are equal ignoring case have the same canonical form
+	if ((l = myuser_find_by_email(cmpr)) == NULL)
+		return true;
+
+	MOWGLI_ITER_FOREACH(n, l->head)
+	{
+		struct myuser *mu = n->data;
+
+		*count += MOWGLI_LIST_LENGTH(&mu->nicks);
+	}
+
+	if (fn == NULL)
+		return true;
+
+	MOWGLI_ITER_FOREACH(n, l->head)
+	{
+		struct myuser *mu = n->data;
+
+		MOWGLI_ITER_FOREACH(n2, mu->nicks.head)
+			if (!fn(n2->data, priv))
+				return true;
+	}
+
+	return true;
+}
+
 static bool
 lastlogin_match(const struct mynick *mn, const void *arg)
 {
@@ -36,37 +100,48 @@ lastlogin_match(const struct mynick *mn, const void *arg)
 	return (CURRTIME - mu->lastlogin) > lastlogin;
 }
 
+static void
+split_pattern(const char *pattern, char pat[static 512], char **nickpattern, char **hostpattern)
+{
+	char *p;
+
+	*nickpattern = NULL;
+	*hostpattern = NULL;
+
+	if (pattern == NULL)
+		return;
+
+	mowgli_strlcpy(pat, pattern, 512);
+	p = strrchr(pat, ' ');
+	if (p == NULL)
+		p = strrchr(pat, '!');
+	if (p != NULL)
+	{
+		*p++ = '\0';
+		*nickpattern = pat;
+		*hostpattern = p;
+	}
+	else if (strchr(pat, '@'))
+		*hostpattern = pat;
+	else
+		*nickpattern = pat;
+	if (*nickpattern && !strcmp(*nickpattern, "*"))
+		*nickpattern = NULL;
+}
+
 static bool
 pattern_match(const struct mynick *mn, const void *arg)
 {
 	const char *pattern = (const char*)arg;
 
-	char pat[512], *nickpattern = NULL, *hostpattern = NULL, *p;
+	char pat[512], *nickpattern, *hostpattern;
 	struct metadata *md;
 
 	bool hostmatch;
 
 	struct myuser *mu = mn->owner;
 
-	if (pattern != NULL)
-	{
-		mowgli_strlcpy(pat, pattern, sizeof pat);
-		p = strrchr(pat, ' ');
-		if (p == NULL)
-			p = strrchr(pat, '!');
-		if (p != NULL)
-		{
-			*p++ = '\0';
-			nickpattern = pat;
-			hostpattern = p;
-		}
-		else if (strchr(pat, '@'))
-			hostpattern = pat;
-		else
-			nickpattern = pat;
-		if (nickpattern && !strcmp(nickpattern, "*"))
-			nickpattern = NULL;
-	}
+	split_pattern(pattern, pat, &nickpattern, &hostpattern);
 
 	if (nickpattern && match(nickpattern, mn->nick))
 		return false;
@@ -87,6 +162,26 @@ pattern_match(const struct mynick *mn, const void *arg)
 	return true;
 }
 
+static bool
+pattern_candidates(const void *arg, size_t *count, list_candidate_fn fn, void *priv)
+{
+	char pat[512], *nickpattern, *hostpattern;
+	struct mynick *mn;
+
+	split_pattern((const char*)arg, pat, &nickpattern, &hostpattern);
+
+	if (nickpattern == NULL || !match_is_literal(nickpattern))
+		return false;
+
+	mn = mynick_find(nickpattern);
+	*count = (mn != NULL) ? 1 : 0;
+
+	if (mn != NULL && fn != NULL)
+		(void) fn(mn, priv);
+
+	return true;
+}
+
 static bool
 registered_match(const struct mynick *mn, const void *arg)
 {
@@ -203,110 +298,205 @@ list_one(struct sourceinfo *si, struct myuser *mu, struct mynick *mn)
 		command_success_nodata(si, "- %s (%s) (%s) %s", mn->nick, mu->email, entity(mu)->name, buf);
 }
 
+static bool
+criteria_match(const struct list_criterion *crit, size_t ncrit, const struct mynick *mn)
+{
+	for (size_t i = 0; i < ncrit; i++)
+		if (!crit[i].param->is_match(mn, crit[i].arg))
+			return false;
+
+	return true;
+}
+
+// Sends a nick if it matches every criterion; returns false once LIMIT is reached
+static bool
+list_visit(struct mynick *mn, void *priv)
+{
+	struct list_state *const ls = priv;
+
+	if (!criteria_match(ls->crit, ls->ncrit, mn))
+		return true;
+
+	if (ls->skipped < ls->offset)
+	{
+		ls->skipped++;
+		return true;
+	}
+
+	list_one(ls->si, NULL, mn);
+	ls->matches++;
+
+	return !(ls->limit && ls->matches >= ls->limit);
+}
+
+static int
+list_visit_account(struct myuser *mu, void *priv)
+{
+	mowgli_node_t *n;
+
+	MOWGLI_ITER_FOREACH(n, mu->nicks.head)
+		if (!list_visit(n->data, priv))
+			return 1;
+
+	return 0;
+}
+
+/* Walks the smallest set of nicks any index can give for the criteria,
+ * including the accounts having every flag asked for, and sends those that
+ * match as they are found. Returns false if no index applies, in which case
+ * every registered nick has to be looked at.
+ */
+static bool
+list_from_index(struct list_state *ls)
+{
+	const struct list_criterion *best = NULL;
+	size_t best_count = 0;
+	unsigned int flagset = 0;
+
+	for (size_t i = 0; i < ls->ncrit; i++)
+	{
+		const struct list_criterion *const c = &ls->crit[i];
+		size_t count;
+
+		flagset |= c->param->flag;
+
+		if (c->param->candidates == NULL || !c->param->candidates(c->arg, &count, NULL, NULL))
+			continue;
+
+		if (best == NULL || count < best_count)
+		{
+			best = c;
+			best_count = count;
+		}
+	}
+
+	// the flag index counts accounts, which have at least one nick each
+	if (flagset != 0 && (best == NULL || myuser_count_with_flags(flagset) < best_count))
+	{
+		myuser_foreach_with_flags(flagset, list_visit_account, ls);
+		return true;
+	}
+
+	if (best == NULL)
+		return false;
+
+	(void) best->param->candidates(best->arg, &best_count, list_visit, ls);
+	return true;
+}
+
 static void
 ns_cmd_list(struct sourceinfo *si, int parc, char *parv[])
 {
 	char criteriastr[BUFSIZE];
 
 	mowgli_patricia_iteration_state_t state;
-	struct myentity_iteration_state mestate;
 	struct mynick *mn;
 
-	unsigned int matches = 0;
+	struct list_criterion crit[LIST_MAXPARC];
+	size_t ncrit = 0;
+
+	unsigned int limit = 0, offset = 0;
 
 	int i;
-	bool error = false;
-	bool found;
 
-	MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+	// parse the criteria once, up front
+	for (i = 0; i < parc; i++)
 	{
-		found = true;
+		const struct list_param *param;
 
-		for (i = 0; i < parc; i++)
+		if (!strcasecmp(parv[i], "limit") || !strcasecmp(parv[i], "offset"))
 		{
-			struct list_param *param = mowgli_patricia_retrieve(list_params, parv[i]);
+			unsigned int *const val = (!strcasecmp(parv[i], "limit")) ? &limit : &offset;
 
-			if (param == NULL) {
-				command_fail(si, fault_badparams, _("\2%s\2 is not a recognized LIST criterion"), parv[i]);
-				error = true;
-				break;
+			if (i + 1 >= parc)
+			{
+				command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
+				return;
 			}
-
-			if (param->opttype == OPT_BOOL) {
-				bool arg = true;
-
-				if (!param->is_match(mn, &arg)) {
-					found = false;
-					break;
-				}
-			} else if (param->opttype == OPT_INT) {
-				if (i + 1 < parc) {
-					int arg = atoi(parv[++i]);
-
-					if (!param->is_match (mn, &arg)) {
-						found = false;
-						break;
-					}
-				} else {
-					command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
-					error = true;
-					break;
-				}
-			} else if (param->opttype == OPT_STRING) {
-				if (i + 1 < parc) {
-					if (!param->is_match (mn, parv[++i])) {
-						found = false;
-						break;
-					}
-				} else {
-					command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
-					error = true;
-					break;
-				}
-			}
-			else if (param->opttype == OPT_AGE) {
-				if (i + 1 < parc)
-				{
-					time_t age = parse_age(parv[++i]);
-
-					if (!param->is_match (mn, &age)) {
-						found = false;
-						break;
-					}
-				} else {
-					command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
-					error = true;
-					break;
-				}
+			if (!string_to_uint(parv[i + 1], val))
+			{
+				command_fail(si, fault_badparams, STR_INVALID_PARAMS, parv[i]);
+				return;
 			}
-		} //for (i = 0; i < parc; i++)
 
-		if (error) {
-			break;
+			i++;
+			continue;
 		}
 
-		if (found) {
-			list_one(si, NULL, mn);
-			matches++;
+		if ((param = mowgli_patricia_retrieve(list_params, parv[i])) == NULL)
+		{
+			command_fail(si, fault_badparams, _("\2%s\2 is not a recognized LIST criterion"), parv[i]);
+			return;
 		}
-	} //MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+
+		if (param->opttype != OPT_BOOL && param->opttype != OPT_FLAG && i + 1 >= parc)
+		{
+			command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, parv[i]);
+			return;
+		}
+
+		struct list_criterion *const c = &crit[ncrit];
+
+		c->param = param;
+
+		switch (param->opttype)
+		{
+			case OPT_BOOL:
+			case OPT_FLAG:
+				c->val.boolval = true;
+				c->arg = &c->val.boolval;
+				break;
+			case OPT_INT:
+				c->val.intval = atoi(parv[++i]);
+				c->arg = &c->val.intval;
+				break;
+			case OPT_STRING:
+				c->arg = parv[++i];
+				break;
+			case OPT_AGE:
+				c->val.ageval = parse_age(parv[++i]);
+				c->arg = &c->val.ageval;
+				break;
+		}
+
+		ncrit++;
+	}
 
 	build_criteriastr(criteriastr, parc, parv);
 
-	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, matches);
-	if (matches == 0)
+	struct list_state ls = {
+		.si             = si,
+		.crit           = crit,
+		.ncrit          = ncrit,
+		.limit          = limit,
+		.offset         = offset,
+	};
+
+	/* Matching nicks are sent as they are found, so even huge result sets
+	 * are never collected in memory; LIMIT and OFFSET allow paging
+	 * through them.
+	 */
+	if (!list_from_index(&ls))
+	{
+		MOWGLI_PATRICIA_FOREACH(mn, &state, nicklist)
+			if (!list_visit(mn, &ls))
+				break;
+	}
+
+	logcommand(si, CMDLOG_ADMIN, "LIST: \2%s\2 (\2%u\2 matches)", criteriastr, ls.matches);
+	if (ls.matches == 0)
 		command_success_nodata(si, _("No nicknames matched criteria \2%s\2"), criteriastr);
 	else
 		command_success_nodata(si, ngettext(N_("\2%u\2 match for criteria \2%s\2."),
-		                                    N_("\2%u\2 matches for criteria \2%s\2."), matches),
-		                                    matches, criteriastr);
+		                                    N_("\2%u\2 matches for criteria \2%s\2."), ls.matches),
+		                                    ls.matches, criteriastr);
 }
 
 static struct command ns_list = {
 	.name           = "LIST",
 	.desc           = N_("Lists nicknames registered matching a given pattern."),
 	.access         = PRIV_USER_AUSPEX,
-	.maxparc        = 10,
+	.maxparc        = LIST_MAXPARC,
 	.cmd            = &ns_cmd_list,
 	.help           = { .path = "nickserv/list" },
 };
@@ -323,6 +513,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param email;
 	email.opttype = OPT_STRING;
 	email.is_match = email_match;
+	email.candidates = email_candidates;
 
 	static struct list_param lastlogin;
 	lastlogin.opttype = OPT_AGE;
@@ -331,6 +522,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param pattern;
 	pattern.opttype = OPT_STRING;
 	pattern.is_match = pattern_match;
+	pattern.candidates = pattern_candidates;
 
 	static struct list_param registered;
 	registered.opttype = OPT_AGE;
@@ -351,6 +543,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param waitauth;
 	waitauth.opttype = OPT_BOOL;
 	waitauth.is_match = has_waitauth;
+	waitauth.flag = MU_WAITAUTH;
 
 	list_register("waitauth", &waitauth);
 }
@@ -21,10 +21,28 @@ enum list_opttype
 	OPT_AGE,
 };
 
+typedef bool (*list_candidate_fn)(struct mynick *mn, void *priv);
+
 struct list_param
 {
 	enum list_opttype opttype;
 	bool (*is_match)(const struct mynick *mn, const void *arg);
+
+	/* Optional. If an index can answer this criterion for the given
+	 * argument, store an upper bound on the number of nicks that can
+	 * match in *count and return true; if fn is not NULL, also call it
+	 * for (at least) every such nick until it returns false. The LIST
+	 * command then only evaluates the criteria for the nicks of the
+	 * smallest such index instead of for every registered nick. Return
+	 * false if the argument cannot be answered from an index.
+	 */
+	bool (*candidates)(const void *arg, size_t *count, list_candidate_fn fn, void *priv);
+
+	/* Optional. For OPT_BOOL criteria that are true exactly for the
+	 * accounts with this MU_* flag set; the LIST command can then take
+	 * its candidates from the account flag indexes.
+	 */
+	unsigned int flag;
 };
 
 #endif /* !ATHEME_MOD_NICKSERV_LIST_COMMON_H */
@@ -17,6 +17,17 @@ struct listmail_state
 	unsigned int matches;
 };
 
+static void
+listmail_report(struct listmail_state *state, struct myuser *mu)
+{
+	// in the future we could add a LIMIT parameter
+	if (state->matches == 0)
+		command_success_nodata(state->origin, _("Accounts matching e-mail address \2%s\2:"), state->pattern);
+
+	command_success_nodata(state->origin, "- %s (%s)", entity(mu)->name, mu->email);
+	state->matches++;
+}
+
 static int
 listmail_foreach_cb(struct myentity *mt, void *privdata)
 {
@@ -24,14 +35,7 @@ listmail_foreach_cb(struct myentity *mt, void *privdata)
 	struct myuser *mu = user(mt);
 
 	if (state->email_canonical == mu->email_canonical || !match(state->pattern, mu->email))
-	{
-		// in the future we could add a LIMIT parameter
-		if (state->matches == 0)
-			command_success_nodata(state->origin, _("Accounts matching e-mail address \2%s\2:"), state->pattern);
-
-		command_success_nodata(state->origin, "- %s (%s)", entity(mu)->name, mu->email);
-		state->matches++;
-	}
+		listmail_report(state, mu);
 
 	return 0;
 }
@@ -53,7 +57,20 @@ ns_cmd_listmail(struct sourceinfo *si, int parc, char *parv[])
 	state.pattern = email;
 	state.email_canonical = canonicalize_email(email);
 	state.origin = si;
-	myentity_foreach_t(ENT_USER, listmail_foreach_cb, &state);
+
+	if (match_is_literal(email))
+	{
+		// no wildcards, so only accounts with the same canonical address can match
+		const mowgli_list_t *const l = myuser_find_by_email_canonical(state.email_canonical);
+		mowgli_node_t *n;
+
+		if (l != NULL)
+			MOWGLI_ITER_FOREACH(n, l->head)
+				listmail_report(&state, n->data);
+	}
+	else
+		myentity_foreach_t(ENT_USER, listmail_foreach_cb, &state);
+
 	strshare_unref(state.email_canonical);
 
 	logcommand(si, CMDLOG_ADMIN, "LISTMAIL: \2%s\2 (\2%u\2 matches)", email, state.matches);
@@ -14,8 +14,8 @@ static bool listownmail_canon = false;
 static void
 ns_cmd_listownmail(struct sourceinfo *si, int parc, char *parv[])
 {
-	struct myentity *mt;
-	struct myentity_iteration_state state;
+	const mowgli_list_t *l;
+	mowgli_node_t *n;
 	unsigned int matches = 0;
 
 	if (si->smu->flags & MU_WAITAUTH)
@@ -37,14 +37,16 @@ ns_cmd_listownmail(struct sourceinfo *si, int parc, char *parv[])
 
 	command_add_flood(si, FLOOD_HEAVY);
 
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
-	{
-		struct myuser *mu = user(mt);
+	/* Addresses that only differ in case have the same canonical form, so
+	 * in either mode all matches are registered to our canonical address.
+	 */
+	l = myuser_find_by_email_canonical(si->smu->email_canonical);
 
-		continue_if_fail(mu != NULL);
+	MOWGLI_ITER_FOREACH(n, l != NULL ? l->head : NULL)
+	{
+		struct myuser *mu = n->data;
 
-		if ((listownmail_canon && !strcasecmp(si->smu->email_canonical, mu->email_canonical))
-		 || (!listownmail_canon && !strcasecmp(si->smu->email, mu->email)))
+		if (listownmail_canon || !strcasecmp(si->smu->email, mu->email))
 		{
 			// in the future we could add a LIMIT parameter
 			if (matches == 0)
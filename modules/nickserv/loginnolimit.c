@@ -47,7 +47,7 @@ ns_cmd_loginnolimit(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mu->flags |= MU_LOGINNOLIMIT;
+		myuser_set_flags(mu, mu->flags | MU_LOGINNOLIMIT);
 
 		wallops("\2%s\2 set the LOGINNOLIMIT option for the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "LOGINNOLIMIT:ON: \2%s\2", entity(mu)->name);
@@ -61,7 +61,7 @@ ns_cmd_loginnolimit(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mu->flags &= ~MU_LOGINNOLIMIT;
+		myuser_set_flags(mu, mu->flags & ~MU_LOGINNOLIMIT);
 
 		wallops("\2%s\2 removed the LOGINNOLIMIT option on the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "LOGINNOLIMIT:OFF: \2%s\2", entity(mu)->name);
@@ -95,6 +95,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param loginnolimit;
 	loginnolimit.opttype = OPT_BOOL;
 	loginnolimit.is_match = has_loginnolimit;
+	loginnolimit.flag = MU_LOGINNOLIMIT;
 
 	list_register("loginnolimit", &loginnolimit);
 }
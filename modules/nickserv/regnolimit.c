@@ -47,7 +47,7 @@ ns_cmd_regnolimit(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mu->flags |= MU_REGNOLIMIT;
+		myuser_set_flags(mu, mu->flags | MU_REGNOLIMIT);
 
 		wallops("\2%s\2 set the REGNOLIMIT option for the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "REGNOLIMIT:ON: \2%s\2", entity(mu)->name);
@@ -61,7 +61,7 @@ ns_cmd_regnolimit(struct sourceinfo *si, int parc, char *parv[])
 			return;
 		}
 
-		mu->flags &= ~MU_REGNOLIMIT;
+		myuser_set_flags(mu, mu->flags & ~MU_REGNOLIMIT);
 
 		wallops("\2%s\2 removed the REGNOLIMIT option on the account \2%s\2.", get_oper_name(si), entity(mu)->name);
 		logcommand(si, CMDLOG_ADMIN, "REGNOLIMIT:OFF: \2%s\2", entity(mu)->name);
@@ -95,6 +95,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param regnolimit;
 	regnolimit.opttype = OPT_BOOL;
 	regnolimit.is_match = has_regnolimit;
+	regnolimit.flag = MU_REGNOLIMIT;
 
 	list_register("regnolimit", &regnolimit);
 }
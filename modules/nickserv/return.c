@@ -64,7 +64,7 @@ ns_cmd_return(struct sourceinfo *si, int parc, char *parv[])
 		&& config_options.defuflags & MU_HIDEMAIL // HIDEMAIL is in default uflags
 		&& strcmp(oldmail, newmail))              // new email is different
 	{
-		mu->flags |= MU_HIDEMAIL;
+		myuser_set_flags(mu, mu->flags | MU_HIDEMAIL);
 		force_hidemail = true;
 	}
 
@@ -91,7 +91,7 @@ ns_cmd_return(struct sourceinfo *si, int parc, char *parv[])
 			mowgli_node_free(n);
 		}
 	}
-	mu->flags |= MU_NOBURSTLOGIN;
+	myuser_set_flags(mu, mu->flags | MU_NOBURSTLOGIN);
 	authcookie_destroy_all(mu);
 
 	wallops("\2%s\2 returned the account \2%s\2 to \2%s\2%s", get_oper_name(si), target, newmail,
@@ -54,7 +54,7 @@ ns_cmd_set_emailmemos(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		logcommand(si, CMDLOG_SET, "SET:EMAILMEMOS:ON");
-		si->smu->flags |= MU_EMAILMEMOS;
+		myuser_set_flags(si->smu, si->smu->flags | MU_EMAILMEMOS);
 		command_success_nodata(si, _("The \2%s\2 flag has been set for account \2%s\2."), "EMAILMEMOS", entity(si->smu)->name);
 		return;
 	}
@@ -68,7 +68,7 @@ ns_cmd_set_emailmemos(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		logcommand(si, CMDLOG_SET, "SET:EMAILMEMOS:OFF");
-		si->smu->flags &= ~MU_EMAILMEMOS;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_EMAILMEMOS);
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for account \2%s\2."), "EMAILMEMOS", entity(si->smu)->name);
 		return;
 	}
@@ -100,6 +100,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param emailmemos;
 	emailmemos.opttype = OPT_BOOL;
 	emailmemos.is_match = has_emailmemos;
+	emailmemos.flag = MU_EMAILMEMOS;
 
 	list_register("emailmemos", &emailmemos);
 }
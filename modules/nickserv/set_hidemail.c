@@ -44,7 +44,7 @@ ns_cmd_set_hidemail(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:HIDEMAIL:ON");
 
-		si->smu->flags |= MU_HIDEMAIL;
+		myuser_set_flags(si->smu, si->smu->flags | MU_HIDEMAIL);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for account \2%s\2."), "HIDEMAIL" ,entity(si->smu)->name);
 
@@ -60,7 +60,7 @@ ns_cmd_set_hidemail(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:HIDEMAIL:OFF");
 
-		si->smu->flags &= ~MU_HIDEMAIL;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_HIDEMAIL);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for account \2%s\2."), "HIDEMAIL", entity(si->smu)->name);
 
@@ -94,6 +94,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param hidemail;
 	hidemail.opttype = OPT_BOOL;
 	hidemail.is_match = has_hidemail;
+	hidemail.flag = MU_HIDEMAIL;
 
 	list_register("hidemail", &hidemail);
 }
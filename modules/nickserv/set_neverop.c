@@ -44,7 +44,7 @@ ns_cmd_set_neverop(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:NEVEROP:ON");
 
-		si->smu->flags |= MU_NEVEROP;
+		myuser_set_flags(si->smu, si->smu->flags | MU_NEVEROP);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for account \2%s\2."), "NEVEROP", entity(si->smu)->name);
 
@@ -61,7 +61,7 @@ ns_cmd_set_neverop(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:NEVEROP:OFF");
 
-		si->smu->flags &= ~MU_NEVEROP;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_NEVEROP);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for account \2%s\2."), "NEVEROP", entity(si->smu)->name);
 
@@ -96,6 +96,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param neverop;
 	neverop.opttype = OPT_BOOL;
 	neverop.is_match = has_neverop;
+	neverop.flag = MU_NEVEROP;
 
 	list_register("neverop", &neverop);
 }
@@ -44,7 +44,7 @@ ns_cmd_set_nogreet(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:NOGREET:ON");
 
-		si->smu->flags |= MU_NOGREET;
+		myuser_set_flags(si->smu, si->smu->flags | MU_NOGREET);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for account \2%s\2."), "NOGREET" ,entity(si->smu)->name);
 
@@ -60,7 +60,7 @@ ns_cmd_set_nogreet(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:NOGREET:OFF");
 
-		si->smu->flags &= ~MU_NOGREET;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_NOGREET);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for account \2%s\2."), "NOGREET", entity(si->smu)->name);
 
@@ -94,6 +94,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param nogreet;
 	nogreet.opttype = OPT_BOOL;
 	nogreet.is_match = has_nogreet;
+	nogreet.flag = MU_NOGREET;
 
 	list_register("nogreet", &nogreet);
 }
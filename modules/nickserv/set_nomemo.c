@@ -42,7 +42,7 @@ ns_cmd_set_nomemo(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		logcommand(si, CMDLOG_SET, "SET:NOMEMO:ON");
-		si->smu->flags |= MU_NOMEMO;
+		myuser_set_flags(si->smu, si->smu->flags | MU_NOMEMO);
 		command_success_nodata(si, _("The \2%s\2 flag has been set for account \2%s\2."), "NOMEMO", entity(si->smu)->name);
 		return;
 	}
@@ -56,7 +56,7 @@ ns_cmd_set_nomemo(struct sourceinfo *si, int parc, char *parv[])
 		}
 
 		logcommand(si, CMDLOG_SET, "SET:NOMEMO:OFF");
-		si->smu->flags &= ~MU_NOMEMO;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_NOMEMO);
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for account \2%s\2."), "NOMEMO", entity(si->smu)->name);
 		return;
 	}
@@ -88,6 +88,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param nomemo;
 	nomemo.opttype = OPT_BOOL;
 	nomemo.is_match = has_nomemo;
+	nomemo.flag = MU_NOMEMO;
 
 	list_register("nomemo", &nomemo);
 }
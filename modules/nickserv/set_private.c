@@ -43,8 +43,8 @@ ns_cmd_set_private(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:PRIVATE:ON");
 
-		si->smu->flags |= MU_PRIVATE;
-		si->smu->flags |= MU_HIDEMAIL;
+		myuser_set_flags(si->smu, si->smu->flags | MU_PRIVATE);
+		myuser_set_flags(si->smu, si->smu->flags | MU_HIDEMAIL);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for \2%s\2."), "PRIVATE" ,entity(si->smu)->name);
 
@@ -60,7 +60,7 @@ ns_cmd_set_private(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:PRIVATE:OFF");
 
-		si->smu->flags &= ~MU_PRIVATE;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_PRIVATE);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for \2%s\2."), "PRIVATE", entity(si->smu)->name);
 
@@ -94,6 +94,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param private;
 	private.opttype = OPT_BOOL;
 	private.is_match = has_private;
+	private.flag = MU_PRIVATE;
 
 	list_register("private", &private);
 }
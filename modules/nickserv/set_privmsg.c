@@ -43,7 +43,7 @@ ns_cmd_set_privmsg(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:PRIVMSG:ON");
 
-		si->smu->flags |= MU_USE_PRIVMSG;
+		myuser_set_flags(si->smu, si->smu->flags | MU_USE_PRIVMSG);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for \2%s\2."), "PRIVMSG" ,entity(si->smu)->name);
 
@@ -59,7 +59,7 @@ ns_cmd_set_privmsg(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:PRIVMSG:OFF");
 
-		si->smu->flags &= ~MU_USE_PRIVMSG;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_USE_PRIVMSG);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for \2%s\2."), "PRIVMSG", entity(si->smu)->name);
 
@@ -95,6 +95,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param use_privmsg;
 	use_privmsg.opttype = OPT_BOOL;
 	use_privmsg.is_match = uses_privmsg;
+	use_privmsg.flag = MU_USE_PRIVMSG;
 
 	list_register("use-privmsg", &use_privmsg);
 	list_register("use_privmsg", &use_privmsg);
@@ -19,7 +19,7 @@ ns_cmd_set_property(struct sourceinfo *si, int parc, char *parv[])
 	char *property = strtok(parv[0], " ");
 	char *value = strtok(NULL, "");
 	unsigned int count;
-	mowgli_patricia_iteration_state_t state;
+	struct metadata_iteration_state state;
 	struct metadata *md;
 	struct hook_metadata_change mdchange;
 
@@ -61,7 +61,7 @@ ns_cmd_set_property(struct sourceinfo *si, int parc, char *parv[])
 	}
 
 	count = 0;
-	MOWGLI_PATRICIA_FOREACH(md, &state, atheme_object(si->smu)->metadata)
+	METADATA_FOREACH(md, &state, si->smu)
 	{
 		if (strncmp(md->name, "private:", 8))
 			count++;
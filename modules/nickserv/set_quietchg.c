@@ -45,7 +45,7 @@ ns_cmd_set_quietchg(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:QUIETCHG:ON");
 
-		si->smu->flags |= MU_QUIETCHG;
+		myuser_set_flags(si->smu, si->smu->flags | MU_QUIETCHG);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been set for account \2%s\2."), "QUIETCHG" ,entity(si->smu)->name);
 
@@ -61,7 +61,7 @@ ns_cmd_set_quietchg(struct sourceinfo *si, int parc, char *parv[])
 
 		logcommand(si, CMDLOG_SET, "SET:QUIETCHG:OFF");
 
-		si->smu->flags &= ~MU_QUIETCHG;
+		myuser_set_flags(si->smu, si->smu->flags & ~MU_QUIETCHG);
 
 		command_success_nodata(si, _("The \2%s\2 flag has been removed for account \2%s\2."), "QUIETCHG", entity(si->smu)->name);
 
@@ -96,6 +96,7 @@ mod_init(struct module *const restrict m)
 	static struct list_param quietchg;
 	quietchg.opttype = OPT_BOOL;
 	quietchg.is_match = has_quietchg;
+	quietchg.flag = MU_QUIETCHG;
 
 	list_register("quietchg", &quietchg);
 }
@@ -14,7 +14,7 @@ ns_verify_activate_account(struct sourceinfo *si, struct myuser *mu)
 {
 	mowgli_node_t *n;
 	struct hook_user_req req;
-	mu->flags &= ~MU_WAITAUTH;
+	myuser_set_flags(mu, mu->flags & ~MU_WAITAUTH);
 
 	metadata_delete(mu, "private:verify:register:key");
 	metadata_delete(mu, "private:verify:register:timestamp");
@@ -28,6 +28,8 @@ os_cmd_clearchan(struct sourceinfo *si, int parc, char *parv[])
 	char reason[512];
 	unsigned int matches = 0;
 	unsigned int ignores = 0;
+	struct kline_bulk_entry *klines = NULL;
+	size_t nklines = 0;
 
 	if (!actionstr || !targchan || !treason)
 	{
@@ -73,6 +75,10 @@ os_cmd_clearchan(struct sourceinfo *si, int parc, char *parv[])
 			get_oper_name(si), targchan, actionstr);
 	command_success_nodata(si, _("Clearing \2%s\2 with \2%s\2"), targchan, actionstr);
 
+	// the AKILLs are added together afterwards, so they go to the ircd as one batch
+	if (action == CLEAR_AKILL && MOWGLI_LIST_LENGTH(&c->members))
+		klines = scalloc(MOWGLI_LIST_LENGTH(&c->members), sizeof *klines);
+
 	// iterate over the users in channel
 	MOWGLI_ITER_FOREACH_SAFE(n, tn, c->members.head)
 	{
@@ -104,7 +110,12 @@ os_cmd_clearchan(struct sourceinfo *si, int parc, char *parv[])
 								cu->user->nick, cu->user->user, cu->user->host);
 					} else {
 						if (! (cu->user->flags & UF_KLINESENT)) {
-							kline_add(cu->user->user, cu->user->host, reason, SECONDS_PER_WEEK, si->su->nick);
+							klines[nklines].user = cu->user->user;
+							klines[nklines].host = cu->user->host;
+							klines[nklines].reason = reason;
+							klines[nklines].setby = si->su->nick;
+							klines[nklines].duration = SECONDS_PER_WEEK;
+							nklines++;
 							cu->user->flags |= UF_KLINESENT;
 						}
 					}
@@ -112,6 +123,11 @@ os_cmd_clearchan(struct sourceinfo *si, int parc, char *parv[])
 		}
 	}
 
+	if (nklines)
+		kline_add_bulk(klines, nklines);
+
+	sfree(klines);
+
 	command_success_nodata(si, _("\2%u\2 match(es), \2%u\2 ignore(s) for \2%s\2 on \2%s\2"), matches, ignores, actionstr, targchan);
 	logcommand(si, CMDLOG_ADMIN, "CLEARCHAN: \2%s\2 \2%s\2 (reason: \2%s\2) (\2%u\2 matches, \2%u\2 ignores)", actionstr, targchan, treason, matches, ignores);
 }
@@ -27,6 +27,7 @@ struct clones_hostentry
 	mowgli_list_t clients;
 	time_t firstkill;
 	unsigned int gracekills;
+	unsigned int splitgen;
 };
 
 static mowgli_patricia_t *os_clones_cmds = NULL;
@@ -40,6 +41,7 @@ static unsigned int grace_count;
 static long kline_duration = SECONDS_PER_HOUR;
 static unsigned int clones_allowed, clones_warn;
 static unsigned int clones_dbversion = 1;
+static unsigned int clones_splitgen = 0;
 
 static inline bool
 cexempt_expired(struct clones_exemption *c)
@@ -805,8 +807,8 @@ clones_userquit(struct user *u)
 	mowgli_node_t *n;
 	struct clones_hostentry *he;
 
-	// User has no IP, ignore them
-	if (is_internal_client(u) || u->ip == NULL)
+	// User has no IP, ignore them; split users were handled by clones_serversplit()
+	if (is_internal_client(u) || u->ip == NULL || (u->flags & UF_SPLIT))
 		return;
 
 	he = mowgli_patricia_retrieve(hostlist, u->ip);
@@ -829,6 +831,50 @@ clones_userquit(struct user *u)
 	}
 }
 
+/* Removing split users one at a time searches each host's client list once
+ * per user; instead, clear every split user out of a host's list in a
+ * single pass the first time one of them is seen.
+ */
+static void
+clones_serversplit(struct hook_server_split *data)
+{
+	mowgli_node_t *n, *tn;
+	struct clones_hostentry *he;
+
+	clones_splitgen++;
+
+	for (size_t i = 0; i < data->count; i++)
+	{
+		struct user *const u = data->users[i];
+
+		if (is_internal_client(u) || u->ip == NULL)
+			continue;
+
+		he = mowgli_patricia_retrieve(hostlist, u->ip);
+		if (he == NULL || he->splitgen == clones_splitgen)
+			continue;
+
+		he->splitgen = clones_splitgen;
+
+		MOWGLI_ITER_FOREACH_SAFE(n, tn, he->clients.head)
+		{
+			const struct user *const tu = n->data;
+
+			if (!(tu->flags & UF_SPLIT))
+				continue;
+
+			mowgli_node_delete(n, &he->clients);
+			mowgli_node_free(n);
+		}
+
+		if (MOWGLI_LIST_LENGTH(&he->clients) == 0)
+		{
+			mowgli_patricia_delete(hostlist, he->ip);
+			mowgli_heap_free(hostentry_heap, he);
+		}
+	}
+}
+
 static struct command os_clones = {
 	.name           = "CLONES",
 	.desc           = N_("Manages network wide clones."),
@@ -964,6 +1010,7 @@ mod_init(struct module *const restrict m)
 	(void) hook_add_config_ready(&clones_configready);
 	(void) hook_add_user_add(&clones_newuser);
 	(void) hook_add_user_delete(&clones_userquit);
+	(void) hook_add_server_split(&clones_serversplit);
 	(void) hook_add_db_write(&write_exemptdb);
 
 	(void) db_register_type_handler("CLONES-DBV", &db_h_clonesdbv);
@@ -0,0 +1,175 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Controls and displays the latency histograms of hook handlers and
+ * commands.
+ */
+
+#include <atheme.h>
+
+#define LATENCY_LIST_DEF        10U
+#define LATENCY_LIST_MAX        100U
+
+static const char *
+latency_format(const uint64_t nsec, char *const restrict buf, const size_t len)
+{
+	if (nsec < 1000U)
+		(void) snprintf(buf, len, "%uns", (unsigned int) nsec);
+	else if (nsec < 1000000U)
+		(void) snprintf(buf, len, "%.1fus", nsec / 1e3);
+	else if (nsec < 1000000000U)
+		(void) snprintf(buf, len, "%.1fms", nsec / 1e6);
+	else
+		(void) snprintf(buf, len, "%.2fs", nsec / 1e9);
+
+	return buf;
+}
+
+static void
+os_cmd_latency_list(struct sourceinfo *const restrict si, const char *const restrict kindstr,
+                    const char *const restrict countstr)
+{
+	const struct latency_stat *stats[LATENCY_LIST_MAX];
+	unsigned int max = LATENCY_LIST_DEF;
+	enum latency_kind kind = LATENCY_HOOK;
+	size_t count;
+
+	if (kindstr && strcasecmp(kindstr, "ALL") != 0 && ! latency_kind_parse(kindstr, &kind))
+	{
+		(void) command_fail(si, fault_badparams, STR_INVALID_PARAMS, "LATENCY LIST");
+		(void) command_fail(si, fault_badparams, _("Syntax: LATENCY LIST [ALL|HOOK|PCOMMAND|COMMAND] [count]"));
+		return;
+	}
+
+	if (countstr && (! string_to_uint(countstr, &max) || ! max || max > LATENCY_LIST_MAX))
+	{
+		(void) command_fail(si, fault_badparams, _("The count must be between 1 and %u."), LATENCY_LIST_MAX);
+		return;
+	}
+
+	const bool all = (! kindstr || strcasecmp(kindstr, "ALL") == 0);
+
+	count = latency_top(all ? NULL : &kind, stats, max);
+
+	(void) logcommand(si, CMDLOG_GET, "LATENCY:LIST: \2%s\2", all ? "ALL" : latency_kind_name(kind));
+
+	if (latency_enabled)
+		(void) command_success_nodata(si, _("Latency timing is enabled."));
+	else
+		(void) command_success_nodata(si, _("Latency timing is disabled."));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const struct latency_histogram *const hist = &stats[i]->hist;
+		char total[32], mean[32], p50[32], p99[32], p999[32], highest[32];
+
+		(void) command_success_nodata(si, "%2zu: %s \2%s\2: %" PRIu64 " calls, total %s, mean %s, "
+		                                  "p50 %s, p99 %s, p99.9 %s, max %s", i + 1U,
+		                              latency_kind_name(stats[i]->kind), stats[i]->name, hist->count,
+		                              latency_format(hist->total, total, sizeof total),
+		                              latency_format(hist->total / hist->count, mean, sizeof mean),
+		                              latency_format(latency_percentile(hist, 500U), p50, sizeof p50),
+		                              latency_format(latency_percentile(hist, 990U), p99, sizeof p99),
+		                              latency_format(latency_percentile(hist, 999U), p999, sizeof p999),
+		                              latency_format(hist->max, highest, sizeof highest));
+	}
+
+	(void) command_success_nodata(si, ngettext(N_("End of list, %zu entry shown."),
+	                                           N_("End of list, %zu entries shown."), count), count);
+}
+
+static void
+os_cmd_latency_func(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
+{
+	const char *const action = parv[0];
+
+	if (! action)
+	{
+		(void) command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, "LATENCY");
+		(void) command_fail(si, fault_needmoreparams, _("Syntax: LATENCY ON|OFF|RESET|LIST [ALL|HOOK|PCOMMAND|COMMAND] [count]"));
+		return;
+	}
+
+	if (strcasecmp(action, "LIST") == 0)
+	{
+		(void) os_cmd_latency_list(si, (parc > 1) ? parv[1] : NULL, (parc > 2) ? parv[2] : NULL);
+		return;
+	}
+
+	if (strcasecmp(action, "ON") != 0 && strcasecmp(action, "OFF") != 0 && strcasecmp(action, "RESET") != 0)
+	{
+		(void) command_fail(si, fault_badparams, STR_INVALID_PARAMS, "LATENCY");
+		(void) command_fail(si, fault_badparams, _("Syntax: LATENCY ON|OFF|RESET|LIST [ALL|HOOK|PCOMMAND|COMMAND] [count]"));
+		return;
+	}
+
+	if (! has_priv(si, PRIV_ADMIN))
+	{
+		(void) command_fail(si, fault_noprivs, STR_NO_PRIVILEGE, PRIV_ADMIN);
+		return;
+	}
+
+	if (strcasecmp(action, "ON") == 0)
+	{
+		if (latency_enabled)
+		{
+			(void) command_fail(si, fault_nochange, _("Latency timing is already enabled."));
+			return;
+		}
+
+		latency_enabled = true;
+
+		(void) wallops("\2%s\2 enabled latency timing.", get_oper_name(si));
+		(void) logcommand(si, CMDLOG_ADMIN, "LATENCY:ON");
+		(void) command_success_nodata(si, _("Latency timing is now enabled."));
+	}
+	else if (strcasecmp(action, "OFF") == 0)
+	{
+		if (! latency_enabled)
+		{
+			(void) command_fail(si, fault_nochange, _("Latency timing is already disabled."));
+			return;
+		}
+
+		latency_enabled = false;
+
+		(void) wallops("\2%s\2 disabled latency timing.", get_oper_name(si));
+		(void) logcommand(si, CMDLOG_ADMIN, "LATENCY:OFF");
+		(void) command_success_nodata(si, _("Latency timing is now disabled."));
+	}
+	else
+	{
+		(void) latency_reset();
+
+		(void) logcommand(si, CMDLOG_ADMIN, "LATENCY:RESET");
+		(void) command_success_nodata(si, _("Latency histograms have been reset."));
+	}
+}
+
+static struct command os_cmd_latency = {
+	.name           = "LATENCY",
+	.desc           = N_("Shows where services spend their time."),
+	.access         = PRIV_SERVER_AUSPEX,
+	.maxparc        = 3,
+	.cmd            = &os_cmd_latency_func,
+	.help           = { .path = "oservice/latency" },
+};
+
+static void
+mod_init(struct module *const restrict m)
+{
+	MODULE_TRY_REQUEST_DEPENDENCY(m, "operserv/main")
+
+	(void) service_named_bind_command("operserv", &os_cmd_latency);
+}
+
+static void
+mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
+{
+	(void) service_named_unbind_command("operserv", &os_cmd_latency);
+}
+
+SIMPLE_DECLARE_MODULE_V1("operserv/latency", MODULE_UNLOAD_CAPABILITY_OK)
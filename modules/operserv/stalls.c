@@ -0,0 +1,148 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Shows the recent stalls of the main loop.
+ */
+
+#include <atheme.h>
+
+static void
+os_cmd_stalls_list(struct sourceinfo *const restrict si)
+{
+	const struct stall_record *rec;
+	unsigned int num;
+
+	(void) logcommand(si, CMDLOG_GET, "STALLS:LIST");
+
+	if (stall_watchdog_running())
+		(void) command_success_nodata(si, _("Stall detection is enabled, with a threshold of %ums."),
+		                              config_options.stall_threshold);
+	else
+		(void) command_success_nodata(si, _("Stall detection is disabled."));
+
+	for (num = 0; (rec = stall_record_get(num)) != NULL; num++)
+	{
+		char where[BUFSIZE];
+
+		(void) command_success_nodata(si, _("%2u: %s ago, blocked for %.3fs in %s"), num + 1U,
+		                              time_ago(rec->when), rec->nsec / 1e9,
+		                              stall_record_describe(rec, where, sizeof where));
+	}
+
+	(void) command_success_nodata(si, ngettext(N_("End of list, %u stall since startup."),
+	                                           N_("End of list, %u stalls since startup."), stall_count),
+	                              stall_count);
+}
+
+static void
+os_cmd_stalls_show(struct sourceinfo *const restrict si, const char *const restrict numstr)
+{
+	const struct stall_record *rec = NULL;
+	unsigned int num;
+
+	if (! numstr)
+	{
+		(void) command_fail(si, fault_needmoreparams, STR_INSUFFICIENT_PARAMS, "STALLS SHOW");
+		(void) command_fail(si, fault_needmoreparams, _("Syntax: STALLS SHOW <number>"));
+		return;
+	}
+
+	if (! string_to_uint(numstr, &num) || ! num || (rec = stall_record_get(num - 1U)) == NULL)
+	{
+		(void) command_fail(si, fault_nosuch_target, _("There is no stall \2%s\2."), numstr);
+		return;
+	}
+
+	(void) logcommand(si, CMDLOG_GET, "STALLS:SHOW: \2%u\2", num);
+
+	(void) command_success_nodata(si, _("Stall \2%u\2, %s ago, blocked for %.3fs:"), num, time_ago(rec->when),
+	                              rec->nsec / 1e9);
+
+	if (! rec->depth)
+		(void) command_success_nodata(si, _("Nothing was named; it was in a timer or I/O handler."));
+
+	// Outermost first
+	for (unsigned int i = 0; i < rec->depth; i++)
+	{
+		const struct stall_context *const ctx = &rec->context[i];
+
+		if (*ctx->detail)
+			(void) command_success_nodata(si, "  %s \2%s\2 (%s)", ctx->kind, ctx->name, ctx->detail);
+		else
+			(void) command_success_nodata(si, "  %s \2%s\2", ctx->kind, ctx->name);
+	}
+
+	if (rec->frames)
+		(void) command_success_nodata(si, _("Backtrace:"));
+	else
+		(void) command_success_nodata(si, _("No backtrace is available."));
+
+	for (unsigned int i = 0; i < rec->frames; i++)
+		(void) command_success_nodata(si, "  #%u %s", i, rec->symbols[i]);
+
+	(void) command_success_nodata(si, _("End of stall \2%u\2."), num);
+}
+
+static void
+os_cmd_stalls_func(struct sourceinfo *const restrict si, const int parc, char **const restrict parv)
+{
+	const char *const action = parv[0];
+
+	if (! action || strcasecmp(action, "LIST") == 0)
+	{
+		(void) os_cmd_stalls_list(si);
+		return;
+	}
+
+	if (strcasecmp(action, "SHOW") == 0)
+	{
+		(void) os_cmd_stalls_show(si, (parc > 1) ? parv[1] : NULL);
+		return;
+	}
+
+	if (strcasecmp(action, "CLEAR") != 0)
+	{
+		(void) command_fail(si, fault_badparams, STR_INVALID_PARAMS, "STALLS");
+		(void) command_fail(si, fault_badparams, _("Syntax: STALLS [LIST|SHOW <number>|CLEAR]"));
+		return;
+	}
+
+	if (! has_priv(si, PRIV_ADMIN))
+	{
+		(void) command_fail(si, fault_noprivs, STR_NO_PRIVILEGE, PRIV_ADMIN);
+		return;
+	}
+
+	(void) stall_clear();
+
+	(void) logcommand(si, CMDLOG_ADMIN, "STALLS:CLEAR");
+	(void) command_success_nodata(si, _("The list of stalls has been cleared."));
+}
+
+static struct command os_cmd_stalls = {
+	.name           = "STALLS",
+	.desc           = N_("Shows when and where services have frozen."),
+	.access         = PRIV_SERVER_AUSPEX,
+	.maxparc        = 2,
+	.cmd            = &os_cmd_stalls_func,
+	.help           = { .path = "oservice/stalls" },
+};
+
+static void
+mod_init(struct module *const restrict m)
+{
+	MODULE_TRY_REQUEST_DEPENDENCY(m, "operserv/main")
+
+	(void) service_named_bind_command("operserv", &os_cmd_stalls);
+}
+
+static void
+mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
+{
+	(void) service_named_unbind_command("operserv", &os_cmd_stalls);
+}
+
+SIMPLE_DECLARE_MODULE_V1("operserv/stalls", MODULE_UNLOAD_CAPABILITY_OK)
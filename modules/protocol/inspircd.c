@@ -12,6 +12,7 @@
 
 #define PROTOCOL_MINIMUM 1202 // we do not support anything older than this
 #define PROTOCOL_PREFERRED_STR "1202"
+#define INSPIRCD_NOTICE_MAXTARGETS 20
 
 static struct ircd InspIRCd = {
 	.ircdname = "InspIRCd",
@@ -445,6 +446,12 @@ inspircd_notice_user_sts(struct user *from, struct user *target, const char *tex
 	sts(":%s NOTICE %s :%s", from ? from->uid : me.numeric, target->uid, text);
 }
 
+static void
+inspircd_notice_users_sts(struct user *from, struct user **targets, size_t count, const char *text)
+{
+	notice_users_multi_sts(from ? from->uid : me.numeric, targets, count, text, INSPIRCD_NOTICE_MAXTARGETS);
+}
+
 static void
 inspircd_notice_global_sts(struct user *from, const char *mask, const char *text)
 {
@@ -1727,6 +1734,7 @@ mod_init(struct module *const restrict m)
 	msg = &inspircd_msg;
 	msg_global_sts = &inspircd_msg_global_sts;
 	notice_user_sts = &inspircd_notice_user_sts;
+	notice_users_sts = &inspircd_notice_users_sts;
 	notice_global_sts = &inspircd_notice_global_sts;
 	notice_channel_sts = &inspircd_notice_channel_sts;
 	numeric_sts = &inspircd_numeric_sts;
@@ -37,6 +37,9 @@
 
 #include <atheme.h>
 
+// default max_targets of ratbox and charybdis
+#define TS6_NOTICE_MAXTARGETS 4
+
 static bool use_rserv_support = false;
 static bool use_tb = false;
 static bool use_euid = false;
@@ -211,6 +214,12 @@ ts6_notice_user_sts(struct user *from, struct user *target, const char *text)
 	sts(":%s NOTICE %s :%s", from ? CLIENT_NAME(from) : ME, CLIENT_NAME(target), text);
 }
 
+static void
+ts6_notice_users_sts(struct user *from, struct user **targets, size_t count, const char *text)
+{
+	notice_users_multi_sts(from ? CLIENT_NAME(from) : ME, targets, count, text, TS6_NOTICE_MAXTARGETS);
+}
+
 static void
 ts6_notice_global_sts(struct user *from, const char *mask, const char *text)
 {
@@ -1535,6 +1544,7 @@ mod_init(struct module *const restrict m)
 	msg = &ts6_msg;
 	msg_global_sts = &ts6_msg_global_sts;
 	notice_user_sts = &ts6_notice_user_sts;
+	notice_users_sts = &ts6_notice_users_sts;
 	notice_global_sts = &ts6_notice_global_sts;
 	notice_channel_sts = &ts6_notice_channel_sts;
 	wallchops = &ts6_wallchops;
@@ -16,6 +16,7 @@
 #define VALID_FLOOD_CHAR(c)	((c == 'c') || (c == 'j') || (c == 'k') || (c == 'm') || (c == 'n') || (c == 't'))
 #define VALID_ACTION_CHAR(c)	((c == 'm') || (c == 'M') || (c == 'C') || (c == 'R') || (c == 'i') || (c == 'K') \
 				 || (c == 'N') || (c == 'b'))
+#define UNREAL_NOTICE_MAXTARGETS 20
 
 static struct ircd Unreal = {
 	.ircdname = "UnrealIRCd 4 or later",
@@ -411,6 +412,12 @@ unreal_notice_user_sts(struct user *from, struct user *target, const char *text)
 	sts(":%s NOTICE %s :%s", from ? CLIENT_NAME(from) : ME, CLIENT_NAME(target), text);
 }
 
+static void
+unreal_notice_users_sts(struct user *from, struct user **targets, size_t count, const char *text)
+{
+	notice_users_multi_sts(from ? CLIENT_NAME(from) : ME, targets, count, text, UNREAL_NOTICE_MAXTARGETS);
+}
+
 static void
 unreal_notice_global_sts(struct user *from, const char *mask, const char *text)
 {
@@ -1600,6 +1607,7 @@ mod_init(struct module *const restrict m)
 	msg = &unreal_msg;
 	msg_global_sts = &unreal_msg_global_sts;
 	notice_user_sts = &unreal_notice_user_sts;
+	notice_users_sts = &unreal_notice_users_sts;
 	notice_global_sts = &unreal_notice_global_sts;
 	notice_channel_sts = &unreal_notice_channel_sts;
 	numeric_sts = &unreal_numeric_sts;
@@ -371,6 +371,14 @@ static const struct sasl_mechanism sasl_mech_ecdh_x25519_challenge = {
 	.password_based = false,
 };
 
+extern const struct ecdh_x25519_functions ecdh_x25519_functions;
+const struct ecdh_x25519_functions ecdh_x25519_functions = {
+
+	.create_keypair = &ecdh_x25519_create_keypair,
+	.compute_shared = &ecdh_x25519_compute_shared,
+	.kdf            = &ecdh_x25519_kdf,
+};
+
 static struct command ns_cmd_set_x25519_pubkey = {
 	.name           = "X25519-PUBKEY",
 	.desc           = N_("Changes your ECDH-X25519-CHALLENGE public key."),
@@ -27,4 +27,13 @@ union ecdh_x25519_server_response
 	struct ecdh_x25519_server_response_fields   field;
 } ATHEME_SATTR_PACKED;
 
+// Published by the module, for tools that play the client side of the mechanism
+struct ecdh_x25519_functions
+{
+	bool    (*create_keypair)(unsigned char *seckey, unsigned char *pubkey);
+	bool    (*compute_shared)(const unsigned char *seckey, const unsigned char *pubkey, unsigned char *shared);
+	bool    (*kdf)(const unsigned char *shared, const unsigned char *client_pubkey,
+	               const unsigned char *server_pubkey, const unsigned char *salt, unsigned char *better_secret);
+};
+
 #endif /* !ATHEME_MOD_SASL_ECDH_X25519_CHALLENGE_H */
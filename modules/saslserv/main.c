@@ -17,7 +17,22 @@
 #define ASASL_OUTFLAGS_WIPE_FREE_BUF    (ASASL_OUTFLAG_WIPE_BUF | ASASL_OUTFLAG_FREE_BUF)
 #define LOGIN_CANCELLED_STR             "There was a problem logging you in; login cancelled"
 
-static mowgli_list_t sasl_sessions;
+/* Sessions are keyed by UID, and also listed per originating server so that
+ * a split only has to look at the sessions from the servers that left.
+ *
+ * Sessions that make no progress are timed out with a timing wheel: every
+ * SASL_WHEEL_TICK seconds the next slot is advanced to and all sessions in
+ * it are destroyed, and whenever a session makes progress it is moved to
+ * the slot that was advanced to last, which comes around again only after
+ * a full turn of the wheel.
+ */
+#define SASL_WHEEL_TICK                 5U
+#define SASL_WHEEL_SLOTS                (SECONDS_PER_MINUTE / SASL_WHEEL_TICK)
+
+static mowgli_patricia_t *sasl_sessions;        // UID -> struct sasl_session
+static mowgli_patricia_t *sasl_server_sessions; // server name -> mowgli_list_t of struct sasl_session
+static mowgli_list_t sasl_wheel[SASL_WHEEL_SLOTS];
+static unsigned int sasl_wheel_pos;
 static mowgli_list_t sasl_mechanisms;
 static char sasl_mechlist_string[SASL_S2S_MAXLEN_ATONCE_B64];
 static bool sasl_hide_server_names;
@@ -108,17 +123,17 @@ sasl_session_find(const char *const restrict uid)
 	if (! uid || ! *uid)
 		return NULL;
 
-	mowgli_node_t *n;
+	return mowgli_patricia_retrieve(sasl_sessions, uid);
+}
 
-	MOWGLI_ITER_FOREACH(n, sasl_sessions.head)
-	{
-		struct sasl_session *const p = n->data;
+static void
+sasl_session_touch(struct sasl_session *const restrict p)
+{
+	(void) mowgli_node_delete(&p->node, &sasl_wheel[p->wheelslot]);
 
-		if (strcmp(p->uid, uid) == 0)
-			return p;
-	}
+	p->wheelslot = sasl_wheel_pos;
 
-	return NULL;
+	(void) mowgli_node_add(p, &p->node, &sasl_wheel[p->wheelslot]);
 }
 
 static struct sasl_session *
@@ -133,7 +148,23 @@ sasl_session_find_or_make(const struct sasl_message *const restrict smsg)
 		p->server = smsg->server;
 
 		(void) mowgli_strlcpy(p->uid, smsg->uid, sizeof p->uid);
-		(void) mowgli_node_add(p, &p->node, &sasl_sessions);
+		(void) mowgli_patricia_add(sasl_sessions, p->uid, p);
+
+		p->wheelslot = sasl_wheel_pos;
+		(void) mowgli_node_add(p, &p->node, &sasl_wheel[p->wheelslot]);
+
+		if (p->server)
+		{
+			mowgli_list_t *l = mowgli_patricia_retrieve(sasl_server_sessions, p->server->name);
+
+			if (! l)
+			{
+				l = mowgli_list_create();
+				(void) mowgli_patricia_add(sasl_server_sessions, p->server->name, l);
+			}
+
+			(void) mowgli_node_add(p, &p->servnode, l);
+		}
 	}
 
 	return p;
@@ -305,8 +336,8 @@ sasl_user_can_login(struct sasl_session *const restrict p)
 	 */
 	if (ircd->flags & IRCD_SASL_USE_PUID)
 	{
-		target_mu->flags &= ~MU_NOBURSTLOGIN;
-		target_mu->flags |= MU_PENDINGLOGIN;
+		myuser_set_flags(target_mu, target_mu->flags & ~MU_NOBURSTLOGIN);
+		myuser_set_flags(target_mu, target_mu->flags | MU_PENDINGLOGIN);
 	}
 
 	if (target_mu != source_mu)
@@ -332,16 +363,24 @@ sasl_session_reset(struct sasl_session *const restrict p)
 static void
 sasl_session_destroy(struct sasl_session *const restrict p)
 {
-	mowgli_node_t *n;
-
 	sasl_session_reset(p);
 
-	MOWGLI_ITER_FOREACH(n, sasl_sessions.head)
+	(void) mowgli_patricia_delete(sasl_sessions, p->uid);
+	(void) mowgli_node_delete(&p->node, &sasl_wheel[p->wheelslot]);
+
+	if (p->server)
 	{
-		if (n == &p->node && n->data == p)
+		mowgli_list_t *const l = mowgli_patricia_retrieve(sasl_server_sessions, p->server->name);
+
+		if (l)
 		{
-			(void) mowgli_node_delete(n, &sasl_sessions);
-			break;
+			(void) mowgli_node_delete(&p->servnode, l);
+
+			if (! MOWGLI_LIST_LENGTH(l))
+			{
+				(void) mowgli_patricia_delete(sasl_server_sessions, p->server->name);
+				(void) mowgli_list_free(l);
+			}
 		}
 	}
 
@@ -630,7 +669,7 @@ sasl_process_packet(struct sasl_session *const restrict p, char *const restrict
 	}
 
 	// Some progress has been made, reset timeout.
-	p->flags &= ~ASASL_SFLAG_MARKED_FOR_DELETION;
+	(void) sasl_session_touch(p);
 
 	switch (rc)
 	{
@@ -904,20 +943,25 @@ sasl_user_add(struct hook_user_nick *const restrict data)
 	(void) sasl_session_destroy(p);
 }
 
+static void
+sasl_server_delete(struct hook_server_delete *const restrict data)
+{
+	mowgli_list_t *l;
+
+	// The list goes away together with its last session
+	while ((l = mowgli_patricia_retrieve(sasl_server_sessions, data->s->name)) != NULL)
+		(void) sasl_session_destroy(l->head->data);
+}
+
 static void
 sasl_delete_stale(void ATHEME_VATTR_UNUSED *const restrict vptr)
 {
 	mowgli_node_t *n, *tn;
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, sasl_sessions.head)
-	{
-		struct sasl_session *const p = n->data;
+	sasl_wheel_pos = (sasl_wheel_pos + 1U) % SASL_WHEEL_SLOTS;
 
-		if (p->flags & ASASL_SFLAG_MARKED_FOR_DELETION)
-			(void) sasl_session_destroy(p);
-		else
-			p->flags |= ASASL_SFLAG_MARKED_FOR_DELETION;
-	}
+	MOWGLI_ITER_FOREACH_SAFE(n, tn, sasl_wheel[sasl_wheel_pos].head)
+		(void) sasl_session_destroy(n->data);
 }
 
 static void
@@ -955,12 +999,12 @@ sasl_mech_register(const struct sasl_mechanism *const restrict mech)
 static void
 sasl_mech_unregister(const struct sasl_mechanism *const restrict mech)
 {
+	mowgli_patricia_iteration_state_t state;
+	struct sasl_session *session;
 	mowgli_node_t *n, *tn;
 
-	MOWGLI_ITER_FOREACH_SAFE(n, tn, sasl_sessions.head)
+	MOWGLI_PATRICIA_FOREACH(session, &state, sasl_sessions)
 	{
-		struct sasl_session *const session = n->data;
-
 		if (session->mechptr == mech)
 		{
 			(void) slog(LG_DEBUG, "%s: destroying session %s", MOWGLI_FUNC_NAME, session->uid);
@@ -1050,6 +1094,12 @@ sasl_authzid_can_login(struct sasl_session *const restrict p, const char *const
 	return sasl_authxid_can_login(p, authzid, muo, p->authzid, p->authzeid, p->authceid);
 }
 
+static size_t
+sasl_session_count(void)
+{
+	return mowgli_patricia_size(sasl_sessions);
+}
+
 extern const struct sasl_core_functions sasl_core_functions;
 const struct sasl_core_functions sasl_core_functions = {
 
@@ -1058,6 +1108,7 @@ const struct sasl_core_functions sasl_core_functions = {
 	.authcid_can_login  = &sasl_authcid_can_login,
 	.authzid_can_login  = &sasl_authzid_can_login,
 	.recalc_mechlist    = &sasl_mechlist_string_build,
+	.session_count      = &sasl_session_count,
 };
 
 static void
@@ -1101,11 +1152,15 @@ mod_init(struct module *const restrict m)
 		return;
 	}
 
+	sasl_sessions = mowgli_patricia_create(&noopcanon);
+	sasl_server_sessions = mowgli_patricia_create(&strcasecanon);
+
 	(void) hook_add_sasl_input(&sasl_input);
 	(void) hook_add_user_add(&sasl_user_add);
 	(void) hook_add_server_eob(&sasl_server_eob);
+	(void) hook_add_server_delete(&sasl_server_delete);
 
-	sasl_delete_stale_timer = mowgli_timer_add(base_eventloop, "sasl_delete_stale", &sasl_delete_stale, NULL, SECONDS_PER_MINUTE / 2);
+	sasl_delete_stale_timer = mowgli_timer_add(base_eventloop, "sasl_delete_stale", &sasl_delete_stale, NULL, SASL_WHEEL_TICK);
 	authservice_loaded++;
 
 	(void) add_bool_conf_item("HIDE_SERVER_NAMES", &saslsvs->conf_table, 0, &sasl_hide_server_names, false);
@@ -1117,6 +1172,7 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 	(void) hook_del_sasl_input(&sasl_input);
 	(void) hook_del_user_add(&sasl_user_add);
 	(void) hook_del_server_eob(&sasl_server_eob);
+	(void) hook_del_server_delete(&sasl_server_delete);
 
 	(void) mowgli_timer_destroy(base_eventloop, sasl_delete_stale_timer);
 
@@ -1125,9 +1181,12 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 
 	authservice_loaded--;
 
-	if (sasl_sessions.head)
+	if (mowgli_patricia_size(sasl_sessions))
 		(void) slog(LG_ERROR, "saslserv/main: shutting down with a non-empty session list; "
 		                      "a mechanism did not unregister itself! (BUG)");
+
+	(void) mowgli_patricia_destroy(sasl_sessions, NULL, NULL);
+	(void) mowgli_patricia_destroy(sasl_server_sessions, NULL, NULL);
 }
 
 SIMPLE_DECLARE_MODULE_V1("saslserv/main", MODULE_UNLOAD_CAPABILITY_OK)
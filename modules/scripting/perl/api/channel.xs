@@ -46,7 +46,7 @@ CODE:
         mc->mlock_off |= CMODE_LIMIT;
     if (self->key == NULL)
         mc->mlock_off |= CMODE_KEY;
-    mc->flags |= config_options.defcflags;
+    mychan_set_flags(mc, mc->flags | config_options.defcflags);
 
     if ( chanacs_add(mc, entity(user), custom_founder_check(), CURRTIME, entity(si->smu)) == NULL) {
         atheme_object_unref (mc);
@@ -70,7 +70,7 @@ unsigned int
 flags (Atheme_ChannelRegistration self, unsigned int newflags = 0)
 CODE:
     if (items > 1)
-        self->flags = newflags;
+        mychan_set_flags(self, newflags);
     RETVAL = self->flags;
 OUTPUT:
     RETVAL
@@ -131,19 +131,10 @@ crypto_type_to_name(const enum crypto_type type)
 	return NULL;
 }
 
-static void
-ss_cmd_pwhashes_func(struct sourceinfo *const restrict si, const int ATHEME_VATTR_UNUSED parc,
-                     char ATHEME_VATTR_UNUSED **const restrict parv)
+struct pwhashes_state
 {
-	(void) logcommand(si, CMDLOG_GET, "PWHASHES");
-
 	unsigned int pwhashes[TYPE_TOTAL_COUNT];
 
-	(void) memset(&pwhashes, 0x00, sizeof pwhashes);
-
-	struct myentity *mt;
-	struct myentity_iteration_state state;
-
 	char s1[BUFSIZE];
 	char s2[BUFSIZE];
 	char s3[BUFSIZE];
@@ -152,162 +143,177 @@ ss_cmd_pwhashes_func(struct sourceinfo *const restrict si, const int ATHEME_VATT
 	unsigned int i2;
 	unsigned int i3;
 	unsigned int i4;
+};
 
-	MYENTITY_FOREACH_T(mt, &state, ENT_USER)
-	{
-		const struct myuser *const mu = user(mt);
-
-		continue_if_fail(mu != NULL);
+static int
+ss_pwhashes_classify(struct myuser *const restrict mu, void *const restrict privdata)
+{
+	struct pwhashes_state *const st = privdata;
 
-		const char *const pw = mu->pass;
-		const size_t pwlen = strlen(pw);
+	const char *const pw = mu->pass;
+	const size_t pwlen = strlen(pw);
 
-		if (! (mu->flags & MU_CRYPTPASS))
-		{
-			pwhashes[TYPE_NONE]++;
-		}
-		else if (sscanf(pw, SCANFMT_ANOPE_ENC_SHA256, s1, s2) == 2)
-		{
-			pwhashes[TYPE_ANOPE_ENC_SHA256]++;
-		}
-		else if (sscanf(pw, SCANFMT_ARGON2, s1, &i1, &i2, &i3, &i4, s2, s3) == 7)
-		{
-			if (strcasecmp(s1, "argon2d") == 0)
-				pwhashes[TYPE_ARGON2D]++;
-			else if (strcasecmp(s1, "argon2i") == 0)
-				pwhashes[TYPE_ARGON2I]++;
-			else if (strcasecmp(s1, "argon2id") == 0)
-				pwhashes[TYPE_ARGON2ID]++;
-			else
-				pwhashes[TYPE_UNKNOWN]++;
-		}
-		else if (sscanf(pw, SCANFMT_BASE64, s1) == 1)
-		{
-			pwhashes[TYPE_BASE64]++;
-		}
-		else if (pwlen >= 60U && sscanf(pw, SCANFMT_BCRYPT, s1, &i1, s2, s3) == 4)
-		{
-			pwhashes[TYPE_BCRYPT]++;
-		}
-		else if (pwlen == 13U && sscanf(pw, SCANFMT_CRYPT3_DES, s1) == 1 && strcmp(s1, pw) == 0)
-		{
-			// Fuzzy (no rigid format)
-			pwhashes[TYPE_CRYPT3_DES]++;
-		}
-		else if (sscanf(pw, SCANFMT_CRYPT3_MD5, s1, s2) == 2)
-		{
-			pwhashes[TYPE_CRYPT3_MD5]++;
-		}
-		else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_256, s1, s2) == 2)
-		{
-			pwhashes[TYPE_CRYPT3_SHA2_256]++;
-		}
-		else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_256_EXT, &i1, s1, s2) == 3)
-		{
-			pwhashes[TYPE_CRYPT3_SHA2_256]++;
-		}
-		else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_512, s1, s2) == 2)
-		{
-			pwhashes[TYPE_CRYPT3_SHA2_512]++;
-		}
-		else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_512_EXT, &i1, s1, s2) == 3)
-		{
-			pwhashes[TYPE_CRYPT3_SHA2_512]++;
-		}
-		else if (sscanf(pw, SCANFMT_IRCSERVICES, s1) == 1)
-		{
-			pwhashes[TYPE_IRCSERVICES]++;
-		}
-		else if (pwlen == 144U && sscanf(pw, SCANFMT_PBKDF2, s1, s2) == 2 &&
-		         strlen(s1) == 16U && strlen(s2) == 128U)
-		{
-			// Fuzzy (no rigid format)
-			pwhashes[TYPE_PBKDF2]++;
-		}
-		else if (sscanf(pw, SCANFMT_PBKDF2V2_SCRAM, &i1, &i2, s1, s2, s3) == 5)
-		{
-			switch (i1)
-			{
-				case PBKDF2_PRF_SCRAM_MD5:
-				case PBKDF2_PRF_SCRAM_MD5_S64:
-					pwhashes[TYPE_PBKDF2V2_SCRAM_MD5]++;
-					break;
-				case PBKDF2_PRF_SCRAM_SHA1:
-				case PBKDF2_PRF_SCRAM_SHA1_S64:
-					pwhashes[TYPE_PBKDF2V2_SCRAM_SHA1]++;
-					break;
-				case PBKDF2_PRF_SCRAM_SHA2_256:
-				case PBKDF2_PRF_SCRAM_SHA2_256_S64:
-					pwhashes[TYPE_PBKDF2V2_SCRAM_SHA2_256]++;
-					break;
-				case PBKDF2_PRF_SCRAM_SHA2_512:
-				case PBKDF2_PRF_SCRAM_SHA2_512_S64:
-					pwhashes[TYPE_PBKDF2V2_SCRAM_SHA2_512]++;
-					break;
-				default:
-					pwhashes[TYPE_UNKNOWN]++;
-					break;
-			}
-		}
-		else if (sscanf(pw, SCANFMT_PBKDF2V2_HMAC, &i1, &i2, s1, s2) == 4)
-		{
-			switch (i1)
-			{
-				case PBKDF2_PRF_HMAC_MD5:
-				case PBKDF2_PRF_HMAC_MD5_S64:
-					pwhashes[TYPE_PBKDF2V2_HMAC_MD5]++;
-					break;
-				case PBKDF2_PRF_HMAC_SHA1:
-				case PBKDF2_PRF_HMAC_SHA1_S64:
-					pwhashes[TYPE_PBKDF2V2_HMAC_SHA1]++;
-					break;
-				case PBKDF2_PRF_HMAC_SHA2_256:
-				case PBKDF2_PRF_HMAC_SHA2_256_S64:
-					pwhashes[TYPE_PBKDF2V2_HMAC_SHA2_256]++;
-					break;
-				case PBKDF2_PRF_HMAC_SHA2_512:
-				case PBKDF2_PRF_HMAC_SHA2_512_S64:
-					pwhashes[TYPE_PBKDF2V2_HMAC_SHA2_512]++;
-					break;
-				default:
-					pwhashes[TYPE_UNKNOWN]++;
-					break;
-			}
-		}
-		else if (sscanf(pw, SCANFMT_RAWMD5, s1) == 1)
-		{
-			pwhashes[TYPE_RAWMD5]++;
-		}
-		else if (sscanf(pw, SCANFMT_RAWSHA1, s1) == 1)
-		{
-			pwhashes[TYPE_RAWSHA1]++;
-		}
-		else if (sscanf(pw, SCANFMT_RAWSHA2_256, s1) == 1)
-		{
-			pwhashes[TYPE_RAWSHA2_256]++;
-		}
-		else if (sscanf(pw, SCANFMT_RAWSHA2_512, s1) == 1)
-		{
-			pwhashes[TYPE_RAWSHA2_512]++;
-		}
-		else if (sscanf(pw, SCANFMT_SCRYPT, &i1, &i2, &i3, s1, s2) == 5)
+	if (sscanf(pw, SCANFMT_ANOPE_ENC_SHA256, st->s1, st->s2) == 2)
+	{
+		st->pwhashes[TYPE_ANOPE_ENC_SHA256]++;
+	}
+	else if (sscanf(pw, SCANFMT_ARGON2, st->s1, &st->i1, &st->i2, &st->i3, &st->i4, st->s2, st->s3) == 7)
+	{
+		if (strcasecmp(st->s1, "argon2d") == 0)
+			st->pwhashes[TYPE_ARGON2D]++;
+		else if (strcasecmp(st->s1, "argon2i") == 0)
+			st->pwhashes[TYPE_ARGON2I]++;
+		else if (strcasecmp(st->s1, "argon2id") == 0)
+			st->pwhashes[TYPE_ARGON2ID]++;
+		else
+			st->pwhashes[TYPE_UNKNOWN]++;
+	}
+	else if (sscanf(pw, SCANFMT_BASE64, st->s1) == 1)
+	{
+		st->pwhashes[TYPE_BASE64]++;
+	}
+	else if (pwlen >= 60U && sscanf(pw, SCANFMT_BCRYPT, st->s1, &st->i1, st->s2, st->s3) == 4)
+	{
+		st->pwhashes[TYPE_BCRYPT]++;
+	}
+	else if (pwlen == 13U && sscanf(pw, SCANFMT_CRYPT3_DES, st->s1) == 1 && strcmp(st->s1, pw) == 0)
+	{
+		// Fuzzy (no rigid format)
+		st->pwhashes[TYPE_CRYPT3_DES]++;
+	}
+	else if (sscanf(pw, SCANFMT_CRYPT3_MD5, st->s1, st->s2) == 2)
+	{
+		st->pwhashes[TYPE_CRYPT3_MD5]++;
+	}
+	else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_256, st->s1, st->s2) == 2)
+	{
+		st->pwhashes[TYPE_CRYPT3_SHA2_256]++;
+	}
+	else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_256_EXT, &st->i1, st->s1, st->s2) == 3)
+	{
+		st->pwhashes[TYPE_CRYPT3_SHA2_256]++;
+	}
+	else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_512, st->s1, st->s2) == 2)
+	{
+		st->pwhashes[TYPE_CRYPT3_SHA2_512]++;
+	}
+	else if (sscanf(pw, SCANFMT_CRYPT3_SHA2_512_EXT, &st->i1, st->s1, st->s2) == 3)
+	{
+		st->pwhashes[TYPE_CRYPT3_SHA2_512]++;
+	}
+	else if (sscanf(pw, SCANFMT_IRCSERVICES, st->s1) == 1)
+	{
+		st->pwhashes[TYPE_IRCSERVICES]++;
+	}
+	else if (pwlen == 144U && sscanf(pw, SCANFMT_PBKDF2, st->s1, st->s2) == 2 &&
+	         strlen(st->s1) == 16U && strlen(st->s2) == 128U)
+	{
+		// Fuzzy (no rigid format)
+		st->pwhashes[TYPE_PBKDF2]++;
+	}
+	else if (sscanf(pw, SCANFMT_PBKDF2V2_SCRAM, &st->i1, &st->i2, st->s1, st->s2, st->s3) == 5)
+	{
+		switch (st->i1)
 		{
-			pwhashes[TYPE_SCRYPT]++;
+			case PBKDF2_PRF_SCRAM_MD5:
+			case PBKDF2_PRF_SCRAM_MD5_S64:
+				st->pwhashes[TYPE_PBKDF2V2_SCRAM_MD5]++;
+				break;
+			case PBKDF2_PRF_SCRAM_SHA1:
+			case PBKDF2_PRF_SCRAM_SHA1_S64:
+				st->pwhashes[TYPE_PBKDF2V2_SCRAM_SHA1]++;
+				break;
+			case PBKDF2_PRF_SCRAM_SHA2_256:
+			case PBKDF2_PRF_SCRAM_SHA2_256_S64:
+				st->pwhashes[TYPE_PBKDF2V2_SCRAM_SHA2_256]++;
+				break;
+			case PBKDF2_PRF_SCRAM_SHA2_512:
+			case PBKDF2_PRF_SCRAM_SHA2_512_S64:
+				st->pwhashes[TYPE_PBKDF2V2_SCRAM_SHA2_512]++;
+				break;
+			default:
+				st->pwhashes[TYPE_UNKNOWN]++;
+				break;
 		}
-		else
+	}
+	else if (sscanf(pw, SCANFMT_PBKDF2V2_HMAC, &st->i1, &st->i2, st->s1, st->s2) == 4)
+	{
+		switch (st->i1)
 		{
-			pwhashes[TYPE_UNKNOWN]++;
+			case PBKDF2_PRF_HMAC_MD5:
+			case PBKDF2_PRF_HMAC_MD5_S64:
+				st->pwhashes[TYPE_PBKDF2V2_HMAC_MD5]++;
+				break;
+			case PBKDF2_PRF_HMAC_SHA1:
+			case PBKDF2_PRF_HMAC_SHA1_S64:
+				st->pwhashes[TYPE_PBKDF2V2_HMAC_SHA1]++;
+				break;
+			case PBKDF2_PRF_HMAC_SHA2_256:
+			case PBKDF2_PRF_HMAC_SHA2_256_S64:
+				st->pwhashes[TYPE_PBKDF2V2_HMAC_SHA2_256]++;
+				break;
+			case PBKDF2_PRF_HMAC_SHA2_512:
+			case PBKDF2_PRF_HMAC_SHA2_512_S64:
+				st->pwhashes[TYPE_PBKDF2V2_HMAC_SHA2_512]++;
+				break;
+			default:
+				st->pwhashes[TYPE_UNKNOWN]++;
+				break;
 		}
 	}
+	else if (sscanf(pw, SCANFMT_RAWMD5, st->s1) == 1)
+	{
+		st->pwhashes[TYPE_RAWMD5]++;
+	}
+	else if (sscanf(pw, SCANFMT_RAWSHA1, st->s1) == 1)
+	{
+		st->pwhashes[TYPE_RAWSHA1]++;
+	}
+	else if (sscanf(pw, SCANFMT_RAWSHA2_256, st->s1) == 1)
+	{
+		st->pwhashes[TYPE_RAWSHA2_256]++;
+	}
+	else if (sscanf(pw, SCANFMT_RAWSHA2_512, st->s1) == 1)
+	{
+		st->pwhashes[TYPE_RAWSHA2_512]++;
+	}
+	else if (sscanf(pw, SCANFMT_SCRYPT, &st->i1, &st->i2, &st->i3, st->s1, st->s2) == 5)
+	{
+		st->pwhashes[TYPE_SCRYPT]++;
+	}
+	else
+	{
+		st->pwhashes[TYPE_UNKNOWN]++;
+	}
+
+	return 0;
+}
+
+static void
+ss_cmd_pwhashes_func(struct sourceinfo *const restrict si, const int ATHEME_VATTR_UNUSED parc,
+                     char ATHEME_VATTR_UNUSED **const restrict parv)
+{
+	(void) logcommand(si, CMDLOG_GET, "PWHASHES");
+
+	struct pwhashes_state st;
+
+	(void) memset(&st, 0x00, sizeof st);
+
+	// Only accounts with MU_CRYPTPASS set need their password looked at
+	const unsigned int crypted = myuser_count_with_flags(MU_CRYPTPASS);
+
+	st.pwhashes[TYPE_NONE] = myuser_count_with_flags(0) - crypted;
+
+	(void) myuser_foreach_with_flags(MU_CRYPTPASS, &ss_pwhashes_classify, &st);
 
-	(void) smemzero(s1, sizeof s1);
-	(void) smemzero(s2, sizeof s2);
-	(void) smemzero(s3, sizeof s3);
-	(void) smemzero(s4, sizeof s4);
+	(void) smemzero(st.s1, sizeof st.s1);
+	(void) smemzero(st.s2, sizeof st.s2);
+	(void) smemzero(st.s3, sizeof st.s3);
+	(void) smemzero(st.s4, sizeof st.s4);
 
 	for (enum crypto_type i = TYPE_NONE; i < TYPE_TOTAL_COUNT; i++)
-		if (pwhashes[i])
-			(void) command_success_nodata(si, "%-36s: %u", crypto_type_to_name(i), pwhashes[i]);
+		if (st.pwhashes[i])
+			(void) command_success_nodata(si, "%-36s: %u", crypto_type_to_name(i), st.pwhashes[i]);
 }
 
 static struct command ss_cmd_pwhashes = {
@@ -613,6 +613,143 @@ jsonrpcmethod_metadata(void *conn, mowgli_list_t *params, char *id)
 	return 0;
 }
 
+static mowgli_json_t *
+jsonrpc_latency_stat(const struct latency_stat *const restrict stat)
+{
+	const struct latency_histogram *const hist = &stat->hist;
+	mowgli_json_t *const statobj = mowgli_json_create_object();
+	mowgli_patricia_t *const patricia = MOWGLI_JSON_OBJECT(statobj);
+
+	mowgli_patricia_add(patricia, "kind", mowgli_json_create_string(latency_kind_name(stat->kind)));
+	mowgli_patricia_add(patricia, "name", mowgli_json_create_string(stat->name));
+	mowgli_patricia_add(patricia, "count", mowgli_json_create_float((double) hist->count));
+	mowgli_patricia_add(patricia, "total_us", mowgli_json_create_float(hist->total / 1e3));
+	mowgli_patricia_add(patricia, "mean_us", mowgli_json_create_float((hist->total / 1e3) / hist->count));
+	mowgli_patricia_add(patricia, "p50_us", mowgli_json_create_float(latency_percentile(hist, 500U) / 1e3));
+	mowgli_patricia_add(patricia, "p90_us", mowgli_json_create_float(latency_percentile(hist, 900U) / 1e3));
+	mowgli_patricia_add(patricia, "p99_us", mowgli_json_create_float(latency_percentile(hist, 990U) / 1e3));
+	mowgli_patricia_add(patricia, "p999_us", mowgli_json_create_float(latency_percentile(hist, 999U) / 1e3));
+	mowgli_patricia_add(patricia, "max_us", mowgli_json_create_float(hist->max / 1e3));
+
+	return statobj;
+}
+
+/* atheme.latency
+ *
+ * JSON inputs:
+ *       authcookie, account name, kind (optional: ALL, HOOK, PCOMMAND or
+ *       COMMAND), count (optional, default 10, at most 100)
+ *
+ * JSON outputs:
+ *       An object with the following properties:
+ *       enabled: boolean: whether services are timing anything
+ *       stats: array: the hook handlers and commands that have taken the
+ *       most time in total, each an object with its kind and name, the
+ *       number of times it ran, and the total, mean, percentile and highest
+ *       times in microseconds
+ *
+ *       The account must have the general:auspex privilege.
+ */
+static bool
+jsonrpcmethod_latency(void *conn, mowgli_list_t *params, char *id)
+{
+	const struct latency_stat *stats[100];
+	unsigned int max = 10;
+	struct myuser *mu;
+	enum latency_kind kind = LATENCY_HOOK;
+	mowgli_node_t *n;
+	size_t count;
+
+	char *param, *cookie, *accountname, *kindstr, *countstr;
+
+	size_t len = MOWGLI_LIST_LENGTH(params);
+
+	MOWGLI_LIST_FOREACH(n, params->head)
+	{
+		param = n->data;
+
+		if (*param == '\0' || strchr(param, '\r') || strchr(param, '\n'))
+		{
+			jsonrpc_failure_string(conn, fault_badparams, "Invalid parameters.", id);
+			return 0;
+		}
+	}
+
+	if (len < 2)
+	{
+		jsonrpc_failure_string(conn, fault_needmoreparams, "Insufficient parameters.", id);
+		return 0;
+	}
+
+	cookie = mowgli_node_nth_data(params, 0);
+	accountname = mowgli_node_nth_data(params, 1);
+	kindstr = (len >= 3) ? mowgli_node_nth_data(params, 2) : NULL;
+	countstr = (len >= 4) ? mowgli_node_nth_data(params, 3) : NULL;
+
+	if ((mu = myuser_find(accountname)) == NULL)
+	{
+		jsonrpc_failure_string(conn, fault_nosuch_source, "Unknown user.", id);
+		return 0;
+	}
+
+	if (authcookie_validate(cookie, mu) == false)
+	{
+		jsonrpc_failure_string(conn, fault_badauthcookie, "Invalid authcookie for this account.", id);
+		return 0;
+	}
+
+	if (! has_priv_myuser(mu, PRIV_SERVER_AUSPEX))
+	{
+		jsonrpc_failure_string(conn, fault_noprivs, "You do not have the general:auspex privilege.", id);
+		return 0;
+	}
+
+	const bool all = (kindstr == NULL || strcasecmp(kindstr, "ALL") == 0);
+
+	if (! all && ! latency_kind_parse(kindstr, &kind))
+	{
+		jsonrpc_failure_string(conn, fault_badparams, "Unknown kind.", id);
+		return 0;
+	}
+
+	if (countstr != NULL && (! string_to_uint(countstr, &max) || max == 0 || max > ARRAY_SIZE(stats)))
+	{
+		jsonrpc_failure_string(conn, fault_badparams, "Invalid count.", id);
+		return 0;
+	}
+
+	count = latency_top(all ? NULL : &kind, stats, max);
+
+	mowgli_json_t *statsobj = mowgli_json_create_array();
+
+	for (size_t i = 0; i < count; i++)
+		mowgli_node_add(jsonrpc_latency_stat(stats[i]), mowgli_node_create(), MOWGLI_JSON_ARRAY(statsobj));
+
+	mowgli_json_t *resultobj = mowgli_json_create_object();
+	mowgli_patricia_t *patricia = MOWGLI_JSON_OBJECT(resultobj);
+
+	mowgli_patricia_add(patricia, "enabled", latency_enabled ? mowgli_json_true : mowgli_json_false);
+	mowgli_patricia_add(patricia, "stats", statsobj);
+
+	mowgli_json_t *obj = mowgli_json_create_object();
+	patricia = MOWGLI_JSON_OBJECT(obj);
+
+	mowgli_patricia_add(patricia, "result", resultobj);
+	mowgli_patricia_add(patricia, "id", mowgli_json_create_string(id));
+	mowgli_patricia_add(patricia, "error", mowgli_json_null);
+
+	mowgli_string_t *str = mowgli_string_create();
+
+	mowgli_json_serialize_to_string(obj, str, 0);
+
+	jsonrpc_send_data(conn, str->str);
+
+	mowgli_string_destroy(str);
+	mowgli_json_decref(obj);
+
+	return 0;
+}
+
 void
 jsonrpc_send_data(void *conn, char *str)
 {
@@ -668,6 +805,7 @@ mod_init(struct module *const restrict m)
 	jsonrpc_register_method("atheme.privset", jsonrpcmethod_privset);
 	jsonrpc_register_method("atheme.ison", jsonrpcmethod_ison);
 	jsonrpc_register_method("atheme.metadata", jsonrpcmethod_metadata);
+	jsonrpc_register_method("atheme.latency", jsonrpcmethod_latency);
 
 }
 
@@ -683,6 +821,7 @@ mod_deinit(const enum module_unload_intent ATHEME_VATTR_UNUSED intent)
 	jsonrpc_unregister_method("atheme.privset");
 	jsonrpc_unregister_method("atheme.ison");
 	jsonrpc_unregister_method("atheme.metadata");
+	jsonrpc_unregister_method("atheme.latency");
 
 	if ((n = mowgli_node_find(&handle_jsonrpc, httpd_path_handlers)) != NULL)
 	{
@@ -15,6 +15,30 @@
 #include <atheme.h>
 #include "rfc1459.h"
 
+/* Server names have a dot in them and nicknames never do, while SIDs and
+ * UIDs start with a digit, which nicknames can't, and SIDs are the short
+ * ones; so the shape of an origin says where to look it up. Only if that
+ * finds nothing is it looked up everywhere.
+ */
+static void
+irc_parse_origin(struct sourceinfo *const restrict si, const char *const restrict origin)
+{
+	if (strchr(origin, '.') != NULL)
+		si->s = server_find(origin);
+	else if (isdigit((unsigned char) *origin) && strlen(origin) <= 3)
+		si->s = server_find(origin);
+	else if (isdigit((unsigned char) *origin))
+		si->su = user_find(origin);
+	else
+		si->su = user_find_named(origin);
+
+	if (si->s == NULL && si->su == NULL)
+	{
+		si->s = server_find(origin);
+		si->su = user_find(origin);
+	}
+}
+
 // parses a standard 2.8.21 style IRC stream
 void
 irc_parse(char *line)
@@ -68,8 +92,7 @@ irc_parse(char *line)
 			{
                         	origin = line + 1;
 
-				si->s = server_find(origin);
-				si->su = user_find(origin);
+				irc_parse_origin(si, origin);
 
 				if ((message = strchr(pos, ' ')))
 				{
@@ -162,10 +185,7 @@ irc_parse(char *line)
 				slog(LG_INFO, "irc_parse(): insufficient parameters for command %s", pcmd->token);
 				goto cleanup;
 			}
-			if (pcmd->handler)
-			{
-				pcmd->handler(si, parc, parv);
-			}
+			pcommand_exec(pcmd, si, parc, parv);
 		}
 	}
 
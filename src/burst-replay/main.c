@@ -0,0 +1,547 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * Burst replay harness.
+ *
+ * This starts services the way atheme_main() does (configuration file,
+ * modules and database), but instead of connecting to the uplink it hands
+ * services one end of a socket pair and feeds a burst through the protocol
+ * module's parser, one line at a time, as if the uplink had sent it. The
+ * burst is either read from a file (raw lines as received from the uplink)
+ * or generated, in which case it is a TS6 burst with EUID, as sent by
+ * charybdis and its descendants.
+ *
+ * Everything services send back is read from the other end of the pair
+ * and counted. At the end it reports how fast the burst was absorbed, how
+ * much was sent back, the peak memory use, and the time spent in each
+ * hook.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+#include <ext/getopt_long.h>
+
+#ifndef MAXIMUM
+#  define MAXIMUM(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define REPLAY_USERS_MAX        10000000U
+#define REPLAY_HOOKS_SHOWN      25U
+
+// Flush and read back what services have sent once this much is waiting
+#define REPLAY_FLUSH_BYTES      65536U
+
+// Shape of a generated burst
+#define REPLAY_USERS_PER_SERVER 5000U
+#define REPLAY_USERS_PER_CHAN   8U
+#define REPLAY_CHANS_PER_USER   3U
+#define REPLAY_SJOIN_UIDS       12U
+#define REPLAY_LOGIN_PERCENT    30U
+
+static const char *replay_config = SYSCONFDIR "/atheme.conf";
+static const char *replay_datadir = DATADIR;
+static const char *replay_logfile = LOGDIR "/burst-replay.log";
+static const char *replay_path = NULL;
+static unsigned int replay_generate = 0;
+
+static char **replay_lines = NULL;
+static size_t replay_line_count = 0;
+static size_t replay_line_alloc = 0;
+
+static int replay_peer = -1;
+static size_t replay_out_lines = 0;
+static size_t replay_out_bytes = 0;
+
+static const struct latency_stat **replay_hooks = NULL;
+static size_t replay_hook_count = 0;
+
+static const mowgli_getopt_option_t replay_long_opts[] = {
+
+	{     "help",       no_argument, NULL, 'h', 0 },
+	{   "config", required_argument, NULL, 'c', 0 },
+	{  "datadir", required_argument, NULL, 'D', 0 },
+	{     "file", required_argument, NULL, 'f', 0 },
+	{ "generate", required_argument, NULL, 'g', 0 },
+	{  "logfile", required_argument, NULL, 'l', 0 },
+
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const restrict progname)
+{
+	(void) fprintf(stderr, ""
+		"\n"
+		"Usage: %s [options] (-f <file> | -g <users>)\n"
+		"\n"
+		"  -h/--help                Display this help information and exit\n"
+		"  -c/--config PATH         Configuration file to use (default: %s)\n"
+		"  -D/--datadir PATH        Directory the database is in (default: %s)\n"
+		"  -f/--file PATH           Burst to replay, one raw line from the uplink per line\n"
+		"  -g/--generate N          Generate a TS6 burst with N users instead\n"
+		"  -l/--logfile PATH        Log file to use (default: %s)\n"
+		"\n"
+		"The configuration must have an uplink{} block; the first one is\n"
+		"used for its name and passwords, but nothing is connected to.\n"
+		"The database is only read, never written.\n"
+		"\n",
+		progname, SYSCONFDIR "/atheme.conf", DATADIR, LOGDIR "/burst-replay.log");
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = mowgli_getopt_long(argc, argv, "c:D:f:g:hl:", replay_long_opts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'c':
+				replay_config = mowgli_optarg;
+				break;
+
+			case 'D':
+				replay_datadir = mowgli_optarg;
+				break;
+
+			case 'f':
+				replay_path = mowgli_optarg;
+				break;
+
+			case 'g':
+				if (! string_to_uint(mowgli_optarg, &replay_generate) || ! replay_generate ||
+				    replay_generate > REPLAY_USERS_MAX)
+				{
+					(void) fprintf(stderr, "'%s' is not a valid value for option '%c' (1 to %u)\n",
+					                       mowgli_optarg, c, REPLAY_USERS_MAX);
+					return false;
+				}
+				break;
+
+			case 'l':
+				replay_logfile = mowgli_optarg;
+				break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+	}
+
+	if ((replay_path != NULL) == (replay_generate != 0))
+	{
+		(void) print_usage(argv[0]);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+replay_clock(struct timespec *const restrict ts)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, ts) != 0)
+	{
+		(void) perror("clock_gettime(2)");
+		return false;
+	}
+
+	return true;
+}
+
+static double
+replay_elapsed(const struct timespec *const restrict begin, const struct timespec *const restrict end)
+{
+	return ((double) (end->tv_sec - begin->tv_sec)) + (((double) (end->tv_nsec - begin->tv_nsec)) / 1e9);
+}
+
+// Peak resident set size in KiB
+static long
+replay_peak_rss(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		return 0;
+
+	return ru.ru_maxrss;
+}
+
+static void ATHEME_FATTR_PRINTF(1, 2)
+replay_line_add(const char *const restrict fmt, ...)
+{
+	char buf[BUFSIZE];
+	va_list ap;
+
+	va_start(ap, fmt);
+	(void) vsnprintf(buf, sizeof buf, fmt, ap);
+	va_end(ap);
+
+	if (replay_line_count == replay_line_alloc)
+	{
+		replay_line_alloc = MAXIMUM(replay_line_alloc * 2U, 1024U);
+		replay_lines = srealloc(replay_lines, replay_line_alloc * sizeof *replay_lines);
+	}
+
+	replay_lines[replay_line_count++] = sstrdup(buf);
+}
+
+/* This is done before services change to their own directory, so that a
+ * relative path means what it did on the command line.
+ */
+static bool
+replay_lines_load(void)
+{
+	char buf[BUFSIZE];
+	FILE *fp;
+
+	if (! (fp = fopen(replay_path, "r")))
+	{
+		(void) fprintf(stderr, "Cannot open '%s': %s\n", replay_path, strerror(errno));
+		return false;
+	}
+
+	while (fgets(buf, sizeof buf, fp) != NULL)
+	{
+		buf[strcspn(buf, "\r\n")] = '\0';
+
+		if (*buf)
+			(void) replay_line_add("%s", buf);
+	}
+
+	(void) fclose(fp);
+
+	if (! replay_line_count)
+	{
+		(void) fprintf(stderr, "'%s' has no lines to replay\n", replay_path);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+replay_make_sid(char *const restrict buf, const unsigned int n)
+{
+	buf[0] = (char) ('1' + (n / (26U * 26U)) % 9U);
+	buf[1] = (char) ('A' + (n / 26U) % 26U);
+	buf[2] = (char) ('A' + n % 26U);
+	buf[3] = '\0';
+}
+
+static void
+replay_make_uid(char *const restrict buf, const char *const restrict sid, unsigned int n)
+{
+	(void) mowgli_strlcpy(buf, sid, 4);
+
+	for (unsigned int i = 8; i >= 3; i--)
+	{
+		buf[i] = (char) ('A' + n % 26U);
+		n /= 26U;
+	}
+
+	buf[9] = '\0';
+}
+
+/* A netjoin of a network with this many users: its servers, then its
+ * users (some of them logged in), then its channels.
+ */
+static void
+replay_lines_generate(void)
+{
+	const unsigned int servers = ((replay_generate - 1U) / REPLAY_USERS_PER_SERVER) + 1U;
+	const unsigned int chans = MAXIMUM(replay_generate / REPLAY_USERS_PER_CHAN, 1U);
+	const char *const usid = "0RP";
+	char sid[4], uid[10];
+
+	(void) replay_line_add("PASS %s TS 6 :%s", curr_uplink->receive_pass ? curr_uplink->receive_pass : "*", usid);
+	(void) replay_line_add("CAPAB :QS EX CHW IE KLN KNOCK TB UNKLN CLUSTER ENCAP SERVICES RSFNC SAVE EUID "
+	                       "EOPMOD BAN MLOCK");
+	(void) replay_line_add("SERVER %s 1 :burst replay uplink", curr_uplink->name);
+	(void) replay_line_add("SVINFO 6 6 0 :%lu", (unsigned long) CURRTIME);
+
+	for (unsigned int s = 0; s < servers; s++)
+	{
+		(void) replay_make_sid(sid, s);
+		(void) replay_line_add(":%s SID leaf%u.burst.invalid 2 %s :burst replay leaf", usid, s, sid);
+	}
+
+	for (unsigned int i = 0; i < replay_generate; i++)
+	{
+		const bool login = (atheme_random_uniform(100U) < REPLAY_LOGIN_PERCENT);
+		char account[BUFSIZE];
+
+		(void) replay_make_sid(sid, i / REPLAY_USERS_PER_SERVER);
+		(void) replay_make_uid(uid, sid, i);
+		(void) snprintf(account, sizeof account, "replay%u", i);
+
+		(void) replay_line_add(":%s EUID Replay%u 2 %lu +i ~u%u %u.%u.example.net 192.0.2.%u %s * %s :user %u",
+		                       sid, i, (unsigned long) CURRTIME - (i % 86400U), i % 5000U, i / 256U, i % 256U,
+		                       i % 256U, uid, (login && (i % 2U)) ? account : "*", i);
+
+		// Half of the logins arrive after the introduction, as they do after SASL
+		if (login && ! (i % 2U))
+			(void) replay_line_add(":%s ENCAP * LOGIN %s", uid, account);
+
+		if (! (i % 10U))
+			(void) replay_line_add(":%s MODE %s +w", uid, uid);
+	}
+
+	for (unsigned int c = 0; c < chans; c++)
+	{
+		const unsigned int members = (replay_generate * REPLAY_CHANS_PER_USER) / chans;
+		char buf[BUFSIZE];
+		size_t len = 0;
+
+		*buf = '\0';
+
+		for (unsigned int m = 0; m < members; m++)
+		{
+			const unsigned int i = atheme_random_uniform(replay_generate);
+
+			(void) replay_make_sid(sid, i / REPLAY_USERS_PER_SERVER);
+			(void) replay_make_uid(uid, sid, i);
+
+			len += (size_t) snprintf(buf + len, sizeof buf - len, "%s%s%s", len ? " " : "",
+			                         (m == 0) ? "@" : "", uid);
+
+			if (((m + 1U) % REPLAY_SJOIN_UIDS) == 0 || (m + 1U) == members)
+			{
+				(void) replay_line_add(":%s SJOIN %lu #replay%u +nt :%s", usid,
+				                       (unsigned long) CURRTIME - c, c, buf);
+				*buf = '\0';
+				len = 0;
+			}
+		}
+	}
+
+	(void) replay_line_add(":%s PING %s :%s", usid, curr_uplink->name, me.name);
+}
+
+// Sends what services have queued up and reads it back, counting the lines
+static void
+replay_drain(struct connection *const restrict conn)
+{
+	char buf[65536];
+	ssize_t len;
+
+	do
+	{
+		(void) sendq_flush(conn);
+
+		while ((len = recv(replay_peer, buf, sizeof buf, 0)) > 0)
+		{
+			replay_out_bytes += (size_t) len;
+
+			for (const char *p = buf; (p = memchr(p, '\n', (size_t) (buf + len - p))) != NULL; p++)
+				replay_out_lines++;
+		}
+	}
+	while (sendq_nonempty(conn) && ! CF_IS_DEAD(conn));
+}
+
+static struct connection *
+replay_uplink_create(void)
+{
+	struct connection *conn;
+	int fds[2];
+
+	if (! uplinks.head)
+	{
+		(void) fprintf(stderr, "The configuration has no uplink{} blocks\n");
+		return NULL;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+	{
+		(void) perror("socketpair(2)");
+		return NULL;
+	}
+
+	if (fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK) != 0)
+	{
+		(void) perror("fcntl(2)");
+		return NULL;
+	}
+
+	if (! (conn = connection_add("burst replay uplink", fds[0], 0, &recvq_put, NULL)))
+		return NULL;
+
+	replay_peer = fds[1];
+	curr_uplink = uplinks.head->data;
+	curr_uplink->conn = conn;
+
+	// What services do once they have connected to the uplink; this sends our own burst
+	(void) irc_handle_connect(conn);
+
+	return conn;
+}
+
+static bool
+replay_run(struct connection *const restrict conn, double *const restrict secs)
+{
+	struct timespec begin, end;
+	char line[BUFSIZE + 1];
+
+	if (! replay_clock(&begin))
+		return false;
+
+	for (size_t i = 0; i < replay_line_count; i++)
+	{
+		(void) mowgli_strlcpy(line, replay_lines[i], sizeof line);
+
+		cnt.bin += (unsigned int) strlen(line) + 2U;
+		me.uplinkpong = CURRTIME;
+
+		(void) parse(line);
+
+		if (CF_IS_DEAD(conn) || (runflags & RF_SHUTDOWN))
+		{
+			(void) fprintf(stderr, "Services dropped the uplink at line %zu: %s\n", i + 1U, replay_lines[i]);
+			return false;
+		}
+
+		if (sendq_length(conn) >= REPLAY_FLUSH_BYTES)
+			(void) replay_drain(conn);
+	}
+
+	(void) replay_drain(conn);
+
+	if (! replay_clock(&end))
+		return false;
+
+	*secs = replay_elapsed(&begin, &end);
+	return true;
+}
+
+static void
+replay_hook_collect(const struct latency_stat *const restrict stat, void ATHEME_VATTR_UNUSED *const restrict priv)
+{
+	if (stat->kind != LATENCY_HOOK || ! stat->hist.count)
+		return;
+
+	replay_hooks = srealloc(replay_hooks, (replay_hook_count + 1U) * sizeof *replay_hooks);
+	replay_hooks[replay_hook_count++] = stat;
+}
+
+static int
+replay_hook_compare(const void *const restrict a, const void *const restrict b)
+{
+	const struct latency_stat *const sa = *(const struct latency_stat *const *) a;
+	const struct latency_stat *const sb = *(const struct latency_stat *const *) b;
+
+	return (sa->hist.total < sb->hist.total) - (sa->hist.total > sb->hist.total);
+}
+
+static void
+replay_report(const double secs, const long rss_before)
+{
+	(void) printf("%zu lines in %.3f s: %.0f lines/s, %.1f us/line\n", replay_line_count, secs,
+	              replay_line_count / secs, (secs * 1e6) / replay_line_count);
+	(void) printf("%zu lines (%zu bytes) sent back\n", replay_out_lines, replay_out_bytes);
+	(void) printf("%u servers, %u users, %u channels\n", mowgli_patricia_size(servlist),
+	              mowgli_patricia_size(userlist), mowgli_patricia_size(chanlist));
+	(void) printf("peak RSS %ld KiB (%ld KiB before the burst)\n", replay_peak_rss(), rss_before);
+
+	(void) latency_foreach(&replay_hook_collect, NULL);
+	(void) qsort(replay_hooks, replay_hook_count, sizeof *replay_hooks, &replay_hook_compare);
+
+	if (replay_hook_count)
+		(void) printf("\n  %-48s %10s %12s %10s %10s\n", "hook (module)", "calls", "total ms", "ns/call",
+		              "p99 ns");
+
+	for (size_t i = 0; i < replay_hook_count && i < REPLAY_HOOKS_SHOWN; i++)
+	{
+		const struct latency_histogram *const hist = &replay_hooks[i]->hist;
+
+		(void) printf("  %-48s %10" PRIu64 " %12.3f %10.0f %10" PRIu64 "\n", replay_hooks[i]->name,
+		              hist->count, hist->total / 1e6, ((double) hist->total) / hist->count,
+		              latency_percentile(hist, 990U));
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct connection *conn;
+	double secs = 0;
+	long rss;
+
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	if (replay_path && ! replay_lines_load())
+		return EXIT_FAILURE;
+
+	(void) atheme_bootstrap();
+	(void) atheme_init(argv[0], sstrdup(replay_logfile));
+
+	runflags |= RF_STARTING;
+	datadir = sstrdup(replay_datadir);
+	readonly = true;
+
+	(void) atheme_setup();
+	(void) conf_init();
+
+	config_file = sstrdup(replay_config);
+
+	if (! conf_parse(config_file))
+	{
+		(void) fprintf(stderr, "Error loading config file %s\n", replay_config);
+		return EXIT_FAILURE;
+	}
+
+	if (! me.name)
+	{
+		(void) fprintf(stderr, "The configuration has no server name\n");
+		return EXIT_FAILURE;
+	}
+
+	if (db_load)
+		(void) db_load(NULL);
+
+	(void) db_check();
+
+	runflags &= ~RF_STARTING;
+
+	if (! (conn = replay_uplink_create()))
+		return EXIT_FAILURE;
+
+	if (replay_generate)
+		(void) replay_lines_generate();
+
+	// Our own burst isn't part of what is measured
+	(void) replay_drain(conn);
+	replay_out_lines = 0;
+	replay_out_bytes = 0;
+
+	rss = replay_peak_rss();
+
+	// Only the burst itself is timed
+	(void) latency_reset();
+	latency_enabled = true;
+
+	if (! replay_run(conn, &secs))
+		return EXIT_FAILURE;
+
+	latency_enabled = false;
+
+	(void) replay_report(secs, rss);
+
+	return EXIT_SUCCESS;
+}
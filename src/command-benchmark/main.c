@@ -0,0 +1,300 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * Command dispatch microbenchmark.
+ *
+ * This looks up command names the way command_exec_split() does for a
+ * service: first through the service's aliases and then in its command
+ * tree, and then again through a dispatch table built from both. Names are
+ * typed in random case, and some are aliases or don't exist at all.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+#include <ext/getopt_long.h>
+
+#define BENCH_LOOKUPS_DEF       1000000U
+#define BENCH_LOOKUPS_MAX       100000000U
+#define BENCH_ROUNDS_DEF        5U
+#define BENCH_ROUNDS_MAX        1000U
+
+// Out of every 16 lookups, how many are for an alias and how many for no command at all
+#define BENCH_ALIAS_SIXTEENTHS  2U
+#define BENCH_MISS_SIXTEENTHS   1U
+
+// Roughly what NickServ and ChanServ have loaded on a typical network
+static const char *const bench_command_names[] = {
+
+	"ACCESS", "AKICK", "BAN", "CLEAR", "CLOSE", "COUNT", "DEHALFOP", "DEOP", "DEOWNER", "DEPROTECT",
+	"DEVOICE", "DROP", "FDROP", "FFLAGS", "FLAGS", "FUNGROUP", "GETKEY", "GHOST", "GROUP", "HALFOP",
+	"HELP", "HOLD", "IDENTIFY", "INFO", "INVITE", "KICK", "KICKBAN", "LIST", "LISTCHANS", "LISTMAIL",
+	"LOGOUT", "MARK", "OP", "OWNER", "PROTECT", "QUIET", "RECOVER", "REGAIN", "REGISTER", "RELEASE",
+	"RESETPASS", "SENDPASS", "SET", "SETPASS", "STATUS", "SYNC", "TAXONOMY", "TEMPLATE", "TOPIC",
+	"TOPICAPPEND", "TOPICPREPEND", "UNBAN", "UNGROUP", "UNQUIET", "UPDATE", "VERIFY", "VHOST", "VOICE",
+	"WHY",
+};
+
+static const char *const bench_aliases[][2] = {
+
+	{    "ID", "IDENTIFY" },
+	{   "REG", "REGISTER" },
+	{    "KB", "KICKBAN"  },
+	{     "T", "TOPIC"    },
+	{   "ACC", "STATUS"   },
+	{ "LOGIN", "IDENTIFY" },
+};
+
+#define BENCH_COMMANDS          (sizeof bench_command_names / sizeof bench_command_names[0])
+#define BENCH_ALIASES           (sizeof bench_aliases / sizeof bench_aliases[0])
+
+static unsigned int bench_lookup_count = BENCH_LOOKUPS_DEF;
+static unsigned int bench_rounds = BENCH_ROUNDS_DEF;
+
+static struct command bench_commands[BENCH_COMMANDS];
+static mowgli_patricia_t *bench_commandtree = NULL;
+static mowgli_patricia_t *bench_aliastree = NULL;
+static char **bench_names = NULL;
+
+static const mowgli_getopt_option_t bench_long_opts[] = {
+
+	{    "help",       no_argument, NULL, 'h', 0 },
+	{ "lookups", required_argument, NULL, 'l', 0 },
+	{  "rounds", required_argument, NULL, 'r', 0 },
+
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const restrict progname)
+{
+	(void) fprintf(stderr, ""
+		"\n"
+		"Usage: %s [options]\n"
+		"\n"
+		"  -h/--help                Display this help information and exit\n"
+		"  -l/--lookups N           Number of command names looked up per round (default: %u)\n"
+		"  -r/--rounds N            Number of rounds (default: %u)\n"
+		"\n",
+		progname, BENCH_LOOKUPS_DEF, BENCH_ROUNDS_DEF);
+}
+
+static bool
+process_uint_option(const int sw, const char *const restrict val, unsigned int *const restrict out,
+                    const unsigned int val_max)
+{
+	if (! string_to_uint(val, out) || ! *out || *out > val_max)
+	{
+		(void) fprintf(stderr, "'%s' is not a valid value for option '%c' (1 to %u)\n", val, sw, val_max);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = mowgli_getopt_long(argc, argv, "hl:r:", bench_long_opts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'l':
+				if (! process_uint_option(c, mowgli_optarg, &bench_lookup_count, BENCH_LOOKUPS_MAX))
+					return false;
+				break;
+
+			case 'r':
+				if (! process_uint_option(c, mowgli_optarg, &bench_rounds, BENCH_ROUNDS_MAX))
+					return false;
+				break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+bench_clock(struct timespec *const restrict ts)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, ts) != 0)
+	{
+		(void) perror("clock_gettime(2)");
+		return false;
+	}
+
+	return true;
+}
+
+static double
+bench_elapsed(const struct timespec *const restrict begin, const struct timespec *const restrict end)
+{
+	return ((double) (end->tv_sec - begin->tv_sec)) + (((double) (end->tv_nsec - begin->tv_nsec)) / 1e9);
+}
+
+static void
+bench_trees_create(void)
+{
+	bench_commandtree = mowgli_patricia_create(strcasecanon);
+	bench_aliastree = mowgli_patricia_create(strcasecanon);
+
+	for (size_t i = 0; i < BENCH_COMMANDS; i++)
+	{
+		bench_commands[i].name = bench_command_names[i];
+		bench_commands[i].maxparc = 1;
+
+		(void) command_add(&bench_commands[i], bench_commandtree);
+	}
+
+	for (size_t i = 0; i < BENCH_ALIASES; i++)
+		(void) mowgli_patricia_add(bench_aliastree, bench_aliases[i][0], (void *) bench_aliases[i][1]);
+}
+
+/* All names are generated up front, so that only looking them up is
+ * timed. Users type commands in whatever case they like.
+ */
+static void
+bench_names_create(void)
+{
+	char buf[BUFSIZE];
+
+	bench_names = smalloc(bench_lookup_count * sizeof *bench_names);
+
+	for (unsigned int i = 0; i < bench_lookup_count; i++)
+	{
+		const unsigned int kind = atheme_random_uniform(16U);
+
+		if (kind < BENCH_MISS_SIXTEENTHS)
+			(void) snprintf(buf, sizeof buf, "NOSUCH%u", atheme_random_uniform(1000U));
+		else if (kind < (BENCH_MISS_SIXTEENTHS + BENCH_ALIAS_SIXTEENTHS))
+			(void) mowgli_strlcpy(buf, bench_aliases[atheme_random_uniform(BENCH_ALIASES)][0], sizeof buf);
+		else
+			(void) mowgli_strlcpy(buf, bench_command_names[atheme_random_uniform(BENCH_COMMANDS)], sizeof buf);
+
+		for (char *p = buf; *p != '\0'; p++)
+			if (atheme_random_uniform(2U))
+				*p = (char) tolower((unsigned char) *p);
+
+		bench_names[i] = sstrdup(buf);
+	}
+}
+
+static struct command *
+bench_lookup_patricia(const char *name)
+{
+	const char *const alias = mowgli_patricia_retrieve(bench_aliastree, name);
+
+	return command_find(bench_commandtree, (alias != NULL) ? alias : name);
+}
+
+static void
+bench_report(const char *const restrict what, const size_t ops, const double secs)
+{
+	(void) printf("  %-10s %10zu ops in %8.3f s: %12.0f ops/s, %7.1f ns/op\n",
+	              what, ops, secs, ops / secs, (secs * 1e9) / ops);
+}
+
+static bool
+bench_run(void)
+{
+	struct command_dispatch *dispatch = NULL;
+	double patricia = 0, build = 0, table = 0;
+	size_t patricia_found = 0, table_found = 0;
+	struct timespec begin, end;
+
+	for (unsigned int r = 0; r < bench_rounds; r++)
+	{
+		if (! bench_clock(&begin))
+			return false;
+
+		for (unsigned int i = 0; i < bench_lookup_count; i++)
+			if (bench_lookup_patricia(bench_names[i]) != NULL)
+				patricia_found++;
+
+		if (! bench_clock(&end))
+			return false;
+
+		patricia += bench_elapsed(&begin, &end);
+
+		// Services throw their table away whenever a module binds or unbinds a command
+		if (! bench_clock(&begin))
+			return false;
+
+		if (dispatch != NULL)
+			(void) command_dispatch_destroy(dispatch);
+
+		dispatch = command_dispatch_create(bench_commandtree, bench_aliastree);
+
+		if (! bench_clock(&end))
+			return false;
+
+		build += bench_elapsed(&begin, &end);
+
+		if (! bench_clock(&begin))
+			return false;
+
+		for (unsigned int i = 0; i < bench_lookup_count; i++)
+			if (command_dispatch_find(dispatch, bench_names[i]) != NULL)
+				table_found++;
+
+		if (! bench_clock(&end))
+			return false;
+
+		table += bench_elapsed(&begin, &end);
+	}
+
+	// Both ways of looking a name up have to agree on every single one
+	for (unsigned int i = 0; i < bench_lookup_count; i++)
+	{
+		if (bench_lookup_patricia(bench_names[i]) != command_dispatch_find(dispatch, bench_names[i]))
+		{
+			(void) fprintf(stderr, "Lookups for '%s' disagree\n", bench_names[i]);
+			return false;
+		}
+	}
+
+	const size_t ops = (size_t) bench_rounds * bench_lookup_count;
+
+	(void) printf("%zu commands, %zu aliases, %u lookups, %u rounds, %zu found\n",
+	              BENCH_COMMANDS, BENCH_ALIASES, bench_lookup_count, bench_rounds, table_found);
+	(void) bench_report("patricia", ops, patricia);
+	(void) bench_report("dispatch", ops, table);
+	(void) bench_report("build", bench_rounds, build);
+
+	(void) command_dispatch_destroy(dispatch);
+	return (patricia_found == table_found);
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	(void) bench_trees_create();
+	(void) bench_names_create();
+
+	if (! bench_run())
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * Expiry queue tests.
+ *
+ * This runs expire_check() against a few records with a simulated clock,
+ * and checks that each of them is treated the way the old full sweep
+ * would have treated it.
+ */
+
+#include <atheme.h>
+
+#include "tests.h"
+
+#define TEST_EPOCH      ((time_t) 1000000000)
+
+static void
+test_run_expiry(const time_t when)
+{
+	CURRTIME = when;
+
+	(void) expire_check(NULL);
+}
+
+/* With channel expiry disabled, a channel that is idle when it is looked at
+ * must still have its last used time refreshed once it is in use again.
+ */
+static void
+test_chan_used_refresh_without_expiry(void)
+{
+	char idlename[] = "#idle";
+	char usedname[] = "#used";
+	struct channel chan;
+	struct chanuser cu;
+	struct user u;
+
+	chansvs.expiry = 0;
+	nicksvs.expiry = 0;
+
+	struct myuser *const mu = myuser_add("tester", "*", "tester@example.org", 0);
+	struct mychan *const idle = mychan_add(idlename);
+	struct mychan *const used = mychan_add(usedname);
+
+	(void) chanacs_add(idle, entity(mu), CA_FOUNDER, TEST_EPOCH, NULL);
+	(void) chanacs_add(used, entity(mu), CA_FOUNDER, TEST_EPOCH, NULL);
+
+	idle->used = TEST_EPOCH - (2 * SECONDS_PER_DAY);
+	used->used = TEST_EPOCH - (2 * SECONDS_PER_DAY);
+
+	// Nobody is in either channel the first time they are looked at
+	(void) test_run_expiry(TEST_EPOCH);
+
+	test_expect(mychan_find(idlename) == idle, "idle channel is kept with expiry disabled");
+	test_expect(idle->used == TEST_EPOCH - (2 * SECONDS_PER_DAY), "idle channel keeps its last used time");
+
+	// The founder then joins one of them and stays there
+	(void) memset(&chan, 0x00, sizeof chan);
+	(void) memset(&cu, 0x00, sizeof cu);
+	(void) memset(&u, 0x00, sizeof u);
+
+	u.nick = "tester";
+	u.user = "tester";
+	u.host = "example.org";
+	u.chost = "example.org";
+	u.vhost = "example.org";
+	u.ip = "192.0.2.1";
+	u.myuser = mu;
+
+	cu.chan = &chan;
+	cu.user = &u;
+
+	chan.name = usedname;
+	chan.mychan = used;
+
+	(void) mowgli_node_add(&cu, &cu.cnode, &chan.members);
+
+	used->chan = &chan;
+	used->used = TEST_EPOCH + SECONDS_PER_HOUR;
+
+	(void) test_run_expiry(TEST_EPOCH + SECONDS_PER_HOUR);
+
+	test_expect(used->used == TEST_EPOCH + SECONDS_PER_HOUR, "last used time is not touched before it is due");
+
+	(void) test_run_expiry(TEST_EPOCH + (3 * SECONDS_PER_DAY));
+
+	test_expect(used->used == TEST_EPOCH + (3 * SECONDS_PER_DAY), "channel in use has its last used time refreshed");
+
+	(void) test_run_expiry(TEST_EPOCH + (30 * SECONDS_PER_DAY));
+
+	test_expect(used->used == TEST_EPOCH + (30 * SECONDS_PER_DAY), "refresh keeps happening later on");
+	test_expect(mychan_find(idlename) == idle, "idle channel is still kept after a month");
+	test_expect(idle->used == TEST_EPOCH - (2 * SECONDS_PER_DAY), "idle channel still keeps its last used time");
+
+	(void) mowgli_node_delete(&cu.cnode, &chan.members);
+
+	used->chan = NULL;
+}
+
+void
+test_expiry(void)
+{
+	CURRTIME = TEST_EPOCH;
+
+	(void) test_chan_used_refresh_without_expiry();
+}
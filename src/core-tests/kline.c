@@ -0,0 +1,139 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * Bulk K-line tests.
+ *
+ * This adds klines with kline_add_bulk() against a fake uplink and checks
+ * what is sent to the ircd while the uplink's sendq is free and while it
+ * is busy.
+ */
+
+#include <atheme.h>
+
+#include "tests.h"
+
+#define TEST_KLINES     8U
+
+static unsigned int test_klines_sent = 0;
+static unsigned int test_unklines_sent = 0;
+static char test_last_host[HOSTLEN + 1];
+
+static void
+test_kline_sts(const char ATHEME_VATTR_UNUSED *const restrict server, const char ATHEME_VATTR_UNUSED *const restrict user,
+               const char *const restrict host, const long ATHEME_VATTR_UNUSED duration,
+               const char ATHEME_VATTR_UNUSED *const restrict reason)
+{
+	(void) mowgli_strlcpy(test_last_host, host, sizeof test_last_host);
+
+	test_klines_sent++;
+}
+
+static void
+test_unkline_sts(const char ATHEME_VATTR_UNUSED *const restrict server, const char ATHEME_VATTR_UNUSED *const restrict user,
+                 const char ATHEME_VATTR_UNUSED *const restrict host)
+{
+	test_unklines_sent++;
+}
+
+static void
+test_bulk(void)
+{
+	char hosts[TEST_KLINES][HOSTLEN + 1];
+	struct kline_bulk_entry entries[TEST_KLINES];
+	struct kline_bulk_entry extra = {
+		.user       = "*",
+		.host       = "extra.example.org",
+		.reason     = "test",
+		.setby      = "tester",
+		.duration   = SECONDS_PER_HOUR,
+	};
+	struct connection conn;
+	struct uplink up;
+
+	for (unsigned int i = 0; i < TEST_KLINES; i++)
+	{
+		(void) snprintf(hosts[i], sizeof hosts[i], "drone%u.example.org", i);
+
+		entries[i].user = "*";
+		entries[i].host = hosts[i];
+		entries[i].reason = "test";
+		entries[i].setby = "tester";
+		entries[i].duration = SECONDS_PER_HOUR;
+	}
+
+	(void) memset(&conn, 0x00, sizeof conn);
+	(void) memset(&up, 0x00, sizeof up);
+
+	up.conn = &conn;
+	curr_uplink = &up;
+
+	// While not linked, klines are only added
+	me.connected = false;
+
+	const unsigned long first = me.kline_id + 1U;
+
+	test_expect(kline_add_bulk(entries, TEST_KLINES) == TEST_KLINES, "all klines are added");
+	test_expect(cnt.kline == TEST_KLINES, "the kline count is updated");
+	test_expect(test_klines_sent == 0, "nothing is sent while not linked");
+
+	struct kline *const k = kline_find("someone", "drone3.example.org");
+
+	test_expect(k != NULL, "a bulk kline can be found");
+	test_expect(k != NULL && k->number == first + 3U, "bulk klines are numbered in order");
+	test_expect(k != NULL && strcmp(k->reason, "test") == 0 && strcmp(k->setby, "tester") == 0,
+	            "bulk klines keep their strings");
+
+	// Once linked and with room in the sendq, they go out straight away
+	me.connected = true;
+
+	test_expect(kline_add_bulk(entries, TEST_KLINES) == TEST_KLINES, "klines are added while linked");
+	test_expect(test_klines_sent == TEST_KLINES, "every kline is sent when the sendq has room");
+
+	// With the sendq more than half full, they wait
+	conn.sendq_limit = 1;
+	conn.sendq.count = 1;
+	test_klines_sent = 0;
+
+	(void) kline_add_bulk(entries, TEST_KLINES);
+
+	test_expect(test_klines_sent == 0, "nothing is sent while the sendq is busy");
+
+	struct kline *const pending = kline_find_num(me.kline_id - 1U);
+
+	test_expect(pending != NULL && pending->pending, "a kline waiting to be sent is marked pending");
+
+	kline_delete(pending);
+
+	test_expect(test_unklines_sent == 0, "deleting a kline that was never sent does not unkline it");
+
+	// When there is room again, what is left goes out in order, before anything newer
+	conn.sendq.count = 0;
+
+	(void) kline_add_bulk(&extra, 1);
+
+	test_expect(test_klines_sent == TEST_KLINES, "the klines that waited are sent, except the deleted one");
+	test_expect(strcmp(test_last_host, "extra.example.org") == 0, "klines are sent in the order they were added");
+
+	kline_delete(kline_find_num(me.kline_id));
+
+	test_expect(test_unklines_sent == 1, "deleting a kline that was sent unklines it");
+
+	me.connected = false;
+	curr_uplink = NULL;
+}
+
+void
+test_kline(void)
+{
+	kline_sts = &test_kline_sts;
+	unkline_sts = &test_unkline_sts;
+
+	(void) test_bulk();
+}
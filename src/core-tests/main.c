@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * libathemecore tests.
+ *
+ * These run parts of libathemecore against a simulated clock and fake
+ * uplink, without a configuration file or a database, and exit with a
+ * failure status if anything is not as expected.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+
+#include "tests.h"
+
+static unsigned int test_failures = 0;
+
+void
+test_expect(const bool cond, const char *const restrict what)
+{
+	(void) printf("%s: %s\n", cond ? "PASS" : "FAIL", what);
+
+	if (! cond)
+		test_failures++;
+}
+
+int
+main(int ATHEME_VATTR_UNUSED argc, char *argv[])
+{
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	(void) atheme_bootstrap();
+	(void) atheme_init(argv[0], "/dev/null");
+	(void) atheme_setup();
+
+	runflags = RF_LIVE;
+	offline_mode = true;
+
+	(void) test_expiry();
+	(void) test_kline();
+
+	if (test_failures)
+	{
+		(void) printf("%u test(s) failed\n", test_failures);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
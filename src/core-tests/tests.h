@@ -0,0 +1,22 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ */
+
+#ifndef ATHEME_SRC_CORE_TESTS_TESTS_H
+#define ATHEME_SRC_CORE_TESTS_TESTS_H 1
+
+#include <atheme/stdheaders.h>      // bool
+
+void test_expect(bool cond, const char *what);
+
+void test_expiry(void);
+void test_kline(void);
+
+#endif /* !ATHEME_SRC_CORE_TESTS_TESTS_H */
@@ -10,6 +10,116 @@
 #include <atheme.h>
 #include <atheme/libathemecore.h>
 
+/* Approximate sizes of mowgli's patricia structures on LP64, used to
+ * estimate what the same metadata took when each object had its own tree.
+ */
+#define PATRICIA_ROOT_SIZE      32U
+#define PATRICIA_LEAF_SIZE      40U
+#define PATRICIA_NODE_SIZE      152U
+#define OLD_METADATA_SIZE       (2U * sizeof(void *))
+
+// Keys given to every synthetic account, and how often their values repeat
+static const struct
+{
+	const char *    name;
+	unsigned int    distinct;       // 0 for a unique value per object
+} footprint_keys[] = {
+	{ "private:host:actual",        0 },
+	{ "private:host:vhost",         0 },
+	{ "private:doenforce",          1 },
+	{ "private:loginfail:failnum",  5 },
+	{ "private:setpass:key",        0 },
+	{ "private:usercloak-timestamp", 0 },
+	{ "private:freeze:freezer",     3 },
+	{ "private:mark:setter",        8 },
+};
+
+static void
+footprint_metadata(unsigned int objcount)
+{
+	struct atheme_object *objs = smalloc(objcount * sizeof *objs);
+	struct metadata_stats stats;
+	size_t before = 0, shared_bytes = 0;
+	char value[BUFSIZE];
+
+	strshare_init();
+	init_metadata();
+
+	for (unsigned int i = 0; i < objcount; i++)
+	{
+		const unsigned int nkeys = (rand() % (ARRAY_SIZE(footprint_keys))) + 1;
+
+		atheme_object_init(&objs[i], NULL, NULL);
+
+		for (unsigned int k = 0; k < nkeys; k++)
+		{
+			if (footprint_keys[k].distinct)
+				(void) snprintf(value, sizeof value, "%u", rand() % footprint_keys[k].distinct);
+			else
+				(void) snprintf(value, sizeof value, "user%u@host-%u.example.net", i, rand());
+
+			(void) metadata_add(&objs[i], footprint_keys[k].name, value);
+
+			before += OLD_METADATA_SIZE + strlen(value) + 1;
+			before += PATRICIA_LEAF_SIZE + strlen(footprint_keys[k].name) + 1;
+		}
+
+		before += PATRICIA_ROOT_SIZE + ((nkeys - 1) * PATRICIA_NODE_SIZE);
+	}
+
+	metadata_get_stats(&stats);
+
+	// Shared values are charged by their share of the string, since other users may hold it too
+	for (unsigned int i = 0; i < objcount; i++)
+	{
+		struct metadata_iteration_state state;
+		struct metadata *md;
+
+		METADATA_FOREACH(md, &state, &objs[i])
+		{
+			if (md->shared)
+				shared_bytes += strshare_share_bytes(md->value);
+		}
+	}
+
+	const size_t after = stats.table_bytes + stats.entry_bytes + stats.key_bytes + stats.private_value_bytes +
+	                     shared_bytes;
+
+	printf("metadata on %u objects: %zu entries, %zu distinct keys\n", objcount, stats.entries, stats.keys);
+	printf("per-object trees (estimated): %zu KB\n", before / 1024);
+	printf("interned tables (measured): %zu KB\n", after / 1024);
+	printf("  tables: %zu B, entries: %zu B, keys: %zu B, private values: %zu B\n",
+	       stats.table_bytes, stats.entry_bytes, stats.key_bytes, stats.private_value_bytes);
+	printf("  shared values: %zu B for %zu values (their share of each strshare string)\n",
+	       shared_bytes, stats.shared_values);
+
+	for (unsigned int i = 0; i < objcount; i++)
+		metadata_delete_all(&objs[i]);
+
+	sfree(objs);
+}
+
+static void
+footprint_slab_type(const struct slab_type_stats *stats, void ATHEME_VATTR_UNUSED *priv)
+{
+	printf("  %-26s size %4zu in %4zu: peak %8zu objects, %8zu KB\n", stats->name,
+	       stats->size, stats->class_size, stats->peak, stats->peak_bytes / 1024);
+}
+
+static void
+footprint_slabs(void)
+{
+	struct slab_stats stats;
+
+	slab_get_stats(&stats);
+
+	printf("slab allocator, by type (size 0 is variable):\n");
+	slab_foreach_type(footprint_slab_type, NULL);
+	printf("%zu slabs in %zu arenas (%zu spare): %zu KB reserved, %zu KB used, %zu KB outside slabs\n",
+	       stats.slabs, stats.arenas, stats.spare_slabs, stats.reserved_bytes / 1024,
+	       stats.used_bytes / 1024, stats.large_bytes / 1024);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -76,5 +186,13 @@ main(int argc, char *argv[])
 
 	printf("sizeof server_t: %zu B --> %zu KB\n", sizeof(struct server), (servercount * sizeof(struct server)) / 1024);
 
+	printf("\n* * *\n\n");
+
+	footprint_metadata(regusercount);
+
+	printf("\n* * *\n\n");
+
+	footprint_slabs();
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,319 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * Protocol command parsing microbenchmark.
+ *
+ * This replays a captured burst (one raw line from the uplink per line of
+ * the file) through the part of irc_parse() that doesn't depend on the
+ * state of the network: splitting off the origin and command, tokenizing
+ * the parameters, and looking the command up. Every distinct command in
+ * the file is registered, as a protocol module would have done. Each line
+ * is looked up both in a patricia tree, the way pcommand_find() used to,
+ * and with pcommand_find() itself.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+#include <ext/getopt_long.h>
+
+#define BENCH_ROUNDS_DEF        10U
+#define BENCH_ROUNDS_MAX        10000U
+
+struct bench_line
+{
+	char *                  origin;
+	char *                  command;
+	char *                  message;
+};
+
+static const char *bench_path = NULL;
+static unsigned int bench_rounds = BENCH_ROUNDS_DEF;
+
+static char **bench_lines = NULL;
+static size_t bench_line_count = 0;
+static mowgli_patricia_t *bench_tree = NULL;
+
+static const mowgli_getopt_option_t bench_long_opts[] = {
+
+	{   "help",       no_argument, NULL, 'h', 0 },
+	{   "file", required_argument, NULL, 'f', 0 },
+	{ "rounds", required_argument, NULL, 'r', 0 },
+
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const restrict progname)
+{
+	(void) fprintf(stderr, ""
+		"\n"
+		"Usage: %s [options] -f <file>\n"
+		"\n"
+		"  -h/--help                Display this help information and exit\n"
+		"  -f/--file PATH           Captured burst to replay, one raw line per line\n"
+		"  -r/--rounds N            Number of times to replay it (default: %u)\n"
+		"\n",
+		progname, BENCH_ROUNDS_DEF);
+}
+
+static bool
+process_uint_option(const int sw, const char *const restrict val, unsigned int *const restrict out,
+                    const unsigned int val_max)
+{
+	if (! string_to_uint(val, out) || ! *out || *out > val_max)
+	{
+		(void) fprintf(stderr, "'%s' is not a valid value for option '%c' (1 to %u)\n", val, sw, val_max);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = mowgli_getopt_long(argc, argv, "f:hr:", bench_long_opts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'f':
+				bench_path = mowgli_optarg;
+				break;
+
+			case 'r':
+				if (! process_uint_option(c, mowgli_optarg, &bench_rounds, BENCH_ROUNDS_MAX))
+					return false;
+				break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+	}
+
+	if (! bench_path)
+	{
+		(void) print_usage(argv[0]);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+bench_clock(struct timespec *const restrict ts)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, ts) != 0)
+	{
+		(void) perror("clock_gettime(2)");
+		return false;
+	}
+
+	return true;
+}
+
+static double
+bench_elapsed(const struct timespec *const restrict begin, const struct timespec *const restrict end)
+{
+	return ((double) (end->tv_sec - begin->tv_sec)) + (((double) (end->tv_nsec - begin->tv_nsec)) / 1e9);
+}
+
+static void
+bench_handler(struct sourceinfo ATHEME_VATTR_UNUSED *const restrict si, const int ATHEME_VATTR_UNUSED parc,
+              char ATHEME_VATTR_UNUSED *parv[])
+{
+	// Nothing to do, only the lookup is of interest
+}
+
+// Splits a line the same way irc_parse() does
+static bool
+bench_split(char *const restrict line, struct bench_line *const restrict out)
+{
+	char *pos;
+
+	out->origin = NULL;
+	out->command = line;
+	out->message = NULL;
+
+	if (! (pos = strchr(line, ' ')))
+		return (*line != '\0');
+
+	*pos++ = '\0';
+
+	if (*line == ':')
+	{
+		out->origin = line + 1;
+		out->command = pos;
+
+		if ((out->message = strchr(pos, ' ')))
+			*out->message++ = '\0';
+	}
+	else
+		out->message = pos;
+
+	return (*out->command != '\0');
+}
+
+static bool
+bench_lines_load(void)
+{
+	char buf[BUFSIZE];
+	size_t alloc = 1024U;
+	FILE *fp;
+
+	if (! (fp = fopen(bench_path, "r")))
+	{
+		(void) fprintf(stderr, "Cannot open '%s': %s\n", bench_path, strerror(errno));
+		return false;
+	}
+
+	bench_lines = smalloc(alloc * sizeof *bench_lines);
+	bench_tree = mowgli_patricia_create(noopcanon);
+
+	while (fgets(buf, sizeof buf, fp) != NULL)
+	{
+		struct bench_line split;
+		char copy[BUFSIZE];
+
+		buf[strcspn(buf, "\r\n")] = '\0';
+
+		if (! *buf)
+			continue;
+
+		(void) mowgli_strlcpy(copy, buf, sizeof copy);
+
+		if (! bench_split(copy, &split))
+			continue;
+
+		if (! mowgli_patricia_retrieve(bench_tree, split.command))
+		{
+			(void) pcommand_add(split.command, &bench_handler, 0, MSRC_UNREG | MSRC_USER | MSRC_SERVER);
+			(void) mowgli_patricia_add(bench_tree, split.command,
+			                           mowgli_patricia_retrieve(pcommands, split.command));
+		}
+
+		if (bench_line_count == alloc)
+		{
+			alloc *= 2U;
+			bench_lines = srealloc(bench_lines, alloc * sizeof *bench_lines);
+		}
+
+		bench_lines[bench_line_count++] = sstrdup(buf);
+	}
+
+	(void) fclose(fp);
+
+	if (! bench_line_count)
+	{
+		(void) fprintf(stderr, "'%s' has no lines to replay\n", bench_path);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+bench_replay(const bool table, double *const restrict secs)
+{
+	char *parv[MAXPARC + 1];
+	struct timespec begin, end;
+	char line[BUFSIZE];
+
+	if (! bench_clock(&begin))
+		return false;
+
+	for (size_t i = 0; i < bench_line_count; i++)
+	{
+		const struct proto_cmd *pcmd;
+		struct bench_line split;
+
+		(void) mowgli_strlcpy(line, bench_lines[i], sizeof line);
+		(void) bench_split(line, &split);
+
+		if (table)
+			pcmd = pcommand_find(split.command);
+		else
+			pcmd = mowgli_patricia_retrieve(bench_tree, split.command);
+
+		if (pcmd == NULL)
+		{
+			(void) fprintf(stderr, "Command '%s' was not found\n", split.command);
+			return false;
+		}
+
+		if (split.message && *split.message == ':')
+			parv[0] = split.message + 1;
+		else if (split.message)
+			(void) tokenize(split.message, parv);
+	}
+
+	if (! bench_clock(&end))
+		return false;
+
+	*secs += bench_elapsed(&begin, &end);
+	return true;
+}
+
+static void
+bench_report(const char *const restrict what, const size_t ops, const double secs)
+{
+	(void) printf("  %-10s %10zu lines in %8.3f s: %12.0f lines/s, %7.1f ns/line\n",
+	              what, ops, secs, ops / secs, (secs * 1e9) / ops);
+}
+
+static bool
+bench_run(void)
+{
+	double patricia = 0, table = 0;
+
+	for (unsigned int r = 0; r < bench_rounds; r++)
+	{
+		if (! bench_replay(false, &patricia))
+			return false;
+
+		if (! bench_replay(true, &table))
+			return false;
+	}
+
+	const size_t ops = (size_t) bench_rounds * bench_line_count;
+
+	(void) printf("%zu lines, %u commands, %u rounds\n", bench_line_count,
+	              mowgli_patricia_size(bench_tree), bench_rounds);
+	(void) bench_report("patricia", ops, patricia);
+	(void) bench_report("table", ops, table);
+
+	return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	(void) pcommand_init();
+
+	if (! bench_lines_load())
+		return EXIT_FAILURE;
+
+	if (! bench_run())
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
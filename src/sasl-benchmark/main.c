@@ -0,0 +1,1037 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * SASL load generator and latency benchmark.
+ *
+ * This boots the services core offline from a normal configuration file,
+ * generates an account database, and feeds SaslServ the same sasl_input
+ * messages a protocol module would. Whatever SaslServ sends back to the
+ * uplink is captured and answered by a small client for each mechanism.
+ * Only the time spent inside SaslServ is measured; the client side is not.
+ */
+
+#include <atheme.h>
+
+#ifndef MINIMUM
+#  define MINIMUM(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#include <atheme/libathemecore.h>
+#include <ext/getopt_long.h>
+
+#include "ecdh-x25519-challenge.h"
+
+#ifdef HAVE_LIBCRYPTO_ECDSA
+#  include <openssl/ec.h>
+#  include <openssl/evp.h>
+#endif
+
+#define BENCH_ACCOUNTS_DEF          100U
+#define BENCH_ACCOUNTS_MAX          1000000U
+#define BENCH_ROUNDS_DEF            500U
+#define BENCH_ROUNDS_MAX            10000000U
+
+// Completed sessions wait for their user to be introduced; clear them out this often
+#define BENCH_FLUSH_INTERVAL        256U
+
+#define BENCH_SERVER_NAME           "sasl-benchmark.invalid"
+#define BENCH_CLIENT_IP             "192.0.2.1"
+#define BENCH_PASSWORD_LEN          24U
+#define BENCH_CERTFP_RAWLEN         32U
+#define BENCH_SCRAM_NONCE_LEN       24U
+
+#define BENCH_ARRAY_SIZE(x)         ((sizeof((x))) / (sizeof((x)[0])))
+
+struct bench_account
+{
+	struct myuser *                 mu;
+	char                            password[BENCH_PASSWORD_LEN + 1];
+	char                            certfp[(2U * BENCH_CERTFP_RAWLEN) + 1];
+#ifdef HAVE_LIBCRYPTO_ECDSA
+	EVP_PKEY *                      ecdsa_key;
+#endif
+	unsigned char                   x25519_seckey[ATHEME_ECDH_X25519_XKEY_LEN];
+	unsigned char                   x25519_pubkey[ATHEME_ECDH_X25519_XKEY_LEN];
+};
+
+struct bench_client;
+
+typedef bool (*bench_step_fn)(struct bench_client *, const unsigned char *, size_t, unsigned char *, size_t *);
+
+struct bench_mech
+{
+	const char *                    name;
+	const char *                    module;
+	bench_step_fn                   step;
+	enum digest_algorithm           digest;     // SCRAM only
+	bool                            external;
+};
+
+struct bench_client
+{
+	const struct bench_account *    acct;
+	const struct bench_mech *       mech;
+	unsigned int                    step;
+
+	// SCRAM only
+	unsigned char                   salted[DIGEST_MDLEN_MAX];
+	size_t                          mdlen;
+	char                            nonce[BENCH_SCRAM_NONCE_LEN + 1];
+	char                            authmsg[(2U * SASL_S2S_MAXLEN_TOTAL_RAW) + 1];
+	size_t                          authmsglen;
+};
+
+struct bench_reply
+{
+	char                            mode;
+	bool                            complete;
+	bool                            mechlist;   // SaslServ did not recognise the mechanism
+	size_t                          len;
+	char                            data[SASL_S2S_MAXLEN_TOTAL_B64 + 1];
+};
+
+struct bench_result
+{
+	unsigned int                    ok;
+	unsigned int                    failed;
+	bool                            unsupported;
+	long double                     elapsed;
+	long double *                   samples;
+};
+
+enum bench_auth_result
+{
+	BENCH_AUTH_OK           = 0,
+	BENCH_AUTH_FAILED       = 1,
+	BENCH_AUTH_UNSUPPORTED  = 2,
+};
+
+static const char *bench_config_file = SYSCONFDIR "/atheme.conf";
+static unsigned int bench_account_count = BENCH_ACCOUNTS_DEF;
+static unsigned int bench_rounds = BENCH_ROUNDS_DEF;
+
+static char **bench_providers = NULL;
+static size_t bench_providers_count = 0;
+static char **bench_mech_names = NULL;
+static size_t bench_mech_names_count = 0;
+
+static struct bench_account *bench_accounts = NULL;
+static const struct ecdh_x25519_functions *bench_x25519 = NULL;
+static struct bench_reply bench_reply;
+static long double bench_elapsed = 0;
+static unsigned int bench_uid_seq = 0;
+
+static struct server bench_server = {
+	.name = BENCH_SERVER_NAME,
+	.desc = "SASL benchmark",
+};
+
+static const mowgli_getopt_option_t bench_long_opts[] = {
+
+	{       "help",       no_argument, NULL, 'h', 0 },
+	{     "config", required_argument, NULL, 'c', 0 },
+	{   "accounts", required_argument, NULL, 'n', 0 },
+	{     "rounds", required_argument, NULL, 'r', 0 },
+	{  "providers", required_argument, NULL, 'p', 0 },
+	{ "mechanisms", required_argument, NULL, 'm', 0 },
+
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const restrict progname)
+{
+	(void) fprintf(stderr, ""
+		"\n"
+		"Usage: %s [options]\n"
+		"\n"
+		"  -h/--help                Display this help information and exit\n"
+		"  -c/--config FILE         Configuration file to boot from (default: %s)\n"
+		"  -n/--accounts N          Number of accounts to generate (default: %u)\n"
+		"  -r/--rounds N            Authentications per mechanism (default: %u)\n"
+		"  -p/--providers LIST      Comma-separated password crypto providers to hash the\n"
+		"                             generated accounts with, one run each, for example\n"
+		"                             'crypto/pbkdf2v2,crypto/argon2' (default: the\n"
+		"                             configuration's default provider)\n"
+		"  -m/--mechanisms LIST     Comma-separated SASL mechanisms to run (default: all)\n"
+		"\n"
+		"  The configuration file must load a protocol module and define an uplink, as\n"
+		"  for atheme-services, but nothing is connected to and no database is loaded.\n"
+		"  Provider tuning (digest, rounds, memory cost, ...) comes from its crypto {}\n"
+		"  block, so compare tunings of one provider by running with different files.\n"
+		"\n",
+		progname, SYSCONFDIR "/atheme.conf", BENCH_ACCOUNTS_DEF, BENCH_ROUNDS_DEF);
+}
+
+static bool
+process_list_option(const char *const restrict val, char ***const restrict arr, size_t *const restrict arr_len)
+{
+	char *const dup = sstrdup(val);
+	char *opt = dup;
+	char *tok;
+
+	while ((tok = strsep(&opt, ",")) != NULL)
+	{
+		if (! *tok)
+			continue;
+
+		*arr = sreallocarray(*arr, (*arr_len) + 1, sizeof **arr);
+		(*arr)[(*arr_len)++] = sstrdup(tok);
+	}
+
+	(void) sfree(dup);
+	return (*arr_len != 0);
+}
+
+static bool
+process_uint_option(const int sw, const char *const restrict val, unsigned int *const restrict out,
+                    const unsigned int val_max)
+{
+	if (! string_to_uint(val, out) || ! *out || *out > val_max)
+	{
+		(void) fprintf(stderr, "'%s' is not a valid value for option '%c' (1 to %u)\n", val, sw, val_max);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = mowgli_getopt_long(argc, argv, "c:hm:n:p:r:", bench_long_opts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'c':
+				bench_config_file = mowgli_optarg;
+				break;
+
+			case 'n':
+				if (! process_uint_option(c, mowgli_optarg, &bench_account_count, BENCH_ACCOUNTS_MAX))
+					return false;
+				break;
+
+			case 'r':
+				if (! process_uint_option(c, mowgli_optarg, &bench_rounds, BENCH_ROUNDS_MAX))
+					return false;
+				break;
+
+			case 'p':
+				if (! process_list_option(mowgli_optarg, &bench_providers, &bench_providers_count))
+					return false;
+				break;
+
+			case 'm':
+				if (! process_list_option(mowgli_optarg, &bench_mech_names, &bench_mech_names_count))
+					return false;
+				break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+bench_sasl_sts(const char ATHEME_VATTR_UNUSED *const restrict target, const char mode,
+               const char *const restrict data)
+{
+	if (mode == 'M')
+	{
+		bench_reply.mechlist = true;
+		return;
+	}
+
+	if (mode != 'C')
+	{
+		bench_reply.mode = mode;
+		bench_reply.complete = true;
+		bench_reply.len = mowgli_strlcpy(bench_reply.data, data, sizeof bench_reply.data);
+		return;
+	}
+
+	if (bench_reply.mode != 'C' || bench_reply.complete)
+	{
+		bench_reply.mode = 'C';
+		bench_reply.complete = false;
+		bench_reply.len = 0;
+		bench_reply.data[0] = 0x00;
+	}
+
+	// A lone '+' is either empty data or the end of data that was a multiple of 400 characters
+	if (strcmp(data, "+") == 0)
+	{
+		bench_reply.complete = true;
+		return;
+	}
+
+	const size_t len = strlen(data);
+	const size_t copy = MINIMUM(len, (sizeof bench_reply.data) - 1U - bench_reply.len);
+
+	(void) memcpy(bench_reply.data + bench_reply.len, data, copy);
+	bench_reply.len += copy;
+	bench_reply.data[bench_reply.len] = 0x00;
+
+	if (len < SASL_S2S_MAXLEN_ATONCE_B64)
+		bench_reply.complete = true;
+}
+
+static void
+bench_svslogin_sts(const char ATHEME_VATTR_UNUSED *const restrict target,
+                   const char ATHEME_VATTR_UNUSED *const restrict nick,
+                   const char ATHEME_VATTR_UNUSED *const restrict user,
+                   const char ATHEME_VATTR_UNUSED *const restrict host,
+                   struct myuser ATHEME_VATTR_UNUSED *const restrict account)
+{
+	// Nothing to tell; the benchmark has no uplink
+}
+
+static void
+bench_sasl_mechlist_sts(const char ATHEME_VATTR_UNUSED *const restrict mechlist)
+{
+	// Nothing to tell; the benchmark has no uplink
+}
+
+static bool
+bench_clock(struct timespec *const restrict ts)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, ts) != 0)
+	{
+		(void) perror("clock_gettime(2)");
+		return false;
+	}
+
+	return true;
+}
+
+/* Hands one message to SaslServ exactly as a protocol module would, and adds
+ * the time it took to the running total for the current authentication.
+ */
+static bool
+bench_send(char *const restrict uid, const char mode, const char *const restrict arg0,
+           const char *const restrict arg1)
+{
+	struct sasl_message smsg = {
+		.server = &bench_server,
+		.uid    = uid,
+		.mode   = mode,
+	};
+	struct timespec begin;
+	struct timespec end;
+
+	smsg.parv[smsg.parc++] = (char *) arg0;
+
+	if (arg1)
+		smsg.parv[smsg.parc++] = (char *) arg1;
+
+	(void) memset(&bench_reply, 0x00, sizeof bench_reply);
+
+	if (! bench_clock(&begin))
+		return false;
+
+	(void) hook_call_sasl_input(&smsg);
+
+	if (! bench_clock(&end))
+		return false;
+
+	bench_elapsed += ((long double) (end.tv_sec - begin.tv_sec)) +
+	                 (((long double) (end.tv_nsec - begin.tv_nsec)) / 1000000000.0L);
+
+	return true;
+}
+
+static bool
+bench_send_data(char *const restrict uid, const unsigned char *const restrict buf, const size_t len)
+{
+	char enc[SASL_S2S_MAXLEN_TOTAL_B64 + 1];
+
+	if (! len)
+		return bench_send(uid, 'C', "+", NULL);
+
+	const size_t enclen = base64_encode(buf, len, enc, sizeof enc);
+
+	if (enclen == BASE64_FAIL)
+		return false;
+
+	for (size_t pos = 0; pos < enclen; pos += SASL_S2S_MAXLEN_ATONCE_B64)
+	{
+		char part[SASL_S2S_MAXLEN_ATONCE_B64 + 1];
+		const size_t partlen = MINIMUM(SASL_S2S_MAXLEN_ATONCE_B64, enclen - pos);
+
+		(void) memcpy(part, enc + pos, partlen);
+		part[partlen] = 0x00;
+
+		if (! bench_send(uid, 'C', part, NULL))
+			return false;
+	}
+
+	if ((enclen % SASL_S2S_MAXLEN_ATONCE_B64) == 0)
+		return bench_send(uid, 'C', "+", NULL);
+
+	return true;
+}
+
+static bool
+bench_put(unsigned char *const restrict out, size_t *const restrict outlen, const void *const restrict data,
+          const size_t len)
+{
+	if ((*outlen + len) > SASL_S2S_MAXLEN_TOTAL_RAW)
+		return false;
+
+	(void) memcpy(out + *outlen, data, len);
+	*outlen += len;
+	return true;
+}
+
+static bool
+bench_step_plain(struct bench_client *const restrict c, const unsigned char ATHEME_VATTR_UNUSED *const restrict in,
+                 const size_t inlen, unsigned char *const restrict out, size_t *const restrict outlen)
+{
+	const char *const name = entity(c->acct->mu)->name;
+	const unsigned char nul = 0x00;
+
+	if (c->step++ || inlen)
+		return false;
+
+	// [authzid] 0x00 authcid 0x00 password
+	return bench_put(out, outlen, &nul, 1U) && bench_put(out, outlen, name, strlen(name)) &&
+	       bench_put(out, outlen, &nul, 1U) &&
+	       bench_put(out, outlen, c->acct->password, strlen(c->acct->password));
+}
+
+static bool
+bench_step_external(struct bench_client *const restrict c,
+                    const unsigned char ATHEME_VATTR_UNUSED *const restrict in, const size_t inlen,
+                    unsigned char ATHEME_VATTR_UNUSED *const restrict out,
+                    size_t ATHEME_VATTR_UNUSED *const restrict outlen)
+{
+	// The fingerprint went out with the start message; reply with an empty authzid
+	return (c->step++ == 0 && ! inlen);
+}
+
+static const char *
+bench_scram_attr(const char *const restrict msg, const char name, size_t *const restrict len)
+{
+	for (const char *ptr = msg; ptr && *ptr; /* No action */)
+	{
+		const char *const end = strchr(ptr, ',');
+
+		if (ptr[0] == name && ptr[1] == '=')
+		{
+			*len = (end ? (size_t) (end - ptr) : strlen(ptr)) - 2U;
+			return ptr + 2;
+		}
+
+		ptr = (end ? (end + 1) : NULL);
+	}
+
+	return NULL;
+}
+
+static bool
+bench_scram_client_first(struct bench_client *const restrict c, unsigned char *const restrict out,
+                         size_t *const restrict outlen)
+{
+	(void) atheme_random_str(c->nonce, BENCH_SCRAM_NONCE_LEN);
+
+	// client-first-message-bare is the first part of the AuthMessage
+	const int ret = snprintf(c->authmsg, sizeof c->authmsg, "n=%s,r=%s", entity(c->acct->mu)->name, c->nonce);
+
+	if (ret <= 0 || (size_t) ret >= sizeof c->authmsg)
+		return false;
+
+	c->authmsglen = (size_t) ret;
+
+	return bench_put(out, outlen, "n,,", 3U) && bench_put(out, outlen, c->authmsg, c->authmsglen);
+}
+
+static bool
+bench_scram_client_final(struct bench_client *const restrict c, const char *const restrict in,
+                         unsigned char *const restrict out, size_t *const restrict outlen)
+{
+	unsigned char salt[PBKDF2_SALTLEN_MAX];
+	unsigned char ckey[DIGEST_MDLEN_MAX];
+	unsigned char skey[DIGEST_MDLEN_MAX];
+	unsigned char csig[DIGEST_MDLEN_MAX];
+	char salt64[BASE64_SIZE_STR(PBKDF2_SALTLEN_MAX)];
+	char iters[16];
+	char final[SASL_S2S_MAXLEN_TOTAL_RAW];
+	char proof64[BASE64_SIZE_STR(DIGEST_MDLEN_MAX)];
+	unsigned int itercount;
+	size_t nlen, slen, ilen;
+
+	const char *const nonce = bench_scram_attr(in, 'r', &nlen);
+	const char *const salt_b64 = bench_scram_attr(in, 's', &slen);
+	const char *const iter = bench_scram_attr(in, 'i', &ilen);
+
+	if (! nonce || ! salt_b64 || ! iter || slen >= sizeof salt64 || ilen >= sizeof iters)
+		return false;
+
+	// The server must extend our nonce, not replace it
+	if (nlen <= BENCH_SCRAM_NONCE_LEN || strncmp(nonce, c->nonce, BENCH_SCRAM_NONCE_LEN) != 0)
+		return false;
+
+	(void) mowgli_strlcpy(salt64, salt_b64, slen + 1U);
+	(void) mowgli_strlcpy(iters, iter, ilen + 1U);
+
+	const size_t saltlen = base64_decode(salt64, salt, sizeof salt);
+
+	if (saltlen == BASE64_FAIL || ! string_to_uint(iters, &itercount))
+		return false;
+
+	c->mdlen = digest_size_alg(c->mech->digest);
+
+	const char *const pass = c->acct->password;
+
+	if (! digest_oneshot_pbkdf2(c->mech->digest, pass, strlen(pass), salt, saltlen, itercount, c->salted, c->mdlen))
+		return false;
+
+	const int flen = snprintf(final, sizeof final, "c=biws,r=%.*s", (int) nlen, nonce);
+
+	if (flen <= 0 || (size_t) flen >= sizeof final)
+		return false;
+
+	// AuthMessage = client-first-message-bare "," server-first-message "," client-final-message-without-proof
+	const int alen = snprintf(c->authmsg + c->authmsglen, (sizeof c->authmsg) - c->authmsglen, ",%s,%s",
+	                          in, final);
+
+	if (alen <= 0 || (size_t) alen >= ((sizeof c->authmsg) - c->authmsglen))
+		return false;
+
+	c->authmsglen += (size_t) alen;
+
+	if (! digest_oneshot_hmac(c->mech->digest, c->salted, c->mdlen, "Client Key", 10U, ckey, NULL))
+		return false;
+	if (! digest_oneshot(c->mech->digest, ckey, c->mdlen, skey, NULL))
+		return false;
+	if (! digest_oneshot_hmac(c->mech->digest, skey, c->mdlen, c->authmsg, c->authmsglen, csig, NULL))
+		return false;
+
+	for (size_t i = 0; i < c->mdlen; i++)
+		ckey[i] ^= csig[i];
+
+	if (base64_encode(ckey, c->mdlen, proof64, sizeof proof64) == BASE64_FAIL)
+		return false;
+
+	return bench_put(out, outlen, final, (size_t) flen) && bench_put(out, outlen, ",p=", 3U) &&
+	       bench_put(out, outlen, proof64, strlen(proof64));
+}
+
+static bool
+bench_scram_verify_server(struct bench_client *const restrict c, const char *const restrict in)
+{
+	unsigned char skey[DIGEST_MDLEN_MAX];
+	unsigned char ssig[DIGEST_MDLEN_MAX];
+	char ssig64[BASE64_SIZE_STR(DIGEST_MDLEN_MAX)];
+	size_t vlen;
+
+	const char *const verifier = bench_scram_attr(in, 'v', &vlen);
+
+	if (! verifier)
+		return false;
+	if (! digest_oneshot_hmac(c->mech->digest, c->salted, c->mdlen, "Server Key", 10U, skey, NULL))
+		return false;
+	if (! digest_oneshot_hmac(c->mech->digest, skey, c->mdlen, c->authmsg, c->authmsglen, ssig, NULL))
+		return false;
+
+	const size_t len = base64_encode(ssig, c->mdlen, ssig64, sizeof ssig64);
+
+	return (len != BASE64_FAIL && len == vlen && memcmp(ssig64, verifier, vlen) == 0);
+}
+
+static bool
+bench_step_scram(struct bench_client *const restrict c, const unsigned char *const restrict in, const size_t inlen,
+                 unsigned char *const restrict out, size_t *const restrict outlen)
+{
+	switch (c->step++)
+	{
+		case 0:
+			return (! inlen && bench_scram_client_first(c, out, outlen));
+
+		case 1:
+			return (inlen && bench_scram_client_final(c, (const char *) in, out, outlen));
+
+		case 2:
+			// Reply to the server's signature with an empty message
+			return (inlen && bench_scram_verify_server(c, (const char *) in));
+	}
+
+	return false;
+}
+
+#ifdef HAVE_LIBCRYPTO_ECDSA
+
+static bool
+bench_step_ecdsa(struct bench_client *const restrict c, const unsigned char *const restrict in, const size_t inlen,
+                 unsigned char *const restrict out, size_t *const restrict outlen)
+{
+	const char *const name = entity(c->acct->mu)->name;
+
+	switch (c->step++)
+	{
+		case 0:
+			return (! inlen && bench_put(out, outlen, name, strlen(name)));
+
+		case 1:
+		{
+			// Without a message digest set, this signs the challenge as it is, like ECDSA_sign()
+			EVP_PKEY_CTX *const ctx = EVP_PKEY_CTX_new(c->acct->ecdsa_key, NULL);
+			size_t siglen = SASL_S2S_MAXLEN_TOTAL_RAW;
+			bool ret = false;
+
+			if (! ctx)
+				return false;
+
+			if (inlen && EVP_PKEY_sign_init(ctx) > 0 && EVP_PKEY_sign(ctx, out, &siglen, in, inlen) > 0)
+			{
+				*outlen = siglen;
+				ret = true;
+			}
+
+			(void) EVP_PKEY_CTX_free(ctx);
+			return ret;
+		}
+	}
+
+	return false;
+}
+
+#endif /* HAVE_LIBCRYPTO_ECDSA */
+
+static bool
+bench_step_ecdh_x25519(struct bench_client *const restrict c, const unsigned char *const restrict in,
+                       const size_t inlen, unsigned char *const restrict out, size_t *const restrict outlen)
+{
+	const char *const name = entity(c->acct->mu)->name;
+
+	switch (c->step++)
+	{
+		case 0:
+			return (bench_x25519 && ! inlen && bench_put(out, outlen, name, strlen(name)));
+
+		case 1:
+		{
+			union ecdh_x25519_server_response resp;
+			unsigned char shared_secret[ATHEME_ECDH_X25519_XKEY_LEN];
+			unsigned char better_secret[ATHEME_ECDH_X25519_CHAL_LEN];
+
+			if (inlen != sizeof resp.octets)
+				return false;
+
+			(void) memcpy(resp.octets, in, sizeof resp.octets);
+
+			if (! bench_x25519->compute_shared(c->acct->x25519_seckey, resp.field.pubkey, shared_secret))
+				return false;
+			if (! bench_x25519->kdf(shared_secret, c->acct->x25519_pubkey, resp.field.pubkey,
+			                        resp.field.salt, better_secret))
+				return false;
+
+			for (size_t x = 0; x < sizeof better_secret; x++)
+				out[x] = resp.field.challenge[x] ^ better_secret[x];
+
+			*outlen = sizeof better_secret;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static const struct bench_mech bench_mechs[] = {
+
+	{ "PLAIN",                      "saslserv/plain",                   &bench_step_plain,  0,               false },
+	{ "SCRAM-SHA-256",              "saslserv/scram",                   &bench_step_scram,  DIGALG_SHA2_256, false },
+	{ "SCRAM-SHA-512",              "saslserv/scram",                   &bench_step_scram,  DIGALG_SHA2_512, false },
+#ifdef HAVE_LIBCRYPTO_ECDSA
+	{ "ECDSA-NIST256P-CHALLENGE",   "saslserv/ecdsa-nist256p-challenge", &bench_step_ecdsa, 0,               false },
+#endif
+	{ "ECDH-X25519-CHALLENGE",      "saslserv/ecdh-x25519-challenge",   &bench_step_ecdh_x25519, 0,          false },
+	{ "EXTERNAL",                   "saslserv/external",                &bench_step_external, 0,             true  },
+};
+
+static enum bench_auth_result
+bench_authenticate(const struct bench_mech *const restrict mech, const struct bench_account *const restrict acct)
+{
+	struct bench_client c = {
+		.acct   = acct,
+		.mech   = mech,
+	};
+	char uid[UIDLEN + 1];
+
+	(void) snprintf(uid, sizeof uid, "0SB%06X", (bench_uid_seq++ & 0xFFFFFFU));
+
+	bench_elapsed = 0;
+
+	if (! bench_send(uid, 'H', BENCH_SERVER_NAME, BENCH_CLIENT_IP))
+		return BENCH_AUTH_FAILED;
+	if (! bench_send(uid, 'S', mech->name, (mech->external ? acct->certfp : NULL)))
+		return BENCH_AUTH_FAILED;
+
+	if (bench_reply.mechlist)
+		return BENCH_AUTH_UNSUPPORTED;
+
+	while (bench_reply.mode == 'C' && bench_reply.complete)
+	{
+		unsigned char in[SASL_S2S_MAXLEN_TOTAL_RAW + 1];
+		unsigned char out[SASL_S2S_MAXLEN_TOTAL_RAW];
+		size_t inlen = 0;
+		size_t outlen = 0;
+
+		if (bench_reply.len && (inlen = base64_decode(bench_reply.data, in, sizeof in - 1U)) == BASE64_FAIL)
+			return BENCH_AUTH_FAILED;
+
+		in[inlen] = 0x00;
+
+		if (! mech->step(&c, in, inlen, out, &outlen))
+		{
+			(void) bench_send(uid, 'D', "A", NULL);
+			return BENCH_AUTH_FAILED;
+		}
+
+		if (! bench_send_data(uid, out, outlen))
+			return BENCH_AUTH_FAILED;
+	}
+
+	if (bench_reply.mode == 'D' && strcmp(bench_reply.data, "S") == 0)
+		return BENCH_AUTH_OK;
+
+	return BENCH_AUTH_FAILED;
+}
+
+static void
+bench_flush_sessions(void)
+{
+	struct hook_server_delete hdata = {
+		.s = &bench_server,
+	};
+
+	(void) hook_call_server_delete(&hdata);
+}
+
+static int
+bench_sample_compare(const void *const a, const void *const b)
+{
+	const long double x = *((const long double *) a);
+	const long double y = *((const long double *) b);
+
+	return (x > y) - (x < y);
+}
+
+static long double
+bench_percentile(const struct bench_result *const restrict res, const unsigned int pct)
+{
+	// Nearest-rank percentile
+	size_t rank = (((size_t) res->ok * pct) + 99U) / 100U;
+
+	if (rank)
+		rank--;
+
+	return res->samples[rank];
+}
+
+static void
+bench_run_mech(const struct bench_mech *const restrict mech, struct bench_result *const restrict res)
+{
+	(void) memset(res, 0x00, sizeof *res);
+
+	res->samples = scalloc(bench_rounds, sizeof *res->samples);
+
+	if (! module_request(mech->module))
+	{
+		res->unsupported = true;
+		return;
+	}
+
+	for (unsigned int i = 0; i < bench_rounds; i++)
+	{
+		const enum bench_auth_result ret = bench_authenticate(mech, &bench_accounts[i % bench_account_count]);
+
+		if (ret == BENCH_AUTH_UNSUPPORTED)
+		{
+			res->unsupported = true;
+			break;
+		}
+		else if (ret == BENCH_AUTH_OK)
+		{
+			res->samples[res->ok++] = bench_elapsed;
+			res->elapsed += bench_elapsed;
+		}
+		else
+			res->failed++;
+
+		if (((i + 1U) % BENCH_FLUSH_INTERVAL) == 0)
+			(void) bench_flush_sessions();
+	}
+
+	(void) bench_flush_sessions();
+
+	if (res->ok)
+		(void) qsort(res->samples, res->ok, sizeof *res->samples, &bench_sample_compare);
+}
+
+static void
+bench_print_result(const struct bench_mech *const restrict mech, const struct bench_result *const restrict res)
+{
+	if (res->unsupported)
+	{
+		(void) printf("%-26s (not offered by SaslServ with this configuration)\n", mech->name);
+		return;
+	}
+
+	if (! res->ok)
+	{
+		(void) printf("%-26s %8u %8u %10s %10s %10s\n", mech->name, res->ok, res->failed, "-", "-", "-");
+		return;
+	}
+
+	(void) printf("%-26s %8u %8u %10.2Lf %10.3Lf %10.3Lf\n", mech->name, res->ok, res->failed,
+	              ((long double) res->ok) / res->elapsed, bench_percentile(res, 50U) * 1000.0L,
+	              bench_percentile(res, 99U) * 1000.0L);
+}
+
+static bool
+bench_mech_selected(const struct bench_mech *const restrict mech)
+{
+	if (! bench_mech_names_count)
+		return true;
+
+	for (size_t i = 0; i < bench_mech_names_count; i++)
+		if (strcasecmp(bench_mech_names[i], mech->name) == 0)
+			return true;
+
+	return false;
+}
+
+static bool
+bench_accounts_create(void)
+{
+	bench_accounts = scalloc(bench_account_count, sizeof *bench_accounts);
+
+	for (unsigned int i = 0; i < bench_account_count; i++)
+	{
+		struct bench_account *const acct = &bench_accounts[i];
+		unsigned char certfp[BENCH_CERTFP_RAWLEN];
+		char name[NICKLEN + 1];
+		char email[EMAILLEN + 1];
+
+		(void) snprintf(name, sizeof name, "sbench%u", i);
+		(void) snprintf(email, sizeof email, "sbench%u@" BENCH_SERVER_NAME, i);
+
+		if (myuser_find(name))
+		{
+			(void) fprintf(stderr, "Account '%s' already exists\n", name);
+			return false;
+		}
+
+		// The password hash is filled in per provider by bench_accounts_rehash()
+		acct->mu = myuser_add(name, "*", email, MU_CRYPTPASS);
+
+		(void) atheme_random_str(acct->password, BENCH_PASSWORD_LEN);
+
+		(void) atheme_random_buf(certfp, sizeof certfp);
+
+		for (size_t x = 0; x < sizeof certfp; x++)
+			(void) snprintf(acct->certfp + (2U * x), 3U, "%02x", certfp[x]);
+
+		(void) mycertfp_add(acct->mu, acct->certfp);
+
+#ifdef HAVE_LIBCRYPTO_ECDSA
+		{
+			EVP_PKEY_CTX *const ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+			unsigned char pubkey[BUFSIZE];
+			unsigned char *pubkey_p = pubkey;
+			char pubkey64[BASE64_SIZE_STR(BUFSIZE)];
+
+			if (! ctx)
+				return false;
+
+			if (EVP_PKEY_keygen_init(ctx) <= 0 ||
+			    EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) <= 0 ||
+			    EVP_PKEY_keygen(ctx, &acct->ecdsa_key) <= 0)
+			{
+				(void) EVP_PKEY_CTX_free(ctx);
+				return false;
+			}
+
+			(void) EVP_PKEY_CTX_free(ctx);
+
+			// For an EC key this is the bare (uncompressed) point, which is what o2i_ECPublicKey() reads
+			const int len = i2d_PublicKey(acct->ecdsa_key, NULL);
+
+			if (len <= 0 || (size_t) len > sizeof pubkey || i2d_PublicKey(acct->ecdsa_key, &pubkey_p) != len)
+				return false;
+			if (base64_encode(pubkey, (size_t) len, pubkey64, sizeof pubkey64) == BASE64_FAIL)
+				return false;
+
+			(void) metadata_add(acct->mu, "private:pubkey", pubkey64);
+		}
+#endif
+
+		if (bench_x25519)
+		{
+			char pubkey64[BASE64_SIZE_STR(ATHEME_ECDH_X25519_XKEY_LEN)];
+
+			if (! bench_x25519->create_keypair(acct->x25519_seckey, acct->x25519_pubkey))
+				return false;
+			if (base64_encode(acct->x25519_pubkey, sizeof acct->x25519_pubkey, pubkey64,
+			                  sizeof pubkey64) == BASE64_FAIL)
+				return false;
+
+			(void) metadata_add(acct->mu, "private:x25519pubkey", pubkey64);
+		}
+	}
+
+	return true;
+}
+
+static bool
+bench_accounts_rehash(const struct crypt_impl *const restrict ci)
+{
+	for (unsigned int i = 0; i < bench_account_count; i++)
+	{
+		struct bench_account *const acct = &bench_accounts[i];
+		const char *const hash = ci->crypt(acct->password, NULL);
+
+		if (! hash)
+		{
+			(void) fprintf(stderr, "Provider '%s' failed to hash a password\n", ci->id);
+			return false;
+		}
+
+		(void) mowgli_strlcpy(acct->mu->pass, hash, sizeof acct->mu->pass);
+	}
+
+	return true;
+}
+
+static bool
+bench_run_provider(const struct crypt_impl *const restrict ci)
+{
+	(void) printf("\nPassword crypto provider: %s (%u accounts, %u authentications per mechanism)\n",
+	              ci->id, bench_account_count, bench_rounds);
+
+	if (! bench_accounts_rehash(ci))
+		return false;
+
+	(void) printf("%-26s %8s %8s %10s %10s %10s\n", "Mechanism", "OK", "Failed", "Auth/s", "p50 (ms)",
+	              "p99 (ms)");
+	(void) printf("-------------------------- -------- -------- ---------- ---------- ----------\n");
+
+	for (size_t i = 0; i < BENCH_ARRAY_SIZE(bench_mechs); i++)
+	{
+		struct bench_result res;
+
+		if (! bench_mech_selected(&bench_mechs[i]))
+			continue;
+
+		(void) bench_run_mech(&bench_mechs[i], &res);
+		(void) bench_print_result(&bench_mechs[i], &res);
+		(void) fflush(stdout);
+		(void) sfree(res.samples);
+	}
+
+	return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	atheme_bootstrap();
+	atheme_init(argv[0], LOGDIR "/sasl-benchmark.log");
+	atheme_setup();
+
+	runflags = RF_LIVE;
+	datadir = DATADIR;
+	strict_mode = false;
+	offline_mode = true;
+	config_file = sstrdup(bench_config_file);
+
+	conf_init();
+
+	if (! conf_parse(config_file))
+	{
+		(void) fprintf(stderr, "Error loading config file %s, aborting\n", config_file);
+		return EXIT_FAILURE;
+	}
+
+	if (! module_request("saslserv/main"))
+		return EXIT_FAILURE;
+
+	/* The client side of ECDH-X25519-CHALLENGE uses the module's own key agreement routines. If it does not
+	 * load (no usable X25519 library), the mechanism is reported as not offered.
+	 */
+	if (module_request("saslserv/ecdh-x25519-challenge"))
+		bench_x25519 = module_locate_symbol("saslserv/ecdh-x25519-challenge", "ecdh_x25519_functions");
+
+	if (! uplinks.head)
+	{
+		(void) fprintf(stderr, "No uplink is configured in %s, aborting\n", config_file);
+		return EXIT_FAILURE;
+	}
+
+	// SaslServ's replies are addressed to the uplink; capture them instead
+	curr_uplink = uplinks.head->data;
+	sasl_sts = &bench_sasl_sts;
+	svslogin_sts = &bench_svslogin_sts;
+	sasl_mechlist_sts = &bench_sasl_mechlist_sts;
+
+	if (! bench_accounts_create())
+	{
+		(void) fprintf(stderr, "Failed to generate the account database, aborting\n");
+		return EXIT_FAILURE;
+	}
+
+	if (! bench_providers_count)
+	{
+		const struct crypt_impl *const ci = crypt_get_default_provider();
+
+		if (! ci)
+		{
+			(void) fprintf(stderr, "No password crypto provider is loaded, aborting\n");
+			return EXIT_FAILURE;
+		}
+
+		return bench_run_provider(ci) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < bench_providers_count; i++)
+	{
+		const struct crypt_impl *ci;
+
+		if (! module_request(bench_providers[i]) || ! (ci = crypt_get_named_provider(bench_providers[i])) ||
+		    ! ci->crypt)
+		{
+			(void) fprintf(stderr, "'%s' is not a usable password crypto provider, skipping\n",
+			                       bench_providers[i]);
+			continue;
+		}
+
+		if (! bench_run_provider(ci))
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/*
+ * SPDX-License-Identifier: ISC
+ * SPDX-URL: https://spdx.org/licenses/ISC.html
+ *
+ * Copyright (C) 2026 Atheme Development Group (https://atheme.github.io/)
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * Shared string (strshare) microbenchmark.
+ *
+ * This interns and releases strings the way user_add() and user_delete()
+ * do: every user has a unique nickname, while idents, hosts, gecos and
+ * vhosts repeat across users to varying degrees. Each round bursts the
+ * whole network in, changes nicknames for a while, and then splits every
+ * user off again in a random order.
+ */
+
+#include <atheme.h>
+#include <atheme/libathemecore.h>
+#include <ext/getopt_long.h>
+
+#ifndef MAXIMUM
+#  define MAXIMUM(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define BENCH_USERS_DEF         100000U
+#define BENCH_USERS_MAX         10000000U
+#define BENCH_ROUNDS_DEF        5U
+#define BENCH_ROUNDS_MAX        1000U
+
+// How many distinct values each field has, as a fraction of the user count
+#define BENCH_IDENT_DIV         4U
+#define BENCH_HOST_DIV          2U
+#define BENCH_GECOS_DIV         50U
+#define BENCH_VHOST_DIV         20U
+
+enum bench_field
+{
+	BENCH_NICK = 0,
+	BENCH_IDENT,
+	BENCH_HOST,
+	BENCH_GECOS,
+	BENCH_VHOST,
+	BENCH_FIELDS,
+};
+
+struct bench_user
+{
+	stringref               fields[BENCH_FIELDS];
+};
+
+static unsigned int bench_user_count = BENCH_USERS_DEF;
+static unsigned int bench_rounds = BENCH_ROUNDS_DEF;
+
+static char **bench_strings[BENCH_FIELDS];
+static char **bench_newnicks = NULL;
+static unsigned int *bench_order = NULL;
+
+static const mowgli_getopt_option_t bench_long_opts[] = {
+
+	{   "help",       no_argument, NULL, 'h', 0 },
+	{  "users", required_argument, NULL, 'u', 0 },
+	{ "rounds", required_argument, NULL, 'r', 0 },
+
+	{ NULL, 0, NULL, 0, 0 },
+};
+
+static void
+print_usage(const char *const restrict progname)
+{
+	(void) fprintf(stderr, ""
+		"\n"
+		"Usage: %s [options]\n"
+		"\n"
+		"  -h/--help                Display this help information and exit\n"
+		"  -u/--users N             Number of users on the simulated network (default: %u)\n"
+		"  -r/--rounds N            Number of burst/split rounds (default: %u)\n"
+		"\n",
+		progname, BENCH_USERS_DEF, BENCH_ROUNDS_DEF);
+}
+
+static bool
+process_uint_option(const int sw, const char *const restrict val, unsigned int *const restrict out,
+                    const unsigned int val_max)
+{
+	if (! string_to_uint(val, out) || ! *out || *out > val_max)
+	{
+		(void) fprintf(stderr, "'%s' is not a valid value for option '%c' (1 to %u)\n", val, sw, val_max);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+process_options(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = mowgli_getopt_long(argc, argv, "hr:u:", bench_long_opts, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				(void) print_usage(argv[0]);
+				exit(EXIT_SUCCESS);
+
+			case 'u':
+				if (! process_uint_option(c, mowgli_optarg, &bench_user_count, BENCH_USERS_MAX))
+					return false;
+				break;
+
+			case 'r':
+				if (! process_uint_option(c, mowgli_optarg, &bench_rounds, BENCH_ROUNDS_MAX))
+					return false;
+				break;
+
+			default:
+				(void) print_usage(argv[0]);
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+bench_clock(struct timespec *const restrict ts)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, ts) != 0)
+	{
+		(void) perror("clock_gettime(2)");
+		return false;
+	}
+
+	return true;
+}
+
+static double
+bench_elapsed(const struct timespec *const restrict begin, const struct timespec *const restrict end)
+{
+	return ((double) (end->tv_sec - begin->tv_sec)) + (((double) (end->tv_nsec - begin->tv_nsec)) / 1e9);
+}
+
+static unsigned int
+bench_distinct(const unsigned int div)
+{
+	return MAXIMUM(bench_user_count / div, 1U);
+}
+
+/* All strings are generated up front, so that only interning and
+ * releasing them is timed.
+ */
+static void
+bench_strings_create(void)
+{
+	static const unsigned int divs[BENCH_FIELDS] = {
+		[BENCH_NICK]    = 1U,
+		[BENCH_IDENT]   = BENCH_IDENT_DIV,
+		[BENCH_HOST]    = BENCH_HOST_DIV,
+		[BENCH_GECOS]   = BENCH_GECOS_DIV,
+		[BENCH_VHOST]   = BENCH_VHOST_DIV,
+	};
+
+	char buf[BUFSIZE];
+
+	for (unsigned int f = 0; f < BENCH_FIELDS; f++)
+	{
+		const unsigned int count = bench_distinct(divs[f]);
+
+		bench_strings[f] = smalloc(bench_user_count * sizeof *bench_strings[f]);
+
+		for (unsigned int i = 0; i < bench_user_count; i++)
+		{
+			const unsigned int v = (i < count) ? i : (atheme_random() % count);
+
+			switch (f)
+			{
+				case BENCH_NICK:
+					(void) snprintf(buf, sizeof buf, "Guest%u", v);
+					break;
+				case BENCH_IDENT:
+					(void) snprintf(buf, sizeof buf, "~user%u", v);
+					break;
+				case BENCH_HOST:
+					(void) snprintf(buf, sizeof buf, "%u-%u-%u.dynamic.example.net",
+					                (v >> 16) & 0xFFU, (v >> 8) & 0xFFU, v & 0xFFU);
+					break;
+				case BENCH_GECOS:
+					(void) snprintf(buf, sizeof buf, "realname number %u", v);
+					break;
+				case BENCH_VHOST:
+					(void) snprintf(buf, sizeof buf, "user/cloak-%08X", v);
+					break;
+			}
+
+			bench_strings[f][i] = sstrdup(buf);
+		}
+	}
+
+	bench_newnicks = smalloc(bench_user_count * sizeof *bench_newnicks);
+	bench_order = smalloc(bench_user_count * sizeof *bench_order);
+
+	for (unsigned int i = 0; i < bench_user_count; i++)
+	{
+		(void) snprintf(buf, sizeof buf, "Renamed%u", i);
+		bench_newnicks[i] = sstrdup(buf);
+		bench_order[i] = i;
+	}
+}
+
+static void
+bench_shuffle(void)
+{
+	for (unsigned int i = bench_user_count - 1U; i > 0; i--)
+	{
+		const unsigned int j = atheme_random_uniform(i + 1U);
+		const unsigned int tmp = bench_order[i];
+
+		bench_order[i] = bench_order[j];
+		bench_order[j] = tmp;
+	}
+}
+
+static void
+bench_report(const char *const restrict what, const size_t ops, const double secs)
+{
+	(void) printf("  %-10s %10zu ops in %8.3f s: %12.0f ops/s, %7.1f ns/op\n",
+	              what, ops, secs, ops / secs, (secs * 1e9) / ops);
+}
+
+static bool
+bench_run(void)
+{
+	struct bench_user *const users = smalloc(bench_user_count * sizeof *users);
+	double burst = 0, nick = 0, split = 0;
+	struct timespec begin, end;
+
+	for (unsigned int r = 0; r < bench_rounds; r++)
+	{
+		(void) bench_shuffle();
+
+		if (! bench_clock(&begin))
+			return false;
+
+		for (unsigned int i = 0; i < bench_user_count; i++)
+			for (unsigned int f = 0; f < BENCH_FIELDS; f++)
+				users[i].fields[f] = strshare_get(bench_strings[f][i]);
+
+		if (! bench_clock(&end))
+			return false;
+
+		burst += bench_elapsed(&begin, &end);
+
+		// Everyone changes nick and back again; each change is one unref and one get
+		if (! bench_clock(&begin))
+			return false;
+
+		for (unsigned int i = 0; i < bench_user_count; i++)
+		{
+			const unsigned int u = bench_order[i];
+
+			(void) strshare_unref(users[u].fields[BENCH_NICK]);
+			users[u].fields[BENCH_NICK] = strshare_get(bench_newnicks[u]);
+		}
+
+		for (unsigned int i = 0; i < bench_user_count; i++)
+		{
+			(void) strshare_unref(users[i].fields[BENCH_NICK]);
+			users[i].fields[BENCH_NICK] = strshare_get(bench_strings[BENCH_NICK][i]);
+		}
+
+		if (! bench_clock(&end))
+			return false;
+
+		nick += bench_elapsed(&begin, &end);
+
+		if (! bench_clock(&begin))
+			return false;
+
+		for (unsigned int i = 0; i < bench_user_count; i++)
+			for (unsigned int f = 0; f < BENCH_FIELDS; f++)
+				(void) strshare_unref(users[bench_order[i]].fields[f]);
+
+		if (! bench_clock(&end))
+			return false;
+
+		split += bench_elapsed(&begin, &end);
+	}
+
+	const size_t fieldops = (size_t) bench_rounds * bench_user_count * BENCH_FIELDS;
+	const size_t nickops = (size_t) bench_rounds * bench_user_count * 2U;
+
+	(void) printf("%u users, %u rounds\n", bench_user_count, bench_rounds);
+	(void) bench_report("burst", fieldops, burst);
+	(void) bench_report("nickchg", nickops, nick);
+	(void) bench_report("split", fieldops, split);
+
+	(void) sfree(users);
+	return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (! libathemecore_early_init())
+		return EXIT_FAILURE;
+
+	if (! process_options(argc, argv))
+		return EXIT_FAILURE;
+
+	(void) strshare_init();
+	(void) bench_strings_create();
+
+	if (! bench_run())
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}